@@ -412,6 +412,12 @@ INT32 QCALLTYPE SystemNative::GetProcessorCount()
         processorCount = systemInfo.dwNumberOfProcessors;
     }
 
+#ifdef FEATURE_PAL
+    UINT cpuLimit;
+    if (PAL_GetCpuLimit(&cpuLimit) && cpuLimit < (UINT)processorCount)
+        processorCount = cpuLimit;
+#endif // FEATURE_PAL
+
     END_QCALL;
 
     return processorCount;
@@ -253,6 +253,7 @@
 #define FireEtwBGCAllocWaitEnd(Reason, ClrInstanceID) 0
 #define FireEtwGCFullNotify(GenNumber, IsAlloc) 0
 #define FireEtwGCFullNotify_V1(GenNumber, IsAlloc, ClrInstanceID) 0
+#define FireEtwLOHFreeListStats(FreeListSpace, FreeObjSpace, FreeItemCount, LargestFreeItem, UsedBuckets, HeapIndex, ClrInstanceID) 0
 #define FireEtwEEStartupStart() 0
 #define FireEtwEEStartupStart_V1(ClrInstanceID) 0
 #define FireEtwEEStartupEnd() 0
@@ -17,6 +17,7 @@
 
 #ifndef _MSC_VER
 #define __stdcall
+#define __cdecl
 #ifdef __clang__
 #define __forceinline __attribute__((always_inline)) inline
 #else // __clang__
@@ -170,6 +171,16 @@ typedef DWORD (WINAPI *PTHREAD_START_ROUTINE)(void* lpThreadParameter);
  #endif
 #else // _MSC_VER
 
+ #if defined(_X86_) || defined(_AMD64_)
+  __forceinline void YieldProcessor() { __asm__ __volatile__ ("pause"); }
+ #elif defined(_ARM_) || defined(_ARM64_)
+  __forceinline void YieldProcessor() { __asm__ __volatile__ ("yield"); }
+ #else
+  __forceinline void YieldProcessor() { }
+ #endif
+
+  __forceinline void MemoryBarrier() { __sync_synchronize(); }
+
 #endif // _MSC_VER
 
 #endif // _INC_WINDOWS
@@ -285,7 +296,11 @@ typedef DPTR(uint8_t)   PTR_uint8_t;
 
 #define RAW_KEYWORD(x) x
 
+#ifdef _MSC_VER
 #define DECLSPEC_ALIGN(x)   __declspec(align(x))
+#else
+#define DECLSPEC_ALIGN(x)   __attribute__ ((aligned(x)))
+#endif
 
 #define OS_PAGE_SIZE 4096
 
@@ -337,23 +352,23 @@ typedef TADDR OBJECTHANDLE;
 //
 // This code is extremely compiler- and CPU-specific, and will need to be altered to 
 // support new compilers and/or CPUs.  Here we enforce that we can only compile using
-// VC++, or Clang on x86, AMD64, ARM and ARM64.
+// VC++, or Clang or GCC on x86, AMD64, ARM and ARM64.
 // 
-#if !defined(_MSC_VER) && !defined(__clang__)
-#error The Volatile type is currently only defined for Visual C++ and Clang
+#if !defined(_MSC_VER) && !defined(__GNUC__)
+#error The Volatile type is currently only defined for Visual C++, Clang and GCC
 #endif
 
-#if defined(__clang__) && !defined(_X86_) && !defined(_AMD64_) && !defined(_ARM_) && !defined(_ARM64_)
-#error The Volatile type is currently only defined for Clang when targeting x86, AMD64, ARM or ARM64 CPUs
+#if defined(__GNUC__) && !defined(_X86_) && !defined(_AMD64_) && !defined(_ARM_) && !defined(_ARM64_)
+#error The Volatile type is currently only defined for Clang and GCC when targeting x86, AMD64, ARM or ARM64 CPUs
 #endif
 
-#if defined(__clang__)
+#if defined(__GNUC__)
 #if defined(_ARM_) || defined(_ARM64_)
 // This is functionally equivalent to the MemoryBarrier() macro used on ARM on Windows.
 #define VOLATILE_MEMORY_BARRIER() asm volatile ("dmb sy" : : : "memory")
 #else
 //
-// For Clang, we prevent reordering by the compiler by inserting the following after a volatile
+// For Clang and GCC, we prevent reordering by the compiler by inserting the following after a volatile
 // load (to prevent subsequent operations from moving before the read), and before a volatile 
 // write (to prevent prior operations from moving past the write).  We don't need to do anything
 // special to prevent CPU reorderings, because the x86 and AMD64 architectures are already
@@ -558,6 +573,17 @@ public:
         UNSUPPORTED_GCConfigLogFile,
         UNSUPPORTED_BGCSpinCount,
         UNSUPPORTED_BGCSpin,
+        UNSUPPORTED_GCDynamicHeapCount,
+        UNSUPPORTED_GCLargePages,
+        UNSUPPORTED_GCSegmentPromotion,
+        UNSUPPORTED_GCGen0Adaptive,
+        UNSUPPORTED_GCTargetPauseMs,
+        UNSUPPORTED_GCAdaptiveAllocQuantum,
+        UNSUPPORTED_GCLOHCompactBudget,
+        UNSUPPORTED_GCMarkPrefetchDepth,
+        UNSUPPORTED_GCHeapSnapshotFile,
+        UNSUPPORTED_GCHeapSnapshotInterval,
+        UNSUPPORTED_GCDecommitTimeWindow,
         EXTERNAL_GCStressStart,
         INTERNAL_GCStressStartAtJit,
         INTERNAL_DbgDACSkipVerifyDlls,
@@ -76,6 +76,10 @@ public:
     static alloc_context * GetAllocContext(Thread * pThread);
     static bool CatchAtSafePoint(Thread * pThread);
 
+    // Returns true if the current thread is a GC thread or the thread that suspended the EE,
+    // i.e. if the runtime is known to be suspended while this thread runs.
+    static bool IsGCThread();
+
     static void GcEnumAllocContexts(enum_alloc_context_func* fn, void* param);
 
     static void AttachCurrentThread(); // does not acquire thread store lock
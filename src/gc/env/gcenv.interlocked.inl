@@ -56,7 +56,7 @@ __forceinline T Interlocked::Exchange(T volatile *destination, T value)
     static_assert(sizeof(long) == sizeof(T), "Size of long must be the same as size of T");
     return _InterlockedExchange((long*)destination, value);
 #else
-    return __sync_swap(destination, value);
+    return __atomic_exchange_n(destination, value, __ATOMIC_SEQ_CST);
 #endif
 }
 
@@ -142,7 +142,7 @@ __forceinline T Interlocked::ExchangePointer(T volatile * destination, T value)
     return (T)(TADDR)_InterlockedExchange((long volatile *)(void* volatile *)destination, (long)(void*)value);
 #endif
 #else
-    return (T)(TADDR)__sync_swap((void* volatile *)destination, value);
+    return (T)(TADDR)__atomic_exchange_n((void* volatile *)destination, (void*)value, __ATOMIC_SEQ_CST);
 #endif
 }
 
@@ -156,7 +156,7 @@ __forceinline T Interlocked::ExchangePointer(T volatile * destination, std::null
     return (T)(TADDR)_InterlockedExchange((long volatile *)(void* volatile *)destination, (long)(void*)value);
 #endif
 #else
-    return (T)(TADDR)__sync_swap((void* volatile *)destination, value);
+    return (T)(TADDR)__atomic_exchange_n((void* volatile *)destination, (void*)value, __ATOMIC_SEQ_CST);
 #endif
 }
 
@@ -31,9 +31,17 @@ public:
     void ClrGCBit() { m_uSyncBlockValue &= ~BIT_SBLK_GC_RESERVE; }
 };
 
-#define MTFlag_ContainsPointers 1
-#define MTFlag_HasFinalizer 2
-#define MTFlag_IsArray 4
+// The flags are at the same positions as in the high 16 bits of the runtime's
+// MethodTable flags (m_componentSize and m_flags together overlay its m_dwFlags),
+// so a GC built as a separate library (see gcinterface.h) can read the runtime's
+// method tables.
+#define MTFlag_ContainsPointers     0x0100
+#define MTFlag_HasFinalizer         0x0010
+#define MTFlag_HasCriticalFinalizer 0x0800
+#define MTFlag_Collectible          0x1000
+#define MTFlag_HasComponentSize     0x8000
+#define MTFlag_Category_Array       0x0008
+#define MTFlag_Category_Array_Mask  0x000C
 
 class MethodTable
 {
@@ -49,7 +57,7 @@ public:
     {
         m_baseSize = 3 * sizeof(void *);
         m_componentSize = 1;
-        m_flags = 0;
+        m_flags = MTFlag_HasComponentSize;
     }
 
     uint32_t GetBaseSize()
@@ -74,7 +82,7 @@ public:
 
     bool HasComponentSize()
     {
-        return m_componentSize != 0;
+        return (m_flags & MTFlag_HasComponentSize) != 0;
     }
 
     bool HasFinalizer()
@@ -84,12 +92,12 @@ public:
 
     bool HasCriticalFinalizer()
     {
-        return false;
+        return (m_flags & MTFlag_HasCriticalFinalizer) != 0;
     }
 
     bool IsArray()
     {
-        return (m_flags & MTFlag_IsArray) != 0;
+        return (m_flags & MTFlag_Category_Array_Mask) == MTFlag_Category_Array;
     }
 
     MethodTable * GetParent()
@@ -33,6 +33,9 @@ struct VirtualReserveFlags
     {
         None = 0,
         WriteWatch = 1,
+        // Ask the OS to back the range with large pages. Only used when GetLargePageSize
+        // returns non zero.
+        LargePages = 2,
     };
 };
 
@@ -115,6 +118,12 @@ public:
     //  true if it has succeeded, false if it has failed
     static bool VirtualReset(void *address, size_t size, bool unlock);
 
+    // Get the size of the large pages VirtualReserve can back memory with when passed
+    // VirtualReserveFlags::LargePages.
+    // Return:
+    //  The large page size, or 0 if large pages are not supported
+    static size_t GetLargePageSize();
+
     //
     // Write watching
     //
@@ -67,9 +67,20 @@ BOOL bgc_heap_walk_for_etw_p = FALSE;
 #define MARK_STACK_INITIAL_LENGTH 128
 #endif // BIT64
 
+// Upper bound for GCMarkPrefetchDepth.
+#define MARK_PREFETCH_MAX_DEPTH 32
+
 #define LOH_PIN_QUEUE_LENGTH 100
 #define LOH_PIN_DECAY 10
 
+// Incremental LOH compaction is only done on a heap whose LOH free space is
+// at least this percentage of its LOH size.
+#define LOH_INCREMENTAL_COMPACT_FRAG_PERCENT 20
+
+// With GCSegmentPromotion a full ephemeral segment is promoted in place only when the
+// ephemeral survivors take up at least this fraction of it.
+#define SEGMENT_PROMOTION_EPH_FRACTION 8
+
 // Right now we support maximum 256 procs - meaning that we will create at most
 // 256 GC threads and 256 GC heaps. 
 #define MAX_SUPPORTED_CPUS 256
@@ -121,7 +132,9 @@ static const char* const str_gc_reasons[] =
     "induced_noforce",
     "gcstress",
     "induced_lowmem",
-    "induced_compacting"
+    "induced_compacting",
+    "lowmem_host",
+    "idle"
 };
 
 static const char* const str_gc_pause_modes[] = 
@@ -597,7 +610,9 @@ enum gc_join_stage
     gc_join_after_commit_soh_no_gc = 35,
     gc_join_expand_loh_no_gc = 36,
     gc_join_final_no_gc = 37,
-    gc_join_max = 38
+    gc_join_after_loh_sweep = 38,
+    gc_join_after_heap_snapshot = 39,
+    gc_join_max = 40
 };
 
 enum gc_join_flavor
@@ -1435,19 +1450,21 @@ void reset_memory (uint8_t* o, size_t sizeo);
 
 #ifdef WRITE_WATCH
 
+#ifndef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
 static bool virtual_alloc_write_watch = false;
+#endif // !FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
 
-static bool write_watch_capability = false;
+static bool hardware_write_watch_capability = false;
 
 #ifndef DACCESS_COMPILE
 
 //check if the write watch APIs are supported.
 
-void write_watch_api_supported()
+void hardware_write_watch_api_supported()
 {
     if (GCToOSInterface::SupportsWriteWatch())
     {
-        write_watch_capability = true;
+        hardware_write_watch_capability = true;
         dprintf (2, ("WriteWatch supported"));
     }
     else
@@ -1458,9 +1475,41 @@ void write_watch_api_supported()
 
 #endif //!DACCESS_COMPILE
 
-inline bool can_use_write_watch()
+inline bool can_use_hardware_write_watch()
+{
+    return hardware_write_watch_capability;
+}
+
+// Write watch on the GC heap is what background GC needs; it is provided by the
+// OS or, on platforms without OS support, by the write barrier (software write watch).
+inline bool can_use_write_watch_for_gc_heap()
+{
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    return true;
+#else // !FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    return can_use_hardware_write_watch();
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+}
+
+// Card bundles are maintained with write watch on the card table itself, which
+// the write barrier does not track, so they need OS support - unless the write
+// barrier sets the card bundles along with the cards.
+inline bool can_use_write_watch_for_card_table()
 {
-    return write_watch_capability;
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    return false;
+#else //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    return can_use_hardware_write_watch();
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+}
+
+inline bool can_use_card_bundles()
+{
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    return true;
+#else //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    return can_use_write_watch_for_card_table();
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
 }
 
 #else
@@ -2054,6 +2103,15 @@ uint8_t* gc_heap::pad_for_alignment_large (uint8_t* newAlloc, int requiredAlignm
 #define CLR_SIZE ((size_t)(8*1024))
 #endif //SERVER_GC
 
+// With GCAdaptiveAllocQuantum an alloc context's quantum is sized so it would be refilled
+// about ALLOC_QUANTUM_REFILLS_PER_GC times between GCs at the rate it allocated since the
+// previous GC. It at most halves or doubles per GC and stays within these bounds. When it's
+// used it's also capped by alloc_quantum_limit, the same share of the gen0 budget that
+// allocation_quantum gets.
+#define MIN_ALLOC_QUANTUM ((size_t)1024)
+#define MAX_ALLOC_QUANTUM (CLR_SIZE * 8)
+#define ALLOC_QUANTUM_REFILLS_PER_GC 16
+
 #define END_SPACE_AFTER_GC (LARGE_OBJECT_SIZE + MAX_STRUCTALIGN)
 
 #ifdef BACKGROUND_GC
@@ -2126,6 +2184,15 @@ uint8_t* align_on_page (uint8_t* add)
     return (uint8_t*)align_on_page ((size_t) add);
 }
 
+// Only valid when we are using large pages. To have the OS back memory with large pages we 
+// commit and decommit whole large pages.
+inline
+uint8_t* align_on_large_page (uint8_t* add)
+{
+    assert (gc_heap::large_page_size != 0);
+    return (uint8_t*)(((size_t)add + gc_heap::large_page_size - 1) & ~(gc_heap::large_page_size - 1));
+}
+
 inline
 size_t align_lower_page (size_t add)
 {
@@ -2249,6 +2316,12 @@ CLREvent    gc_heap::gc_start_event;
 SVAL_IMPL_NS(int, SVR, gc_heap, n_heaps);
 SPTR_IMPL_NS(PTR_gc_heap, SVR, gc_heap, g_heaps);
 
+int         gc_heap::n_active_heaps = 0;
+
+bool        gc_heap::dynamic_heap_count_p = false;
+
+gc_heap::dynamic_heap_count_data_t gc_heap::dynamic_heap_count_data;
+
 size_t*     gc_heap::g_promoted;
 
 #ifdef MH_SC_MARK
@@ -2286,6 +2359,18 @@ size_t      gc_heap::gc_last_ephemeral_decommit_time = 0;
 
 size_t      gc_heap::gc_gen0_desired_high;
 
+size_t      gc_heap::decommit_time_window = 0;
+
+size_t      gc_heap::standby_decommit_time = 0;
+
+BOOL        gc_heap::standby_decommit_pending_p = FALSE;
+
+// How long (ms) no GC needs to happen before we do an idle GC, when something 
+// wants idle GCs.
+#define IDLE_GC_INTERVAL 5000
+
+size_t      gc_heap::idle_gc_interval = 0;
+
 #ifdef SHORT_PLUGS
 double       gc_heap::short_plugs_pad_ratio = 0;
 #endif //SHORT_PLUGS
@@ -2311,6 +2396,34 @@ uint64_t    gc_heap::entry_available_physical_mem;
 
 bool        gc_heap::restricted_physical_memory_p = false;
 
+size_t      gc_heap::heap_hard_limit = 0;
+
+size_t      gc_heap::current_total_committed = 0;
+
+size_t      gc_heap::hard_limit_max_seg_size = 0;
+
+size_t      gc_heap::large_page_size = 0;
+
+BOOL        gc_heap::segment_promotion_p = FALSE;
+
+BOOL        gc_heap::gen0_tuning_p = FALSE;
+
+BOOL        gc_heap::adaptive_alloc_quantum_p = FALSE;
+
+uint64_t    gc_heap::target_pause_us = 0;
+
+#ifdef FEATURE_PREMORTEM_FINALIZATION
+BOOL        gc_heap::finalization_backed_up_p = FALSE;
+#endif //FEATURE_PREMORTEM_FINALIZATION
+
+gc_heap::gen0_tuning_data_t gc_heap::gen0_tuning_data;
+
+uint64_t    gc_heap::pause_cost_per_mb[max_generation + 1][2];
+
+int         gc_heap::gen2_deferred_count = 0;
+
+CLRCriticalSection gc_heap::check_commit_cs;
+
 #ifdef BACKGROUND_GC
 CLREvent    gc_heap::bgc_start_event;
 
@@ -2346,6 +2459,8 @@ SVAL_IMPL_NS_INIT(gc_heap::c_gc_state, WKS, gc_heap, current_c_gc_state, c_gc_st
 VOLATILE(gc_heap::c_gc_state) gc_heap::current_c_gc_state = c_gc_state_free;
 #endif //DACCESS_COMPILE && !MULTIPLE_HEAPS
 
+VOLATILE(BOOL) gc_heap::bgc_loh_swept_p = FALSE;
+
 #endif //BACKGROUND_GC
 
 #ifndef MULTIPLE_HEAPS
@@ -2380,6 +2495,14 @@ BOOL        gc_heap::ro_segments_in_range;
 
 size_t      gc_heap::gen0_big_free_spaces = 0;
 
+size_t      gc_heap::decommit_peak_slack = 0;
+
+size_t      gc_heap::decommit_peak_time = 0;
+
+size_t      gc_heap::decommit_last_step_time = 0;
+
+BOOL        gc_heap::decommit_pending_p = FALSE;
+
 uint8_t*    gc_heap::lowest_address;
 
 uint8_t*    gc_heap::highest_address;
@@ -2600,9 +2723,31 @@ size_t gc_heap::time_since_init = 0;
 size_t gc_heap::compact_or_sweep_gcs[2];
 #endif //GC_CONFIG_DRIVEN
 
+int           gc_heap::mark_prefetch_depth = 0;
+
+TCHAR*        gc_heap::heap_snapshot_file_name = NULL;
+uint32_t      gc_heap::heap_snapshot_interval = 0;
+VOLATILE(BOOL) gc_heap::heap_snapshot_requested_p = FALSE;
+size_t        gc_heap::heap_snapshot_gen2_count = 0;
+size_t        gc_heap::heap_snapshot_count = 0;
+BOOL          gc_heap::heap_snapshot_p = FALSE;
+VOLATILE(heap_snapshot_file*) gc_heap::heap_snapshot_pending = NULL;
+
+gc_info_record gc_heap::gc_info_records[max_gc_info_records];
+int32_t       gc_heap::gc_info_record_seq[max_gc_info_records];
+int32_t       gc_heap::gc_info_record_count = 0;
+int64_t       gc_heap::gc_info_start_ts = 0;
+#ifdef BACKGROUND_GC
+int64_t       gc_heap::bgc_info_start_ts = 0;
+int64_t       gc_heap::bgc_loh_alloc_blocked_start_ts = 0;
+uint64_t      gc_heap::bgc_loh_alloc_blocked_time = 0;
+#endif //BACKGROUND_GC
+
 #ifdef FEATURE_LOH_COMPACTION
 BOOL                   gc_heap::loh_compaction_always_p = FALSE;
 gc_loh_compaction_mode gc_heap::loh_compaction_mode = loh_compaction_default;
+size_t                 gc_heap::loh_compaction_budget = 0;
+BOOL                   gc_heap::loh_compaction_incremental_p = FALSE;
 int                    gc_heap::loh_pinned_queue_decay = LOH_PIN_DECAY;
 
 #endif //FEATURE_LOH_COMPACTION
@@ -2649,17 +2794,20 @@ GARY_IMPL(size_t, interesting_mechanism_bits_per_heap, max_gc_mechanism_bits_cou
 
 #ifndef MULTIPLE_HEAPS
 
-alloc_list gc_heap::loh_alloc_list [NUM_LOH_ALIST-1];
+alloc_list gc_heap::loh_alloc_list [NUM_LOH_ALIST_BUCKETS-1];
 alloc_list gc_heap::gen2_alloc_list[NUM_GEN2_ALIST-1];
 
 dynamic_data gc_heap::dynamic_data_table [NUMBERGENERATIONS+1];
 gc_history_per_heap gc_heap::gc_data_per_heap;
+gc_info_heap_record gc_heap::gc_info_heap_records[max_gc_info_records];
 size_t gc_heap::maxgen_pinned_compact_before_advance = 0;
 
 SPTR_IMPL_NS_INIT(uint8_t, WKS, gc_heap, alloc_allocated, 0);
 
 size_t gc_heap::allocation_quantum = CLR_SIZE;
 
+size_t gc_heap::alloc_quantum_limit = MAX_ALLOC_QUANTUM;
+
 GCSpinLock gc_heap::more_space_lock;
 
 #ifdef SYNCHRONIZATION_STATS
@@ -2874,6 +3022,132 @@ void gc_heap::fire_pevents()
 #endif //!CORECLR
 }
 
+void gc_heap::record_phase_time (gc_phase phase, int64_t start_ts)
+{
+    uint64_t elapsed_us = ((GCToOSInterface::QueryPerformanceCounter() - start_ts) * 1000000) / qpf;
+    get_gc_data_per_heap()->phase_time[phase] += elapsed_us;
+}
+
+// This is called at the end of each GC by the thread that fires the per GC events; unlike
+// those events the records are kept in process so they can be read with GetGCInfoRecords
+// without any tracing. A BGC and an FGC during it can record at the same time so each 
+// reserves its own slot.
+void gc_heap::record_gc_info()
+{
+    int32_t r = Interlocked::Increment (&gc_info_record_count) - 1;
+    int slot = r % max_gc_info_records;
+    Interlocked::Exchange (&gc_info_record_seq[slot], 0);
+
+    gc_info_record* record = &gc_info_records[slot];
+    int64_t start_ts = gc_info_start_ts;
+    record->loh_alloc_blocked_time = 0;
+#ifdef BACKGROUND_GC
+    if (settings.concurrent)
+    {
+        start_ts = bgc_info_start_ts;
+        record->loh_alloc_blocked_time = bgc_loh_alloc_blocked_time;
+    }
+#endif //BACKGROUND_GC
+
+    record->index = settings.gc_index;
+    record->duration = ((GCToOSInterface::QueryPerformanceCounter() - start_ts) * 1000000) / qpf;
+    record->generation = settings.condemned_generation;
+    record->reason = settings.reason;
+    record->flags = (settings.compaction ? GC_INFO_COMPACTING : 0) | 
+                    (settings.concurrent ? GC_INFO_CONCURRENT : 0);
+
+#ifdef MULTIPLE_HEAPS
+    record->heap_count = gc_heap::n_heaps;
+    for (int i = 0; i < gc_heap::n_heaps; i++)
+    {
+        gc_heap* hp = gc_heap::g_heaps[i];
+#else //MULTIPLE_HEAPS
+    record->heap_count = 1;
+    {
+        gc_heap* hp = pGenGCHeap;
+        int i = 0;
+#endif //MULTIPLE_HEAPS
+        gc_history_per_heap* current_gc_data_per_heap = hp->get_gc_data_per_heap();
+        gc_info_heap_record* heap_record = &hp->gc_info_heap_records[slot];
+
+        heap_record->mark_time = current_gc_data_per_heap->phase_time[gc_phase_mark];
+        heap_record->plan_time = current_gc_data_per_heap->phase_time[gc_phase_plan];
+        heap_record->relocate_time = current_gc_data_per_heap->phase_time[gc_phase_relocate];
+        heap_record->compact_time = current_gc_data_per_heap->phase_time[gc_phase_compact];
+        heap_record->sweep_time = current_gc_data_per_heap->phase_time[gc_phase_sweep];
+        heap_record->pinned_plug_count = (uint32_t)current_gc_data_per_heap->pinned_plug_count;
+        heap_record->compact_reason = current_gc_data_per_heap->get_mechanism (gc_heap_compact);
+
+#ifdef BACKGROUND_GC
+        if (settings.concurrent)
+        {
+            heap_record->promoted_bytes = bpromoted_bytes (i);
+        }
+        else
+#endif //BACKGROUND_GC
+        {
+            heap_record->promoted_bytes = promoted_bytes (i);
+        }
+
+        uint64_t fragmentation = 0;
+        for (int gen_number = 0; gen_number <= (max_generation + 1); gen_number++)
+        {
+            generation* gen = hp->generation_of (gen_number);
+            fragmentation += generation_free_list_space (gen) + generation_free_obj_space (gen);
+        }
+        heap_record->fragmentation = fragmentation;
+    }
+
+    dprintf (2, ("GC#%Id info record %d: gen%d, %I64dus", 
+        (size_t)record->index, r, record->generation, record->duration));
+
+    VolatileStore (&gc_info_record_seq[slot], (int32_t)(r + 1));
+}
+
+// Copies out the most recent records. The GC may be writing a record while we read it so
+// we check its sequence number before and after the copy and skip it if it changed.
+int gc_heap::get_gc_info_records (gc_info_record* records, gc_info_heap_record* heap_records, int max_records)
+{
+    int32_t count = VolatileLoad (&gc_info_record_count);
+    int num_records = min (min (count, max_records), max_gc_info_records);
+    int num_heaps = 1;
+#ifdef MULTIPLE_HEAPS
+    num_heaps = gc_heap::n_heaps;
+#endif //MULTIPLE_HEAPS
+
+    int copied = 0;
+    for (int32_t r = count - 1; (r >= 0) && (r >= count - num_records); r--)
+    {
+        int slot = r % max_gc_info_records;
+        if (VolatileLoad (&gc_info_record_seq[slot]) != (r + 1))
+        {
+            continue;
+        }
+
+        records[copied] = gc_info_records[slot];
+        gc_info_heap_record* heap_record = &heap_records[copied * num_heaps];
+        for (int i = 0; i < num_heaps; i++)
+        {
+#ifdef MULTIPLE_HEAPS
+            gc_heap* hp = gc_heap::g_heaps[i];
+#else //MULTIPLE_HEAPS
+            gc_heap* hp = pGenGCHeap;
+#endif //MULTIPLE_HEAPS
+            heap_record[i] = hp->gc_info_heap_records[slot];
+        }
+
+        MemoryBarrier();
+        if (VolatileLoad (&gc_info_record_seq[slot]) != (r + 1))
+        {
+            continue;
+        }
+
+        copied++;
+    }
+
+    return copied;
+}
+
 inline BOOL
 gc_heap::dt_low_ephemeral_space_p (gc_tuning_point tp)
 {
@@ -4255,8 +4529,18 @@ void* virtual_alloc (size_t size)
         }
     }
 
+#ifndef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
     uint32_t flags = virtual_alloc_write_watch ? VirtualReserveFlags::WriteWatch : VirtualReserveFlags::None;
-    void* prgmem = GCToOSInterface::VirtualReserve (0, requested_size, card_size * card_word_width, flags);
+#else // !FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    uint32_t flags = VirtualReserveFlags::None;
+#endif // !FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    size_t alignment = card_size * card_word_width;
+    if (gc_heap::large_page_size)
+    {
+        flags |= VirtualReserveFlags::LargePages;
+        alignment = max (alignment, gc_heap::large_page_size);
+    }
+    void* prgmem = GCToOSInterface::VirtualReserve (0, requested_size, alignment, flags);
     void *aligned_mem = prgmem;
 
     // We don't want (prgmem + size) to be right at the end of the address space 
@@ -4335,7 +4619,14 @@ static size_t get_valid_segment_size (BOOL large_seg=FALSE)
         if ((seg_size >> 1) && !(seg_size >> 22))
             seg_size = 1024*1024*4;
         else
+        {
             seg_size = initial_seg_size;
+
+            // With a hard limit the default segments would be way bigger than what 
+            // each heap is allowed to commit.
+            if (gc_heap::hard_limit_max_seg_size)
+                seg_size = min (seg_size, gc_heap::hard_limit_max_seg_size);
+        }
     }
 
     return (seg_size);
@@ -4396,7 +4687,10 @@ gc_heap::soh_get_segment_to_expand()
     //compute the size of the new ephemeral heap segment.
     compute_new_ephemeral_size();
 
-    if ((settings.pause_mode != pause_low_latency) &&
+    // With segment promotion we never reuse an existing segment as the new ephemeral 
+    // segment; the old one may be promoted in place instead.
+    if (!segment_promotion_p &&
+        (settings.pause_mode != pause_low_latency) &&
         (settings.pause_mode != pause_no_gc)
 #ifdef BACKGROUND_GC
         && (!recursive_gc_sync::background_running_p())
@@ -4649,6 +4943,10 @@ void release_segment (heap_segment* sg)
 {
     ptrdiff_t delta = 0;
     FireEtwGCFreeSegment_V1((size_t)heap_segment_mem(sg), GetClrInstanceId());
+    if (gc_heap::heap_hard_limit)
+    {
+        gc_heap::release_committed_bytes (heap_segment_committed (sg) - (uint8_t*)sg);
+    }
     virtual_free (sg, (uint8_t*)heap_segment_reserved (sg)-(uint8_t*)sg);
 }
 
@@ -4696,7 +4994,7 @@ void gc_heap::thread_loh_segment (heap_segment* new_seg)
 }
 
 heap_segment*
-gc_heap::get_large_segment (size_t size, BOOL* did_full_compact_gc)
+gc_heap::get_large_segment (size_t size, BOOL poh_p, BOOL* did_full_compact_gc)
 {
     *did_full_compact_gc = FALSE;
     size_t last_full_compact_gc_count = get_full_compact_gc_count();
@@ -4718,7 +5016,7 @@ gc_heap::get_large_segment (size_t size, BOOL* did_full_compact_gc)
     }
 
 #ifdef BACKGROUND_GC
-    while (current_c_gc_state == c_gc_state_planning)
+    while (bgc_loh_alloc_blocked_p())
     {
         dprintf (3, ("lh state planning, waiting to get a large seg"));
 
@@ -4729,7 +5027,8 @@ gc_heap::get_large_segment (size_t size, BOOL* did_full_compact_gc)
         dprintf (SPINLOCK_LOG, ("[%d]Seg: P, Egc", heap_number));
     }
     assert ((current_c_gc_state == c_gc_state_free) ||
-            (current_c_gc_state == c_gc_state_marking));
+            (current_c_gc_state == c_gc_state_marking) ||
+            bgc_loh_swept_p);
 #endif //BACKGROUND_GC
 
     heap_segment* res = get_segment_for_loh (size
@@ -4738,6 +5037,21 @@ gc_heap::get_large_segment (size_t size, BOOL* did_full_compact_gc)
 #endif //MULTIPLE_HEAPS
                                             );
 
+#ifdef BACKGROUND_GC
+    if (res && (current_c_gc_state == c_gc_state_planning))
+    {
+        // We only get here during bgc sweep after LOH is swept, so like new
+        // SOH segs gotten during bgc sweep this seg is already swept.
+        res->flags |= heap_segment_flags_swept;
+    }
+#endif //BACKGROUND_GC
+
+    if (res && poh_p)
+    {
+        res->flags |= heap_segment_flags_poh;
+        dprintf (2, ("h%d: new POH seg %Ix", heap_number, (size_t)res));
+    }
+
     dprintf (SPINLOCK_LOG, ("[%d]Seg: A Lgc", heap_number));
     leave_spin_lock (&gc_heap::gc_lock);
     enter_spin_lock (&more_space_lock);
@@ -4913,7 +5227,7 @@ public:
     static int select_heap(alloc_context* acontext, int hint)
     {
         if (GCToOSInterface::CanGetCurrentProcessorNumber())
-            return proc_no_to_heap_no[GCToOSInterface::GetCurrentProcessorNumber() % gc_heap::n_heaps];
+            return (proc_no_to_heap_no[GCToOSInterface::GetCurrentProcessorNumber() % gc_heap::n_heaps] % gc_heap::n_active_heaps);
 
         unsigned sniff_index = Interlocked::Increment(&cur_sniff_index);
         sniff_index %= n_sniff_buffers;
@@ -4924,7 +5238,7 @@ public:
 
         uint8_t *l_sniff_buffer = sniff_buffer;
         unsigned l_n_sniff_buffers = n_sniff_buffers;
-        for (int heap_number = 0; heap_number < gc_heap::n_heaps; heap_number++)
+        for (int heap_number = 0; heap_number < gc_heap::n_active_heaps; heap_number++)
         {
             int this_access_time = access_time(l_sniff_buffer, heap_number, sniff_index, l_n_sniff_buffers);
             if (this_access_time < best_access_time)
@@ -5258,6 +5572,8 @@ void gc_heap::gc_thread_function ()
             END_TIMING(restart_ee_during_log);
             process_sync_log_stats();
 
+            flush_heap_snapshot();
+
             dprintf (SPINLOCK_LOG, ("GC Lgc"));
             leave_spin_lock (&gc_heap::gc_lock);
 
@@ -5308,6 +5624,59 @@ bool virtual_alloc_commit_for_heap(void* addr, size_t size, int h_number)
     return GCToOSInterface::VirtualCommit(addr, size);
 }
 
+// Commits memory for a heap segment. When there's a hard limit on the heap this also does
+// the accounting and fails the commit if it would take us over the limit.
+bool gc_heap::virtual_commit (void* address, size_t size, int h_number)
+{
+    if (heap_hard_limit)
+    {
+        bool exceeded_p = false;
+
+        check_commit_cs.Enter();
+        if ((current_total_committed + size) > heap_hard_limit)
+        {
+            exceeded_p = true;
+        }
+        else
+        {
+            current_total_committed += size;
+        }
+        check_commit_cs.Leave();
+
+        if (exceeded_p)
+        {
+            dprintf (1, ("committing %Id would exceed the hard limit %Id (%Id already committed)",
+                size, heap_hard_limit, current_total_committed));
+            return false;
+        }
+    }
+
+    bool commit_succeeded_p = virtual_alloc_commit_for_heap (address, size, h_number);
+
+    if (!commit_succeeded_p && heap_hard_limit)
+    {
+        release_committed_bytes (size);
+    }
+
+    return commit_succeeded_p;
+}
+
+void gc_heap::virtual_decommit (void* address, size_t size)
+{
+    if (GCToOSInterface::VirtualDecommit (address, size) && heap_hard_limit)
+    {
+        release_committed_bytes (size);
+    }
+}
+
+void gc_heap::release_committed_bytes (size_t size)
+{
+    check_commit_cs.Enter();
+    assert (current_total_committed >= size);
+    current_total_committed -= size;
+    check_commit_cs.Leave();
+}
+
 #ifndef SEG_MAPPING_TABLE
 inline
 heap_segment* gc_heap::segment_of (uint8_t* add, ptrdiff_t& delta, BOOL verify_p)
@@ -5729,8 +6098,16 @@ void gc_heap::fix_allocation_context (alloc_context* acontext, BOOL for_gc_p,
             {
                 generation_free_obj_space (generation_of (0)) += size;
                 alloc_contexts_used ++;
+                adapt_alloc_quantum (acontext, size);
             }
         }
+        else if (for_gc_p)
+        {
+            // The context didn't allocate since the last GC retired it. Its count
+            // still has to start over here or what it allocated before that GC
+            // would be counted again when it is next retired.
+            acontext->alloc_bytes_last_gc = acontext->alloc_bytes;
+        }
     }
     else if (for_gc_p)
     {
@@ -5738,6 +6115,8 @@ void gc_heap::fix_allocation_context (alloc_context* acontext, BOOL for_gc_p,
         assert (heap_segment_allocated (ephemeral_heap_segment) <=
                 heap_segment_committed (ephemeral_heap_segment));
         alloc_contexts_used ++;
+        adapt_alloc_quantum (acontext, 
+            (acontext->alloc_limit - acontext->alloc_ptr) + Align (min_obj_size, align_const));
     }
 
 
@@ -5748,6 +6127,31 @@ void gc_heap::fix_allocation_context (alloc_context* acontext, BOOL for_gc_p,
     }
 }
 
+// Called when a GC retires an alloc context that still had unused_size bytes left. A context
+// that hardly allocated since the previous GC held on to space that now becomes a free object 
+// in gen0 so we give it less next time, while one that allocated a lot gets more so it goes 
+// through allocate_more_space less often.
+void gc_heap::adapt_alloc_quantum (alloc_context* acontext, size_t unused_size)
+{
+    int64_t allocated = acontext->alloc_bytes - acontext->alloc_bytes_last_gc - (int64_t)unused_size;
+    acontext->alloc_bytes_last_gc = acontext->alloc_bytes;
+
+    if (!adaptive_alloc_quantum_p)
+    {
+        return;
+    }
+
+    size_t old_quantum = ((acontext->alloc_quantum != 0) ? acontext->alloc_quantum : allocation_quantum);
+    size_t new_quantum = (size_t)max (allocated, (int64_t)0) / ALLOC_QUANTUM_REFILLS_PER_GC;
+    new_quantum = max (new_quantum, old_quantum / 2);
+    new_quantum = min (new_quantum, old_quantum * 2);
+    new_quantum = min (max (new_quantum, MIN_ALLOC_QUANTUM), MAX_ALLOC_QUANTUM);
+    acontext->alloc_quantum = Align (new_quantum, get_alignment_constant (TRUE));
+
+    dprintf (3, ("alloc context %Ix allocated %I64d, %Id left, quantum %Id->%Id",
+                 (size_t)acontext, allocated, unused_size, old_quantum, acontext->alloc_quantum));
+}
+
 //used by the heap verification for concurrent gc.
 //it nulls out the words set by fix_allocation_context for heap_verification
 void repair_allocation (alloc_context* acontext, void*)
@@ -6364,11 +6768,20 @@ void gc_heap::clear_card (size_t card)
               (size_t)card_address (card+1)));
 }
 
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+size_t cardw_card_bundle (size_t cardw);
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+
 inline
 void gc_heap::set_card (size_t card)
 {
     card_table [card_word (card)] =
         (card_table [card_word (card)] | (1 << card_bit (card)));
+
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    // Nothing else sets the bundle of a card the GC sets.
+    card_bundle_set (cardw_card_bundle (card_word (card)));
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
 }
 
 inline
@@ -6404,6 +6817,13 @@ size_t size_card_of (uint8_t* from, uint8_t* end)
 //how do we express the fact that 32 bits (card_word_width) is one uint32_t?
 #define card_bundle_size ((size_t)(OS_PAGE_SIZE/(sizeof (uint32_t)*card_bundle_word_width)))
 
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+// The write barrier sets a whole byte, i.e. 8 card bundles, of the card bundle
+// table for each card it sets, so the byte has to cover what it assumes.
+static_assert((card_size*card_word_width*card_bundle_size*8) == ((size_t)1 << CARD_BUNDLE_AddressToTableByteIndexShift),
+              "Unexpected card bundle size");
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+
 inline
 size_t card_bundle_word (size_t cardb)
 {
@@ -6433,12 +6853,42 @@ size_t card_bundle_cardw (size_t cardb)
 
 void gc_heap::card_bundle_clear(size_t cardb)
 {
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    // Other heaps may be setting bundles in the same word.
+    Interlocked::And (&card_bundle_table [card_bundle_word (cardb)], ~(1u << card_bundle_bit (cardb)));
+#else //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
     card_bundle_table [card_bundle_word (cardb)] &= ~(1 << card_bundle_bit (cardb));
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
     dprintf (3,("Cleared card bundle %Ix [%Ix, %Ix[", cardb, (size_t)card_bundle_cardw (cardb),
               (size_t)card_bundle_cardw (cardb+1)));
 //    printf ("Cleared card bundle %Ix\n", cardb);
 }
 
+void gc_heap::card_bundle_set (size_t cardb)
+{
+    if (!card_bundle_set_p (cardb))
+    {
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+        Interlocked::Or (&card_bundle_table [card_bundle_word (cardb)], (1u << card_bundle_bit (cardb)));
+#else //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+        card_bundle_table [card_bundle_word (cardb)] |= (1 << card_bundle_bit (cardb));
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    }
+}
+
+// With manually managed card bundles the partial words may be shared with other
+// heaps (or with the write barrier) setting bundles at the same time, so they're
+// updated with interlocked operations.
+inline
+void set_card_bundle_bits (uint32_t* bundle_word, uint32_t bits)
+{
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    Interlocked::Or (bundle_word, bits);
+#else //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    *bundle_word |= bits;
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+}
+
 void gc_heap::card_bundles_set (size_t start_cardb, size_t end_cardb)
 {
     size_t start_word = card_bundle_word (start_cardb);
@@ -6446,10 +6896,10 @@ void gc_heap::card_bundles_set (size_t start_cardb, size_t end_cardb)
     if (start_word < end_word)
     {
         //set the partial words
-        card_bundle_table [start_word] |= highbits (~0u, card_bundle_bit (start_cardb));
+        set_card_bundle_bits (&card_bundle_table [start_word], highbits (~0u, card_bundle_bit (start_cardb)));
 
         if (card_bundle_bit (end_cardb))
-            card_bundle_table [end_word] |= lowbits (~0u, card_bundle_bit (end_cardb));
+            set_card_bundle_bits (&card_bundle_table [end_word], lowbits (~0u, card_bundle_bit (end_cardb)));
 
         for (size_t i = start_word+1; i < end_word; i++)
             card_bundle_table [i] = ~0u;
@@ -6457,8 +6907,8 @@ void gc_heap::card_bundles_set (size_t start_cardb, size_t end_cardb)
     }
     else
     {
-        card_bundle_table [start_word] |= (highbits (~0u, card_bundle_bit (start_cardb)) &
-                                           lowbits (~0u, card_bundle_bit (end_cardb)));
+        set_card_bundle_bits (&card_bundle_table [start_word], (highbits (~0u, card_bundle_bit (start_cardb)) &
+                                                               lowbits (~0u, card_bundle_bit (end_cardb))));
 
     }
 
@@ -6483,14 +6933,14 @@ size_t size_card_bundle_of (uint8_t* from, uint8_t* end)
     return ((end - from) / (card_size*card_word_width*card_bundle_size*card_bundle_word_width)) * sizeof (uint32_t);
 }
 
-uint32_t* translate_card_bundle_table (uint32_t* cb)
+uint32_t* translate_card_bundle_table (uint32_t* cb, uint8_t* lowest_address)
 {
-    return (uint32_t*)((uint8_t*)cb - ((((size_t)g_lowest_address) / (card_size*card_word_width*card_bundle_size*card_bundle_word_width)) * sizeof (uint32_t)));
+    return (uint32_t*)((uint8_t*)cb - ((((size_t)lowest_address) / (card_size*card_word_width*card_bundle_size*card_bundle_word_width)) * sizeof (uint32_t)));
 }
 
 void gc_heap::enable_card_bundles ()
 {
-    if (can_use_write_watch() && (!card_bundles_enabled()))
+    if (can_use_card_bundles() && (!card_bundles_enabled()))
     {
         dprintf (3, ("Enabling card bundles"));
         //set all of the card bundles
@@ -6866,13 +7316,28 @@ uint32_t* gc_heap::make_card_table (uint8_t* start, uint8_t* end)
     size_t cb = 0;
 
 #ifdef CARD_BUNDLE
-    if (can_use_write_watch())
+    if (can_use_card_bundles())
     {
-        virtual_reserve_flags |= VirtualReserveFlags::WriteWatch;
+        // Manually managed card bundles are set by the write barrier instead.
+        if (can_use_write_watch_for_card_table())
+        {
+            virtual_reserve_flags |= VirtualReserveFlags::WriteWatch;
+        }
         cb = size_card_bundle_of (g_lowest_address, g_highest_address);
     }
 #endif //CARD_BUNDLE
 
+    size_t wws = 0;
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    size_t sw_ww_table_offset = 0;
+    if (gc_can_use_concurrent)
+    {
+        size_t sw_ww_size_before_table = sizeof(card_table_info) + cs + bs + cb;
+        sw_ww_table_offset = SoftwareWriteWatch::GetTableStartByteOffset (sw_ww_size_before_table);
+        wws = sw_ww_table_offset - sw_ww_size_before_table + SoftwareWriteWatch::GetTableByteSize (start, end);
+    }
+#endif //FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
 #ifdef GROWABLE_SEG_MAPPING_TABLE
     size_t st = size_seg_mapping_table_of (g_lowest_address, g_highest_address);
 #else //GROWABLE_SEG_MAPPING_TABLE
@@ -6881,9 +7346,14 @@ uint32_t* gc_heap::make_card_table (uint8_t* start, uint8_t* end)
 
     // it is impossible for alloc_size to overflow due bounds on each of 
     // its components.
-    size_t alloc_size = sizeof (uint8_t)*(bs + cs + cb + ms + st + sizeof (card_table_info));
+    size_t alloc_size = sizeof (uint8_t)*(bs + cs + cb + wws + ms + st + sizeof (card_table_info));
     size_t alloc_size_aligned = Align (alloc_size, g_SystemInfo.dwAllocationGranularity-1);
 
+    // The card table, brick table and mark array are accessed all over during a GC
+    // so they are backed by large pages too.
+    if (large_page_size)
+        virtual_reserve_flags |= VirtualReserveFlags::LargePages;
+
     uint32_t* ct = (uint32_t*)GCToOSInterface::VirtualReserve (0, alloc_size_aligned, 0, virtual_reserve_flags);
 
     if (!ct)
@@ -6902,6 +7372,13 @@ uint32_t* gc_heap::make_card_table (uint8_t* start, uint8_t* end)
         return 0;
     }
 
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    if (gc_can_use_concurrent)
+    {
+        SoftwareWriteWatch::InitializeUntranslatedTable ((uint8_t*)ct + sw_ww_table_offset, start);
+    }
+#endif //FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
     // initialize the ref count
     ct = (uint32_t*)((uint8_t*)ct+sizeof (card_table_info));
     card_table_refcount (ct) = 0;
@@ -6916,14 +7393,14 @@ uint32_t* gc_heap::make_card_table (uint8_t* start, uint8_t* end)
 #endif //CARD_BUNDLE
 
 #ifdef GROWABLE_SEG_MAPPING_TABLE
-    seg_mapping_table = (seg_mapping*)((uint8_t*)card_table_brick_table (ct) + bs + cb);
+    seg_mapping_table = (seg_mapping*)((uint8_t*)card_table_brick_table (ct) + bs + cb + wws);
     seg_mapping_table = (seg_mapping*)((uint8_t*)seg_mapping_table - 
                                         size_seg_mapping_table_of (0, (align_lower_segment (g_lowest_address))));
 #endif //GROWABLE_SEG_MAPPING_TABLE
 
 #ifdef MARK_ARRAY
     if (gc_can_use_concurrent)
-        card_table_mark_array (ct) = (uint32_t*)((uint8_t*)card_table_brick_table (ct) + bs + cb + st);
+        card_table_mark_array (ct) = (uint32_t*)((uint8_t*)card_table_brick_table (ct) + bs + cb + wws + st);
     else
         card_table_mark_array (ct) = NULL;
 #endif //MARK_ARRAY
@@ -7016,6 +7493,9 @@ int gc_heap::grow_brick_card_tables (uint8_t* start,
 
         uint32_t virtual_reserve_flags = VirtualReserveFlags::None;
         uint32_t* saved_g_card_table = g_card_table;
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+        uint32_t* saved_g_card_bundle_table = g_card_bundle_table;
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
         uint32_t* ct = 0;
         short* bt = 0;
 
@@ -7033,13 +7513,30 @@ int gc_heap::grow_brick_card_tables (uint8_t* start,
         size_t cb = 0;
 
 #ifdef CARD_BUNDLE
-        if (can_use_write_watch())
+        if (can_use_card_bundles())
         {
-            virtual_reserve_flags = VirtualReserveFlags::WriteWatch;
+            if (can_use_write_watch_for_card_table())
+            {
+                virtual_reserve_flags = VirtualReserveFlags::WriteWatch;
+            }
             cb = size_card_bundle_of (saved_g_lowest_address, saved_g_highest_address);
         }
 #endif //CARD_BUNDLE
 
+        size_t wws = 0;
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+        size_t sw_ww_table_offset = 0;
+        if (gc_can_use_concurrent)
+        {
+            size_t sw_ww_size_before_table = sizeof(card_table_info) + cs + bs + cb;
+            sw_ww_table_offset = SoftwareWriteWatch::GetTableStartByteOffset (sw_ww_size_before_table);
+            wws =
+                sw_ww_table_offset -
+                sw_ww_size_before_table +
+                SoftwareWriteWatch::GetTableByteSize (saved_g_lowest_address, saved_g_highest_address);
+        }
+#endif //FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
 #ifdef GROWABLE_SEG_MAPPING_TABLE
         size_t st = size_seg_mapping_table_of (saved_g_lowest_address, saved_g_highest_address);
 #else //GROWABLE_SEG_MAPPING_TABLE
@@ -7048,10 +7545,13 @@ int gc_heap::grow_brick_card_tables (uint8_t* start,
 
         // it is impossible for alloc_size to overflow due bounds on each of 
         // its components.
-        size_t alloc_size = sizeof (uint8_t)*(bs + cs + cb + ms +st + sizeof (card_table_info));
+        size_t alloc_size = sizeof (uint8_t)*(bs + cs + cb + wws + ms +st + sizeof (card_table_info));
         size_t alloc_size_aligned = Align (alloc_size, g_SystemInfo.dwAllocationGranularity-1);
-        dprintf (GC_TABLE_LOG, ("brick table: %Id; card table: %Id; mark array: %Id, card bundle: %Id, seg table: %Id",
-                                  bs, cs, ms, cb, st));
+        dprintf (GC_TABLE_LOG, ("brick table: %Id; card table: %Id; mark array: %Id, card bundle: %Id, sw ww table: %Id, seg table: %Id",
+                                  bs, cs, ms, cb, wws, st));
+
+        if (large_page_size)
+            virtual_reserve_flags |= VirtualReserveFlags::LargePages;
 
         uint8_t* mem = (uint8_t*)GCToOSInterface::VirtualReserve (0, alloc_size_aligned, 0, virtual_reserve_flags);
 
@@ -7104,7 +7604,7 @@ int gc_heap::grow_brick_card_tables (uint8_t* start,
 
 #ifdef GROWABLE_SEG_MAPPING_TABLE
         {
-            seg_mapping* new_seg_mapping_table = (seg_mapping*)((uint8_t*)card_table_brick_table (ct) + bs + cb);
+            seg_mapping* new_seg_mapping_table = (seg_mapping*)((uint8_t*)card_table_brick_table (ct) + bs + cb + wws);
             new_seg_mapping_table = (seg_mapping*)((uint8_t*)new_seg_mapping_table -
                                               size_seg_mapping_table_of (0, (align_lower_segment (saved_g_lowest_address))));
             memcpy(&new_seg_mapping_table[seg_mapping_word_of(g_lowest_address)],
@@ -7117,13 +7617,19 @@ int gc_heap::grow_brick_card_tables (uint8_t* start,
 
 #ifdef MARK_ARRAY
         if(gc_can_use_concurrent)
-            card_table_mark_array (ct) = (uint32_t*)((uint8_t*)card_table_brick_table (ct) + bs + cb + st);
+            card_table_mark_array (ct) = (uint32_t*)((uint8_t*)card_table_brick_table (ct) + bs + cb + wws + st);
         else
             card_table_mark_array (ct) = NULL;
 #endif //MARK_ARRAY
 
         g_card_table = translate_card_table (ct);
 
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+        // The write barrier switches to the new bundle table along with the new
+        // card table, before the bounds change.
+        g_card_bundle_table = translate_card_bundle_table (card_table_card_bundle_table (ct), saved_g_lowest_address);
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+
         dprintf (GC_TABLE_LOG, ("card table: %Ix(translated: %Ix), seg map: %Ix, mark array: %Ix", 
             (size_t)ct, (size_t)g_card_table, (size_t)seg_mapping_table, (size_t)card_table_mark_array (ct)));
 
@@ -7155,11 +7661,54 @@ int gc_heap::grow_brick_card_tables (uint8_t* start,
         }
 #endif //BACKGROUND_GC
 
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+        if (gc_can_use_concurrent)
+        {
+            // Software write watch requires the runtime to be suspended while the table
+            // is resized: the dirty state is copied to the new table here instead of the
+            // old table being merged lazily like the card table is, and the write barrier
+            // must not see the new table with the old heap bounds or vice versa. Resizing
+            // is far less frequent than getting/resetting write watch, so suspend here.
+            // Background GC threads take gc_lock around reading the table concurrently,
+            // and we are holding gc_lock.
+            //
+            // If this is a GC thread we are in a blocking GC and already suspended.
+            BOOL is_runtime_suspended = GCToEEInterface::IsGCThread();
+            if (!is_runtime_suspended)
+            {
+                suspend_EE();
+            }
+
+            SoftwareWriteWatch::SetResizedUntranslatedTable (
+                mem + sw_ww_table_offset,
+                saved_g_lowest_address,
+                saved_g_highest_address);
+
+            // The runtime is suspended so the order doesn't matter; the bounds are
+            // set first so a runtime that copies them when the write barrier is
+            // stomped (see gcinterface.h) gets the new ones.
+            g_lowest_address = saved_g_lowest_address;
+            g_highest_address = saved_g_highest_address;
+
+            // See the comment below on switching to the post grow write barrier.
+            StompWriteBarrierResize(la != saved_g_lowest_address);
+
+            if (!is_runtime_suspended)
+            {
+                restart_EE();
+            }
+
+            return 0;
+        }
+#endif //FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
+#ifndef BUILD_AS_STANDALONE
         // This passes a bool telling whether we need to switch to the post
         // grow version of the write barrier.  This test tells us if the new
         // segment was allocated at a lower address than the old, requiring
         // that we start doing an upper bounds check in the write barrier.
         StompWriteBarrierResize(la != saved_g_lowest_address);
+#endif //!BUILD_AS_STANDALONE
 
         // We need to make sure that other threads executing checked write barriers
         // will see the g_card_table update before g_lowest/highest_address updates.
@@ -7172,6 +7721,13 @@ int gc_heap::grow_brick_card_tables (uint8_t* start,
         g_lowest_address = saved_g_lowest_address;
         VolatileStore(&g_highest_address, saved_g_highest_address);
 
+#ifdef BUILD_AS_STANDALONE
+        // The runtime has its own copies of the card table and the bounds. It takes
+        // them all when the write barrier is stomped and publishes the card table
+        // before the bounds itself, so we stomp once the bounds are updated.
+        StompWriteBarrierResize(la != saved_g_lowest_address);
+#endif //BUILD_AS_STANDALONE
+
         return 0;
         
 fail:
@@ -7184,6 +7740,13 @@ fail:
                 g_card_table = saved_g_card_table; 
             }
 
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+            if (g_card_bundle_table != saved_g_card_bundle_table)
+            {
+                g_card_bundle_table = saved_g_card_bundle_table;
+            }
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+
             //delete (uint32_t*)((uint8_t*)ct - sizeof(card_table_info));
             if (!GCToOSInterface::VirtualRelease (mem, alloc_size_aligned))
             {
@@ -7370,7 +7933,7 @@ void gc_heap::copy_brick_card_table()
     assert (!gc_can_use_concurrent || 
             (((uint8_t*)card_table_card_bundle_table (ct) + size_card_bundle_of (g_lowest_address, g_highest_address) + st) == (uint8_t*)card_table_mark_array (ct)));
 #endif //MARK_ARRAY && _DEBUG
-    card_bundle_table = translate_card_bundle_table (card_table_card_bundle_table (ct));
+    card_bundle_table = translate_card_bundle_table (card_table_card_bundle_table (ct), g_lowest_address);
     assert (&card_bundle_table [card_bundle_word (cardw_card_bundle (card_word (card_of (g_lowest_address))))] ==
             card_table_card_bundle_table (ct));
 
@@ -8913,9 +9476,14 @@ int gc_heap::object_gennum_plan (uint8_t* o)
 heap_segment* gc_heap::make_heap_segment (uint8_t* new_pages, size_t size, int h_number)
 {
     size_t initial_commit = SEGMENT_INITIAL_COMMIT;
+    if (large_page_size)
+    {
+        // Segments are large page aligned, commit the first large page.
+        initial_commit = min (large_page_size, size);
+    }
 
     //Commit the first page
-    if (!virtual_alloc_commit_for_heap (new_pages, initial_commit, h_number))
+    if (!virtual_commit (new_pages, initial_commit, h_number))
     {
         return 0;
     }
@@ -8978,7 +9546,17 @@ void gc_heap::delete_heap_segment (heap_segment* seg, BOOL consider_hoarding)
             if (!heap_segment_decommitted_p (seg))
 #endif //BACKGROUND_GC
             {
-                decommit_heap_segment (seg);
+                // With gradual decommit we keep the segment committed so it's cheap 
+                // to reuse, decommit_standby_segments gives it back if it stays unused.
+                if (decommit_time_window && !g_low_memory_status)
+                {
+                    standby_decommit_time = GetHighPrecisionTimeStamp();
+                    standby_decommit_pending_p = TRUE;
+                }
+                else
+                {
+                    decommit_heap_segment (seg);
+                }
             }
 
 #ifdef SEG_MAPPING_TABLE
@@ -9018,12 +9596,10 @@ void gc_heap::delete_heap_segment (heap_segment* seg, BOOL consider_hoarding)
 
 void gc_heap::reset_heap_segment_pages (heap_segment* seg)
 {
-#ifndef FEATURE_PAL // No MEM_RESET support in PAL VirtualAlloc
     size_t page_start = align_on_page ((size_t)heap_segment_allocated (seg));
     size_t size = (size_t)heap_segment_committed (seg) - page_start;
     if (size != 0)
         GCToOSInterface::VirtualReset((void*)page_start, size, false /* unlock */);
-#endif //!FEATURE_PAL
 }
 
 void gc_heap::decommit_heap_segment_pages (heap_segment* seg,
@@ -9037,7 +9613,16 @@ void gc_heap::decommit_heap_segment_pages (heap_segment* seg,
         page_start += max(extra_space, 32*OS_PAGE_SIZE);
         size -= max (extra_space, 32*OS_PAGE_SIZE);
 
-        GCToOSInterface::VirtualDecommit (page_start, size);
+        if (large_page_size)
+        {
+            // Only give back whole large pages.
+            page_start = align_on_large_page (page_start);
+            if (page_start >= heap_segment_committed (seg))
+                return;
+            size = heap_segment_committed (seg) - page_start;
+        }
+
+        virtual_decommit (page_start, size);
         dprintf (3, ("Decommitting heap segment [%Ix, %Ix[(%d)", 
             (size_t)page_start, 
             (size_t)(page_start + size),
@@ -9061,8 +9646,16 @@ void gc_heap::decommit_heap_segment (heap_segment* seg)
     page_start += OS_PAGE_SIZE;
 #endif //BACKGROUND_GC
 
+    if (large_page_size)
+    {
+        // Keep the large page with the segment header, and only give back whole large pages.
+        page_start = align_on_large_page (page_start);
+        if (page_start >= heap_segment_committed (seg))
+            return;
+    }
+
     size_t size = heap_segment_committed (seg) - page_start;
-    GCToOSInterface::VirtualDecommit (page_start, size);
+    virtual_decommit (page_start, size);
 
     //re-init the segment object
     heap_segment_committed (seg) = page_start;
@@ -9072,6 +9665,101 @@ void gc_heap::decommit_heap_segment (heap_segment* seg)
     }
 }
 
+// With GCDecommitTimeWindow set we keep enough of the ephemeral segment 
+// committed for the highest slack we wanted during the last window, and give 
+// back what's committed above that a bit at a time, in proportion to the time 
+// since we last did, so bursty allocation doesn't make us decommit and commit 
+// the same pages over and over. Returns the slack to keep.
+size_t gc_heap::gradual_decommit_slack (size_t target_slack)
+{
+    size_t now = GetHighPrecisionTimeStamp();
+    size_t committed_slack = heap_segment_committed (ephemeral_heap_segment) - 
+                             heap_segment_allocated (ephemeral_heap_segment);
+
+    if ((target_slack >= decommit_peak_slack) || 
+        ((now - decommit_peak_time) >= decommit_time_window))
+    {
+        decommit_peak_slack = target_slack;
+        decommit_peak_time = now;
+    }
+
+    size_t keep_slack = max (target_slack, decommit_peak_slack);
+    if ((committed_slack <= keep_slack) || (decommit_last_step_time == 0))
+    {
+        decommit_last_step_time = now;
+        return committed_slack;
+    }
+
+    size_t excess = committed_slack - keep_slack;
+    size_t elapsed = now - decommit_last_step_time;
+    size_t step = excess;
+    if (elapsed < decommit_time_window)
+    {
+        step = (size_t)((double)excess * elapsed / decommit_time_window);
+
+        // decommit_heap_segment_pages ignores small amounts, so let the time 
+        // accumulate until the step is worth doing.
+        if (step < 100*OS_PAGE_SIZE)
+        {
+            return committed_slack;
+        }
+    }
+
+    dprintf (3, ("h%d: peak slack %Id, committed slack %Id, decommitting %Id", 
+        heap_number, keep_slack, committed_slack, step));
+
+    decommit_last_step_time = now;
+    return (committed_slack - step);
+}
+
+// Segments on the standby list are reused before we reserve new ones. With 
+// gradual decommit they stay committed when they are hoarded, so we give one 
+// back each time a whole window passes without a segment being hoarded.
+void gc_heap::decommit_standby_segments()
+{
+    if (!decommit_time_window)
+    {
+        return;
+    }
+
+    size_t now = GetHighPrecisionTimeStamp();
+    if (!g_low_memory_status && ((now - standby_decommit_time) < decommit_time_window))
+    {
+        return;
+    }
+
+#ifdef MULTIPLE_HEAPS
+    // Segments on the standby list don't belong to any heap.
+    gc_heap* hp = g_heaps[0];
+#else
+    gc_heap* hp = pGenGCHeap;
+#endif //MULTIPLE_HEAPS
+
+    standby_decommit_pending_p = FALSE;
+    BOOL decommitted_p = FALSE;
+
+    for (heap_segment* seg = segment_standby_list; seg != 0; seg = heap_segment_next (seg))
+    {
+        uint8_t* committed = heap_segment_committed (seg);
+        if (committed > (align_on_page (heap_segment_mem (seg)) + OS_PAGE_SIZE))
+        {
+            if (decommitted_p && !g_low_memory_status)
+            {
+                standby_decommit_pending_p = TRUE;
+                break;
+            }
+
+            hp->decommit_heap_segment (seg);
+            if (heap_segment_committed (seg) != committed)
+            {
+                dprintf (2, ("Decommitted standby segment %Ix", (size_t)seg));
+                standby_decommit_time = now;
+                decommitted_p = TRUE;
+            }
+        }
+    }
+}
+
 void gc_heap::clear_gen0_bricks()
 {
     if (!gen0_bricks_cleared)
@@ -9095,8 +9783,8 @@ void gc_heap::rearrange_small_heap_segments()
     while (seg)
     {
         heap_segment* next_seg = heap_segment_next (seg);
-        // TODO: we need to consider hoarding here.
-        delete_heap_segment (seg, FALSE);
+        // Same as when a blocking GC frees a segment, see rearrange_heap_segments.
+        delete_heap_segment (seg, (segment_promotion_p || (g_pConfig->GetGCRetainVM() != 0)));
         seg = next_seg;
     }
     freeable_small_heap_segment = 0;
@@ -9153,7 +9841,7 @@ void gc_heap::rearrange_heap_segments(BOOL compacting)
                 assert (prev_seg);
                 assert (seg != ephemeral_heap_segment);
                 heap_segment_next (prev_seg) = next_seg;
-                delete_heap_segment (seg, (g_pConfig->GetGCRetainVM() != 0));
+                delete_heap_segment (seg, (segment_promotion_p || (g_pConfig->GetGCRetainVM() != 0)));
 
                 dprintf (2, ("Deleting heap segment %Ix", (size_t)seg));
             }
@@ -9196,6 +9884,7 @@ void gc_heap::update_card_table_bundle()
 {
     if (card_bundles_enabled())
     {
+#ifndef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
         uint8_t* base_address = (uint8_t*)(&card_table[card_word (card_of (lowest_address))]);
         uint8_t* saved_base_address = base_address;
         uintptr_t bcount = array_size;
@@ -9242,7 +9931,10 @@ void gc_heap::update_card_table_bundle()
         } while ((bcount >= array_size) && (base_address < high_address));
 
         GCToOSInterface::ResetWriteWatch (saved_base_address, saved_region_size);
+#endif //!FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
 
+        // With manually managed card bundles the write barrier has already set
+        // the bundles, which leaves only the verification to do here.
 #ifdef _DEBUG
 
         size_t lowest_card = card_word (card_of (lowest_address));
@@ -9279,6 +9971,28 @@ void gc_heap::update_card_table_bundle()
 }
 #endif //CARD_BUNDLE
 
+// static
+void gc_heap::reset_write_watch_for_gc_heap (void* base_address, size_t region_size)
+{
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    SoftwareWriteWatch::ClearDirty (base_address, region_size);
+#else // !FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    GCToOSInterface::ResetWriteWatch (base_address, region_size);
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+}
+
+// static
+void gc_heap::get_write_watch_for_gc_heap (bool reset, void* base_address, size_t region_size, void** dirty_pages, uintptr_t* dirty_page_count_ref, bool is_runtime_suspended)
+{
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    SoftwareWriteWatch::GetDirty (base_address, region_size, dirty_pages, dirty_page_count_ref, reset, is_runtime_suspended);
+#else // !FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    UNREFERENCED_PARAMETER(is_runtime_suspended);
+    bool success = GCToOSInterface::GetWriteWatch (reset, base_address, region_size, dirty_pages, dirty_page_count_ref);
+    assert (success);
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+}
+
 const size_t ww_reset_quantum = 128*1024*1024;
 
 inline
@@ -9302,7 +10016,7 @@ void gc_heap::reset_ww_by_chunk (uint8_t* start_address, size_t total_reset_size
         next_reset_size = ((remaining_reset_size >= ww_reset_quantum) ? ww_reset_quantum : remaining_reset_size);
         if (next_reset_size)
         {
-            GCToOSInterface::ResetWriteWatch (start_address, next_reset_size);
+            reset_write_watch_for_gc_heap (start_address, next_reset_size);
             reset_size += next_reset_size;
 
             switch_one_quantum();
@@ -9371,7 +10085,7 @@ void gc_heap::reset_write_watch (BOOL concurrent_p)
 #endif //TIME_WRITE_WATCH
             dprintf (3, ("h%d: soh ww: [%Ix(%Id)", heap_number, (size_t)base_address, region_size));
             //reset_ww_by_chunk (base_address, region_size);
-            GCToOSInterface::ResetWriteWatch (base_address, region_size);
+            reset_write_watch_for_gc_heap (base_address, region_size);
 
 #ifdef TIME_WRITE_WATCH
             unsigned int time_stop = GetCycleCount32();
@@ -9414,7 +10128,7 @@ void gc_heap::reset_write_watch (BOOL concurrent_p)
 #endif //TIME_WRITE_WATCH
             dprintf (3, ("h%d: loh ww: [%Ix(%Id)", heap_number, (size_t)base_address, region_size));
             //reset_ww_by_chunk (base_address, region_size);
-            GCToOSInterface::ResetWriteWatch (base_address, region_size);
+            reset_write_watch_for_gc_heap (base_address, region_size);
 
 #ifdef TIME_WRITE_WATCH
             unsigned int time_stop = GetCycleCount32();
@@ -9636,12 +10350,14 @@ HRESULT gc_heap::initialize_gc (size_t segment_size,
     HRESULT hres = S_OK;
 
 #ifdef WRITE_WATCH
-    write_watch_api_supported();
+    hardware_write_watch_api_supported();
 #ifdef BACKGROUND_GC
-    if (can_use_write_watch () && g_pConfig->GetGCconcurrent()!=0)
+    if (can_use_write_watch_for_gc_heap() && g_pConfig->GetGCconcurrent()!=0)
     {
         gc_can_use_concurrent = true;
+#ifndef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
         virtual_alloc_write_watch = true;
+#endif // !FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
     }
     else
     {
@@ -9650,6 +10366,27 @@ HRESULT gc_heap::initialize_gc (size_t segment_size,
 #endif //BACKGROUND_GC
 #endif //WRITE_WATCH
 
+    if (heap_hard_limit)
+    {
+        check_commit_cs.Initialize();
+    }
+
+    if (CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_GCLargePages) != 0)
+    {
+        large_page_size = GCToOSInterface::GetLargePageSize();
+        dprintf (1, ("GCLargePages: large page size is %Id", large_page_size));
+    }
+
+    segment_promotion_p = (CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_GCSegmentPromotion) != 0);
+
+    // A pause target only makes sense with a budget that follows it.
+    target_pause_us = (uint64_t)CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_GCTargetPauseMs) * 1000;
+    gen0_tuning_p = ((target_pause_us != 0) || 
+                     (CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_GCGen0Adaptive) != 0));
+    adaptive_alloc_quantum_p = (CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_GCAdaptiveAllocQuantum) != 0);
+    memset (&gen0_tuning_data, 0, sizeof (gen0_tuning_data));
+    memset (pause_cost_per_mb, 0, sizeof (pause_cost_per_mb));
+
     reserved_memory = 0;
     unsigned block_count;
 #ifdef MULTIPLE_HEAPS
@@ -9673,7 +10410,7 @@ HRESULT gc_heap::initialize_gc (size_t segment_size,
     uint64_t th = (uint64_t)SH_TH_CARD_BUNDLE;
 #endif //MULTIPLE_HEAPS
 
-    if ((can_use_write_watch() && reserved_memory >= th))
+    if ((can_use_card_bundles() && reserved_memory >= th))
     {
         settings.card_bundles = TRUE;
     } else
@@ -9689,10 +10426,22 @@ HRESULT gc_heap::initialize_gc (size_t segment_size,
     if (!g_card_table)
         return E_OUTOFMEMORY;
 
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    g_card_bundle_table = translate_card_bundle_table (card_table_card_bundle_table (&g_card_table[card_word (gcard_of (g_lowest_address))]), g_lowest_address);
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+
     gc_started = FALSE;
 
 #ifdef MULTIPLE_HEAPS
     n_heaps = number_of_heaps;
+    n_active_heaps = number_of_heaps;
+
+    // We start with all heaps active and only shrink when we see we are not spending
+    // much time in GC.
+    dynamic_heap_count_p = ((number_of_heaps > 1) && 
+                            (CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_GCDynamicHeapCount) != 0));
+    memset (&dynamic_heap_count_data, 0, sizeof (dynamic_heap_count_data));
+    dynamic_heap_count_data.sample_start_ts = GCToOSInterface::QueryPerformanceCounter();
 
     g_heaps = new (nothrow) gc_heap* [number_of_heaps];
     if (!g_heaps)
@@ -9818,9 +10567,36 @@ gc_heap::init_semi_shared()
     last_gc_index = 0;
     should_expand_in_full_gc = FALSE;
 
+#ifdef PREFETCH
+    mark_prefetch_depth = (int)min (CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_GCMarkPrefetchDepth), 
+                                    (uint32_t)MARK_PREFETCH_MAX_DEPTH);
+#endif //PREFETCH
+
+    CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_GCHeapSnapshotFile, &heap_snapshot_file_name);
+    heap_snapshot_interval = CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_GCHeapSnapshotInterval);
+
+    decommit_time_window = (size_t)CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_GCDecommitTimeWindow);
+
+    // With gradual decommit what we kept committed is only given back by later GCs,
+    // so if the process stopped allocating it would stay committed.
+    if (decommit_time_window)
+    {
+        idle_gc_interval = IDLE_GC_INTERVAL;
+    }
+
+#ifdef MULTIPLE_HEAPS
+    // With a dynamic heap count we want to shrink to fewer heaps when the process 
+    // stopped allocating, which otherwise only happens when it starts again.
+    if (dynamic_heap_count_p)
+    {
+        idle_gc_interval = IDLE_GC_INTERVAL;
+    }
+#endif //MULTIPLE_HEAPS
+
 #ifdef FEATURE_LOH_COMPACTION
     loh_compaction_always_p = (g_pConfig->GetGCLOHCompactionMode() != 0);
     loh_compaction_mode = loh_compaction_default;
+    loh_compaction_budget = (size_t)CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_GCLOHCompactBudget) * 1024 * 1024;
 #endif //FEATURE_LOH_COMPACTION
 
 #ifdef BACKGROUND_GC
@@ -10111,6 +10887,7 @@ gc_heap::init_gc_heap (int  h_number)
     gen0_must_clear_bricks = 0;
 
     allocation_quantum = CLR_SIZE;
+    alloc_quantum_limit = MAX_ALLOC_QUANTUM;
 
     more_space_lock = gc_lock;
 
@@ -10120,6 +10897,14 @@ gc_heap::init_gc_heap (int  h_number)
 
     new_heap_segment = NULL;
 
+    decommit_peak_slack = 0;
+
+    decommit_peak_time = 0;
+
+    decommit_last_step_time = 0;
+
+    decommit_pending_p = FALSE;
+
 #ifdef RECORD_LOH_STATE
     loh_state_index = 0;
 #endif //RECORD_LOH_STATE
@@ -10182,7 +10967,7 @@ gc_heap::init_gc_heap (int  h_number)
     lowest_address = card_table_lowest_address (ct);
 
 #ifdef CARD_BUNDLE
-    card_bundle_table = translate_card_bundle_table (card_table_card_bundle_table (ct));
+    card_bundle_table = translate_card_bundle_table (card_table_card_bundle_table (ct), g_lowest_address);
     assert (&card_bundle_table [card_bundle_word (cardw_card_bundle (card_word (card_of (g_lowest_address))))] ==
             card_table_card_bundle_table (ct));
 #endif //CARD_BUNDLE
@@ -10234,7 +11019,7 @@ gc_heap::init_gc_heap (int  h_number)
 
     generation_table [max_generation].free_list_allocator = allocator(NUM_GEN2_ALIST, BASE_GEN2_ALIST, gen2_alloc_list);
     //assign the alloc_list for the large generation 
-    generation_table [max_generation+1].free_list_allocator = allocator(NUM_LOH_ALIST, BASE_LOH_ALIST, loh_alloc_list);
+    generation_table [max_generation+1].free_list_allocator = allocator(NUM_LOH_ALIST, BASE_LOH_ALIST, loh_alloc_list, LOH_ALIST_SUB_BUCKETS);
     generation_table [max_generation+1].gen_num = max_generation+1;
     make_generation (generation_table [max_generation+1],lseg, heap_segment_mem (lseg), 0);
     heap_segment_allocated (lseg) = heap_segment_mem (lseg) + Align (min_obj_size, get_alignment_constant (FALSE));
@@ -10588,6 +11373,23 @@ BOOL gc_heap::grow_heap_segment (heap_segment* seg, uint8_t* high_address)
     c_size = max (c_size, 16*OS_PAGE_SIZE);
     c_size = min (c_size, (size_t)(heap_segment_reserved (seg) - heap_segment_committed (seg)));
 
+    if (heap_hard_limit)
+    {
+        // Don't let the extra we normally commit ahead of time be what gets us over the limit.
+        size_t c_size_needed = align_on_page ((size_t)(high_address - heap_segment_committed (seg)));
+        if ((c_size > c_size_needed) && ((current_total_committed + c_size) > heap_hard_limit))
+        {
+            c_size = c_size_needed;
+        }
+    }
+
+    if (large_page_size)
+    {
+        // Commit up to a large page boundary. The segment end is always on one.
+        c_size = align_on_large_page (heap_segment_committed (seg) + c_size) - heap_segment_committed (seg);
+        c_size = min (c_size, (size_t)(heap_segment_reserved (seg) - heap_segment_committed (seg)));
+    }
+
     if (c_size == 0)
         return FALSE;
 
@@ -10597,7 +11399,7 @@ BOOL gc_heap::grow_heap_segment (heap_segment* seg, uint8_t* high_address)
 
     dprintf(3, ("Growing segment allocation %Ix %Ix", (size_t)heap_segment_committed(seg),c_size));
     
-    if (!virtual_alloc_commit_for_heap(heap_segment_committed (seg), c_size, heap_number))
+    if (!virtual_commit (heap_segment_committed (seg), c_size, heap_number))
     {
         dprintf(3, ("Cannot grow heap segment"));
         return FALSE;
@@ -10836,14 +11638,41 @@ void gc_heap::check_batch_mark_array_bits (uint8_t* start, uint8_t* end)
 }
 #endif //VERIFY_HEAP && BACKGROUND_GC
 
-allocator::allocator (unsigned int num_b, size_t fbs, alloc_list* b)
+allocator::allocator (unsigned int num_b, size_t fbs, alloc_list* b, unsigned int sub_b)
 {
     assert (num_b < MAX_BUCKET_COUNT);
-    num_buckets = num_b;
+    assert (sub_b >= 1);
+    // The first (below fbs) and the last (no upper limit) buckets are never split.
+    num_buckets = ((num_b > 2) ? ((num_b - 2) * sub_b + 2) : num_b);
     frst_bucket_size = fbs;
+    sub_buckets = sub_b;
     buckets = b;
 }
 
+unsigned int allocator::bucket_of (size_t size)
+{
+    size_t sz = frst_bucket_size;
+    if (size < sz)
+    {
+        return 0;
+    }
+
+    unsigned int a_l_number = 1;
+    while (a_l_number < (num_buckets-1))
+    {
+        if (size < (sz * 2))
+        {
+            size_t sub_bucket = (size - sz) / (sz / sub_buckets);
+            assert (sub_bucket < sub_buckets);
+            return (a_l_number + (unsigned int)sub_bucket);
+        }
+        a_l_number += (unsigned int)sub_buckets;
+        sz = sz * 2;
+    }
+
+    return (unsigned int)(num_buckets-1);
+}
+
 alloc_list& allocator::alloc_list_of (unsigned int bn)
 {
     assert (bn < num_buckets);
@@ -10924,17 +11753,7 @@ void allocator::thread_free_item (uint8_t* item, uint8_t*& head, uint8_t*& tail)
 
 void allocator::thread_item (uint8_t* item, size_t size)
 {
-    size_t sz = frst_bucket_size;
-    unsigned int a_l_number = 0; 
-
-    for (; a_l_number < (num_buckets-1); a_l_number++)
-    {
-        if (size < sz)
-        {
-            break;
-        }
-        sz = sz * 2;
-    }
+    unsigned int a_l_number = bucket_of (size);
     alloc_list* al = &alloc_list_of (a_l_number);
     thread_free_item (item, 
                       al->alloc_list_head(),
@@ -10944,16 +11763,7 @@ void allocator::thread_item (uint8_t* item, size_t size)
 void allocator::thread_item_front (uint8_t* item, size_t size)
 {
     //find right free list
-    size_t sz = frst_bucket_size;
-    unsigned int a_l_number = 0; 
-    for (; a_l_number < (num_buckets-1); a_l_number++)
-    {
-        if (size < sz)
-        {
-            break;
-        }
-        sz = sz * 2;
-    }
+    unsigned int a_l_number = bucket_of (size);
     alloc_list* al = &alloc_list_of (a_l_number);
     free_list_slot (item) = al->alloc_list_head();
     free_list_undo (item) = UNDO_EMPTY;
@@ -11200,13 +12010,19 @@ void gc_heap::adjust_limit_clr (uint8_t* start, size_t limit_size,
  */
 
 size_t gc_heap::limit_from_size (size_t size, size_t room, int gen_number,
-                                 int align_const)
+                                 alloc_context* acontext, int align_const)
 {
+    size_t quantum = 0;
+    if (gen_number < max_generation+1)
+    {
+        quantum = ((acontext->alloc_quantum != 0) ? 
+                   min (acontext->alloc_quantum, alloc_quantum_limit) : 
+                   allocation_quantum);
+    }
+
     size_t new_limit = new_allocation_limit ((size + Align (min_obj_size, align_const)),
                                              min (room,max (size + Align (min_obj_size, align_const),
-                                                            ((gen_number < max_generation+1) ?
-                                                             allocation_quantum :
-                                                             0))),
+                                                            quantum)),
                                              gen_number);
     assert (new_limit >= (size + Align (min_obj_size, align_const)));
     dprintf (100, ("requested to allocate %Id bytes, actual size is %Id", size, new_limit));
@@ -11540,7 +12356,7 @@ BOOL gc_heap::a_fit_free_list_p (int gen_number,
                     // We ask for more Align (min_obj_size)
                     // to make sure that we can insert a free object
                     // in adjust_limit will set the limit lower
-                    size_t limit = limit_from_size (size, free_list_size, gen_number, align_const);
+                    size_t limit = limit_from_size (size, free_list_size, gen_number, acontext, align_const);
 
                     uint8_t*  remain = (free_list + limit);
                     size_t remain_size = (free_list_size - limit);
@@ -11667,7 +12483,8 @@ void gc_heap::bgc_loh_alloc_clr (uint8_t* alloc_start,
 
 BOOL gc_heap::a_fit_free_list_large_p (size_t size, 
                                        alloc_context* acontext,
-                                       int align_const)
+                                       int align_const,
+                                       BOOL poh_p)
 {
 #ifdef BACKGROUND_GC
     wait_for_background_planning (awr_loh_alloc_during_plan);
@@ -11685,19 +12502,39 @@ BOOL gc_heap::a_fit_free_list_large_p (size_t size,
 #ifdef BACKGROUND_GC
     int cookie = -1;
 #endif //BACKGROUND_GC
-    size_t sz_list = loh_allocator->first_bucket_size();
-    for (unsigned int a_l_idx = 0; a_l_idx < loh_allocator->number_of_buckets(); a_l_idx++)
+#ifdef FEATURE_LOH_COMPACTION
+    size_t exact_fit_size = size + loh_pad;
+#else
+    size_t exact_fit_size = size;
+#endif //FEATURE_LOH_COMPACTION
+
+    // The LOH buckets are narrow so instead of taking the first item that fits
+    // we take the smallest one in the first bucket that has any fit. This keeps
+    // the large free items intact for the allocations that need them.
+    for (unsigned int a_l_idx = loh_allocator->bucket_of (size); a_l_idx < loh_allocator->number_of_buckets(); a_l_idx++)
     {
-        if ((size < sz_list) || (a_l_idx == (loh_allocator->number_of_buckets()-1)))
+        uint8_t* free_list = loh_allocator->alloc_list_head_of (a_l_idx);
+        uint8_t* prev_free_item = 0;
+        uint8_t* best_free_item = 0;
+        uint8_t* best_prev_free_item = 0;
+        size_t best_free_item_size = 0;
+
+        while (free_list != 0)
         {
-            uint8_t* free_list = loh_allocator->alloc_list_head_of (a_l_idx);
-            uint8_t* prev_free_item = 0;
-            while (free_list != 0)
-            {
-                dprintf (3, ("considering free list %Ix", (size_t)free_list));
+            dprintf (3, ("considering free list %Ix", (size_t)free_list));
 
-                size_t free_list_size = unused_array_size(free_list);
+            size_t free_list_size = unused_array_size(free_list);
 
+            // Pinned objects can only go on free space that's on a POH segment, and nothing
+            // else can, or it could never be moved.
+#ifdef SEG_MAPPING_TABLE
+            heap_segment* free_list_seg = seg_mapping_table_segment_of (free_list);
+#else //SEG_MAPPING_TABLE
+            ptrdiff_t delta = 0;
+            heap_segment* free_list_seg = segment_of (free_list, delta);
+#endif //SEG_MAPPING_TABLE
+            if (heap_segment_poh_p (free_list_seg) == (poh_p ? TRUE : FALSE))
+            {
 #ifdef FEATURE_LOH_COMPACTION
                 if ((size + loh_pad) <= free_list_size)
 #else
@@ -11705,63 +12542,81 @@ BOOL gc_heap::a_fit_free_list_large_p (size_t size,
                     (size == free_list_size))
 #endif //FEATURE_LOH_COMPACTION
                 {
+                    if ((best_free_item == 0) || (free_list_size < best_free_item_size))
+                    {
+                        best_free_item = free_list;
+                        best_prev_free_item = prev_free_item;
+                        best_free_item_size = free_list_size;
+
+                        if (free_list_size == exact_fit_size)
+                        {
+                            break;
+                        }
+                    }
+                }
+            }
+
+            prev_free_item = free_list;
+            free_list = free_list_slot (free_list); 
+        }
+
+        if (best_free_item != 0)
+        {
+            free_list = best_free_item;
+            size_t free_list_size = best_free_item_size;
+
 #ifdef BACKGROUND_GC
-                    cookie = bgc_alloc_lock->loh_alloc_set (free_list);
+            cookie = bgc_alloc_lock->loh_alloc_set (free_list);
 #endif //BACKGROUND_GC
 
-                    //unlink the free_item
-                    loh_allocator->unlink_item (a_l_idx, free_list, prev_free_item, FALSE);
+            //unlink the free_item
+            loh_allocator->unlink_item (a_l_idx, free_list, best_prev_free_item, FALSE);
 
-                    // Substract min obj size because limit_from_size adds it. Not needed for LOH
-                    size_t limit = limit_from_size (size - Align(min_obj_size, align_const), free_list_size, 
-                                                    gen_number, align_const);
+            // Substract min obj size because limit_from_size adds it. Not needed for LOH
+            size_t limit = limit_from_size (size - Align(min_obj_size, align_const), free_list_size, 
+                                            gen_number, acontext, align_const);
 
 #ifdef FEATURE_LOH_COMPACTION
-                    make_unused_array (free_list, loh_pad);
-                    limit -= loh_pad;
-                    free_list += loh_pad;
-                    free_list_size -= loh_pad;
+            make_unused_array (free_list, loh_pad);
+            limit -= loh_pad;
+            free_list += loh_pad;
+            free_list_size -= loh_pad;
 #endif //FEATURE_LOH_COMPACTION
 
-                    uint8_t*  remain = (free_list + limit);
-                    size_t remain_size = (free_list_size - limit);
-                    if (remain_size != 0)
-                    {
-                        assert (remain_size >= Align (min_obj_size, align_const));
-                        make_unused_array (remain, remain_size);
-                    }
-                    if (remain_size >= Align(min_free_list, align_const))
-                    {
-                        loh_thread_gap_front (remain, remain_size, gen);
-                        assert (remain_size >= Align (min_obj_size, align_const));
-                    }
-                    else
-                    {
-                        generation_free_obj_space (gen) += remain_size;
-                    }
-                    generation_free_list_space (gen) -= free_list_size;
-                    dprintf (3, ("found fit on loh at %Ix", free_list));
+            uint8_t*  remain = (free_list + limit);
+            size_t remain_size = (free_list_size - limit);
+            if (remain_size != 0)
+            {
+                assert (remain_size >= Align (min_obj_size, align_const));
+                make_unused_array (remain, remain_size);
+            }
+            if (remain_size >= Align(min_free_list, align_const))
+            {
+                loh_thread_gap_front (remain, remain_size, gen);
+                assert (remain_size >= Align (min_obj_size, align_const));
+            }
+            else
+            {
+                generation_free_obj_space (gen) += remain_size;
+            }
+            generation_free_list_space (gen) -= free_list_size;
+            dprintf (3, ("found fit on loh at %Ix", free_list));
 #ifdef BACKGROUND_GC
-                    if (cookie != -1)
-                    {
-                        bgc_loh_alloc_clr (free_list, limit, acontext, align_const, cookie, FALSE, 0);
-                    }
-                    else
+            if (cookie != -1)
+            {
+                bgc_loh_alloc_clr (free_list, limit, acontext, align_const, cookie, FALSE, 0);
+            }
+            else
 #endif //BACKGROUND_GC
-                    {
-                        adjust_limit_clr (free_list, limit, acontext, 0, align_const, gen_number);
-                    }
-
-                    //fix the limit to compensate for adjust_limit_clr making it too short 
-                    acontext->alloc_limit += Align (min_obj_size, align_const);
-                    can_fit = TRUE;
-                    goto exit;
-                }
-                prev_free_item = free_list;
-                free_list = free_list_slot (free_list); 
+            {
+                adjust_limit_clr (free_list, limit, acontext, 0, align_const, gen_number);
             }
+
+            //fix the limit to compensate for adjust_limit_clr making it too short 
+            acontext->alloc_limit += Align (min_obj_size, align_const);
+            can_fit = TRUE;
+            goto exit;
         }
-        sz_list = sz_list * 2;
     }
 exit:
     return can_fit;
@@ -11803,7 +12658,7 @@ BOOL gc_heap::a_fit_segment_end_p (int gen_number,
     {
         limit = limit_from_size (size, 
                                  (end - allocated), 
-                                 gen_number, align_const);
+                                 gen_number, acontext, align_const);
         goto found_fit;
     }
 
@@ -11813,7 +12668,7 @@ BOOL gc_heap::a_fit_segment_end_p (int gen_number,
     {
         limit = limit_from_size (size, 
                                  (end - allocated), 
-                                 gen_number, align_const);
+                                 gen_number, acontext, align_const);
         if (grow_heap_segment (seg, allocated + limit))
         {
             goto found_fit;
@@ -11877,6 +12732,7 @@ BOOL gc_heap::loh_a_fit_segment_end_p (int gen_number,
                                        size_t size, 
                                        alloc_context* acontext,
                                        int align_const,
+                                       BOOL poh_p,
                                        BOOL* commit_failed_p,
                                        oom_reason* oom_r)
 {
@@ -11886,6 +12742,15 @@ BOOL gc_heap::loh_a_fit_segment_end_p (int gen_number,
 
     while (seg)
     {
+        // Pinned objects are only allocated at the end of POH segments and
+        // other large objects never are, so POH segments stay free of movable
+        // objects as much as possible.
+        if (heap_segment_poh_p (seg) != poh_p)
+        {
+            seg = heap_segment_next_rw (seg);
+            continue;
+        }
+
         if (a_fit_segment_end_p (gen_number, seg, (size - Align (min_obj_size, align_const)), 
                                  acontext, align_const, commit_failed_p))
         {
@@ -12270,10 +13135,16 @@ exit:
 }
 
 #ifdef BACKGROUND_GC
+inline
+BOOL gc_heap::bgc_loh_alloc_blocked_p()
+{
+    return ((current_c_gc_state == c_gc_state_planning) && !bgc_loh_swept_p);
+}
+
 inline
 void gc_heap::wait_for_background_planning (alloc_wait_reason awr)
 {
-    while (current_c_gc_state == c_gc_state_planning)
+    while (bgc_loh_alloc_blocked_p())
     {
         dprintf (3, ("lh state planning, cannot allocate"));
 
@@ -12286,7 +13157,8 @@ void gc_heap::wait_for_background_planning (alloc_wait_reason awr)
         dprintf (SPINLOCK_LOG, ("[%d]Emsl after waiting for bgc plan", heap_number));
     }
     assert ((current_c_gc_state == c_gc_state_free) ||
-            (current_c_gc_state == c_gc_state_marking));
+            (current_c_gc_state == c_gc_state_marking) ||
+            bgc_loh_swept_p);
 }
 
 BOOL gc_heap::bgc_loh_should_allocate()
@@ -12337,6 +13209,7 @@ size_t gc_heap::get_large_seg_size (size_t size)
 BOOL gc_heap::loh_get_new_seg (generation* gen,
                                size_t size,
                                int align_const,
+                               BOOL poh_p,
                                BOOL* did_full_compact_gc,
                                oom_reason* oom_r)
 {
@@ -12347,7 +13220,7 @@ BOOL gc_heap::loh_get_new_seg (generation* gen,
 
     size_t seg_size = get_large_seg_size (size);
 
-    heap_segment* new_seg = get_large_segment (seg_size, did_full_compact_gc);
+    heap_segment* new_seg = get_large_segment (seg_size, poh_p, did_full_compact_gc);
 
     if (new_seg)
     {
@@ -12412,15 +13285,16 @@ BOOL gc_heap::loh_try_fit (int gen_number,
                            size_t size, 
                            alloc_context* acontext,
                            int align_const,
+                           BOOL poh_p,
                            BOOL* commit_failed_p,
                            oom_reason* oom_r)
 {
     BOOL can_allocate = TRUE;
 
-    if (!a_fit_free_list_large_p (size, acontext, align_const))
+    if (!a_fit_free_list_large_p (size, acontext, align_const, poh_p))
     {
         can_allocate = loh_a_fit_segment_end_p (gen_number, size, 
-                                                acontext, align_const, 
+                                                acontext, align_const, poh_p,
                                                 commit_failed_p, oom_r);
 
 #ifdef BACKGROUND_GC
@@ -12531,7 +13405,8 @@ void gc_heap::add_saved_loh_state (allocation_state loh_state_to_save, EEThreadI
 BOOL gc_heap::allocate_large (int gen_number,
                               size_t size, 
                               alloc_context* acontext,
-                              int align_const)
+                              int align_const,
+                              BOOL poh_p)
 {
 #ifdef BACKGROUND_GC
     if (recursive_gc_sync::background_running_p() && (current_c_gc_state != c_gc_state_planning))
@@ -12602,7 +13477,7 @@ BOOL gc_heap::allocate_large (int gen_number,
                 BOOL can_use_existing_p = FALSE;
 
                 can_use_existing_p = loh_try_fit (gen_number, size, acontext, 
-                                                  align_const, &commit_failed_p, &oom_r);
+                                                  align_const, poh_p, &commit_failed_p, &oom_r);
                 loh_alloc_state = (can_use_existing_p ?
                                         a_state_can_allocate : 
                                         (commit_failed_p ? 
@@ -12617,7 +13492,7 @@ BOOL gc_heap::allocate_large (int gen_number,
                 BOOL can_use_existing_p = FALSE;
 
                 can_use_existing_p = loh_try_fit (gen_number, size, acontext, 
-                                                  align_const, &commit_failed_p, &oom_r);
+                                                  align_const, poh_p, &commit_failed_p, &oom_r);
                 // Even after we got a new seg it doesn't necessarily mean we can allocate,
                 // another LOH allocating thread could have beat us to acquire the msl so 
                 // we need to try again.
@@ -12631,7 +13506,7 @@ BOOL gc_heap::allocate_large (int gen_number,
                 BOOL can_use_existing_p = FALSE;
 
                 can_use_existing_p = loh_try_fit (gen_number, size, acontext, 
-                                                  align_const, &commit_failed_p, &oom_r);
+                                                  align_const, poh_p, &commit_failed_p, &oom_r);
                 // Even after we got a new seg it doesn't necessarily mean we can allocate,
                 // another LOH allocating thread could have beat us to acquire the msl so 
                 // we need to try again. However, if we failed to commit, which means we 
@@ -12651,7 +13526,7 @@ BOOL gc_heap::allocate_large (int gen_number,
                 BOOL can_use_existing_p = FALSE;
 
                 can_use_existing_p = loh_try_fit (gen_number, size, acontext, 
-                                                  align_const, &commit_failed_p, &oom_r);
+                                                  align_const, poh_p, &commit_failed_p, &oom_r);
                 loh_alloc_state = (can_use_existing_p ? a_state_can_allocate : a_state_cant_allocate);
                 assert ((loh_alloc_state == a_state_can_allocate) == (acontext->alloc_ptr != 0));
                 assert ((loh_alloc_state != a_state_cant_allocate) || (oom_r != oom_no_failure));
@@ -12663,7 +13538,7 @@ BOOL gc_heap::allocate_large (int gen_number,
                 BOOL can_use_existing_p = FALSE;
 
                 can_use_existing_p = loh_try_fit (gen_number, size, acontext, 
-                                                  align_const, &commit_failed_p, &oom_r);
+                                                  align_const, poh_p, &commit_failed_p, &oom_r);
                 loh_alloc_state = (can_use_existing_p ?
                                         a_state_can_allocate : 
                                         (commit_failed_p ? 
@@ -12678,7 +13553,7 @@ BOOL gc_heap::allocate_large (int gen_number,
                 BOOL can_use_existing_p = FALSE;
 
                 can_use_existing_p = loh_try_fit (gen_number, size, acontext, 
-                                                  align_const, &commit_failed_p, &oom_r);
+                                                  align_const, poh_p, &commit_failed_p, &oom_r);
                 loh_alloc_state = (can_use_existing_p ?
                                         a_state_can_allocate : 
                                         (commit_failed_p ? 
@@ -12694,7 +13569,7 @@ BOOL gc_heap::allocate_large (int gen_number,
 
                 current_full_compact_gc_count = get_full_compact_gc_count();
 
-                can_get_new_seg_p = loh_get_new_seg (gen, size, align_const, &did_full_compacting_gc, &oom_r);
+                can_get_new_seg_p = loh_get_new_seg (gen, size, align_const, poh_p, &did_full_compacting_gc, &oom_r);
                 loh_alloc_state = (can_get_new_seg_p ? 
                                         a_state_try_fit_new_seg : 
                                         (did_full_compacting_gc ? 
@@ -12709,7 +13584,7 @@ BOOL gc_heap::allocate_large (int gen_number,
 
                 current_full_compact_gc_count = get_full_compact_gc_count();
 
-                can_get_new_seg_p = loh_get_new_seg (gen, size, align_const, &did_full_compacting_gc, &oom_r);
+                can_get_new_seg_p = loh_get_new_seg (gen, size, align_const, poh_p, &did_full_compacting_gc, &oom_r);
                 // Since we release the msl before we try to allocate a seg, other
                 // threads could have allocated a bunch of segments before us so
                 // we might need to retry.
@@ -12725,7 +13600,7 @@ BOOL gc_heap::allocate_large (int gen_number,
              
                 current_full_compact_gc_count = get_full_compact_gc_count();
 
-                can_get_new_seg_p = loh_get_new_seg (gen, size, align_const, &did_full_compacting_gc, &oom_r); 
+                can_get_new_seg_p = loh_get_new_seg (gen, size, align_const, poh_p, &did_full_compacting_gc, &oom_r); 
                 loh_alloc_state = (can_get_new_seg_p ? 
                                         a_state_try_fit_new_seg : 
                                         (did_full_compacting_gc ? 
@@ -12812,7 +13687,7 @@ exit:
 }
 
 int gc_heap::try_allocate_more_space (alloc_context* acontext, size_t size,
-                                   int gen_number)
+                                   int gen_number, BOOL poh_p)
 {
     if (gc_heap::gc_started)
     {
@@ -12902,7 +13777,7 @@ int gc_heap::try_allocate_more_space (alloc_context* acontext, size_t size,
 
     BOOL can_allocate = ((gen_number == 0) ?
         allocate_small (gen_number, size, acontext, align_const) :
-        allocate_large (gen_number, size, acontext, align_const));
+        allocate_large (gen_number, size, acontext, align_const, poh_p));
    
     if (can_allocate)
     {
@@ -12949,6 +13824,15 @@ void gc_heap::balance_heaps (alloc_context* acontext)
             acontext->alloc_heap = acontext->home_heap;
             hp->alloc_context_count++;
         }
+        else if (acontext->alloc_heap->pGenGCHeap->heap_number >= n_active_heaps)
+        {
+            // The number of active heaps went down since this context picked its heap.
+            gc_heap* org_hp = acontext->alloc_heap->pGenGCHeap;
+            acontext->home_heap = GCHeap::GetHeap( heap_select::select_heap(acontext, 0) );
+            acontext->alloc_heap = acontext->home_heap;
+            org_hp->alloc_context_count--;
+            acontext->alloc_heap->pGenGCHeap->alloc_context_count++;
+        }
     }
     else
     {
@@ -12971,6 +13855,11 @@ void gc_heap::balance_heaps (alloc_context* acontext)
                 set_home_heap = TRUE;
         }
 
+        if (acontext->alloc_heap->pGenGCHeap->heap_number >= n_active_heaps)
+        {
+            set_home_heap = TRUE;
+        }
+
         if (set_home_heap)
         {
 /*
@@ -13017,6 +13906,8 @@ try_again:
                     for (int i = start; i < end; i++)
                     {
                         gc_heap* hp = GCHeap::GetHeap(i%n_heaps)->pGenGCHeap;
+                        if (hp->heap_number >= n_active_heaps)
+                            continue;
                         dd = hp->dynamic_data_of (0);
                         ptrdiff_t size = dd_new_allocation (dd);
                         if (hp == acontext->home_heap->pGenGCHeap)
@@ -13042,6 +13933,12 @@ try_again:
                     goto try_again;
                 }
 
+                if (max_hp->heap_number >= n_active_heaps)
+                {
+                    // Nothing was better than the inactive heap we were on, go to our home heap.
+                    max_hp = acontext->home_heap->pGenGCHeap;
+                }
+
                 if (max_hp != org_hp)
                 {
                     org_hp->alloc_context_count--;
@@ -13130,6 +14027,8 @@ try_again:
             for (int i = start; i < end; i++)
             {
                 gc_heap* hp = GCHeap::GetHeap(i%n_heaps)->pGenGCHeap;
+                if (hp->heap_number >= n_active_heaps)
+                    continue;
                 dd = hp->dynamic_data_of (max_generation + 1);
                 ptrdiff_t size = dd_new_allocation (dd);
                 dprintf (3, ("hp: %d, size: %d",
@@ -13153,6 +14052,11 @@ try_again:
             goto try_again;
         }
 
+        if (max_hp->heap_number >= n_active_heaps)
+        {
+            max_hp = GCHeap::GetHeap (heap_select::select_heap (acontext, 0))->pGenGCHeap;
+        }
+
         if (max_hp != org_hp)
         {
             dprintf (3, ("loh: %d(%Id)->%d(%Id)", 
@@ -13167,10 +14071,120 @@ try_again:
         return org_hp;
     }
 }
+
+// How many blocking GCs we look at before deciding whether to change the number of active heaps.
+#define DHC_GCS_PER_SAMPLE 5
+// If we spend at least this % of the time in GC, we grow the number of active heaps.
+#define DHC_HIGH_GC_PCT 5
+// If we spend less than this % of the time in GC for DHC_LOW_SAMPLES_TO_SHRINK samples in a row,
+// we shrink the number of active heaps.
+#define DHC_LOW_GC_PCT 1
+#define DHC_LOW_SAMPLES_TO_SHRINK 3
+// If the allocation rate in the sample after a shrink dropped by at least this % while the
+// % of time in GC went up, the shrink cost throughput - we go back to the heaps we had and
+// don't shrink again for DHC_SHRINK_BACKOFF_SAMPLES samples.
+#define DHC_THROUGHPUT_LOSS_PCT 10
+#define DHC_SHRINK_BACKOFF_SAMPLES 10
+
+// This is called by the thread that does the last join of a blocking GC. Fewer active heaps means
+// a smaller total gen0 budget and so a smaller working set, at the cost of GCing more often - so
+// we grow the active heaps quickly when too much time goes to GC and shrink them slowly when
+// very little does.
+//
+// The pause cost alone doesn't tell us whether allocating threads got slower, e.g. because
+// they now contend on fewer heaps, so we also compare the allocation rate of the sample after
+// a shrink with the one before it.
+//
+// An idle GC (see GCHeap::PerformIdleWork) ends the sample right away - the process hasn't
+// allocated enough to trigger a GC for a while so we don't need to wait for more GCs to know
+// we can shrink.
+void gc_heap::update_active_heap_count()
+{
+    dynamic_heap_count_data_t* data = &dynamic_heap_count_data;
+    uint64_t now = GCToOSInterface::QueryPerformanceCounter();
+    BOOL idle_p = (settings.reason == reason_idle);
+
+    data->sample_gc_pause += now - data->gc_start_ts;
+    data->sample_gc_count++;
+
+    if (!idle_p && (data->sample_gc_count < DHC_GCS_PER_SAMPLE))
+    {
+        return;
+    }
+
+    uint64_t elapsed = now - data->sample_start_ts;
+    int gc_pct = ((elapsed == 0) ? 0 : (int)((data->sample_gc_pause * 100) / elapsed));
+    uint64_t elapsed_ms = (elapsed * 1000) / qpf;
+    uint64_t alloc_rate = ((elapsed_ms == 0) ? 0 : (data->sample_alloc_bytes / elapsed_ms));
+    int new_n_active_heaps = n_active_heaps;
+
+    if (data->shrink_backoff_samples > 0)
+    {
+        data->shrink_backoff_samples--;
+    }
+
+    if (idle_p)
+    {
+        // Nothing to compare the idle sample's throughput with.
+        data->alloc_rate_before_shrink = 0;
+        data->shrink_backoff_samples = 0;
+        data->low_cost_samples = 0;
+        new_n_active_heaps = max (1, (n_active_heaps - max (1, (n_active_heaps / 4))));
+    }
+    else if (data->alloc_rate_before_shrink && 
+             (gc_pct > data->gc_pct_before_shrink) &&
+             (alloc_rate < (data->alloc_rate_before_shrink * (100 - DHC_THROUGHPUT_LOSS_PCT) / 100)))
+    {
+        new_n_active_heaps = max (n_active_heaps, data->n_active_heaps_before_shrink);
+        data->shrink_backoff_samples = DHC_SHRINK_BACKOFF_SAMPLES;
+        data->low_cost_samples = 0;
+    }
+    else if (gc_pct >= DHC_HIGH_GC_PCT)
+    {
+        new_n_active_heaps = min (n_heaps, (n_active_heaps * 2));
+        data->low_cost_samples = 0;
+    }
+    else if (gc_pct < DHC_LOW_GC_PCT)
+    {
+        data->low_cost_samples++;
+        if ((data->low_cost_samples >= DHC_LOW_SAMPLES_TO_SHRINK) && (data->shrink_backoff_samples == 0))
+        {
+            new_n_active_heaps = max (1, (n_active_heaps - max (1, (n_active_heaps / 4))));
+            data->low_cost_samples = 0;
+        }
+    }
+    else
+    {
+        data->low_cost_samples = 0;
+    }
+
+    dprintf (1, ("dhc: %d GCs took %d%% of the time, alloc rate %I64d bytes/ms, active heaps %d->%d%s", 
+        data->sample_gc_count, gc_pct, alloc_rate, n_active_heaps, new_n_active_heaps,
+        (idle_p ? " (idle)" : "")));
+
+    // We only check the throughput of the sample right after a shrink.
+    if (!idle_p && (new_n_active_heaps < n_active_heaps))
+    {
+        data->alloc_rate_before_shrink = alloc_rate;
+        data->gc_pct_before_shrink = gc_pct;
+        data->n_active_heaps_before_shrink = n_active_heaps;
+    }
+    else
+    {
+        data->alloc_rate_before_shrink = 0;
+    }
+
+    n_active_heaps = new_n_active_heaps;
+
+    data->sample_start_ts = now;
+    data->sample_gc_pause = 0;
+    data->sample_gc_count = 0;
+    data->sample_alloc_bytes = 0;
+}
 #endif //MULTIPLE_HEAPS
 
 BOOL gc_heap::allocate_more_space(alloc_context* acontext, size_t size,
-                                  int alloc_generation_number)
+                                  int alloc_generation_number, BOOL poh_p)
 {
     int status;
     do
@@ -13179,15 +14193,15 @@ BOOL gc_heap::allocate_more_space(alloc_context* acontext, size_t size,
         if (alloc_generation_number == 0)
         {
             balance_heaps (acontext);
-            status = acontext->alloc_heap->pGenGCHeap->try_allocate_more_space (acontext, size, alloc_generation_number);
+            status = acontext->alloc_heap->pGenGCHeap->try_allocate_more_space (acontext, size, alloc_generation_number, poh_p);
         }
         else
         {
             gc_heap* alloc_heap = balance_heaps_loh (acontext, size);
-            status = alloc_heap->try_allocate_more_space (acontext, size, alloc_generation_number);
+            status = alloc_heap->try_allocate_more_space (acontext, size, alloc_generation_number, poh_p);
         }
 #else
-        status = try_allocate_more_space (acontext, size, alloc_generation_number);
+        status = try_allocate_more_space (acontext, size, alloc_generation_number, poh_p);
 #endif //MULTIPLE_HEAPS
     }
     while (status == -1);
@@ -13218,7 +14232,7 @@ CObjectHeader* gc_heap::allocate (size_t jsize, alloc_context* acontext)
 #pragma inline_depth(0)
 #endif //_MSC_VER
 
-            if (! allocate_more_space (acontext, size, 0))
+            if (! allocate_more_space (acontext, size, 0, FALSE))
                 return 0;
 
 #ifdef _MSC_VER
@@ -14192,6 +15206,26 @@ int gc_heap::joined_generation_to_condemn (BOOL should_evaluate_elevation,
         settings.elevation_locked_count = 0;
     }
 
+    if (target_pause_us && (n == max_generation))
+    {
+        if (pause_target_defers_gen2_p (*blocking_collection_p))
+        {
+            n = max_generation - 1;
+        }
+        else
+        {
+            gen2_deferred_count = 0;
+        }
+    }
+
+    // Heap snapshots are only written at the end of blocking gen2s so a pending
+    // request makes the next gen2 a blocking one.
+    if ((n == max_generation) && heap_snapshot_requested_p && heap_snapshot_file_name)
+    {
+        dprintf (GTC_LOG, ("heap snapshot requested, gen2 will be blocking"));
+        *blocking_collection_p = TRUE;
+    }
+
 #ifdef STRESS_HEAP
 #ifdef BACKGROUND_GC
     // We can only do Concurrent GC Stress if the caller did not explicitly ask for all
@@ -14361,6 +15395,7 @@ int gc_heap::generation_to_condemn (int n_initial,
     BOOL high_memory_load    = FALSE;
     BOOL low_ephemeral_space = FALSE;
     BOOL evaluate_elevation  = TRUE;
+    BOOL finalization_lagging_p = FALSE;
     *elevation_requested_p   = FALSE;
     *blocking_collection_p   = FALSE;
 
@@ -14675,12 +15710,32 @@ int gc_heap::generation_to_condemn (int n_initial,
         }
     }
 
+    // If the finalizer is behind, what's waiting in its queue (and everything reachable from it)
+    // survives a gen2 anyway so under high (but not very high) memory load we don't do a gen2
+    // just because of the gen2 budget. Once the finalizer has caught up that's all garbage and
+    // that's when a gen2 is worth doing.
+#ifdef FEATURE_PREMORTEM_FINALIZATION
+    if (!check_only_p && high_memory_load && !v_high_memory_load && finalization_backed_up_p)
+    {
+        if (GCHeap::GetNumberFinalizableObjects() == 0)
+        {
+            dprintf (GTC_LOG, ("h%d: finalization drained", heap_number));
+            n = max_generation;
+            local_condemn_reasons->set_condition (gen_finalization_drained_p);
+        }
+        else
+        {
+            finalization_lagging_p = TRUE;
+        }
+    }
+#endif //FEATURE_PREMORTEM_FINALIZATION
+
     if (evaluate_elevation && (low_ephemeral_space || high_memory_load || v_high_memory_load))
     {
         *elevation_requested_p = TRUE;
 #ifdef BIT64
         // if we are in high memory load and have consumed 10% of the gen2 budget, do a gen2 now.
-        if (high_memory_load || v_high_memory_load)
+        if ((high_memory_load || v_high_memory_load) && !finalization_lagging_p)
         {
             dynamic_data* dd_max = dynamic_data_of (max_generation);
             if (((float)dd_new_allocation (dd_max) / (float)dd_desired_allocation (dd_max)) < 0.9)
@@ -15032,6 +16087,16 @@ void gc_heap::gc1()
     mark_time = plan_time = reloc_time = compact_time = sweep_time = 0;
 #endif //TIME_GC
 
+    if (heap_number == 0)
+    {
+#ifdef BACKGROUND_GC
+        if (settings.concurrent)
+            bgc_info_start_ts = GCToOSInterface::QueryPerformanceCounter();
+        else
+#endif //BACKGROUND_GC
+            gc_info_start_ts = GCToOSInterface::QueryPerformanceCounter();
+    }
+
     verify_soh_segment_list();
 
     int n = settings.condemned_generation;
@@ -15209,14 +16274,18 @@ void gc_heap::gc1()
 #endif //BACKGROUND_GC
 
     int bottom_gen = 0;
+    int top_gen = max_generation + 1;
 #ifdef BACKGROUND_GC
     if (settings.concurrent) 
     {
         bottom_gen = max_generation;
+        // LOH budget was refreshed when LOH was done being swept, resetting it
+        // here would drop what's been allocated in LOH since.
+        top_gen = max_generation;
     }
 #endif //BACKGROUND_GC
     {
-        for (int gen_number = bottom_gen; gen_number <= max_generation+1; gen_number++)
+        for (int gen_number = bottom_gen; gen_number <= top_gen; gen_number++)
         {
             dynamic_data* dd = dynamic_data_of (gen_number);
             dd_new_allocation(dd) = dd_gc_new_allocation (dd);
@@ -15257,10 +16326,12 @@ void gc_heap::gc1()
         //decide on the next allocation quantum
         if (alloc_contexts_used >= 1)
         {
-            allocation_quantum = Align (min ((size_t)CLR_SIZE,
-                                            (size_t)max (1024, get_new_allocation (0) / (2 * alloc_contexts_used))),
+            size_t budget_share = (size_t)max (1024, get_new_allocation (0) / (2 * alloc_contexts_used));
+            allocation_quantum = Align (min ((size_t)CLR_SIZE, budget_share),
                                             get_alignment_constant(FALSE));
-            dprintf (3, ("New allocation quantum: %d(0x%Ix)", allocation_quantum, allocation_quantum));
+            alloc_quantum_limit = Align (min (MAX_ALLOC_QUANTUM, budget_share), 
+                                         get_alignment_constant(FALSE));
+            dprintf (3, ("New allocation quantum: %d(0x%Ix), limit %Id", allocation_quantum, allocation_quantum, alloc_quantum_limit));
         }
     }
 #ifdef NO_WRITE_BARRIER
@@ -15402,6 +16473,19 @@ void gc_heap::gc1()
         {
             gc_heap::internal_gc_done = false;
 
+            // Budgets for the generations we allocate in (gen0 and LOH) are only for the heaps
+            // we were allocating on; the new active heaps each get the average of those.
+            int prev_n_active_heaps = n_active_heaps;
+            if (dynamic_heap_count_p)
+            {
+                update_active_heap_count();
+            }
+
+            if (target_pause_us)
+            {
+                record_pause_for_target();
+            }
+
             //equalize the new desired size of the generations
             int limit = settings.condemned_generation;
             if (limit == max_generation)
@@ -15411,8 +16495,10 @@ void gc_heap::gc1()
             for (int gen = 0; gen <= limit; gen++)
             {
                 size_t total_desired = 0;
+                BOOL alloc_gen_p = ((gen == 0) || (gen == (max_generation + 1)));
+                int n_budget_heaps = (alloc_gen_p ? prev_n_active_heaps : gc_heap::n_heaps);
 
-                for (int i = 0; i < gc_heap::n_heaps; i++)
+                for (int i = 0; i < n_budget_heaps; i++)
                 {
                     gc_heap* hp = gc_heap::g_heaps[i];
                     dynamic_data* dd = hp->dynamic_data_of (gen);
@@ -15426,7 +16512,7 @@ void gc_heap::gc1()
                     total_desired = temp_total_desired;
                 }
 
-                size_t desired_per_heap = Align (total_desired/gc_heap::n_heaps,
+                size_t desired_per_heap = Align (total_desired/n_budget_heaps,
                                                     get_alignment_constant ((gen != (max_generation+1))));
 
                 if (gen == 0)
@@ -15460,6 +16546,11 @@ void gc_heap::gc1()
                     dprintf (2, ("final gen0 new_alloc: %Id", desired_per_heap));
 #endif // BIT64
 
+                    if (gen0_tuning_p)
+                    {
+                        desired_per_heap = adapt_gen0_budget (desired_per_heap);
+                    }
+
                     gc_data_global.final_youngest_desired = desired_per_heap;
                 }
 #if 1 //subsumed by the linear allocation model 
@@ -15481,13 +16572,17 @@ void gc_heap::gc1()
                 {
                     gc_heap* hp = gc_heap::g_heaps[i];
                     dynamic_data* dd = hp->dynamic_data_of (gen);
-                    dd_desired_allocation (dd) = desired_per_heap;
-                    dd_gc_new_allocation (dd) = desired_per_heap;
-                    dd_new_allocation (dd) = desired_per_heap;
+                    // Nothing allocates on inactive heaps; giving them the minimum budget lets
+                    // us decommit what they had for gen0.
+                    size_t heap_desired = ((alloc_gen_p && (i >= n_active_heaps)) ? 
+                                           dd_min_size (dd) : desired_per_heap);
+                    dd_desired_allocation (dd) = heap_desired;
+                    dd_gc_new_allocation (dd) = heap_desired;
+                    dd_new_allocation (dd) = heap_desired;
 
                     if (gen == 0)
                     {
-                        hp->fgn_last_alloc = desired_per_heap;
+                        hp->fgn_last_alloc = heap_desired;
                     }
                 }
             }
@@ -15505,19 +16600,43 @@ void gc_heap::gc1()
 #endif //FEATURE_LOH_COMPACTION
             }
 
+            decommit_standby_segments();
+
 #ifdef FEATURE_LOH_COMPACTION
             check_loh_compact_mode (all_heaps_compacted_p);
 #endif //FEATURE_LOH_COMPACTION
 
             fire_pevents();
+            record_gc_info();
+
+            heap_snapshot_p = should_write_heap_snapshot();
 
             gc_t_join.restart();
         }
         alloc_context_count = 0;
         heap_select::mark_heap (heap_number);
+
+        if (heap_snapshot_p)
+        {
+            write_heap_snapshot();
+        }
     }
 
 #else
+    if (target_pause_us && !settings.concurrent)
+    {
+        record_pause_for_target();
+    }
+
+    if (gen0_tuning_p && !settings.concurrent)
+    {
+        dynamic_data* dd = dynamic_data_of (0);
+        size_t desired = adapt_gen0_budget (dd_desired_allocation (dd));
+        dd_desired_allocation (dd) = desired;
+        dd_gc_new_allocation (dd) = desired;
+        dd_new_allocation (dd) = desired;
+    }
+
     gc_data_global.final_youngest_desired = 
         dd_desired_allocation (dynamic_data_of (0));
 
@@ -15525,10 +16644,18 @@ void gc_heap::gc1()
 
     decommit_ephemeral_segment_pages();
     fire_pevents();
+    record_gc_info();
 
     if (!(settings.concurrent))
     {
         rearrange_large_heap_segments();
+        decommit_standby_segments();
+
+        if (should_write_heap_snapshot())
+        {
+            write_heap_snapshot();
+        }
+
         do_post_gc();
     }
 
@@ -15674,27 +16801,22 @@ void gc_heap::record_gcs_during_no_gc()
 BOOL gc_heap::find_loh_free_for_no_gc()
 {
     allocator* loh_allocator = generation_allocator (generation_of (max_generation + 1));
-    size_t sz_list = loh_allocator->first_bucket_size();
     size_t size = loh_allocation_no_gc;
-    for (unsigned int a_l_idx = 0; a_l_idx < loh_allocator->number_of_buckets(); a_l_idx++)
+    for (unsigned int a_l_idx = loh_allocator->bucket_of (size); a_l_idx < loh_allocator->number_of_buckets(); a_l_idx++)
     {
-        if ((size < sz_list) || (a_l_idx == (loh_allocator->number_of_buckets()-1)))
+        uint8_t* free_list = loh_allocator->alloc_list_head_of (a_l_idx);
+        while (free_list)
         {
-            uint8_t* free_list = loh_allocator->alloc_list_head_of (a_l_idx);
-            while (free_list)
-            {
-                size_t free_list_size = unused_array_size(free_list);
+            size_t free_list_size = unused_array_size(free_list);
 
-                if (free_list_size > loh_allocation_no_gc)
-                {
-                    dprintf (3, ("free item %Ix(%Id) for no gc", (size_t)free_list, free_list_size));
-                    return TRUE;
-                }
-
-                free_list = free_list_slot (free_list); 
+            if (free_list_size > loh_allocation_no_gc)
+            {
+                dprintf (3, ("free item %Ix(%Id) for no gc", (size_t)free_list, free_list_size));
+                return TRUE;
             }
+
+            free_list = free_list_slot (free_list); 
         }
-        sz_list = sz_list * 2;
     }
 
     return FALSE;
@@ -16254,6 +17376,22 @@ int gc_heap::garbage_collect (int n)
 #endif //TRACE_GC
 
 #ifdef MULTIPLE_HEAPS
+            if (dynamic_heap_count_p)
+            {
+                dynamic_heap_count_data.gc_start_ts = GCToOSInterface::QueryPerformanceCounter();
+
+                // What's been used of the gen0 budgets since the last GC is what we allocated.
+                for (int i = 0; i < n_heaps; i++)
+                {
+                    dynamic_data* dd0 = g_heaps[i]->dynamic_data_of (0);
+                    ptrdiff_t allocated = (ptrdiff_t)dd_desired_allocation (dd0) - dd_new_allocation (dd0);
+                    if (allocated > 0)
+                    {
+                        dynamic_heap_count_data.sample_alloc_bytes += (uint64_t)allocated;
+                    }
+                }
+            }
+
 #if !defined(SEG_MAPPING_TABLE) && !defined(FEATURE_BASICFREEZE)
             //delete old slots from the segment table
             seg_table->delete_old_slots();
@@ -16328,6 +17466,24 @@ int gc_heap::garbage_collect (int n)
 
         record_gcs_during_no_gc();
 
+        if (gen0_tuning_p)
+        {
+            record_gen0_tuning_start();
+        }
+
+#ifdef FEATURE_PREMORTEM_FINALIZATION
+        // The memory load is only measured for some GCs so only update this when 
+        // we have a fresh one. Whatever is still on the finalization queues at 
+        // this point was found by earlier GCs and the finalizer hasn't caught up.
+        if (settings.entry_memory_load != 0)
+        {
+            finalization_backed_up_p = ((settings.entry_memory_load >= high_memory_load_th) &&
+                                        (GCHeap::GetNumberFinalizableObjects() != 0));
+            dprintf (GTC_LOG, ("ml %d, finalization %s", settings.entry_memory_load, 
+                (finalization_backed_up_p ? "backed up" : "ok")));
+        }
+#endif //FEATURE_PREMORTEM_FINALIZATION
+
         if (settings.condemned_generation > 1)
             settings.promotion = TRUE;
 
@@ -17302,6 +18458,7 @@ void gc_heap::save_post_plug_info (uint8_t* last_pinned_plug, uint8_t* last_obje
 
 //#define PREFETCH
 #ifdef PREFETCH
+#if defined(_MSC_VER) && defined(_X86_)
 __declspec(naked) void __fastcall Prefetch(void* addr)
 {
    __asm {
@@ -17309,12 +18466,80 @@ __declspec(naked) void __fastcall Prefetch(void* addr)
         ret
     };
 }
+#elif defined(__GNUC__) || defined(__clang__)
+inline void Prefetch (void* addr)
+{
+    __builtin_prefetch (addr);
+}
+#else
+inline void Prefetch (void* addr)
+{
+    UNREFERENCED_PARAMETER(addr);
+}
+#endif
 #else //PREFETCH
 inline void Prefetch (void* addr)
 {
     UNREFERENCED_PARAMETER(addr);
 }
 #endif //PREFETCH
+
+// A small FIFO of objects popped off a mark stack. Instead of scanning
+// an object right after we pop it (and waiting on its header) we prefetch 
+// it and scan the one that was prefetched mark_prefetch_depth pops ago.
+// Objects in the queue are already marked so it needs to be emptied 
+// before marking is done. Prefetch is a no-op unless PREFETCH is defined
+// so mark_prefetch_depth stays 0 without it.
+class mark_prefetch_queue
+{
+    uint8_t* items[MARK_PREFETCH_MAX_DEPTH];
+    int depth;
+    int head;
+    int count;
+
+public:
+    mark_prefetch_queue (int d) : depth (d), head (0), count (0)
+    {
+        assert (depth <= MARK_PREFETCH_MAX_DEPTH);
+    }
+
+    BOOL enabled_p()
+    {
+        return (depth != 0);
+    }
+
+    BOOL empty_p()
+    {
+        return (count == 0);
+    }
+
+    // Returns the object to scan now which is 0 if the queue isn't full yet.
+    uint8_t* push (uint8_t* o)
+    {
+        Prefetch (o);
+
+        if (count < depth)
+        {
+            items[(head + count) % depth] = o;
+            count++;
+            return 0;
+        }
+
+        uint8_t* oldest = items[head];
+        items[head] = o;
+        head = (head + 1) % depth;
+        return oldest;
+    }
+
+    uint8_t* pop()
+    {
+        assert (count > 0);
+        uint8_t* oldest = items[head];
+        head = (head + 1) % depth;
+        count--;
+        return oldest;
+    }
+};
 #ifdef MH_SC_MARK
 inline
 VOLATILE(uint8_t*)& gc_heap::ref_mark_stack (gc_heap* hp, int index)
@@ -17376,6 +18601,8 @@ void gc_heap::mark_object_simple1 (uint8_t* oo, uint8_t* start THREAD_NUMBER_DCL
     // update mark list.
     BOOL  full_p = (settings.condemned_generation == max_generation);
 
+    mark_prefetch_queue prefetch_queue (mark_prefetch_depth);
+
     assert ((start >= oo) && (start < oo+size(oo)));
 
 #ifndef MH_SC_MARK
@@ -17575,11 +18802,24 @@ more_to_do:
         if (!(mark_stack_empty_p()))
         {
             oo = *(--mark_stack_tos);
-            start = oo;
 
 #ifdef SORT_MARK_STACK
             sorted_tos = min ((size_t)sorted_tos, (size_t)mark_stack_tos);
 #endif //SORT_MARK_STACK
+
+            // Only whole objects go through the prefetch queue - partial marks
+            // and stolen entries depend on where they are on the mark stack.
+            if (prefetch_queue.enabled_p() && oo && ((size_t)oo != 4) && 
+                (((size_t)oo & (stolen | partial)) == 0))
+            {
+                oo = prefetch_queue.push (oo);
+            }
+            start = oo;
+        }
+        else if (!prefetch_queue.empty_p())
+        {
+            oo = prefetch_queue.pop();
+            start = oo;
         }
         else
             break;
@@ -17997,6 +19237,8 @@ void gc_heap::background_mark_simple1 (uint8_t* oo THREAD_NUMBER_DCL)
 
     background_mark_stack_tos = background_mark_stack_array;
 
+    mark_prefetch_queue prefetch_queue (mark_prefetch_depth);
+
     while (1)
     {
 #ifdef MULTIPLE_HEAPS
@@ -18169,7 +19411,32 @@ void gc_heap::background_mark_simple1 (uint8_t* oo THREAD_NUMBER_DCL)
         }
 #endif //SORT_MARK_STACK
 
-        allow_fgc();
+        if (prefetch_queue.empty_p())
+        {
+            allow_fgc();
+        }
+        else if (fgc_pending_p())
+        {
+            // A foreground GC only relocates what's on the mark stack so 
+            // the queued objects need to go back there before we let it in.
+            while (!prefetch_queue.empty_p())
+            {
+                uint8_t* queued_o = prefetch_queue.pop();
+                if (background_mark_stack_tos < mark_stack_limit)
+                {
+                    *(background_mark_stack_tos++) = queued_o;
+                }
+                else
+                {
+                    dprintf (3,("mark stack overflow for object %Ix ", (size_t)queued_o));
+                    bgc_overflow_count++;
+                    background_min_overflow_address = min (background_min_overflow_address, queued_o);
+                    background_max_overflow_address = max (background_max_overflow_address, queued_o);
+                }
+            }
+
+            allow_fgc();
+        }
 
         if (!(background_mark_stack_tos == background_mark_stack_array))
         {
@@ -18178,6 +19445,16 @@ void gc_heap::background_mark_simple1 (uint8_t* oo THREAD_NUMBER_DCL)
 #ifdef SORT_MARK_STACK
             sorted_tos = (uint8_t**)min ((size_t)sorted_tos, (size_t)background_mark_stack_tos);
 #endif //SORT_MARK_STACK
+
+            // Partial marks need to stay where they are on the mark stack.
+            if (prefetch_queue.enabled_p() && oo && (((size_t)oo & 1) == 0))
+            {
+                oo = prefetch_queue.push (oo);
+            }
+        }
+        else if (!prefetch_queue.empty_p())
+        {
+            oo = prefetch_queue.pop();
         }
         else
             break;
@@ -18451,10 +19728,9 @@ void gc_heap::fix_card_table ()
 #ifdef TIME_WRITE_WATCH
             unsigned int time_start = GetCycleCount32();
 #endif //TIME_WRITE_WATCH
-            bool success = GCToOSInterface::GetWriteWatch(reset_watch_state, base_address, region_size,
-                                                          (void**)g_addresses,
-                                                          &bcount);
-            assert (success);
+            get_write_watch_for_gc_heap(reset_watch_state, base_address, region_size,
+                                        (void**)g_addresses,
+                                        &bcount, true);
 
 #ifdef TIME_WRITE_WATCH
             unsigned int time_stop = GetCycleCount32();
@@ -18491,7 +19767,7 @@ void gc_heap::fix_card_table ()
             align_on_page (generation_allocation_start (generation_of (0)));
         size_t region_size =
             heap_segment_allocated (ephemeral_heap_segment) - base_address;
-        GCToOSInterface::ResetWriteWatch (base_address, region_size);
+        reset_write_watch_for_gc_heap (base_address, region_size);
     }
 #endif //BACKGROUND_GC
 #endif //WRITE_WATCH
@@ -18909,15 +20185,43 @@ void gc_heap::get_memory_info (uint32_t* memory_load,
                                uint64_t* available_physical,
                                uint64_t* available_page_file)
 {
-    if (restricted_physical_memory_p)
+    if (restricted_physical_memory_p || heap_hard_limit)
     {
-        size_t working_set_size = GCToOSInterface::GetCurrentPhysicalMemory();
-        if (working_set_size)
+        bool got_info_p = false;
+        uint32_t restricted_load = 0;
+        uint64_t restricted_available = 0;
+
+        if (restricted_physical_memory_p)
+        {
+            size_t working_set_size = GCToOSInterface::GetCurrentPhysicalMemory();
+            if (working_set_size)
+            {
+                restricted_load = (uint32_t)((float)working_set_size * 100.0 / (float)total_physical_mem);
+                restricted_available = ((total_physical_mem > working_set_size) ? 
+                                        (total_physical_mem - working_set_size) : 0);
+                got_info_p = true;
+            }
+        }
+
+        if (heap_hard_limit)
+        {
+            // The load is how close we are to the hard limit; if we are also restricted on 
+            // physical memory, whichever one we are closer to is what matters.
+            size_t committed = current_total_committed;
+            uint32_t hard_limit_load = (uint32_t)((float)committed * 100.0 / (float)heap_hard_limit);
+            uint64_t hard_limit_available = ((heap_hard_limit > committed) ? (heap_hard_limit - committed) : 0);
+
+            restricted_load = (got_info_p ? max (restricted_load, hard_limit_load) : hard_limit_load);
+            restricted_available = (got_info_p ? min (restricted_available, hard_limit_available) : hard_limit_available);
+            got_info_p = true;
+        }
+
+        if (got_info_p)
         {
             if (memory_load)
-                *memory_load = (uint32_t)((float)working_set_size * 100.0 / (float)total_physical_mem);
+                *memory_load = restricted_load;
             if (available_physical)
-                *available_physical = total_physical_mem - working_set_size;
+                *available_physical = restricted_available;
             // Available page file doesn't mean much when physical memory is restricted since
             // we don't know how much of it is available to this process so we are not going to 
             // bother to make another OS call for it.
@@ -19254,6 +20558,7 @@ void gc_heap::mark_phase (int condemned_gen_number, BOOL mark_only_p)
     unsigned finish;
     start = GetCycleCount32();
 #endif //TIME_GC
+    int64_t phase_start_ts = GCToOSInterface::QueryPerformanceCounter();
 
     int gen_to_init = condemned_gen_number;
     if (condemned_gen_number == max_generation)
@@ -19738,6 +21043,7 @@ void gc_heap::mark_phase (int condemned_gen_number, BOOL mark_only_p)
         finish = GetCycleCount32();
         mark_time = finish - start;
 #endif //TIME_GC
+    record_phase_time (gc_phase_mark, phase_start_ts);
 
     dprintf(2,("---- End of mark phase ----"));
 }
@@ -20032,7 +21338,7 @@ size_t gc_heap::update_brick_table (uint8_t* tree, size_t current_brick,
     dprintf (3, ("tree: %Ix, current b: %Ix, x: %Ix, plug_end: %Ix",
         tree, current_brick, x, plug_end));
 
-    if (tree > 0)
+    if (tree != NULL)
     {
         dprintf (3, ("b- %Ix->%Ix pointing to tree %Ix", 
             current_brick, (size_t)(tree - brick_address (current_brick)), tree));
@@ -20641,7 +21947,53 @@ retry:
 
 BOOL gc_heap::should_compact_loh()
 {
-    return (loh_compaction_always_p || (loh_compaction_mode != loh_compaction_default));
+    loh_compaction_incremental_p = FALSE;
+
+    if (loh_compaction_always_p || (loh_compaction_mode != loh_compaction_default))
+        return TRUE;
+
+    // When we are about to throw OOM because of the hard limit, the last GC also compacts LOH
+    // so what's freed there can be decommitted.
+    if (heap_hard_limit)
+    {
+#ifdef MULTIPLE_HEAPS
+        for (int i = 0; i < n_heaps; i++)
+        {
+            if (g_heaps[i]->last_gc_before_oom)
+                return TRUE;
+        }
+#else //MULTIPLE_HEAPS
+        if (last_gc_before_oom)
+            return TRUE;
+#endif //MULTIPLE_HEAPS
+    }
+
+    // With a budget each full blocking GC that compacts SOH also moves a bounded amount
+    // of large objects on the heaps whose LOH is fragmented (see loh_incremental_compact_p), so
+    // fragmentation is recovered over several GCs instead of in one long pause.
+    if (loh_compaction_budget != 0)
+    {
+        loh_compaction_incremental_p = TRUE;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+BOOL gc_heap::loh_incremental_compact_p()
+{
+    generation* gen = large_object_generation;
+    size_t free_space = generation_free_list_space (gen) + generation_free_obj_space (gen);
+    size_t loh_size = generation_size (max_generation + 1);
+
+    BOOL compact_p = ((free_space >= loh_compaction_budget) &&
+                      ((free_space * 100) >= (loh_size * LOH_INCREMENTAL_COMPACT_FRAG_PERCENT)));
+
+    dprintf (GTC_LOG, ("h%d: loh free %Id of %Id, budget %Id -> %s", 
+        heap_number, free_space, loh_size, loh_compaction_budget,
+        (compact_p ? "compact" : "sweep")));
+
+    return compact_p;
 }
 
 inline
@@ -20709,6 +22061,7 @@ BOOL gc_heap::plan_loh()
     uint8_t* free_space_start = o;
     uint8_t* free_space_end = o;
     uint8_t* new_address = 0;
+    size_t moved_size = 0;
 
     while (1)
     {
@@ -20729,7 +22082,18 @@ BOOL gc_heap::plan_loh()
             size_t size = AlignQword (size (o));
             dprintf (1235, ("%Ix(%Id) M", o, size));
 
-            if (pinned (o))
+            // When incremental compaction has used up its budget the rest of 
+            // the objects stay where they are. We pin them so compact_loh 
+            // handles them (and the gaps in front of them) like user pins.
+            if (loh_compaction_incremental_p && (moved_size >= loh_compaction_budget) && 
+                !pinned (o) && !heap_segment_poh_p (seg))
+            {
+                set_pinned (o);
+            }
+
+            // Objects on POH segments are never moved so we treat them
+            // as if they were pinned.
+            if (pinned (o) || heap_segment_poh_p (seg))
             {
                 // We don't clear the pinned bit yet so we can check in 
                 // compact phase how big a free object we should allocate
@@ -20744,6 +22108,10 @@ BOOL gc_heap::plan_loh()
             else
             {
                 new_address = loh_allocate_in_condemned (o, size);
+                if (new_address != o)
+                {
+                    moved_size += size;
+                }
             }
 
             loh_set_node_relocation_distance (o, (new_address - o));
@@ -20806,12 +22174,16 @@ BOOL gc_heap::plan_loh()
     generation_allocation_pointer (gen) = 0;
     generation_allocation_limit (gen) = 0;
 
+    dprintf (GTC_LOG, ("h%d: loh plan moves %Id bytes", heap_number, moved_size));
+
     return TRUE;
 }
 
 void gc_heap::compact_loh()
 {
-    assert (should_compact_loh());
+    // should_compact_loh could have changed since we decided (last_gc_before_oom gets reset
+    // during planning) so check what we decided for this GC.
+    assert (settings.loh_compaction);
 
     generation* gen        = large_object_generation;
     heap_segment* start_seg = heap_segment_rw (generation_start_segment (gen));
@@ -20891,7 +22263,7 @@ void gc_heap::compact_loh()
             uint8_t* reloc = o;
             clear_marked (o);
 
-            if (pinned (o))
+            if (pinned (o) || heap_segment_poh_p (seg))
             {
                 // We are relying on the fact the pinned objects are always looked at in the same order 
                 // in plan phase and in compact phase.
@@ -20934,6 +22306,8 @@ void gc_heap::compact_loh()
         generation_size (max_generation + 1), 
         generation_free_list_space (gen),
         generation_free_obj_space (gen)));
+
+    fire_loh_free_list_event();
 }
 
 void gc_heap::relocate_in_loh_compact()
@@ -21189,6 +22563,7 @@ void gc_heap::plan_phase (int condemned_gen_number)
     unsigned finish;
     start = GetCycleCount32();
 #endif //TIME_GC
+    int64_t phase_start_ts = GCToOSInterface::QueryPerformanceCounter();
 
     dprintf (2,("---- Plan Phase ---- Condemned generation %d, promotion: %d",
                 condemned_gen_number, settings.promotion ? 1 : 0));
@@ -22140,6 +23515,8 @@ void gc_heap::plan_phase (int condemned_gen_number)
     finish = GetCycleCount32();
     plan_time = finish - start;
 #endif //TIME_GC
+    get_gc_data_per_heap()->pinned_plug_count = mark_stack_tos;
+    record_phase_time (gc_phase_plan, phase_start_ts);
 
     // We may update write barrier code.  We assume here EE has been suspended if we are on a GC thread.
     assert(GCHeap::IsGCInProgress());
@@ -22184,7 +23561,11 @@ void gc_heap::plan_phase (int condemned_gen_number)
     if (condemned_gen_number == max_generation)
     {
 #ifdef FEATURE_LOH_COMPACTION
-        if (settings.loh_compaction)
+        // Incremental LOH compaction is there to keep pauses short so it only
+        // piggybacks on GCs that already compact SOH - it never turns a sweeping
+        // GC into a compacting one.
+        if (settings.loh_compaction && 
+            (!loh_compaction_incremental_p || (should_compact && loh_incremental_compact_p())))
         {
             if (plan_loh())
             {
@@ -22822,6 +24203,7 @@ void gc_heap::make_free_lists (int condemned_gen_number)
     unsigned finish;
     start = GetCycleCount32();
 #endif //TIME_GC
+    int64_t phase_start_ts = GCToOSInterface::QueryPerformanceCounter();
 
     //Promotion has to happen in sweep case.
     assert (settings.promotion);
@@ -22942,6 +24324,7 @@ void gc_heap::make_free_lists (int condemned_gen_number)
     finish = GetCycleCount32();
     sweep_time = finish - start;
 #endif //TIME_GC
+    record_phase_time (gc_phase_sweep, phase_start_ts);
 }
 
 void gc_heap::make_free_list_in_brick (uint8_t* tree, make_free_args* args)
@@ -23037,7 +24420,7 @@ void gc_heap::thread_gap (uint8_t* gap_start, size_t size, generation*  gen)
         assert (size >= Align (min_obj_size));
         make_unused_array (gap_start, size, 
                           (!settings.concurrent && (gen != youngest_generation)),
-                          (gen->gen_num == max_generation));
+                          (gen->gen_num >= max_generation));
         dprintf (3, ("fr: [%Ix, %Ix[", (size_t)gap_start, (size_t)gap_start+size));
 
         if ((size >= min_free_list))
@@ -24120,6 +25503,7 @@ void gc_heap::relocate_phase (int condemned_gen_number,
         unsigned finish;
         start = GetCycleCount32();
 #endif //TIME_GC
+    int64_t phase_start_ts = GCToOSInterface::QueryPerformanceCounter();
 
 //  %type%  category = quote (relocate);
     dprintf (2,("---- Relocate phase -----"));
@@ -24209,6 +25593,7 @@ void gc_heap::relocate_phase (int condemned_gen_number,
         finish = GetCycleCount32();
         reloc_time = finish - start;
 #endif //TIME_GC
+    record_phase_time (gc_phase_relocate, phase_start_ts);
 
     dprintf(2,( "---- End of Relocate phase ----"));
 }
@@ -24295,6 +25680,14 @@ void  gc_heap::gcmemcopy (uint8_t* dest, uint8_t* src, size_t len, BOOL copy_car
         //dprintf(3,(" Memcopy [%Ix->%Ix, %Ix->%Ix[", (size_t)src, (size_t)dest, (size_t)src+len, (size_t)dest+len));
         dprintf(3,(" mc: [%Ix->%Ix, %Ix->%Ix[", (size_t)src, (size_t)dest, (size_t)src+len, (size_t)dest+len));
         memcopy (dest - plug_skew, src - plug_skew, (int)len);
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+        if (SoftwareWriteWatch::IsEnabledForGCHeap())
+        {
+            // The plug_skew bytes before dest and before dest + len are object
+            // headers which hold no references, so they need not be marked.
+            SoftwareWriteWatch::SetDirtyRegion(dest, len - plug_skew);
+        }
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
         copy_cards_range (dest, src, len, copy_cards_p);
     }
 }
@@ -24562,6 +25955,7 @@ void gc_heap::compact_phase (int condemned_gen_number,
         unsigned finish;
         start = GetCycleCount32();
 #endif //TIME_GC
+    int64_t phase_start_ts = GCToOSInterface::QueryPerformanceCounter();
     generation*   condemned_gen = generation_of (condemned_gen_number);
     uint8_t*  start_address = first_condemned_address;
     size_t   current_brick = brick_of (start_address);
@@ -24684,6 +26078,7 @@ void gc_heap::compact_phase (int condemned_gen_number,
     finish = GetCycleCount32();
     compact_time = finish - start;
 #endif //TIME_GC
+    record_phase_time (gc_phase_compact, phase_start_ts);
 
     concurrent_print_time_delta ("compact end");
 
@@ -25034,11 +26429,18 @@ void gc_heap::recover_bgc_settings()
     }
 }
 
-void gc_heap::allow_fgc()
+// Whether a foreground GC is waiting for the BGC thread to get to a safe point.
+BOOL gc_heap::fgc_pending_p()
 {
     assert (bgc_thread == GetThread());
 
-    if (GCToEEInterface::IsPreemptiveGCDisabled(bgc_thread) && GCToEEInterface::CatchAtSafePoint(bgc_thread))
+    return (GCToEEInterface::IsPreemptiveGCDisabled(bgc_thread) && 
+            GCToEEInterface::CatchAtSafePoint(bgc_thread));
+}
+
+void gc_heap::allow_fgc()
+{
+    if (fgc_pending_p())
     {
         GCToEEInterface::EnablePreemptiveGC(bgc_thread);
         GCToEEInterface::DisablePreemptiveGC(bgc_thread);
@@ -25491,6 +26893,7 @@ void gc_heap::background_mark_phase ()
     unsigned finish;
     start = GetCycleCount32();
 #endif //TIME_GC
+    int64_t phase_start_ts = GCToOSInterface::QueryPerformanceCounter();
 
 #ifdef FFIND_OBJECT
     if (gen0_must_clear_bricks > 0)
@@ -25578,6 +26981,25 @@ void gc_heap::background_mark_phase ()
             dprintf (BGC_LOG, ("setting cm_in_progress"));
             c_write (cm_in_progress, TRUE);
 
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+            // With software write watch, write watch is reset while the EE is
+            // still suspended. The table is only ever read or modified by one
+            // thread at a time while the runtime is suspended, which avoids
+            // having to synchronize a concurrent reset with the write barrier.
+            concurrent_print_time_delta ("CRWW begin");
+
+#ifdef MULTIPLE_HEAPS
+            for (int i = 0; i < n_heaps; i++)
+            {
+                g_heaps[i]->reset_write_watch (FALSE);
+            }
+#else
+            reset_write_watch (FALSE);
+#endif //MULTIPLE_HEAPS
+
+            concurrent_print_time_delta ("CRWW");
+#endif //FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
             //restart all thread, doing the marking from the array
             assert (dont_restart_ee_p);
             dont_restart_ee_p = FALSE;
@@ -25597,11 +27019,16 @@ void gc_heap::background_mark_phase ()
         {
             disable_preemptive (current_thread, TRUE);
 
-#ifdef WRITE_WATCH
+#ifdef MULTIPLE_HEAPS
+            int i;
+#endif //MULTIPLE_HEAPS
+
+#if defined(WRITE_WATCH) && !defined(FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP)
+            // With software write watch this was done, for all segments, before
+            // restarting the EE.
             concurrent_print_time_delta ("CRWW begin");
 
 #ifdef MULTIPLE_HEAPS
-            int i;
             for (i = 0; i < n_heaps; i++)
             {
                 g_heaps[i]->reset_write_watch (TRUE);
@@ -25610,9 +27037,6 @@ void gc_heap::background_mark_phase ()
             reset_write_watch (TRUE);
 #endif //MULTIPLE_HEAPS
 
-            concurrent_print_time_delta ("CRWW");
-#endif //WRITE_WATCH
-
 #ifdef MULTIPLE_HEAPS
             for (i = 0; i < n_heaps; i++)
             {
@@ -25623,6 +27047,7 @@ void gc_heap::background_mark_phase ()
 #endif //MULTIPLE_HEAPS
 
             concurrent_print_time_delta ("CRW");
+#endif //WRITE_WATCH && !FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
 
 #ifdef MULTIPLE_HEAPS
             for (i = 0; i < n_heaps; i++)
@@ -25912,6 +27337,13 @@ void gc_heap::background_mark_phase ()
         // scan for deleted entries in the syncblk cache
         GCScan::GcWeakPtrScanBySingleThread (max_generation, max_generation, &sc);
         concurrent_print_time_delta ("NR GcWeakPtrScanBySingleThread");
+
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+        // Marking is done; nothing reads write watch until the next BGC. The EE
+        // is still suspended so the write barrier can be switched back here.
+        SoftwareWriteWatch::DisableForGCHeap();
+#endif //FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
 #ifdef MULTIPLE_HEAPS
         dprintf(2, ("Starting BGC threads for end of background mark phase"));
         bgc_t_join.restart();
@@ -25973,6 +27405,7 @@ void gc_heap::background_mark_phase ()
         finish = GetCycleCount32();
         mark_time = finish - start;
 #endif //TIME_GC
+    record_phase_time (gc_phase_mark, phase_start_ts);
 
     dprintf (2, ("end of bgc mark: gen2 free list space: %d, free obj space: %d", 
         generation_free_list_space (generation_of (max_generation)), 
@@ -26327,18 +27760,27 @@ void gc_heap::revisit_written_pages (BOOL concurrent_p, BOOL reset_only_p)
                     ptrdiff_t region_size = high_address - base_address;
                     dprintf (3, ("h%d: gw: [%Ix(%Id)", heap_number, (size_t)base_address, (size_t)region_size));
 
-                    bool success = GCToOSInterface::GetWriteWatch (reset_watch_state, base_address, region_size,
-                                                                   (void**)background_written_addresses,
-                                                                   &bcount);
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+                    // When the runtime is not suspended the table may be resized
+                    // concurrently by grow_brick_card_tables, which holds gc_lock.
+                    // When it is suspended, background GC threads only scan
+                    // disjoint regions and don't need to synchronize.
+                    if (concurrent_p)
+                    {
+                        enter_spin_lock (&gc_lock);
+                    }
+#endif //FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
+                    get_write_watch_for_gc_heap (reset_watch_state, base_address, region_size,
+                                                 (void**)background_written_addresses,
+                                                 &bcount, !concurrent_p);
 
-    //#ifdef _DEBUG
-                    if (!success)
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+                    if (concurrent_p)
                     {
-                        printf ("GetWriteWatch Error ");
-                        printf ("Probing pages [%Ix, %Ix[\n", (size_t)base_address, (size_t)high_address);
+                        leave_spin_lock (&gc_lock);
                     }
-    //#endif
-                    assert (success);
+#endif //FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
 
                     if (bcount != 0)
                     {
@@ -26792,6 +28234,13 @@ void gc_heap::do_background_gc()
 #else
     init_background_gc();
 #endif //MULTIPLE_HEAPS
+
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    // The EE is suspended here; start tracking writes to the heap before the
+    // BGC restarts it so none are missed.
+    SoftwareWriteWatch::EnableForGCHeap();
+#endif //FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
     //start the background gc
     start_c_gc ();
 
@@ -26837,6 +28286,16 @@ uint32_t gc_heap::bgc_thread_function()
         background_gc_create_event.Set();
         return 0;
     }
+#else //FEATURE_REDHAWK
+    // rh_bgc_thread_stub sets bgc_thread to the Thread the EE attached to
+    // this thread, it is NULL if the EE failed to set one up.
+    if (!bgc_thread)
+    {
+        dprintf (2, ("AttachCurrentThread failed"));
+        bgc_thread_running = FALSE;
+        background_gc_create_event.Set();
+        return 0;
+    }
 #endif //FEATURE_REDHAWK
 
     bgc_thread_running = TRUE;    
@@ -26937,8 +28396,10 @@ uint32_t gc_heap::bgc_thread_function()
             bgc_start_event.Reset();
             do_post_gc();
 #ifdef MULTIPLE_HEAPS
-            for (int gen = max_generation; gen <= (max_generation + 1); gen++)
+            // LOH budget was already equalized when all heaps finished sweeping LOH,
+            // and LOH allocations have been consuming it since.
             {
+                int gen = max_generation;
                 size_t desired_per_heap = 0;
                 size_t total_desired = 0;
                 gc_heap* hp = 0;
@@ -26971,6 +28432,8 @@ uint32_t gc_heap::bgc_thread_function()
 #endif //MULTIPLE_HEAPS
 #ifdef MULTIPLE_HEAPS
             fire_pevents();
+            // gc1 only records blocking GCs with server GC
+            record_gc_info();
 #endif //MULTIPLE_HEAPS
 
             c_write (settings.concurrent, FALSE);
@@ -27154,6 +28617,12 @@ void gc_heap::copy_cards_for_addresses (uint8_t* dest, uint8_t* src, size_t len)
 
     if (card_set_p (card_of (src + len - 1)))
         set_card (end_dest_card);
+
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    // copy_cards sets cards without setting their bundles.
+    card_bundles_set (cardw_card_bundle (card_word (card_of (dest))),
+                      cardw_card_bundle (align_cardw_on_bundle (card_word (end_dest_card) + 1)));
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
 }
 
 #ifdef BACKGROUND_GC
@@ -29235,6 +30704,17 @@ generation* gc_heap::expand_heap (int condemned_generation,
         if (!use_bestfit)
         {
             should_promote_ephemeral = dt_low_ephemeral_space_p (tuning_deciding_promote_ephemeral);
+
+            // The new segment is never a reused one so not promoting means copying the ephemeral
+            // survivors over to it. Promoting them in place saves that but makes gen0 survivors
+            // gen2 early, so we only do it when there's a lot to copy.
+            if (!should_promote_ephemeral && segment_promotion_p)
+            {
+                size_t eph_seg_size = heap_segment_reserved (ephemeral_heap_segment) - heap_segment_mem (ephemeral_heap_segment);
+                should_promote_ephemeral = ((size_t)eph_size >= (eph_seg_size / SEGMENT_PROMOTION_EPH_FRACTION));
+                dprintf (2, ("segment promotion: eph size %Id, seg size %Id, promote: %d", 
+                    (size_t)eph_size, eph_seg_size, should_promote_ephemeral));
+            }
         }
     }
 
@@ -29859,6 +31339,314 @@ size_t gc_heap::joined_youngest_desired (size_t new_allocation)
 }
 #endif // BIT64 
 
+// Number of ephemeral GCs we measure before we move the gen0 budget floor again.
+#define GEN0_TUNING_GCS_PER_STEP 4
+// How much (%) we move the gen0 budget floor by each time.
+#define GEN0_TUNING_STEP_PCT 25
+// Changes in the GC cost per MB smaller than this (%) are treated as noise.
+#define GEN0_TUNING_NOISE_PCT 5
+// Below this gen0 survival rate (%) a GC costs about the same however much we let gen0 
+// allocate, so we'd rather have a budget that fits in the cache.
+#define GEN0_TUNING_LOW_SURV_PCT 10
+#define GEN0_TUNING_MIN_BUDGET (256*1024)
+
+// This is called by the thread that does the last join at the start of a GC.
+void gc_heap::record_gen0_tuning_start()
+{
+    size_t allocated = 0;
+
+#ifdef MULTIPLE_HEAPS
+    for (int i = 0; i < gc_heap::n_heaps; i++)
+    {
+        gc_heap* hp = gc_heap::g_heaps[i];
+#else //MULTIPLE_HEAPS
+    {
+        gc_heap* hp = pGenGCHeap;
+#endif //MULTIPLE_HEAPS
+        dynamic_data* dd = hp->dynamic_data_of (0);
+        ptrdiff_t heap_allocated = (ptrdiff_t)dd_desired_allocation (dd) - dd_new_allocation (dd);
+        if (heap_allocated > 0)
+        {
+            allocated += (size_t)heap_allocated;
+        }
+    }
+
+    gen0_tuning_data.allocated = allocated;
+    gen0_tuning_data.gc_start_ts = GCToOSInterface::QueryPerformanceCounter();
+}
+
+// This is called by the thread that does the last join at the end of a blocking GC, with
+// the per heap gen0 budget the survival based model came up with. We measure how long 
+// ephemeral GCs take for each MB gen0 allocated and hill climb the budget floor towards
+// what makes that cheapest; with a pause target we also cap the budget at what we think
+// keeps the pause within it.
+size_t gc_heap::adapt_gen0_budget (size_t desired_per_heap)
+{
+    gen0_tuning_data_t* data = &gen0_tuning_data;
+
+#ifdef MULTIPLE_HEAPS
+    int num_heaps = gc_heap::n_heaps;
+    gc_heap* hp0 = gc_heap::g_heaps[0];
+#else //MULTIPLE_HEAPS
+    int num_heaps = 1;
+    gc_heap* hp0 = pGenGCHeap;
+#endif //MULTIPLE_HEAPS
+
+    size_t max_budget = dd_max_size (hp0->dynamic_data_of (0));
+
+    if (data->min_budget == 0)
+    {
+        data->initial_min_budget = dd_min_gc_size (hp0->dynamic_data_of (0));
+        data->min_budget = data->initial_min_budget;
+        data->direction = 1;
+    }
+
+    size_t old_min_budget = data->min_budget;
+
+    // Full GCs are dominated by gen2 and GCs in a no gc region don't follow the budget, so 
+    // neither tells us how the gen0 budget affects what a GC costs.
+    if ((settings.condemned_generation < max_generation) &&
+        !current_no_gc_region_info.started &&
+        (data->allocated != 0))
+    {
+        uint64_t pause_us = ((GCToOSInterface::QueryPerformanceCounter() - data->gc_start_ts) * 1000000) / qpf;
+        uint64_t cost_per_mb = (pause_us * 1024 * 1024) / data->allocated;
+
+        uint64_t begin_size = 0;
+        uint64_t survived_size = 0;
+#ifdef MULTIPLE_HEAPS
+        for (int i = 0; i < gc_heap::n_heaps; i++)
+        {
+            gc_heap* hp = gc_heap::g_heaps[i];
+#else //MULTIPLE_HEAPS
+        {
+            gc_heap* hp = pGenGCHeap;
+#endif //MULTIPLE_HEAPS
+            dynamic_data* dd = hp->dynamic_data_of (0);
+            begin_size += dd_begin_data_size (dd);
+            survived_size += dd_survived_size (dd);
+        }
+        int surv_pct = ((begin_size == 0) ? 0 : (int)((survived_size * 100) / begin_size));
+
+        // to avoid reacting to a single unusual GC, apply some smoothing.
+        data->measured_gc_count++;
+        uint64_t smoothing = min ((uint64_t)4, (uint64_t)data->measured_gc_count);
+        data->pause_us = pause_us / smoothing + (data->pause_us / smoothing) * (smoothing - 1);
+        data->cost_per_mb = cost_per_mb / smoothing + (data->cost_per_mb / smoothing) * (smoothing - 1);
+        data->surv_pct = (int)((surv_pct + data->surv_pct * (smoothing - 1)) / smoothing);
+        data->sample_count++;
+
+        if (data->sample_count >= GEN0_TUNING_GCS_PER_STEP)
+        {
+            int step = data->direction;
+
+            if (data->prev_cost_per_mb != 0)
+            {
+                uint64_t noise = data->prev_cost_per_mb * GEN0_TUNING_NOISE_PCT / 100;
+                if (data->cost_per_mb > (data->prev_cost_per_mb + noise))
+                {
+                    // The last step made things worse, go back the other way.
+                    step = -data->direction;
+                }
+                else if ((data->cost_per_mb + noise) >= data->prev_cost_per_mb)
+                {
+                    step = (((data->surv_pct < GEN0_TUNING_LOW_SURV_PCT) && 
+                             (data->min_budget > data->initial_min_budget)) ? -1 : 0);
+                }
+            }
+
+            if (step != 0)
+            {
+                data->direction = step;
+                size_t delta = data->min_budget / 100 * GEN0_TUNING_STEP_PCT;
+                data->min_budget = ((step > 0) ? (data->min_budget + delta) : (data->min_budget - delta));
+                data->min_budget = Align (min (max (data->min_budget, (size_t)GEN0_TUNING_MIN_BUDGET), max_budget), 
+                                          get_alignment_constant (TRUE));
+            }
+
+            data->prev_cost_per_mb = data->cost_per_mb;
+            data->sample_count = 0;
+        }
+
+        if (target_pause_us && (data->cost_per_mb != 0))
+        {
+            // The pause is roughly the cost per MB times the MBs allocated on all heaps.
+            uint64_t target_total = (target_pause_us * 1024 * 1024) / data->cost_per_mb;
+            size_t target_budget = (size_t)min ((target_total / num_heaps), (uint64_t)max_budget);
+            data->target_budget = Align (max (target_budget, (size_t)GEN0_TUNING_MIN_BUDGET), 
+                                         get_alignment_constant (TRUE));
+        }
+
+        dprintf (1, ("gen0 tuning: pause %I64dus (avg %I64dus), %I64dus/MB (avg %I64dus/MB), surv %d%% (avg %d%%)",
+            pause_us, data->pause_us, cost_per_mb, data->cost_per_mb, surv_pct, data->surv_pct));
+    }
+
+    if (data->target_budget)
+    {
+        data->min_budget = min (data->min_budget, data->target_budget);
+    }
+
+    if (data->min_budget != old_min_budget)
+    {
+#ifdef MULTIPLE_HEAPS
+        for (int i = 0; i < gc_heap::n_heaps; i++)
+        {
+            gc_heap* hp = gc_heap::g_heaps[i];
+#else //MULTIPLE_HEAPS
+        {
+            gc_heap* hp = pGenGCHeap;
+#endif //MULTIPLE_HEAPS
+            dynamic_data* dd = hp->dynamic_data_of (0);
+            dd_min_gc_size (dd) = data->min_budget;
+            dd_min_size (dd) = data->min_budget;
+        }
+    }
+
+    size_t new_desired_per_heap = max (desired_per_heap, data->min_budget);
+    if (data->target_budget)
+    {
+        new_desired_per_heap = min (new_desired_per_heap, data->target_budget);
+    }
+
+    dprintf (1, ("gen0 tuning: budget floor %Id->%Id, target budget %Id, desired %Id->%Id",
+        old_min_budget, data->min_budget, data->target_budget, desired_per_heap, new_desired_per_heap));
+
+    return new_desired_per_heap;
+}
+
+// Even with a pause target we can't put off full GCs forever, so every this many we let one
+// through regardless.
+#define PAUSE_TARGET_MAX_GEN2_DEFERRED 8
+
+// This is called by the thread that does the last join at the end of a blocking GC. It 
+// records what the GC cost per MB condemned on an average heap, using the sizes the
+// GC recorded in its per heap history.
+void gc_heap::record_pause_for_target()
+{
+    if (current_no_gc_region_info.started)
+    {
+        return;
+    }
+
+    int gen_number = settings.condemned_generation;
+    uint64_t pause_us = ((GCToOSInterface::QueryPerformanceCounter() - gen0_tuning_data.gc_start_ts) * 1000000) / qpf;
+
+    uint64_t condemned_size = 0;
+    int num_heaps = 1;
+#ifdef MULTIPLE_HEAPS
+    num_heaps = gc_heap::n_heaps;
+    for (int i = 0; i < gc_heap::n_heaps; i++)
+    {
+        gc_heap* hp = gc_heap::g_heaps[i];
+#else //MULTIPLE_HEAPS
+    {
+        gc_heap* hp = pGenGCHeap;
+#endif //MULTIPLE_HEAPS
+        gc_history_per_heap* current_gc_data_per_heap = hp->get_gc_data_per_heap();
+        for (int i = 0; i <= gen_number; i++)
+        {
+            condemned_size += current_gc_data_per_heap->gen_data[i].size_before;
+        }
+    }
+
+    uint64_t condemned_mb_per_heap = max ((uint64_t)1, (condemned_size / num_heaps) / (1024 * 1024));
+    uint64_t cost_per_mb = pause_us / condemned_mb_per_heap;
+    uint64_t* smoothed_cost_per_mb = &pause_cost_per_mb[gen_number][settings.compaction ? 1 : 0];
+
+    // to avoid reacting to a single unusual GC, apply some smoothing.
+    *smoothed_cost_per_mb = ((*smoothed_cost_per_mb == 0) ? 
+                             cost_per_mb : ((*smoothed_cost_per_mb * 3 + cost_per_mb) / 4));
+
+    dprintf (GTC_LOG, ("pause target: gen%d %s took %I64dus for %I64dMB/heap, %I64dus/MB (avg %I64dus/MB)",
+        gen_number, (settings.compaction ? "compacting" : "sweeping"), pause_us, condemned_mb_per_heap,
+        cost_per_mb, *smoothed_cost_per_mb));
+}
+
+// Returns how long we think a blocking GC of gen_number would take, if it condemns
+// condemned_size bytes on the heap that has the most to do. When we haven't done that 
+// kind of GC yet we go by the cost of the other kind, and by the cheapest of the younger
+// generations after that; 0 means we have nothing to go by.
+uint64_t gc_heap::estimate_pause_us (int gen_number, BOOL compact_p, size_t condemned_size)
+{
+    uint64_t cost_per_mb = pause_cost_per_mb[gen_number][compact_p ? 1 : 0];
+
+    if (cost_per_mb == 0)
+    {
+        cost_per_mb = pause_cost_per_mb[gen_number][compact_p ? 0 : 1];
+    }
+
+    for (int i = gen_number - 1; (cost_per_mb == 0) && (i >= 0); i--)
+    {
+        cost_per_mb = max (pause_cost_per_mb[i][0], pause_cost_per_mb[i][1]);
+    }
+
+    return ((cost_per_mb * condemned_size) / (1024 * 1024));
+}
+
+// Decides if a full GC would be a blocking one that's likely to go over the pause target,
+// and can be done as a gen1 GC instead. We only do that for gen2s triggered by SOH
+// allocations - never for GCs that were asked for, GCs that LOH needs (a gen1 doesn't
+// collect LOH) or when we are low on memory.
+BOOL gc_heap::pause_target_defers_gen2_p (BOOL blocking_p)
+{
+#ifdef BACKGROUND_GC
+    BOOL bgc_p = (!blocking_p && gc_can_use_concurrent &&
+                  ((settings.pause_mode == pause_interactive) || (settings.pause_mode == pause_sustained_low_latency)));
+    if (bgc_p)
+    {
+        return FALSE;
+    }
+#else //BACKGROUND_GC
+    UNREFERENCED_PARAMETER(blocking_p);
+#endif //BACKGROUND_GC
+
+    if ((settings.reason != reason_alloc_soh) ||
+        g_low_memory_status ||
+        (settings.entry_memory_load >= high_memory_load_th) ||
+        (gen2_deferred_count >= PAUSE_TARGET_MAX_GEN2_DEFERRED))
+    {
+        return FALSE;
+    }
+
+    size_t max_condemned_size = 0;
+#ifdef MULTIPLE_HEAPS
+    for (int i = 0; i < gc_heap::n_heaps; i++)
+    {
+        gc_heap* hp = gc_heap::g_heaps[i];
+#else //MULTIPLE_HEAPS
+    {
+        gc_heap* hp = pGenGCHeap;
+#endif //MULTIPLE_HEAPS
+        if (hp->last_gc_before_oom || 
+            (hp->get_new_allocation (max_generation + 1) <= 0))
+        {
+            return FALSE;
+        }
+
+        size_t condemned_size = 0;
+        for (int gen_number = 0; gen_number <= max_generation; gen_number++)
+        {
+            condemned_size += hp->generation_size (gen_number);
+        }
+        max_condemned_size = max (max_condemned_size, condemned_size);
+    }
+
+    // We don't know yet if we'd compact so go by the cheaper of the two.
+    uint64_t sweep_pause_us = estimate_pause_us (max_generation, FALSE, max_condemned_size);
+    uint64_t compact_pause_us = estimate_pause_us (max_generation, TRUE, max_condemned_size);
+    uint64_t gen2_pause_us = min (sweep_pause_us, compact_pause_us);
+
+    if (gen2_pause_us <= target_pause_us)
+    {
+        return FALSE;
+    }
+
+    gen2_deferred_count++;
+    dprintf (GTC_LOG, ("pause target: gen2 would take ~%I64dus, target %I64dus - doing gen1 instead (%d in a row)",
+        gen2_pause_us, target_pause_us, gen2_deferred_count));
+    return TRUE;
+}
+
 inline
 gc_history_per_heap* gc_heap::get_gc_data_per_heap()
 {
@@ -29876,7 +31664,10 @@ void gc_heap::compute_new_dynamic_data (int gen_number)
 
     dynamic_data* dd = dynamic_data_of (gen_number);
     generation*   gen = generation_of (gen_number);
-    size_t        in = (gen_number==0) ? 0 : compute_in (gen_number);
+    if (gen_number != 0)
+    {
+        compute_in (gen_number);
+    }
 
     size_t total_gen_size = generation_size (gen_number);
     //keep track of fragmentation
@@ -29944,7 +31735,22 @@ void gc_heap::compute_new_dynamic_data (int gen_number)
         }
         else
         {
-            dd_desired_allocation (dd) = desired_new_allocation (dd, out, gen_number, 0);
+            size_t budget_out = out;
+#ifdef FEATURE_PREMORTEM_FINALIZATION
+            // Same as for gen0 above - when the finalizer is behind, what a full GC only kept
+            // alive for it will be dead by the next full GC so it shouldn't grow the gen2 budget.
+            if ((gen_number == max_generation) && finalization_backed_up_p
+#ifdef BACKGROUND_GC
+                && !settings.concurrent
+#endif //BACKGROUND_GC
+                )
+            {
+                size_t final_promoted = min (promoted_bytes (heap_number), out);
+                dprintf (2, ("gen: %d final promoted: %Id (finalization backed up)", gen_number, final_promoted));
+                budget_out -= final_promoted;
+            }
+#endif //FEATURE_PREMORTEM_FINALIZATION
+            dd_desired_allocation (dd) = desired_new_allocation (dd, budget_out, gen_number, 0);
         }
     }
 
@@ -29956,31 +31762,41 @@ void gc_heap::compute_new_dynamic_data (int gen_number)
     dd_promoted_size (dd) = out;
     if (gen_number == max_generation)
     {
-        dd = dynamic_data_of (max_generation+1);
-        total_gen_size = generation_size (max_generation + 1);
-        dd_fragmentation (dd) = generation_free_list_space (large_object_generation) + 
-                                generation_free_obj_space (large_object_generation);
-        dd_current_size (dd) = total_gen_size - dd_fragmentation (dd);
-        dd_survived_size (dd) = dd_current_size (dd);
-        in = 0;
-        out = dd_current_size (dd);
-        dd_desired_allocation (dd) = desired_new_allocation (dd, out, max_generation+1, 0);
-        dd_gc_new_allocation (dd) = Align (dd_desired_allocation (dd),
-                                           get_alignment_constant (FALSE));
-
-        gen_data = &(current_gc_data_per_heap->gen_data[max_generation+1]);
-        gen_data->size_after = total_gen_size;
-        gen_data->free_list_space_after = generation_free_list_space (large_object_generation);
-        gen_data->free_obj_space_after = generation_free_obj_space (large_object_generation);
-        gen_data->npinned_surv = out;
 #ifdef BACKGROUND_GC
-        end_loh_size = total_gen_size;
+        // A BGC already did this when it finished sweeping LOH.
+        if (!settings.concurrent)
 #endif //BACKGROUND_GC
-        //update counter
-        dd_promoted_size (dd) = out;
+        {
+            compute_new_loh_dynamic_data();
+        }
     }
 }
 
+void gc_heap::compute_new_loh_dynamic_data()
+{
+    dynamic_data* dd = dynamic_data_of (max_generation+1);
+    size_t total_gen_size = generation_size (max_generation + 1);
+    dd_fragmentation (dd) = generation_free_list_space (large_object_generation) + 
+                            generation_free_obj_space (large_object_generation);
+    dd_current_size (dd) = total_gen_size - dd_fragmentation (dd);
+    dd_survived_size (dd) = dd_current_size (dd);
+    size_t out = dd_current_size (dd);
+    dd_desired_allocation (dd) = desired_new_allocation (dd, out, max_generation+1, 0);
+    dd_gc_new_allocation (dd) = Align (dd_desired_allocation (dd),
+                                       get_alignment_constant (FALSE));
+
+    gc_generation_data* gen_data = &(get_gc_data_per_heap()->gen_data[max_generation+1]);
+    gen_data->size_after = total_gen_size;
+    gen_data->free_list_space_after = generation_free_list_space (large_object_generation);
+    gen_data->free_obj_space_after = generation_free_obj_space (large_object_generation);
+    gen_data->npinned_surv = out;
+#ifdef BACKGROUND_GC
+    end_loh_size = total_gen_size;
+#endif //BACKGROUND_GC
+    //update counter
+    dd_promoted_size (dd) = out;
+}
+
 void gc_heap::trim_youngest_desired_low_memory()
 {
     if (g_low_memory_status)
@@ -30052,8 +31868,29 @@ void gc_heap::decommit_ephemeral_segment_pages()
         slack_space = min (slack_space, new_slack_space);
     }
 
+    size_t target_slack_space = slack_space;
+
+    if (decommit_time_window && !g_low_memory_status)
+    {
+        slack_space = gradual_decommit_slack (slack_space);
+    }
+
+#ifdef MULTIPLE_HEAPS
+    if (heap_number >= n_active_heaps)
+    {
+        // This heap isn't being allocated on, give back what it has committed for gen0.
+        slack_space = 0;
+    }
+#endif //MULTIPLE_HEAPS
+
     decommit_heap_segment_pages (ephemeral_heap_segment, slack_space);    
 
+    if (decommit_time_window)
+    {
+        size_t committed_slack = heap_segment_committed (ephemeral_heap_segment) - heap_segment_allocated (ephemeral_heap_segment);
+        decommit_pending_p = (committed_slack >= (target_slack_space + 100*OS_PAGE_SIZE));
+    }
+
     gc_history_per_heap* current_gc_data_per_heap = get_gc_data_per_heap();
     current_gc_data_per_heap->extra_gen0_committed = heap_segment_committed (ephemeral_heap_segment) - heap_segment_allocated (ephemeral_heap_segment);
 }
@@ -30289,6 +32126,30 @@ BOOL gc_heap::decide_on_compacting (int condemned_gen_number,
 #endif // BIT64
     }
 
+    // High fragmentation is the only reason above we can choose not to compact for; if 
+    // compacting would take us over the pause target and sweeping wouldn't, we sweep and
+    // let a later GC that fits in the target deal with the fragmentation.
+    if (should_compact && target_pause_us &&
+        (get_gc_data_per_heap()->get_mechanism (gc_heap_compact) == compact_high_frag))
+    {
+        size_t condemned_size = 0;
+        for (int i = 0; i <= condemned_gen_number; i++)
+        {
+            condemned_size += generation_size (i);
+        }
+
+        uint64_t compact_pause_us = estimate_pause_us (condemned_gen_number, TRUE, condemned_size);
+        uint64_t sweep_pause_us = estimate_pause_us (condemned_gen_number, FALSE, condemned_size);
+
+        if ((compact_pause_us > target_pause_us) && (sweep_pause_us < compact_pause_us))
+        {
+            dprintf (GTC_LOG, ("h%d: compacting gen%d would take ~%I64dus, sweeping ~%I64dus, target %I64dus - sweeping", 
+                heap_number, condemned_gen_number, compact_pause_us, sweep_pause_us, target_pause_us));
+            should_compact = FALSE;
+            get_gc_data_per_heap()->clear_mechanism (gc_heap_compact);
+        }
+    }
+
     // The purpose of calling ensure_gap_allocation here is to make sure
     // that we actually are able to commit the memory to allocate generation
     // starts.
@@ -30491,7 +32352,7 @@ BOOL gc_heap::ephemeral_gen_fit_p (gc_tuning_point tp)
     }
 }
 
-CObjectHeader* gc_heap::allocate_large_object (size_t jsize, int64_t& alloc_bytes)
+CObjectHeader* gc_heap::allocate_large_object (size_t jsize, int64_t& alloc_bytes, BOOL poh_p)
 {
     //create a new alloc context because gen3context is shared.
     alloc_context acontext;
@@ -30546,10 +32407,22 @@ CObjectHeader* gc_heap::allocate_large_object (size_t jsize, int64_t& alloc_byte
 #endif //FEATURE_LOH_COMPACTION
 
     assert (size >= Align (min_obj_size, align_const));
+
+    // Pinned objects can be much smaller than what normally goes on LOH. The LOH 
+    // code needs an object to cover at least a full mark word so we make a free 
+    // object after a small pinned object to fill up the rest.
+    size_t poh_tail = 0;
+#ifdef MARK_ARRAY
+    if (poh_p && (size <= mark_word_size))
+    {
+        poh_tail = AlignQword (mark_word_size - size + Align (min_obj_size, align_const));
+    }
+#endif //MARK_ARRAY
+
 #ifdef _MSC_VER
 #pragma inline_depth(0)
 #endif //_MSC_VER
-    if (! allocate_more_space (&acontext, (size + pad), max_generation+1))
+    if (! allocate_more_space (&acontext, (size + pad + poh_tail), max_generation+1, poh_p))
     {
         return 0;
     }
@@ -30565,7 +32438,13 @@ CObjectHeader* gc_heap::allocate_large_object (size_t jsize, int64_t& alloc_byte
 
     uint8_t*  result = acontext.alloc_ptr;
 
-    assert ((size_t)(acontext.alloc_limit - acontext.alloc_ptr) == size);
+    assert ((size_t)(acontext.alloc_limit - acontext.alloc_ptr) == (size + poh_tail));
+
+    if (poh_tail)
+    {
+        make_unused_array (result + size, poh_tail);
+        dprintf (3, ("POH obj %Ix(%Id) followed by free %Id", (size_t)result, size, poh_tail));
+    }
 
     CObjectHeader* obj = (CObjectHeader*)result;
 
@@ -30581,7 +32460,7 @@ CObjectHeader* gc_heap::allocate_large_object (size_t jsize, int64_t& alloc_byte
         }
 #ifdef BACKGROUND_GC
         //the object has to cover one full mark uint32_t
-        assert (size > mark_word_size);
+        assert ((size + poh_tail) > mark_word_size);
         if (current_c_gc_state == c_gc_state_marking)
         {
             dprintf (3, ("Concurrent allocation of a large object %Ix",
@@ -30606,9 +32485,11 @@ CObjectHeader* gc_heap::allocate_large_object (size_t jsize, int64_t& alloc_byte
     return obj;
 }
 
+// On Linux the PAL resets memory with MADV_FREE, so the kernel only takes 
+// these pages back when it's short on memory and we don't refault them if 
+// the space gets reused before that.
 void reset_memory (uint8_t* o, size_t sizeo)
 {
-#ifndef FEATURE_PAL
     if (sizeo > 128 * 1024)
     {
         // We cannot reset the memory for the useful part of a free object.
@@ -30623,7 +32504,6 @@ void reset_memory (uint8_t* o, size_t sizeo)
             reset_mm_p = GCToOSInterface::VirtualReset((void*)page_start, size, true /* unlock */);
         }
     }
-#endif //!FEATURE_PAL
 }
 
 void gc_heap::reset_large_object (uint8_t* o)
@@ -31168,38 +33048,50 @@ void gc_heap::background_ephemeral_sweep()
 void gc_heap::background_sweep()
 {
     Thread* current_thread  = GetThread();
-    generation* gen         = generation_of (max_generation);
     dynamic_data* dd        = dynamic_data_of (max_generation);
-    // For SOH segments we go backwards.
-    heap_segment* start_seg = ephemeral_heap_segment;
-    PREFIX_ASSUME(start_seg != NULL);
-    heap_segment* fseg      = heap_segment_rw (generation_start_segment (generation_of (max_generation)));
-    heap_segment* seg       = start_seg;
-    uint8_t* o                 = heap_segment_mem (seg);
 
-    heap_segment* prev_seg = heap_segment_next (seg);
-    int align_const        = get_alignment_constant (TRUE);
-    if (seg == fseg)
+    // For SOH segments we go backwards. We sweep LOH first so LOH allocations can 
+    // resume while we are still sweeping SOH, but we need to remember where SOH
+    // starts now since an FGC can change the ephemeral segment.
+    heap_segment* soh_start_seg = ephemeral_heap_segment;
+    PREFIX_ASSUME(soh_start_seg != NULL);
+    heap_segment* fseg      = heap_segment_rw (generation_start_segment (generation_of (max_generation)));
+    uint8_t* soh_start_o    = heap_segment_mem (soh_start_seg);
+    heap_segment* soh_prev_seg = heap_segment_next (soh_start_seg);
+    if (soh_start_seg == fseg)
     {
-        assert (o == generation_allocation_start (generation_of (max_generation)));
-        o = o + Align(size (o), align_const);
+        assert (soh_start_o == generation_allocation_start (generation_of (max_generation)));
+        soh_start_o = soh_start_o + Align(size (soh_start_o), get_alignment_constant (TRUE));
     }
+    uint8_t* soh_start_end  = heap_segment_background_allocated (soh_start_seg);
+
+    generation* gen         = large_object_generation;
+    heap_segment* start_seg = heap_segment_rw (generation_start_segment (gen));
+    PREFIX_ASSUME(start_seg != NULL);
+    heap_segment* seg       = start_seg;
+    heap_segment* prev_seg  = 0;
+    int align_const         = get_alignment_constant (FALSE);
+    uint8_t* o              = generation_allocation_start (gen);
+    assert (method_table (o) == g_pFreeObjectMethodTable);
+    o = o + Align(size (o), align_const);
 
     uint8_t* plug_end      = o;
     uint8_t* plug_start    = o;
     next_sweep_obj         = o;
     current_sweep_pos      = o;
 
-    //uint8_t* end              = background_next_end (seg, (gen == large_object_generation));
-    uint8_t* end              = heap_segment_background_allocated (seg);
+    uint8_t* end              = heap_segment_allocated (seg);
     BOOL delete_p          = FALSE;
 
+    int64_t phase_start_ts = GCToOSInterface::QueryPerformanceCounter();
+
     //concurrent_print_time_delta ("finished with mark and start with sweep");
     concurrent_print_time_delta ("Sw");
     dprintf (2, ("---- (GC%d)Background Sweep Phase ----", VolatileLoad(&settings.gc_index)));
 
     //block concurrent allocation for large objects
     dprintf (3, ("lh state: planning"));
+    bgc_loh_swept_p = FALSE;
     if (gc_lh_block_event.IsValid())
     {
         gc_lh_block_event.Reset();
@@ -31222,7 +33114,7 @@ void gc_heap::background_sweep()
 
     fire_bgc_event (BGC2ndNonConEnd);
 
-    current_bgc_state = bgc_sweep_soh;
+    current_bgc_state = bgc_sweep_loh;
     verify_soh_segment_list();
 
 #ifdef FEATURE_BASICFREEZE
@@ -31236,6 +33128,7 @@ void gc_heap::background_sweep()
     //TODO BACKGROUND_GC: can we move this to where we switch to the LOH?
     if (current_c_gc_state != c_gc_state_planning)
     {
+        bgc_loh_alloc_blocked_start_ts = GCToOSInterface::QueryPerformanceCounter();
         current_c_gc_state = c_gc_state_planning;
     }
 
@@ -31289,7 +33182,7 @@ void gc_heap::background_sweep()
 
     disable_preemptive (current_thread, TRUE);
 
-    dprintf (2, ("bgs: sweeping gen2 objects"));
+    dprintf (2, ("bgs: sweeping gen3 objects"));
     dprintf (2, ("bgs: seg: %Ix, [%Ix, %Ix[%Ix", (size_t)seg,
                     (size_t)heap_segment_mem (seg),
                     (size_t)heap_segment_allocated (seg),
@@ -31320,8 +33213,8 @@ void gc_heap::background_sweep()
                 {
                     // we can treat all LOH segments as in the bgc domain
                     // regardless of whether we saw in bgc mark or not
-                    // because we don't allow LOH allocations during bgc
-                    // sweep anyway - the LOH segments can't change.
+                    // because LOH allocations are blocked until every heap
+                    // is done sweeping LOH - the LOH segments can't change.
                     process_background_segment_end (seg, gen, plug_end, 
                                                     start_seg, &delete_p);
                 }
@@ -31358,28 +33251,80 @@ void gc_heap::background_sweep()
 
                 PREFIX_ASSUME(generation_allocation_segment(gen) != NULL);
 
-                if (gen != large_object_generation)
+                if (gen == large_object_generation)
                 {
-                    dprintf (2, ("bgs: sweeping gen3 objects"));
-                    current_bgc_state = bgc_sweep_loh;
-                    gen = generation_of (max_generation+1);
-                    start_seg = heap_segment_rw (generation_start_segment (gen));
+                    // We are done with LOH - its budget can be computed now and LOH 
+                    // allocations no longer need to wait for the rest of the sweep.
+                    compute_new_loh_dynamic_data();
+                    fire_loh_free_list_event();
 
-                    PREFIX_ASSUME(start_seg != NULL);
+                    enable_preemptive (current_thread);
+
+#ifdef MULTIPLE_HEAPS
+                    bgc_t_join.join(this, gc_join_after_loh_sweep);
+                    if (bgc_t_join.joined())
+#endif //MULTIPLE_HEAPS
+                    {
+#ifdef MULTIPLE_HEAPS
+                        size_t total_desired = 0;
+                        for (int i = 0; i < n_heaps; i++)
+                        {
+                            size_t temp_total_desired = total_desired + 
+                                dd_desired_allocation (g_heaps[i]->dynamic_data_of (max_generation + 1));
+                            if (temp_total_desired < total_desired)
+                            {
+                                // we overflowed.
+                                total_desired = (size_t)MAX_PTR;
+                                break;
+                            }
+                            total_desired = temp_total_desired;
+                        }
+
+                        size_t desired_per_heap = Align ((total_desired / n_heaps), get_alignment_constant (FALSE));
+                        for (int i = 0; i < n_heaps; i++)
+                        {
+                            dynamic_data* dd = g_heaps[i]->dynamic_data_of (max_generation + 1);
+                            dd_desired_allocation (dd) = desired_per_heap;
+                            dd_gc_new_allocation (dd) = desired_per_heap;
+                            dd_new_allocation (dd) = desired_per_heap;
+                        }
+#else
+                        dynamic_data* dd = dynamic_data_of (max_generation + 1);
+                        dd_new_allocation (dd) = dd_gc_new_allocation (dd);
+#endif //MULTIPLE_HEAPS
+
+                        // The new LOH budget has to be in place before LOH allocators
+                        // are let go; it's not refreshed again at the end of this BGC.
+                        bgc_loh_alloc_blocked_time = ((GCToOSInterface::QueryPerformanceCounter() - bgc_loh_alloc_blocked_start_ts) * 1000000) / qpf;
+                        dprintf (3, ("lh state: swept, LOH allocs were blocked for %I64dus", bgc_loh_alloc_blocked_time));
+                        bgc_loh_swept_p = TRUE;
+                        if (gc_lh_block_event.IsValid())
+                        {
+                            gc_lh_block_event.Set();
+                        }
+
+#ifdef MULTIPLE_HEAPS
+                        dprintf(2, ("Starting BGC threads after LOH sweep"));
+                        bgc_t_join.restart();
+#endif //MULTIPLE_HEAPS
+                    }
+
+                    disable_preemptive (current_thread, TRUE);
 
+                    dprintf (2, ("bgs: sweeping gen2 objects"));
+                    current_bgc_state = bgc_sweep_soh;
+                    gen = generation_of (max_generation);
+                    start_seg = soh_start_seg;
                     seg = start_seg;
-                    prev_seg = 0;
-                    o = generation_allocation_start (gen);
-                    assert (method_table (o) == g_pFreeObjectMethodTable);
-                    align_const = get_alignment_constant (FALSE);
-                    o = o + Align(size (o), align_const);
+                    prev_seg = soh_prev_seg;
+                    o = soh_start_o;
+                    align_const = get_alignment_constant (TRUE);
                     plug_end = o;
-                    end = heap_segment_allocated (seg);
-                    dprintf (2, ("sweeping gen3 objects"));
-                    generation_free_obj_space (gen) = 0;
-                    generation_allocator (gen)->clear();
-                    generation_free_list_space (gen) = 0;
+                    current_sweep_pos = o;
+                    next_sweep_obj = o;
+                    end = soh_start_end;
 
+                    allow_fgc();
                     dprintf (2, ("bgs: seg: %Ix, [%Ix, %Ix[%Ix", (size_t)seg,
                                     (size_t)heap_segment_mem (seg),
                                     (size_t)heap_segment_allocated (seg),
@@ -31494,6 +33439,7 @@ void gc_heap::background_sweep()
 
     fire_bgc_event (BGC2ndConEnd);
     concurrent_print_time_delta ("background sweep");
+    record_phase_time (gc_phase_sweep, phase_start_ts);
     
     heap_segment* reset_seg = heap_segment_rw (generation_start_segment (generation_of (max_generation)));
     PREFIX_ASSUME(reset_seg != NULL);
@@ -31643,6 +33589,56 @@ void gc_heap::sweep_large_objects ()
     generation_allocation_segment (gen) = heap_segment_rw (generation_start_segment (gen));
 
     PREFIX_ASSUME(generation_allocation_segment(gen) != NULL);
+
+    fire_loh_free_list_event();
+}
+
+// Reports how fragmented the LOH free list is after it's been rebuilt. The free
+// list can be long so we only walk it when someone is listening.
+void gc_heap::fire_loh_free_list_event ()
+{
+    if (!ETW_EVENT_ENABLED(MICROSOFT_WINDOWS_DOTNETRUNTIME_PRIVATE_PROVIDER_Context, LOHFreeListStats))
+    {
+        return;
+    }
+
+    generation* gen = large_object_generation;
+    allocator* loh_allocator = generation_allocator (gen);
+    size_t free_item_count = 0;
+    size_t largest_free_item = 0;
+    unsigned int used_buckets = 0;
+
+    for (unsigned int a_l_idx = 0; a_l_idx < loh_allocator->number_of_buckets(); a_l_idx++)
+    {
+        uint8_t* free_list = loh_allocator->alloc_list_head_of (a_l_idx);
+        if (free_list)
+        {
+            used_buckets++;
+        }
+
+        while (free_list)
+        {
+            size_t free_list_size = unused_array_size (free_list);
+            free_item_count++;
+            if (free_list_size > largest_free_item)
+            {
+                largest_free_item = free_list_size;
+            }
+            free_list = free_list_slot (free_list);
+        }
+    }
+
+    dprintf (GTC_LOG, ("h%d: loh FL: %Id in %Id items (%d buckets), largest %Id, FO: %Id",
+        heap_number, generation_free_list_space (gen), free_item_count, used_buckets,
+        largest_free_item, generation_free_obj_space (gen)));
+
+    FireEtwLOHFreeListStats ((uint64_t)generation_free_list_space (gen),
+                             (uint64_t)generation_free_obj_space (gen),
+                             (uint64_t)free_item_count,
+                             (uint64_t)largest_free_item,
+                             used_buckets,
+                             heap_number,
+                             GetClrInstanceId());
 }
 
 void gc_heap::relocate_in_large_objects ()
@@ -32787,7 +34783,6 @@ gc_heap::verify_free_lists ()
     {
         dprintf (3, ("Verifying free list for gen:%d", gen_num));
         allocator* gen_alloc = generation_allocator (generation_of (gen_num));
-        size_t sz = gen_alloc->first_bucket_size();
         bool verify_undo_slot = (gen_num != 0) && (gen_num != max_generation+1) && !gen_alloc->discard_if_no_fit_p();
 
         for (unsigned int a_l_number = 0; a_l_number < gen_alloc->number_of_buckets(); a_l_number++)
@@ -32802,8 +34797,7 @@ gc_heap::verify_free_lists ()
                                  (size_t)free_list));
                     FATAL_GC_ERROR();
                 }
-                if (((a_l_number < (gen_alloc->number_of_buckets()-1))&& (unused_array_size (free_list) >= sz))
-                    || ((a_l_number != 0) && (unused_array_size (free_list) < sz/2)))
+                if (gen_alloc->bucket_of (unused_array_size (free_list)) != a_l_number)
                 {
                     dprintf (3, ("Verifiying Heap: curr free list item %Ix isn't in the right bucket",
                                  (size_t)free_list));
@@ -32841,8 +34835,6 @@ gc_heap::verify_free_lists ()
                     FATAL_GC_ERROR();
                 }
             }
-
-            sz *=2;
         }
     }
 }
@@ -33357,6 +35349,11 @@ void GCHeap::ValidateObjectMember (Object* obj)
                                 } );
 
 }
+#else //VERIFY_HEAP
+void GCHeap::ValidateObjectMember (Object* obj)
+{
+    UNREFERENCED_PARAMETER(obj);
+}
 #endif  //VERIFY_HEAP
 
 void DestructObject (CObjectHeader* hdr)
@@ -33489,29 +35486,25 @@ HRESULT GCHeap::Initialize ()
     CreatedObjectCount = 0;
 #endif //TRACE_GC
 
-    size_t seg_size = get_valid_segment_size();
-    size_t large_seg_size = get_valid_segment_size(TRUE);
-    gc_heap::min_segment_size = min (seg_size, large_seg_size);
-
-#ifdef MULTIPLE_HEAPS
-    // GetGCProcessCpuCount only returns up to 64 procs.
-    unsigned nhp = CPUGroupInfo::CanEnableGCCPUGroups() ? CPUGroupInfo::GetNumActiveProcessors(): 
-                                                          GCToOSInterface::GetCurrentProcessCpuCount();
-    hr = gc_heap::initialize_gc (seg_size, large_seg_size /*LHEAP_ALLOC*/, nhp);
-#else
-    hr = gc_heap::initialize_gc (seg_size, large_seg_size /*LHEAP_ALLOC*/);
-#endif //MULTIPLE_HEAPS
-
-    if (hr != S_OK)
-        return hr;
-
     // If there's a physical memory limit set on this process, it needs to be checked very early on, 
-    // before we set various memory info.
+    // before we set various memory info and decide the segment sizes.
     uint64_t physical_memory_limit = GCToOSInterface::GetRestrictedPhysicalMemoryLimit();
 
     if (physical_memory_limit)
         gc_heap::restricted_physical_memory_p = true;
 
+    gc_heap::heap_hard_limit = g_pConfig->GetGCHeapHardLimit();
+
+    // If we are running in a container with a memory limit and the hard limit isn't specified,
+    // we don't let the GC heap take more than 75% of the limit (but at least 20MB) so the rest
+    // of the process still has room.
+    if (!gc_heap::heap_hard_limit && gc_heap::restricted_physical_memory_p)
+    {
+        gc_heap::heap_hard_limit = (size_t)max ((uint64_t)(20 * 1024 * 1024), (physical_memory_limit / 4 * 3));
+    }
+
+    // This needs to be set before initialize_gc since sizing gen0 gets the memory info, which
+    // uses it when physical memory is restricted.
     GCMemoryStatus ms;
     GCToOSInterface::GetMemoryStatus (&ms);
     gc_heap::total_physical_mem = ms.ullTotalPhys;
@@ -33522,6 +35515,44 @@ HRESULT GCHeap::Initialize ()
         gc_heap::total_physical_mem = min (gc_heap::total_physical_mem, physical_memory_limit);
     }
 
+#ifdef MULTIPLE_HEAPS
+    // GetGCProcessCpuCount only returns up to 64 procs.
+    unsigned nhp = CPUGroupInfo::CanEnableGCCPUGroups() ? CPUGroupInfo::GetNumActiveProcessors(): 
+                                                          GCToOSInterface::GetCurrentProcessCpuCount();
+
+    if (gc_heap::heap_hard_limit)
+    {
+        // Each heap needs some room of its own to be useful, so with a small limit we use fewer heaps.
+        unsigned max_nhp_for_limit = (unsigned)max ((size_t)1, (gc_heap::heap_hard_limit / (16 * 1024 * 1024)));
+        nhp = min (nhp, max_nhp_for_limit);
+    }
+#else
+    unsigned nhp = 1;
+#endif //MULTIPLE_HEAPS
+
+    if (gc_heap::heap_hard_limit)
+    {
+        // Segment sizes need to be a power of 2; each heap gets its share of the limit rounded 
+        // down, but never less than 16MB.
+        size_t limit_per_heap = gc_heap::heap_hard_limit / nhp;
+        gc_heap::hard_limit_max_seg_size = max (round_down_power2 (limit_per_heap), (size_t)(16 * 1024 * 1024));
+        dprintf (1, ("hard limit %Id, %d heaps, max seg size %Id", 
+            gc_heap::heap_hard_limit, nhp, gc_heap::hard_limit_max_seg_size));
+    }
+
+    size_t seg_size = get_valid_segment_size();
+    size_t large_seg_size = get_valid_segment_size(TRUE);
+    gc_heap::min_segment_size = min (seg_size, large_seg_size);
+
+#ifdef MULTIPLE_HEAPS
+    hr = gc_heap::initialize_gc (seg_size, large_seg_size /*LHEAP_ALLOC*/, nhp);
+#else
+    hr = gc_heap::initialize_gc (seg_size, large_seg_size /*LHEAP_ALLOC*/);
+#endif //MULTIPLE_HEAPS
+
+    if (hr != S_OK)
+        return hr;
+
     gc_heap::mem_one_percent = gc_heap::total_physical_mem / 100;
 #ifndef MULTIPLE_HEAPS
     gc_heap::mem_one_percent /= g_SystemInfo.dwNumberOfProcessors;
@@ -33534,7 +35565,8 @@ HRESULT GCHeap::Initialize ()
     // I am assuming 47 processes using WKS GC and 3 using SVR GC.
     // I am assuming 3 in part due to the "very high memory load" is 97%.
     int available_mem_th = 10;
-    if (gc_heap::total_physical_mem >= ((uint64_t)80 * 1024 * 1024 * 1024))
+    if (!gc_heap::restricted_physical_memory_p && 
+        (gc_heap::total_physical_mem >= ((uint64_t)80 * 1024 * 1024 * 1024)))
     {
         int adjusted_available_mem_th = 3 + (int)((float)47 / (float)(g_SystemInfo.dwNumberOfProcessors));
         available_mem_th = min (available_mem_th, adjusted_available_mem_th);
@@ -33655,6 +35687,16 @@ size_t GCHeap::GetPromotedBytes(int heap_index)
     }
 }
 
+int GCHeap::GetGCInfoRecords(gc_info_record* records, gc_info_heap_record* heap_records, int max_records)
+{
+    return gc_heap::get_gc_info_records (records, heap_records, max_records);
+}
+
+size_t GCHeap::GetTotalCommittedBytes()
+{
+    return gc_heap::get_total_committed_size();
+}
+
 unsigned int GCHeap::WhichGeneration (Object* object)
 {
     gc_heap* hp = gc_heap::heap_of ((uint8_t*)object);
@@ -33670,7 +35712,6 @@ BOOL    GCHeap::IsEphemeral (Object* object)
     return hp->ephemeral_pointer_p (o);
 }
 
-#ifdef VERIFY_HEAP
 // Return NULL if can't find next object. When EE is not suspended,
 // the result is not accurate: if the input arg is in gen0, the function could 
 // return zeroed out memory as next object
@@ -33723,10 +35764,14 @@ BOOL GCHeap::IsInFrozenSegment (Object * object)
     //object. But given all other checks present, the hole should be very small
     return !hs || heap_segment_read_only_p (hs);
 }
+#else //FEATURE_BASICFREEZE
+BOOL GCHeap::IsInFrozenSegment (Object * object)
+{
+    UNREFERENCED_PARAMETER(object);
+    return FALSE;
+}
 #endif //FEATURE_BASICFREEZE
 
-#endif //VERIFY_HEAP
-
 // returns TRUE if the pointer is in one of the GC heaps.
 BOOL GCHeap::IsHeapPointer (void* vpObject, BOOL small_heap_only)
 {
@@ -34135,6 +36180,14 @@ BOOL GCHeap::StressHeap(alloc_context * acontext)
 #endif // STRESS_HEAP
 #endif // FEATURE_REDHAWK
 
+#if defined(FEATURE_REDHAWK) || !defined(STRESS_HEAP)
+BOOL GCHeap::StressHeap(alloc_context * acontext)
+{
+    UNREFERENCED_PARAMETER(acontext);
+    return FALSE;
+}
+#endif // FEATURE_REDHAWK || !STRESS_HEAP
+
 
 #ifdef FEATURE_PREMORTEM_FINALIZATION
 #define REGISTER_FOR_FINALIZATION(_object, _size) \
@@ -34227,7 +36280,7 @@ GCHeap::Alloc( size_t size, uint32_t flags REQD_ALIGN_DCL)
 
         alloc_context* acontext = 0;
 
-        if (size < LARGE_OBJECT_SIZE)
+        if ((size < LARGE_OBJECT_SIZE) && !(flags & GC_ALLOC_PINNED_OBJECT_HEAP))
         {
             acontext = generation_alloc_context (hp->generation_of (0));
 
@@ -34244,7 +36297,7 @@ GCHeap::Alloc( size_t size, uint32_t flags REQD_ALIGN_DCL)
         {
             acontext = generation_alloc_context (hp->generation_of (max_generation+1));
 
-            newAlloc = (Object*) hp->allocate_large_object (size + ComputeMaxStructAlignPadLarge(requiredAlignment), acontext->alloc_bytes_loh);
+            newAlloc = (Object*) hp->allocate_large_object (size + ComputeMaxStructAlignPadLarge(requiredAlignment), acontext->alloc_bytes_loh, !!(flags & GC_ALLOC_PINNED_OBJECT_HEAP));
 #ifdef FEATURE_STRUCTALIGN
             newAlloc = (Object*) hp->pad_for_alignment_large ((uint8_t*) newAlloc, requiredAlignment, size);
 #endif // FEATURE_STRUCTALIGN
@@ -34371,7 +36424,7 @@ GCHeap::AllocAlign8Common(void* _hp, alloc_context* acontext, size_t size, uint3
     GCStress<gc_on_alloc>::MaybeTrigger(acontext);
 #endif // FEATURE_REDHAWK
 
-    if (size < LARGE_OBJECT_SIZE)
+    if ((size < LARGE_OBJECT_SIZE) && !(flags & GC_ALLOC_PINNED_OBJECT_HEAP))
     {
 #ifdef TRACE_GC
         AllocSmallCount++;
@@ -34436,7 +36489,7 @@ GCHeap::AllocAlign8Common(void* _hp, alloc_context* acontext, size_t size, uint3
 
         alloc_context* acontext = generation_alloc_context (hp->generation_of (max_generation+1));
 
-        newAlloc = (Object*) hp->allocate_large_object (size, acontext->alloc_bytes_loh);
+        newAlloc = (Object*) hp->allocate_large_object (size, acontext->alloc_bytes_loh, !!(flags & GC_ALLOC_PINNED_OBJECT_HEAP));
         ASSERT(((size_t)newAlloc & 7) == 0);
     }
 
@@ -34453,6 +36506,26 @@ GCHeap::AllocAlign8Common(void* _hp, alloc_context* acontext, size_t size, uint3
 #endif //TRACE_GC
     return newAlloc;
 }
+#else // FEATURE_64BIT_ALIGNMENT
+// Without FEATURE_64BIT_ALIGNMENT objects don't need more alignment than what they get anyway.
+Object *
+GCHeap::AllocAlign8( size_t size, uint32_t flags)
+{
+    return Alloc (size, flags);
+}
+
+Object*
+GCHeap::AllocAlign8(alloc_context* acontext, size_t size, uint32_t flags )
+{
+    return Alloc (acontext, size, flags);
+}
+
+Object*
+GCHeap::AllocAlign8Common(void* _hp, alloc_context* acontext, size_t size, uint32_t flags)
+{
+    UNREFERENCED_PARAMETER(_hp);
+    return Alloc (acontext, size, flags);
+}
 #endif // FEATURE_64BIT_ALIGNMENT
 
 Object *
@@ -34508,7 +36581,7 @@ GCHeap::AllocLHeap( size_t size, uint32_t flags REQD_ALIGN_DCL)
 
     alloc_context* acontext = generation_alloc_context (hp->generation_of (max_generation+1));
 
-    newAlloc = (Object*) hp->allocate_large_object (size + ComputeMaxStructAlignPadLarge(requiredAlignment), acontext->alloc_bytes_loh);
+    newAlloc = (Object*) hp->allocate_large_object (size + ComputeMaxStructAlignPadLarge(requiredAlignment), acontext->alloc_bytes_loh, !!(flags & GC_ALLOC_PINNED_OBJECT_HEAP));
 #ifdef FEATURE_STRUCTALIGN
     newAlloc = (Object*) hp->pad_for_alignment_large ((uint8_t*) newAlloc, requiredAlignment, size);
 #endif // FEATURE_STRUCTALIGN
@@ -34584,7 +36657,7 @@ GCHeap::Alloc(alloc_context* acontext, size_t size, uint32_t flags REQD_ALIGN_DC
 #endif //_PREFAST_
 #endif //MULTIPLE_HEAPS
 
-    if (size < LARGE_OBJECT_SIZE)
+    if ((size < LARGE_OBJECT_SIZE) && !(flags & GC_ALLOC_PINNED_OBJECT_HEAP))
     {
 
 #ifdef TRACE_GC
@@ -34598,7 +36671,7 @@ GCHeap::Alloc(alloc_context* acontext, size_t size, uint32_t flags REQD_ALIGN_DC
     }
     else 
     {
-        newAlloc = (Object*) hp->allocate_large_object (size + ComputeMaxStructAlignPadLarge(requiredAlignment), acontext->alloc_bytes_loh);
+        newAlloc = (Object*) hp->allocate_large_object (size + ComputeMaxStructAlignPadLarge(requiredAlignment), acontext->alloc_bytes_loh, !!(flags & GC_ALLOC_PINNED_OBJECT_HEAP));
 #ifdef FEATURE_STRUCTALIGN
         newAlloc = (Object*) hp->pad_for_alignment_large ((uint8_t*) newAlloc, requiredAlignment, size);
 #endif // FEATURE_STRUCTALIGN
@@ -35295,6 +37368,8 @@ GCHeap::GarbageCollectGeneration (unsigned int gen, gc_reason reason)
 #ifdef BACKGROUND_GC
         }
 #endif //BACKGROUND_GC
+
+        gc_heap::flush_heap_snapshot();
 #endif //!MULTIPLE_HEAPS
 
     }
@@ -35697,9 +37772,16 @@ size_t GCHeap::GetValidGen0MaxSize(size_t seg_size)
 
         GCMemoryStatus ms;
         GCToOSInterface::GetMemoryStatus (&ms);
+        uint64_t available_physical = ms.ullAvailPhys;
+        // When we are limited (by a job object/cgroup or a heap hard limit) what's available
+        // on the machine doesn't mean much, go by what's available to us instead.
+        if (gc_heap::restricted_physical_memory_p || gc_heap::heap_hard_limit)
+        {
+            gc_heap::get_memory_info (NULL, &available_physical);
+        }
         // if the total min GC across heaps will exceed 1/6th of available memory,
         // then reduce the min GC size until it either fits or has been reduced to cache size.
-        while ((gen0size * gc_heap::n_heaps) > (ms.ullAvailPhys / 6))
+        while ((gen0size * gc_heap::n_heaps) > (available_physical / 6))
         {
             gen0size = gen0size / 2;
             if (gen0size <= trueSize)
@@ -35722,6 +37804,18 @@ size_t GCHeap::GetValidGen0MaxSize(size_t seg_size)
     if (gen0size >= (seg_size / 2))
         gen0size = seg_size / 2;
 
+    // With a hard limit segments are sized to fit in the limit so they can be small; keep
+    // gen0 to a fraction of the segment so we GC well before we get to the limit.
+    if (gc_heap::heap_hard_limit)
+    {
+        size_t gen0size_seg = seg_size / 8;
+        if (gen0size >= gen0size_seg)
+        {
+            dprintf (1, ("gen0 limited by seg size %Id->%Id", gen0size, gen0size_seg));
+            gen0size = gen0size_seg;
+        }
+    }
+
     return (gen0size);
 }
 
@@ -35737,21 +37831,31 @@ void GCHeap::SetReservedVMLimit (size_t vmlimit)
 
 Object* GCHeap::GetNextFinalizableObject()
 {
+    return GetNextFinalizableObjectFrom (0, FALSE);
+}
+
+Object* GCHeap::GetNextFinalizableObjectFrom (int start_heap, BOOL only_non_critical)
+{
+    assert (start_heap >= 0);
 
 #ifdef MULTIPLE_HEAPS
 
     //return the first non critical one in the first queue.
-    for (int hn = 0; hn < gc_heap::n_heaps; hn++)
+    for (int i = 0; i < gc_heap::n_heaps; i++)
     {
-        gc_heap* hp = gc_heap::g_heaps [hn];
+        gc_heap* hp = gc_heap::g_heaps [(start_heap + i) % gc_heap::n_heaps];
         Object* O = hp->finalize_queue->GetNextFinalizableObject(TRUE);
         if (O)
             return O;
     }
+
+    if (only_non_critical)
+        return 0;
+
     //return the first non crtitical/critical one in the first queue.
-    for (int hn = 0; hn < gc_heap::n_heaps; hn++)
+    for (int i = 0; i < gc_heap::n_heaps; i++)
     {
-        gc_heap* hp = gc_heap::g_heaps [hn];
+        gc_heap* hp = gc_heap::g_heaps [(start_heap + i) % gc_heap::n_heaps];
         Object* O = hp->finalize_queue->GetNextFinalizableObject(FALSE);
         if (O)
             return O;
@@ -35760,11 +37864,17 @@ Object* GCHeap::GetNextFinalizableObject()
 
 
 #else //MULTIPLE_HEAPS
-    return pGenGCHeap->finalize_queue->GetNextFinalizableObject();
+    UNREFERENCED_PARAMETER(start_heap);
+    return pGenGCHeap->finalize_queue->GetNextFinalizableObject(only_non_critical);
 #endif //MULTIPLE_HEAPS
 
 }
 
+BOOL GCHeap::IsFinalizationBackedUp()
+{
+    return gc_heap::finalization_backed_up_p;
+}
+
 size_t GCHeap::GetNumberFinalizableObjects()
 {
 #ifdef MULTIPLE_HEAPS
@@ -35822,6 +37932,61 @@ BOOL GCHeap::ShouldRestartFinalizerWatchDog()
     return gc_heap::gc_lock.lock != -1;
 }
 
+// Whether an idle GC would get us something the GCs triggered by allocations would 
+// otherwise only get us once the process allocates again.
+BOOL gc_heap::idle_gc_needed_p()
+{
+    if (settings.pause_mode == pause_no_gc)
+        return FALSE;
+
+#ifdef BACKGROUND_GC
+    if (recursive_gc_sync::background_running_p())
+        return FALSE;
+#endif //BACKGROUND_GC
+
+#ifdef MULTIPLE_HEAPS
+    if (dynamic_heap_count_p && (n_active_heaps > 1))
+        return TRUE;
+#endif //MULTIPLE_HEAPS
+
+    if (decommit_time_window)
+    {
+        if (standby_decommit_pending_p)
+            return TRUE;
+
+#ifdef MULTIPLE_HEAPS
+        for (int i = 0; i < n_heaps; i++)
+        {
+            if (g_heaps[i]->decommit_pending_p)
+                return TRUE;
+        }
+#else
+        if (decommit_pending_p)
+            return TRUE;
+#endif //MULTIPLE_HEAPS
+    }
+
+    return FALSE;
+}
+
+uint32_t GCHeap::PerformIdleWork()
+{
+    if (!gc_heap::idle_gc_interval)
+        return INFINITE;
+
+    size_t elapsed = GetNow() - GetLastGCStartTime (0);
+    if (elapsed < gc_heap::idle_gc_interval)
+        return (uint32_t)(gc_heap::idle_gc_interval - elapsed);
+
+    if (gc_heap::idle_gc_needed_p())
+    {
+        dprintf (2, ("no GC for %Id ms, doing an idle GC", elapsed));
+        GarbageCollectGeneration (max_generation - 1, reason_idle);
+    }
+
+    return (uint32_t)gc_heap::idle_gc_interval;
+}
+
 void GCHeap::SetFinalizeQueueForShutdown(BOOL fHasLock)
 {
 #ifdef MULTIPLE_HEAPS
@@ -35903,6 +38068,13 @@ GCHeap::SetCardsAfterBulkCopy( Object **StartPoint, size_t len )
             updateGCShadow(&StartPoint[i], StartPoint[i]);
 #endif //WRITE_BARRIER_CHECK && !SERVER_GC
 
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    if (SoftwareWriteWatch::IsEnabledForGCHeap())
+    {
+        SoftwareWriteWatch::SetDirtyRegion(StartPoint, len);
+    }
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
     // If destination is in Gen 0 don't bother
     if (
 #ifdef BACKGROUND_GC
@@ -35921,6 +38093,10 @@ GCHeap::SetCardsAfterBulkCopy( Object **StartPoint, size_t len )
             size_t card = gcard_of ((uint8_t*)rover);
 
             Interlocked::Or (&g_card_table[card/card_word_width], (1U << (card % card_word_width)));
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+            size_t cardb = cardw_card_bundle (card_word (card));
+            Interlocked::Or (&g_card_bundle_table[card_bundle_word (cardb)], (1U << card_bundle_bit (cardb)));
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
             // Skip to next card for the object
             rover = (Object**)align_on_card ((uint8_t*)(rover+1));
         }
@@ -36679,7 +38855,6 @@ void gc_heap::walk_heap (walk_fn fn, void* context, int gen_number, BOOL walk_la
     }
 }
 
-#if defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
 void GCHeap::WalkObject (Object* obj, walk_fn fn, void* context)
 {
     uint8_t* o = (uint8_t*)obj;
@@ -36697,7 +38872,452 @@ void GCHeap::WalkObject (Object* obj, walk_fn fn, void* context)
             );
     }
 }
-#endif //defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
+
+// Heap snapshots are taken at the end of a blocking gen2 GC. Each heap
+// records its own objects (on Server GC each GC thread does its heap in
+// parallel) for <GCHeapSnapshotFile>.<pid>.<snapshot>.<heap>.gcsnap and the
+// roots go to <GCHeapSnapshotFile>.<pid>.<snapshot>.roots.gcsnap. A file is
+// a heap_snapshot_header followed by records, each of which is a record
+// kind byte followed by LEB128 encoded fields:
+//
+// heap_snapshot_object: the object's address as a delta from the previous
+//     object's, its method table, its size, how many references it has and
+//     each reference as a delta from the object's address.
+// heap_snapshot_root: the root kind and the object's address.
+// heap_snapshot_end: the number of records and the total object size.
+//
+// Deltas are zigzag encoded as they can be negative. Types are identified
+// by their method table address only.
+//
+// During the GC the files are only built in memory. They are written out on
+// their own thread after the EE is restarted (see flush_heap_snapshot) so
+// the file IO isn't part of the pause.
+#define HEAP_SNAPSHOT_MAGIC 0x53484347 // "GCHS"
+#define HEAP_SNAPSHOT_VERSION 1
+#define HEAP_SNAPSHOT_ROOTS_FILE ((uint32_t)-1)
+#define HEAP_SNAPSHOT_CHUNK_SIZE (1024*1024)
+
+enum heap_snapshot_record
+{
+    heap_snapshot_end = 0,
+    heap_snapshot_object = 1,
+    heap_snapshot_root = 2
+};
+
+enum heap_snapshot_root_kind
+{
+    heap_snapshot_root_stack = 0,
+    heap_snapshot_root_finalizer = 1,
+    heap_snapshot_root_handle = 2
+};
+
+struct heap_snapshot_header
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t pointer_size;
+    // HEAP_SNAPSHOT_ROOTS_FILE for the roots file.
+    uint32_t heap_index;
+    uint32_t n_heaps;
+    uint64_t gc_index;
+};
+
+struct heap_snapshot_chunk
+{
+    heap_snapshot_chunk* next;
+    size_t used;
+    uint8_t data[HEAP_SNAPSHOT_CHUNK_SIZE];
+};
+
+struct heap_snapshot_file
+{
+    heap_snapshot_file* next;
+    heap_snapshot_chunk* first_chunk;
+    TCHAR name[MAX_LONGPATH+1];
+};
+
+void delete_heap_snapshot_file (heap_snapshot_file* file)
+{
+    heap_snapshot_chunk* chunk = file->first_chunk;
+    while (chunk)
+    {
+        heap_snapshot_chunk* next = chunk->next;
+        delete chunk;
+        chunk = next;
+    }
+    delete file;
+}
+
+// Runs on its own thread - writes out and frees a list of snapshot files.
+void write_heap_snapshot_files (void* param)
+{
+    heap_snapshot_file* file = (heap_snapshot_file*)param;
+    while (file)
+    {
+        FILE* f = _tfopen (file->name, _T("wb"));
+        if (f)
+        {
+            for (heap_snapshot_chunk* chunk = file->first_chunk; chunk; chunk = chunk->next)
+            {
+                fwrite (chunk->data, chunk->used, 1, f);
+            }
+            fclose (f);
+        }
+
+        heap_snapshot_file* next = file->next;
+        delete_heap_snapshot_file (file);
+        file = next;
+    }
+}
+
+class heap_snapshot_writer
+{
+    heap_snapshot_file* file;
+    heap_snapshot_chunk* chunk;
+    // Set if we couldn't get memory for the file - it's dropped then.
+    BOOL failed_p;
+    uint8_t* last_object;
+    size_t record_count;
+    size_t total_object_size;
+
+    // Makes sure the current chunk has room for n more bytes.
+    BOOL reserve (size_t n)
+    {
+        if (failed_p)
+        {
+            return FALSE;
+        }
+
+        if ((chunk == NULL) || ((chunk->used + n) > HEAP_SNAPSHOT_CHUNK_SIZE))
+        {
+            heap_snapshot_chunk* new_chunk = new (nothrow) heap_snapshot_chunk;
+            if (!new_chunk)
+            {
+                failed_p = TRUE;
+                return FALSE;
+            }
+
+            new_chunk->next = NULL;
+            new_chunk->used = 0;
+            if (chunk)
+            {
+                chunk->next = new_chunk;
+            }
+            else
+            {
+                file->first_chunk = new_chunk;
+            }
+            chunk = new_chunk;
+        }
+
+        return TRUE;
+    }
+
+    void put_byte (uint8_t b)
+    {
+        if (reserve (1))
+        {
+            chunk->data[chunk->used++] = b;
+        }
+    }
+
+    void put_uint (uint64_t v)
+    {
+        // A 64-bit value takes at most 10 bytes.
+        if (!reserve (10))
+        {
+            return;
+        }
+        while (v >= 0x80)
+        {
+            chunk->data[chunk->used++] = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        chunk->data[chunk->used++] = (uint8_t)v;
+    }
+
+    void put_int (int64_t v)
+    {
+        put_uint (((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+    }
+
+public:
+    heap_snapshot_writer() : file (NULL), chunk (NULL), failed_p (FALSE),
+        last_object (0), record_count (0), total_object_size (0)
+    {
+    }
+
+    // The file is <GCHeapSnapshotFile>.<pid>.<snapshot>.<suffix>.
+    BOOL open (const TCHAR* prefix, size_t snapshot, const TCHAR* suffix, heap_snapshot_header* file_header)
+    {
+        size_t prefix_len = _tcslen (prefix);
+        // leave room for the rest of the name.
+        if (prefix_len > (MAX_LONGPATH - 64))
+        {
+            return FALSE;
+        }
+
+        file = new (nothrow) heap_snapshot_file;
+        if (!file)
+        {
+            return FALSE;
+        }
+
+        file->next = NULL;
+        file->first_chunk = NULL;
+        _tcscpy (file->name, prefix);
+        _stprintf_s (file->name + prefix_len, MAX_LONGPATH + 1 - prefix_len, _T(".%d.%d.%s.gcsnap"),
+            GCToOSInterface::GetCurrentProcessId(), (int)snapshot, suffix);
+
+        if (reserve (sizeof (*file_header)))
+        {
+            memcpy (chunk->data, file_header, sizeof (*file_header));
+            chunk->used = sizeof (*file_header);
+        }
+        return !failed_p;
+    }
+
+    // Returns the finished file, NULL if it couldn't be built.
+    heap_snapshot_file* close()
+    {
+        heap_snapshot_file* finished_file = file;
+        if (finished_file)
+        {
+            put_byte (heap_snapshot_end);
+            put_uint (record_count);
+            put_uint (total_object_size);
+
+            if (failed_p)
+            {
+                dprintf (GTC_LOG, ("no memory for heap snapshot file, dropping it"));
+                delete_heap_snapshot_file (finished_file);
+                finished_file = NULL;
+            }
+
+            file = NULL;
+            chunk = NULL;
+        }
+
+        return finished_file;
+    }
+
+    void write_object (uint8_t* o)
+    {
+        size_t s = size (o);
+
+        put_byte (heap_snapshot_object);
+        put_int ((int64_t)((size_t)o - (size_t)last_object));
+        put_uint ((size_t)method_table (o));
+        put_uint (s);
+
+        size_t num_refs = 0;
+        go_through_object_cl (method_table (o), o, s, pref,
+                              {
+                                  if (*pref)
+                                  {
+                                      num_refs++;
+                                  }
+                              }
+            );
+        put_uint (num_refs);
+        go_through_object_cl (method_table (o), o, s, pref,
+                              {
+                                  if (*pref)
+                                  {
+                                      put_int ((int64_t)(*pref - o));
+                                  }
+                              }
+            );
+
+        last_object = o;
+        record_count++;
+        total_object_size += s;
+    }
+
+    void write_root (uint8_t* o, heap_snapshot_root_kind kind)
+    {
+        put_byte (heap_snapshot_root);
+        put_byte ((uint8_t)kind);
+        put_uint ((size_t)o);
+        record_count++;
+    }
+};
+
+struct heap_snapshot_scan_context : ScanContext
+{
+    heap_snapshot_writer* writer;
+    heap_snapshot_root_kind root_kind;
+};
+
+BOOL heap_snapshot_walk_object (Object* obj, void* context)
+{
+    ((heap_snapshot_writer*)context)->write_object ((uint8_t*)obj);
+    return TRUE;
+}
+
+void gc_heap::heap_snapshot_root (Object** ppObject, ScanContext* sc, uint32_t flags)
+{
+    uint8_t* o = (uint8_t*)*ppObject;
+    if (o == 0)
+        return;
+
+#ifdef INTERIOR_POINTERS
+    if (flags & GC_CALL_INTERIOR)
+    {
+        gc_heap* hp = gc_heap::heap_of (o);
+        if ((o < hp->gc_low) || (o >= hp->gc_high))
+            return;
+        o = hp->find_object (o, hp->gc_low);
+    }
+#else
+    UNREFERENCED_PARAMETER(flags);
+#endif //INTERIOR_POINTERS
+
+    heap_snapshot_scan_context* snapshot_sc = (heap_snapshot_scan_context*)sc;
+    snapshot_sc->writer->write_root (o, snapshot_sc->root_kind);
+}
+
+// Called once per GC, after the GC's work is done.
+BOOL gc_heap::should_write_heap_snapshot()
+{
+    if (!heap_snapshot_file_name || settings.concurrent || 
+        (settings.condemned_generation != max_generation))
+    {
+        return FALSE;
+    }
+
+    heap_snapshot_gen2_count++;
+
+    BOOL write_p = (heap_snapshot_requested_p || 
+                    (heap_snapshot_interval && ((heap_snapshot_gen2_count % heap_snapshot_interval) == 0)));
+    if (write_p)
+    {
+        heap_snapshot_requested_p = FALSE;
+        heap_snapshot_count++;
+        dprintf (GTC_LOG, ("writing heap snapshot %Id in GC#%Id", heap_snapshot_count, (size_t)settings.gc_index));
+    }
+
+    return write_p;
+}
+
+void gc_heap::write_heap_snapshot()
+{
+#ifdef MULTIPLE_HEAPS
+    int n_snapshot_heaps = n_heaps;
+    int snapshot_heap_number = heap_number;
+#else
+    int n_snapshot_heaps = 1;
+    int snapshot_heap_number = 0;
+#endif //MULTIPLE_HEAPS
+
+    heap_snapshot_header file_header;
+    file_header.magic = HEAP_SNAPSHOT_MAGIC;
+    file_header.version = HEAP_SNAPSHOT_VERSION;
+    file_header.pointer_size = sizeof (uint8_t*);
+    file_header.heap_index = snapshot_heap_number;
+    file_header.n_heaps = n_snapshot_heaps;
+    file_header.gc_index = settings.gc_index;
+
+    TCHAR suffix[16];
+    _stprintf_s (suffix, _countof(suffix), _T("%d"), snapshot_heap_number);
+
+    heap_snapshot_writer writer;
+    if (writer.open (heap_snapshot_file_name, heap_snapshot_count, suffix, &file_header))
+    {
+        walk_heap (&heap_snapshot_walk_object, &writer, max_generation, TRUE);
+    }
+    add_heap_snapshot_file (writer.close());
+
+    // The roots are scanned by one thread - stack roots with interior 
+    // pointers can be on any heap and finding their objects isn't safe to 
+    // do from multiple threads. Scanning them is cheap compared to the heap
+    // walk anyway.
+#ifdef MULTIPLE_HEAPS
+    gc_t_join.join(this, gc_join_after_heap_snapshot);
+    if (gc_t_join.joined())
+#endif //MULTIPLE_HEAPS
+    {
+        file_header.heap_index = HEAP_SNAPSHOT_ROOTS_FILE;
+
+        heap_snapshot_writer roots_writer;
+        if (roots_writer.open (heap_snapshot_file_name, heap_snapshot_count, _T("roots"), &file_header))
+        {
+            heap_snapshot_scan_context sc;
+#ifdef FEATURE_CONSERVATIVE_GC
+            // To not confuse GCScan::GcScanRoots
+            sc.promotion = g_pConfig->GetGCConservative();
+#endif //FEATURE_CONSERVATIVE_GC
+            sc.writer = &roots_writer;
+
+            for (int hn = 0; hn < n_snapshot_heaps; hn++)
+            {
+#ifdef MULTIPLE_HEAPS
+                gc_heap* hp = g_heaps[hn];
+#else
+                gc_heap* hp = pGenGCHeap;
+#endif //MULTIPLE_HEAPS
+                sc.thread_number = hn;
+                sc.root_kind = heap_snapshot_root_stack;
+                GCScan::GcScanRoots (&heap_snapshot_root, max_generation, max_generation, &sc);
+
+                sc.root_kind = heap_snapshot_root_finalizer;
+                hp->finalize_queue->GcScanRoots (&heap_snapshot_root, hn, &sc);
+            }
+
+            sc.thread_number = 0;
+            sc.root_kind = heap_snapshot_root_handle;
+            GCScan::GcScanStrongHandlesBySingleThread (&heap_snapshot_root, max_generation, &sc);
+        }
+        add_heap_snapshot_file (roots_writer.close());
+
+#ifdef MULTIPLE_HEAPS
+        gc_t_join.restart();
+#endif //MULTIPLE_HEAPS
+    }
+}
+
+void gc_heap::add_heap_snapshot_file (heap_snapshot_file* file)
+{
+    if (!file)
+    {
+        return;
+    }
+
+    // On Server GC every heap's GC thread adds its own file.
+    heap_snapshot_file* head;
+    do
+    {
+        head = heap_snapshot_pending;
+        file->next = head;
+    } while (Interlocked::CompareExchangePointer (&heap_snapshot_pending, file, head) != head);
+}
+
+// Called after the EE is restarted, with the gc lock still held so no other GC
+// can add to heap_snapshot_pending meanwhile.
+void gc_heap::flush_heap_snapshot()
+{
+    heap_snapshot_file* files = heap_snapshot_pending;
+    if (!files)
+    {
+        return;
+    }
+    heap_snapshot_pending = NULL;
+
+    GCThreadAffinity affinity;
+    affinity.Group = GCThreadAffinity::None;
+    affinity.Processor = GCThreadAffinity::None;
+
+    if (!GCToOSInterface::CreateThread (write_heap_snapshot_files, files, &affinity))
+    {
+        dprintf (GTC_LOG, ("couldn't create the heap snapshot thread, writing it on this thread"));
+        write_heap_snapshot_files (files);
+    }
+}
+
+void GCHeap::RequestHeapSnapshot()
+{
+    gc_heap::heap_snapshot_requested_p = TRUE;
+}
 
 // Go through and touch (read) each page straddled by a memory block.
 void TouchPages(void * pStart, size_t cb)
@@ -123,6 +123,16 @@ GPTR_DECL(uint32_t,g_card_table);
 }
 #endif
 
+#if defined(FEATURE_MANUALLY_MANAGED_CARD_BUNDLES) && !defined(DACCESS_COMPILE)
+// The card bundle table, translated like g_card_table. Without OS write watch on
+// the card table, the write barrier helpers set the card bundle of each card they
+// set by storing 0xFF to the byte of this table at
+// address >> CARD_BUNDLE_AddressToTableByteIndexShift; they hard-code this constant.
+#define CARD_BUNDLE_AddressToTableByteIndexShift 0x15
+
+extern "C" uint32_t* g_card_bundle_table;
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES && !DACCESS_COMPILE
+
 #ifdef DACCESS_COMPILE
 class DacHeapWalker;
 #endif
@@ -176,6 +186,8 @@ struct alloc_context
     uint8_t*       alloc_limit;
     int64_t        alloc_bytes; //Number of bytes allocated on SOH by this context
     int64_t        alloc_bytes_loh; //Number of bytes allocated on LOH by this context
+    int64_t        alloc_bytes_last_gc; //alloc_bytes when the last GC retired this context
+    size_t         alloc_quantum; //How much this context gets at a time on SOH, 0 means the heap's allocation_quantum
 #if defined(FEATURE_SVR_GC)
     SVR::GCHeap*   alloc_heap;
     SVR::GCHeap*   home_heap;
@@ -191,6 +203,8 @@ public:
         alloc_limit = 0;
         alloc_bytes = 0;
         alloc_bytes_loh = 0;
+        alloc_bytes_last_gc = 0;
+        alloc_quantum = 0;
 #if defined(FEATURE_SVR_GC)
         alloc_heap = 0;
         home_heap = 0;
@@ -199,6 +213,9 @@ public:
     }
 };
 
+// The runtime fills in the fields after concurrent while scanning roots, so they
+// are padded out when unused to keep the layout the same for a GC built as a
+// separate library (see gcinterface.h).
 struct ScanContext
 {
     Thread* thread_under_crawl;
@@ -208,15 +225,19 @@ struct ScanContext
     BOOL concurrent; //TRUE: concurrent scanning 
 #if CHECK_APP_DOMAIN_LEAKS || defined (FEATURE_APPDOMAIN_RESOURCE_MONITORING) || defined (DACCESS_COMPILE)
     AppDomain *pCurrentDomain;
+#else
+    void* _unused1;
 #endif //CHECK_APP_DOMAIN_LEAKS || FEATURE_APPDOMAIN_RESOURCE_MONITORING || DACCESS_COMPILE
 
-#ifndef FEATURE_REDHAWK
-#if defined(GC_PROFILING) || defined (DACCESS_COMPILE)
+#if !defined(FEATURE_REDHAWK) && (defined(GC_PROFILING) || defined (DACCESS_COMPILE))
     MethodDesc *pMD;
-#endif //GC_PROFILING || DACCESS_COMPILE
-#endif // FEATURE_REDHAWK
+#else
+    void* _unused2;
+#endif //!FEATURE_REDHAWK && (GC_PROFILING || DACCESS_COMPILE)
 #if defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
     EtwGCRootKind dwEtwRootKind;
+#else
+    uint32_t _unused3;
 #endif // GC_PROFILING || FEATURE_EVENT_TRACE
     
     ScanContext()
@@ -324,6 +345,47 @@ enum end_no_gc_region_status
     end_no_gc_alloc_exceeded = 3
 };
 
+// !!!!!!!!!!!!!!!!!!!!!!!
+// make sure you change the def in bcl\system\gc.cs 
+// if you change this!
+// Describes one of the most recent GCs, see GCHeap::GetGCInfoRecords.
+struct gc_info_record
+{
+    uint64_t index;
+    // from the start of the GC till the end, in microseconds.
+    uint64_t duration;
+    // for a BGC, how long LOH allocations were blocked while it was sweeping, 
+    // in microseconds; 0 for other GCs.
+    uint64_t loh_alloc_blocked_time;
+    uint32_t generation;
+    uint32_t reason;
+    uint32_t flags;
+    uint32_t heap_count;
+};
+
+//flags for gc_info_record
+#define GC_INFO_COMPACTING 0x1
+#define GC_INFO_CONCURRENT 0x2
+
+// !!!!!!!!!!!!!!!!!!!!!!!
+// make sure you change the def in bcl\system\gc.cs 
+// if you change this!
+// What a GC did on one heap. The times are in microseconds.
+struct gc_info_heap_record
+{
+    uint64_t mark_time;
+    uint64_t plan_time;
+    uint64_t relocate_time;
+    uint64_t compact_time;
+    uint64_t sweep_time;
+    uint64_t promoted_bytes;
+    // free list and free object space left in the heap after the GC.
+    uint64_t fragmentation;
+    uint32_t pinned_plug_count;
+    // a gc_heap_compact_reason or -1 if this heap was not compacted.
+    int32_t compact_reason;
+};
+
 enum bgc_state
 {
     bgc_not_in_process = 0,
@@ -367,6 +429,7 @@ void record_global_mechanism (int mech_index);
 #define GC_ALLOC_CONTAINS_REF 0x2
 #define GC_ALLOC_ALIGN8_BIAS 0x4
 #define GC_ALLOC_ALIGN8 0x8
+#define GC_ALLOC_PINNED_OBJECT_HEAP 0x10
 
 class GCHeap {
     friend struct ::_DacGlobals;
@@ -528,11 +591,24 @@ public:
 
     virtual void    SetFinalizationRun (Object* obj) = 0;
     virtual Object* GetNextFinalizable() = 0;
+    // Like GetNextFinalizable but starts looking at the finalization queue of heap 
+    // startHeap (modulo the number of heaps) so multiple finalizer threads drain 
+    // different queues. If onlyNonCritical is TRUE, critical finalizable objects are 
+    // left for GetNextFinalizable.
+    virtual Object* GetNextFinalizableFrom(int startHeap, BOOL onlyNonCritical) = 0;
     virtual size_t GetNumberOfFinalizable() = 0;
+    // TRUE when the last GC that checked the memory load found it high while
+    // objects from earlier GCs were still waiting to be finalized.
+    virtual BOOL IsFinalizationBackedUp() = 0;
 
     virtual void SetFinalizeQueueForShutdown(BOOL fHasLock) = 0;
     virtual BOOL FinalizeAppDomain(AppDomain *pDomain, BOOL fRunFinalizers) = 0;
     virtual BOOL ShouldRestartFinalizerWatchDog() = 0;
+    // Called by the finalizer thread, in cooperative mode, when it has nothing to do. 
+    // The GC may do a GC here if none happened for a while, e.g. to give back memory 
+    // when the process stopped allocating. Returns how many ms to wait before calling 
+    // it again, INFINITE if it never needs to be called.
+    virtual uint32_t PerformIdleWork() = 0;
 
     //wait for concurrent GC to finish
     virtual void WaitUntilConcurrentGCComplete () = 0;                                  // Use in managed threads
@@ -557,19 +633,20 @@ public:
 
     virtual HRESULT GarbageCollect (int generation = -1, BOOL low_memory_p=FALSE, int mode = collection_blocking) = 0;
     virtual Object*  Alloc (size_t size, uint32_t flags) = 0;
-#ifdef FEATURE_64BIT_ALIGNMENT
+    // Same as Alloc when the build doesn't have FEATURE_64BIT_ALIGNMENT.
     virtual Object*  AllocAlign8 (size_t size, uint32_t flags) = 0;
     virtual Object*  AllocAlign8 (alloc_context* acontext, size_t size, uint32_t flags) = 0;
 private:
     virtual Object*  AllocAlign8Common (void* hp, alloc_context* acontext, size_t size, uint32_t flags) = 0;
 public:
-#endif // FEATURE_64BIT_ALIGNMENT
     virtual Object*  AllocLHeap (size_t size, uint32_t flags) = 0;
     virtual void     SetReservedVMLimit (size_t vmlimit) = 0;
     virtual void SetCardsAfterBulkCopy( Object**, size_t ) = 0;
-#if defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
     virtual void WalkObject (Object* obj, walk_fn fn, void* context) = 0;
-#endif //defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
+    // Asks for a heap snapshot (see GCHeapSnapshotFile) to be written at the end of the 
+    // next gen2 GC, which will be a blocking one. This only sets a flag so it's safe to 
+    // call from a signal handler.
+    virtual void RequestHeapSnapshot() = 0;
 
     virtual bool IsThreadUsingAllocationContextHeap(alloc_context* acontext, int thread_number) = 0;
     virtual int GetNumberOfHeaps () = 0; 
@@ -629,6 +706,15 @@ public:
 
     virtual size_t GetPromotedBytes(int heap_index) = 0;
 
+    // Copies the records of up to max_records of the most recent GCs, most recent 
+    // first, into records. heap_records gets GetNumberOfHeaps() entries for each 
+    // record, of which the first heap_count are used. Returns the number of records.
+    virtual int GetGCInfoRecords(gc_info_record* records, gc_info_heap_record* heap_records, int max_records) = 0;
+
+    // How much is committed for the heap's segments, not counting the GC's own
+    // bookkeeping (card table, brick table, mark array) or retained segments.
+    virtual size_t GetTotalCommittedBytes() = 0;
+
 private:
     enum {
         max_generation  = 2,
@@ -636,39 +722,28 @@ private:
     
 public:
 
-#ifdef FEATURE_BASICFREEZE
-    // frozen segment management functions
+    // frozen segment management functions, without FEATURE_BASICFREEZE registering
+    // a frozen segment always fails.
     virtual segment_handle RegisterFrozenSegment(segment_info *pseginfo) = 0;
     virtual void UnregisterFrozenSegment(segment_handle seg) = 0;
-#endif //FEATURE_BASICFREEZE
 
         // debug support 
-#ifndef FEATURE_REDHAWK // Redhawk forces relocation a different way
-#ifdef STRESS_HEAP
+    // These are declared whatever the build flags are so that the vtable of a GC
+    // built as a separate library (see gcinterface.h) matches the runtime's; the
+    // GC implements them as no-ops when the feature is off.
+
     //return TRUE if GC actually happens, otherwise FALSE
     virtual BOOL    StressHeap(alloc_context * acontext = 0) = 0;
-#endif
-#endif // FEATURE_REDHAWK
-#ifdef VERIFY_HEAP
     virtual void    ValidateObjectMember (Object *obj) = 0;
-#endif
 
-#if defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
     virtual void DescrGenerationsToProfiler (gen_walk_fn fn, void *context) = 0;
-#endif // defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
 
-protected: 
-#ifdef VERIFY_HEAP
-public:
     // Return NULL if can't find next object. When EE is not suspended,
     // the result is not accurate: if the input arg is in gen0, the function could 
     // return zeroed out memory as next object
     virtual Object * NextObj (Object * object) = 0;
-#ifdef FEATURE_BASICFREEZE
     // Return TRUE if object lives in frozen segment
     virtual BOOL IsInFrozenSegment (Object * object) = 0;
-#endif //FEATURE_BASICFREEZE
-#endif //VERIFY_HEAP    
 };
 
 extern VOLATILE(int32_t) m_GCLock;
@@ -23,6 +23,10 @@ GPTR_IMPL(GCHeap,g_pGCHeap);
 /* global versions of the card table and brick table */ 
 GPTR_IMPL(uint32_t,g_card_table);
 
+#if defined(FEATURE_MANUALLY_MANAGED_CARD_BUNDLES) && !defined(DACCESS_COMPILE)
+uint32_t* g_card_bundle_table = 0;
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES && !DACCESS_COMPILE
+
 /* absolute bounds of the GC memory */
 GPTR_IMPL_INIT(uint8_t,g_lowest_address,0);
 GPTR_IMPL_INIT(uint8_t,g_highest_address,0);
@@ -820,12 +820,15 @@ void GCHeap::TraceGCSegments()
 #endif // FEATURE_EVENT_TRACE
 }
 
-#if defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
 void GCHeap::DescrGenerationsToProfiler (gen_walk_fn fn, void *context)
 {
+#if defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
     pGenGCHeap->descr_generations_to_profiler(fn, context);
-}
+#else
+    UNREFERENCED_PARAMETER(fn);
+    UNREFERENCED_PARAMETER(context);
 #endif // defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
+}
 
 #if defined(BACKGROUND_GC) && defined(FEATURE_REDHAWK)
 
@@ -895,6 +898,17 @@ void GCHeap::UnregisterFrozenSegment(segment_handle seg)
 
     heap->remove_ro_segment(reinterpret_cast<heap_segment*>(seg));
 }
+#else // FEATURE_BASICFREEZE
+segment_handle GCHeap::RegisterFrozenSegment(segment_info *pseginfo)
+{
+    UNREFERENCED_PARAMETER(pseginfo);
+    return NULL;
+}
+
+void GCHeap::UnregisterFrozenSegment(segment_handle seg)
+{
+    UNREFERENCED_PARAMETER(seg);
+}
 #endif // FEATURE_BASICFREEZE
 
 
@@ -41,6 +41,9 @@ class gc_heap;
 class CFinalize;
 
 // TODO : it would be easier to make this an ORed value
+// !!!!!!!!!!!!!!!!!!!!!!!
+// make sure you change GCReason in bcl\system\gc.cs 
+// if you change this!
 enum gc_reason
 {
     reason_alloc_soh = 0,
@@ -55,6 +58,7 @@ enum gc_reason
     reason_lowmemory_blocking = 9,
     reason_induced_compacting = 10,
     reason_lowmemory_host = 11,
+    reason_idle = 12,           // triggered from PerformIdleWork when no GC happened for a while.
     reason_max
 };
 
@@ -111,13 +115,11 @@ public:
 
     //flags can be GC_ALLOC_CONTAINS_REF GC_ALLOC_FINALIZE
     Object*  Alloc (size_t size, uint32_t flags);
-#ifdef FEATURE_64BIT_ALIGNMENT
     Object*  AllocAlign8 (size_t size, uint32_t flags);
     Object*  AllocAlign8 (alloc_context* acontext, size_t size, uint32_t flags);
 private:
     Object*  AllocAlign8Common (void* hp, alloc_context* acontext, size_t size, uint32_t flags);
 public:
-#endif // FEATURE_64BIT_ALIGNMENT
     Object*  AllocLHeap (size_t size, uint32_t flags);
     Object* Alloc (alloc_context* acontext, size_t size, uint32_t flags);
 
@@ -148,6 +150,10 @@ public:
     BOOL    IsPromoted (Object *object);
 
     size_t GetPromotedBytes (int heap_index);
+
+    int GetGCInfoRecords (gc_info_record* records, gc_info_heap_record* heap_records, int max_records);
+
+    size_t GetTotalCommittedBytes ();
     
     int CollectionCount (int generation, int get_bgc_fgc_count = 0);
 
@@ -176,9 +182,7 @@ public:
     BOOL    IsEphemeral (Object* object);
     BOOL    IsHeapPointer (void* object, BOOL small_heap_only = FALSE);
     
-#ifdef VERIFY_HEAP
     void    ValidateObjectMember (Object *obj);
-#endif //_DEBUG
 
     PER_HEAP    size_t  ApproxTotalBytesInUse(BOOL small_heap_only = FALSE);
     PER_HEAP    size_t  ApproxFreeBytes();
@@ -205,7 +209,12 @@ public:
     unsigned GetGcCount();
 
     Object* GetNextFinalizable() { return GetNextFinalizableObject(); };
+    Object* GetNextFinalizableFrom(int startHeap, BOOL onlyNonCritical) 
+    { 
+        return GetNextFinalizableObjectFrom(startHeap, onlyNonCritical); 
+    };
     size_t GetNumberOfFinalizable() { return GetNumberFinalizableObjects(); }
+    BOOL IsFinalizationBackedUp();
 
     PER_HEAP_ISOLATED HRESULT GetGcCounters(int gen, gc_counters* counters);
 
@@ -216,17 +225,18 @@ public:
     void SetReservedVMLimit (size_t vmlimit);
 
     PER_HEAP_ISOLATED Object* GetNextFinalizableObject();
+    PER_HEAP_ISOLATED Object* GetNextFinalizableObjectFrom (int start_heap, BOOL only_non_critical);
     PER_HEAP_ISOLATED size_t GetNumberFinalizableObjects();
     PER_HEAP_ISOLATED size_t GetFinalizablePromotedCount();
 
     void SetFinalizeQueueForShutdown(BOOL fHasLock);
     BOOL FinalizeAppDomain(AppDomain *pDomain, BOOL fRunFinalizers);
     BOOL ShouldRestartFinalizerWatchDog();
+    uint32_t PerformIdleWork();
 
     void SetCardsAfterBulkCopy( Object**, size_t);
-#if defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
     void WalkObject (Object* obj, walk_fn fn, void* context);
-#endif // defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
+    void RequestHeapSnapshot();
 
 public:	// FIX 
 
@@ -249,11 +259,9 @@ public:	// FIX
     // Interface with gc_heap
     size_t  GarbageCollectTry (int generation, BOOL low_memory_p=FALSE, int mode=collection_blocking);
 
-#ifdef FEATURE_BASICFREEZE
     // frozen segment management functions
     virtual segment_handle RegisterFrozenSegment(segment_info *pseginfo);
     virtual void UnregisterFrozenSegment(segment_handle seg);
-#endif // FEATURE_BASICFREEZE
 
     void    WaitUntilConcurrentGCComplete ();                               // Use in managd threads
 #ifndef DACCESS_COMPILE    
@@ -281,11 +289,12 @@ private:
         // the condition here may have to change as well.
         return g_TrapReturningThreads == 0;
     }
-#ifndef FEATURE_REDHAWK // Redhawk forces relocation a different way
-#ifdef STRESS_HEAP 
 public:
     //return TRUE if GC actually happens, otherwise FALSE
     BOOL    StressHeap(alloc_context * acontext = 0);
+
+#ifndef FEATURE_REDHAWK // Redhawk forces relocation a different way
+#ifdef STRESS_HEAP 
 protected:
 
     // only used in BACKGROUND_GC, but the symbol is not defined yet...
@@ -300,17 +309,11 @@ protected:
 #endif  // STRESS_HEAP 
 #endif // FEATURE_REDHAWK
 
-#if defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
     virtual void DescrGenerationsToProfiler (gen_walk_fn fn, void *context);
-#endif // defined(GC_PROFILING) || defined(FEATURE_EVENT_TRACE)
 
-#ifdef VERIFY_HEAP
 public:
     Object * NextObj (Object * object);
-#ifdef FEATURE_BASICFREEZE
     BOOL IsInFrozenSegment (Object * object);
-#endif //FEATURE_BASICFREEZE
-#endif //VERIFY_HEAP     
 };
 
 #endif  // GCIMPL_H_
@@ -0,0 +1,283 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+/*++
+
+Module Name:
+
+    gcinterface.h
+
+    Interface between the runtime and a GC built as a separate shared library
+    (see src/gc/standalone). The runtime loads the library named by the GCName
+    config, checks its version with GC_VersionInfo and creates the heap with
+    GC_Initialize, passing the services the GC gets from the runtime.
+
+    Besides the types below, the GCHeap class (gc.h) and the structures passed
+    through it (alloc_context, ScanContext) are part of the interface, so their
+    layout must not depend on build flags. The GC is built against the GC
+    environment (src/gc/env) and does not know the runtime's MethodTable beyond
+    what gcenv.object.h mirrors.
+
+    Rules for changing the interface:
+    - Adding a method at the end of IGCToCLR or IGCToOS, or a new export, bumps
+      the minor version; a GC still works with a runtime that is at least as new
+      as the GC.
+    - Any other change (removing or reordering methods, changing signatures or
+      the layout of a shared type) bumps the major version; the runtime only
+      loads a GC with the same major version.
+    The runtime and the library are built from the same tree until the
+    interface first ships, so the version stays at 1.0 until then.
+
+    What a standalone GC does not support yet:
+    - Server GC. The library only builds the workstation GC and GC_Initialize
+      fails if the runtime asks for server GC.
+    - GC stress. The library has no StressHeap, so the runtime does not load a
+      GC when GC stress is on.
+    - ETW events and profiler heap walks. The library reports neither.
+    - Collectible types. The library does not promote the LoaderAllocator of
+      a collectible type's objects.
+    - The DAC and SOS, which read the built-in GC's globals.
+    - String configs, e.g. GCLogFile or GCHeapSnapshotFile. Only DWORD configs
+      are passed through GetConfigDWORD.
+
+--*/
+
+#ifndef __GCINTERFACE_H__
+#define __GCINTERFACE_H__
+
+#define GC_INTERFACE_MAJOR_VERSION 1
+#define GC_INTERFACE_MINOR_VERSION 0
+
+// Names of the functions a standalone GC exports.
+#define GC_VERSION_INFO_FUNCTION_NAME "GC_VersionInfo"
+#define GC_INITIALIZE_FUNCTION_NAME "GC_Initialize"
+
+struct VersionInfo
+{
+    uint32_t MajorVersion;
+    uint32_t MinorVersion;
+    uint32_t BuildVersion;
+    const char* Name;
+};
+
+// The write barrier operations a GC asks the runtime to perform.
+enum WriteBarrierOp
+{
+    // The heap range or the card table changed.
+    WriteBarrierOp_StompResize,
+    // The ephemeral range changed.
+    WriteBarrierOp_StompEphemeral,
+    // Start or stop updating the software write watch table.
+    WriteBarrierOp_SwitchToWriteWatch,
+    WriteBarrierOp_SwitchToNonWriteWatch
+};
+
+// The runtime has its own copy of the globals the write barrier reads; these
+// are the GC's current values, which the runtime copies before updating the
+// barrier.
+struct WriteBarrierParameters
+{
+    WriteBarrierOp operation;
+
+    // For WriteBarrierOp_StompResize, whether the barrier must check the upper
+    // bound of the heap.
+    bool requires_upper_bounds_check;
+
+    // For the write watch switches, whether the runtime is already suspended.
+    bool is_runtime_suspended;
+
+    uint32_t* card_table;
+    uint32_t* card_bundle_table;
+    uint8_t* lowest_address;
+    uint8_t* highest_address;
+    uint8_t* ephemeral_low;
+    uint8_t* ephemeral_high;
+    uint8_t* write_watch_table;
+    bool write_watch_enabled;
+};
+
+// The EEConfig settings a GC reads.
+enum GCConfigValue
+{
+    GCConfig_HeapVerifyLevel,
+    GCConfig_BreakOnOOM,
+    GCConfig_Gen0Size,
+    GCConfig_SegmentSize,
+    GCConfig_HeapHardLimit,
+    GCConfig_Concurrent,
+    GCConfig_LatencyMode,
+    GCConfig_ForceCompact,
+    GCConfig_RetainVM,
+    GCConfig_TrimCommit,
+    GCConfig_LOHCompactionMode,
+    GCConfig_AllowVeryLargeObjects,
+    GCConfig_Conservative
+};
+
+// The runtime defines GCMemoryStatus as MEMORYSTATUSEX, so the memory status is
+// passed with the fields of the GC environment's GCMemoryStatus.
+struct GCInterfaceMemoryStatus
+{
+    uint32_t dwMemoryLoad;
+    uint64_t ullTotalPhys;
+    uint64_t ullAvailPhys;
+    uint64_t ullTotalPageFile;
+    uint64_t ullAvailPageFile;
+    uint64_t ullTotalVirtual;
+    uint64_t ullAvailVirtual;
+};
+
+typedef uint32_t (__stdcall *GCBackgroundThreadFunction)(void* param);
+
+//
+// Execution engine services a standalone GC gets from the runtime: the
+// GCToEEInterface callbacks, plus the parts of the environment that are
+// runtime state (threads, finalizer, write barrier, handle table and config).
+//
+class IGCToCLR
+{
+public:
+    //
+    // GCToEEInterface
+    //
+    virtual void SuspendEE(GCToEEInterface::SUSPEND_REASON reason) = 0;
+    virtual void RestartEE(bool bFinishedGC) = 0;
+    virtual void GcScanRoots(promote_func* fn, int condemned, int max_gen, ScanContext* sc) = 0;
+    virtual void GcStartWork(int condemned, int max_gen) = 0;
+    virtual void AfterGcScanRoots(int condemned, int max_gen, ScanContext* sc) = 0;
+    virtual void GcBeforeBGCSweepWork() = 0;
+    virtual void GcDone(int condemned) = 0;
+    virtual bool RefCountedHandleCallbacks(Object * pObject) = 0;
+    virtual void SyncBlockCacheWeakPtrScan(HANDLESCANPROC scanProc, uintptr_t lp1, uintptr_t lp2) = 0;
+    virtual void SyncBlockCacheDemote(int max_gen) = 0;
+    virtual void SyncBlockCachePromotionsGranted(int max_gen) = 0;
+    virtual bool IsPreemptiveGCDisabled(Thread * pThread) = 0;
+    virtual void EnablePreemptiveGC(Thread * pThread) = 0;
+    virtual void DisablePreemptiveGC(Thread * pThread) = 0;
+    virtual void SetGCSpecial(Thread * pThread) = 0;
+    virtual alloc_context * GetAllocContext(Thread * pThread) = 0;
+    virtual bool CatchAtSafePoint(Thread * pThread) = 0;
+    virtual bool IsGCThread() = 0;
+    virtual void GcEnumAllocContexts(enum_alloc_context_func* fn, void* param) = 0;
+    virtual void AttachCurrentThread() = 0;
+
+    //
+    // Threads and finalization
+    //
+    virtual Thread * GetThread() = 0;
+    virtual bool IsGCSpecialThread() = 0;
+    // Creates a thread the runtime knows about (background GC threads must be
+    // runtime threads) and runs fn on it.
+    virtual bool CreateBackgroundThread(GCBackgroundThreadFunction fn, void* param) = 0;
+    virtual void DestroyThread(Thread * pThread) = 0;
+    virtual void EnableFinalization() = 0;
+    virtual bool HaveExtraWorkForFinalizer() = 0;
+
+    //
+    // Write barrier
+    //
+    virtual void StompWriteBarrier(WriteBarrierParameters* args) = 0;
+
+    //
+    // Handle table. The handle table belongs to the runtime, which creates
+    // handles without going through the GC, so the GC scans it through the
+    // runtime; see GCScan.
+    //
+    virtual void GcScanHandles(promote_func* fn, int condemned, int max_gen, ScanContext* sc) = 0;
+    virtual void GcScanSizedRefs(promote_func* fn, int condemned, int max_gen, ScanContext* sc) = 0;
+    virtual void GcShortWeakPtrScan(promote_func* fn, int condemned, int max_gen, ScanContext* sc) = 0;
+    virtual void GcWeakPtrScan(promote_func* fn, int condemned, int max_gen, ScanContext* sc) = 0;
+    virtual void GcWeakPtrScanBySingleThread(int condemned, int max_gen, ScanContext* sc) = 0;
+    virtual void GcScanStrongHandlesBySingleThread(promote_func* fn, int max_gen, ScanContext* sc) = 0;
+    virtual void GcDhInitialScan(promote_func* fn, int condemned, int max_gen, ScanContext* sc) = 0;
+    virtual bool GcDhUnpromotedHandlesExist(ScanContext* sc) = 0;
+    virtual bool GcDhReScan(ScanContext* sc) = 0;
+    virtual void GcPromotionsGranted(int condemned, int max_gen, ScanContext* sc) = 0;
+    virtual void GcDemote(int condemned, int max_gen, ScanContext* sc) = 0;
+    virtual void VerifyHandleTable(int condemned, int max_gen, ScanContext* sc) = 0;
+    virtual void GcRuntimeStructuresValid(BOOL bValid) = 0;
+    virtual bool GetGcRuntimeStructuresValid() = 0;
+    virtual size_t AskForMoreReservedMemory(size_t old_size, size_t need_size) = 0;
+
+    //
+    // Configuration
+    //
+    virtual size_t GetGCConfigValue(GCConfigValue value) = 0;
+    // Reads a DWORD CLRConfig value by its name, e.g. "GCgen0MaxBudget". There
+    // is no way to read string configs, so the library treats them as not set.
+    virtual uint32_t GetConfigDWORD(const char* name, uint32_t defaultValue) = 0;
+};
+
+//
+// OS services a standalone GC gets from the runtime: the GCToOSInterface
+// methods, which the runtime already implements on top of its PAL, and events,
+// which have to cooperate with the runtime's thread suspension.
+//
+class IGCToOS
+{
+public:
+    virtual void GetSystemInfo(uint32_t* numberOfProcessors, uint32_t* pageSize, uint32_t* allocationGranularity) = 0;
+
+    virtual void* VirtualReserve(void *address, size_t size, size_t alignment, uint32_t flags) = 0;
+    virtual bool VirtualRelease(void *address, size_t size) = 0;
+    virtual bool VirtualCommit(void *address, size_t size) = 0;
+    virtual bool VirtualDecommit(void *address, size_t size) = 0;
+    virtual bool VirtualReset(void *address, size_t size, bool unlock) = 0;
+    virtual size_t GetLargePageSize() = 0;
+    virtual bool SupportsWriteWatch() = 0;
+    virtual void ResetWriteWatch(void *address, size_t size) = 0;
+    virtual bool GetWriteWatch(bool resetState, void* address, size_t size, void** pageAddresses, uintptr_t* pageAddressesCount) = 0;
+    virtual bool CreateThread(GCThreadFunction function, void* param, GCThreadAffinity* affinity) = 0;
+    virtual void Sleep(uint32_t sleepMSec) = 0;
+    virtual void YieldThread(uint32_t switchCount) = 0;
+    virtual uint32_t GetCurrentProcessorNumber() = 0;
+    virtual bool CanGetCurrentProcessorNumber() = 0;
+    virtual bool SetCurrentThreadIdealAffinity(GCThreadAffinity* affinity) = 0;
+    virtual uint32_t GetCurrentThreadIdForLogging() = 0;
+    virtual uint32_t GetCurrentProcessId() = 0;
+    virtual uint32_t GetLogicalCpuCount() = 0;
+    virtual size_t GetLargestOnDieCacheSize(bool trueSize) = 0;
+    virtual uint32_t GetCurrentProcessCpuCount() = 0;
+    virtual bool GetCurrentProcessAffinityMask(uintptr_t *processMask, uintptr_t *systemMask) = 0;
+    virtual uint64_t GetRestrictedPhysicalMemoryLimit() = 0;
+    virtual size_t GetCurrentPhysicalMemory() = 0;
+    virtual void GetMemoryStatus(GCInterfaceMemoryStatus* ms) = 0;
+    virtual void FlushProcessWriteBuffers() = 0;
+    virtual void DebugBreak() = 0;
+    virtual int64_t QueryPerformanceCounter() = 0;
+    virtual int64_t QueryPerformanceFrequency() = 0;
+    virtual uint32_t GetLowPrecisionTimeStamp() = 0;
+
+    // Events, as opaque handles to the runtime's CLREvent. WaitEvent does not
+    // change the GC mode of the current thread; the GC switches to preemptive
+    // mode before waiting when it needs to.
+    virtual void* CreateGCEvent(bool manualReset, bool initialState, bool osEvent) = 0;
+    virtual void CloseGCEvent(void* hEvent) = 0;
+    virtual bool SetGCEvent(void* hEvent) = 0;
+    virtual bool ResetGCEvent(void* hEvent) = 0;
+    virtual uint32_t WaitGCEvent(void* hEvent, uint32_t dwMilliseconds, bool bAlertable) = 0;
+};
+
+// Runtime state a standalone GC reads directly.
+struct GCRuntimeState
+{
+    MethodTable* free_object_method_table;
+    int32_t* trap_returning_threads;
+    bool* finalizer_run_on_shutdown;
+    bool server_gc;
+};
+
+// Returns the version of the interface the GC was built with. Must not depend
+// on anything being initialized.
+typedef void (*GC_VersionInfoFunction)(VersionInfo* info);
+
+// Initializes the GC and returns its heap, which the runtime then initializes
+// with GCHeap::Initialize.
+typedef HRESULT (*GC_InitializeFunction)(
+    IGCToCLR* clrToGC,
+    IGCToOS* osToGC,
+    GCRuntimeState* runtimeState,
+    GCHeap** gcHeap);
+
+#endif // __GCINTERFACE_H__
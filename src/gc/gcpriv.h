@@ -87,7 +87,9 @@ inline void FATAL_GC_ERROR()
 
 #define INTERIOR_POINTERS   //Allow interior pointers in the code manager
 
-#define CARD_BUNDLE         //enable card bundle feature.(requires WRITE_WATCH)
+#define CARD_BUNDLE         //enable card bundle feature.(requires WRITE_WATCH, or
+                            //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES where the write
+                            //barrier sets the card bundles itself)
 
 // If this is defined we use a map for segments in order to find the heap for 
 // a segment fast. But it does use more memory as we have to cover the whole
@@ -398,6 +400,7 @@ class sorted_table;
 class c_synchronize;
 class seg_free_spaces;
 class gc_heap;
+struct heap_snapshot_file;
 
 #ifdef BACKGROUND_GC
 class exclusive_sync;
@@ -662,6 +665,8 @@ typedef DPTR(class CFinalize)                  PTR_CFinalize;
 //-------------------------------------
 //generation free list. It is an array of free lists bucketed by size, starting at sizes lower than first_bucket_size 
 //and doubling each time. The last bucket (index == num_buckets) is for largest sizes with no limit
+//Each power of 2 range can optionally be split into sub_buckets equally sized buckets (used for LOH where
+//free items are large and a closer fit matters more than the cost of the extra buckets).
 
 #define MAX_BUCKET_COUNT (13)//Max number of buckets for the small generations. 
 class alloc_list 
@@ -691,20 +696,26 @@ class allocator
 {
     size_t num_buckets;
     size_t frst_bucket_size;
+    size_t sub_buckets;
     alloc_list first_bucket;
     alloc_list* buckets;
     alloc_list& alloc_list_of (unsigned int bn);
     size_t& alloc_list_damage_count_of (unsigned int bn);
 
 public:
-    allocator (unsigned int num_b, size_t fbs, alloc_list* b);
+    allocator (unsigned int num_b, size_t fbs, alloc_list* b, unsigned int sub_b = 1);
     allocator()
     {
         num_buckets = 1;
         frst_bucket_size = SIZE_T_MAX;
+        sub_buckets = 1;
     }
     unsigned int number_of_buckets() {return (unsigned int)num_buckets;}
 
+    // The bucket a free item of this size is threaded on. Allocation requests
+    // of this size should start looking at this bucket.
+    unsigned int bucket_of (size_t size);
+
     size_t first_bucket_size() {return frst_bucket_size;}
     uint8_t*& alloc_list_head_of (unsigned int bn)
     {
@@ -1237,8 +1248,10 @@ public:
     // For LOH allocations we only update the alloc_bytes_loh in allocation
     // context - we don't actually use the ptr/limit from it so I am
     // making this explicit by not passing in the alloc_context.
+    // When poh_p is TRUE the object is placed on a pinned object heap segment
+    // and will never be moved by the GC.
     PER_HEAP
-    CObjectHeader* allocate_large_object (size_t size, int64_t& alloc_bytes);
+    CObjectHeader* allocate_large_object (size_t size, int64_t& alloc_bytes, BOOL poh_p);
 
 #ifdef FEATURE_STRUCTALIGN
     PER_HEAP
@@ -1290,6 +1303,21 @@ protected:
     PER_HEAP
     void walk_heap (walk_fn fn, void* context, int gen_number, BOOL walk_large_object_heap_p);
 
+    PER_HEAP_ISOLATED
+    BOOL should_write_heap_snapshot();
+
+    PER_HEAP
+    void write_heap_snapshot();
+
+    PER_HEAP_ISOLATED
+    void add_heap_snapshot_file (heap_snapshot_file* file);
+
+    PER_HEAP_ISOLATED
+    void flush_heap_snapshot();
+
+    PER_HEAP_ISOLATED
+    void heap_snapshot_root (Object** ppObject, ScanContext* sc, uint32_t flags);
+
     struct walk_relocate_args
     {
         uint8_t* last_plug;
@@ -1416,13 +1444,13 @@ protected:
 
     PER_HEAP
     size_t limit_from_size (size_t size, size_t room, int gen_number,
-                            int align_const);
+                            alloc_context* acontext, int align_const);
     PER_HEAP
     int try_allocate_more_space (alloc_context* acontext, size_t jsize,
-                                 int alloc_generation_number);
+                                 int alloc_generation_number, BOOL poh_p);
     PER_HEAP
     BOOL allocate_more_space (alloc_context* acontext, size_t jsize,
-                              int alloc_generation_number);
+                              int alloc_generation_number, BOOL poh_p);
 
     PER_HEAP
     size_t get_full_compact_gc_count();
@@ -1459,6 +1487,9 @@ protected:
     PER_HEAP
     void wait_for_background_planning (alloc_wait_reason awr);
 
+    PER_HEAP_ISOLATED
+    BOOL bgc_loh_alloc_blocked_p();
+
     PER_HEAP
     BOOL bgc_loh_should_allocate();
 #endif //BACKGROUND_GC
@@ -1481,7 +1512,8 @@ protected:
     PER_HEAP
     BOOL a_fit_free_list_large_p (size_t size, 
                                   alloc_context* acontext,
-                                  int align_const);
+                                  int align_const,
+                                  BOOL poh_p);
 
     PER_HEAP
     BOOL a_fit_segment_end_p (int gen_number,
@@ -1495,12 +1527,14 @@ protected:
                                   size_t size, 
                                   alloc_context* acontext,
                                   int align_const,
+                                  BOOL poh_p,
                                   BOOL* commit_failed_p,
                                   oom_reason* oom_r);
     PER_HEAP
     BOOL loh_get_new_seg (generation* gen,
                           size_t size,
                           int align_const,
+                          BOOL poh_p,
                           BOOL* commit_failed_p,
                           oom_reason* oom_r);
 
@@ -1533,6 +1567,7 @@ protected:
                       size_t size, 
                       alloc_context* acontext,
                       int align_const,
+                      BOOL poh_p,
                       BOOL* commit_failed_p,
                       oom_reason* oom_r);
 
@@ -1569,7 +1604,8 @@ protected:
     BOOL allocate_large (int gen_number,
                          size_t size, 
                          alloc_context* acontext,
-                         int align_const);
+                         int align_const,
+                         BOOL poh_p);
 
     PER_HEAP_ISOLATED
     int init_semi_shared();
@@ -1589,6 +1625,8 @@ protected:
     void fix_allocation_context (alloc_context* acontext, BOOL for_gc_p,
                                  int align_const);
     PER_HEAP
+    void adapt_alloc_quantum (alloc_context* acontext, size_t unused_size);
+    PER_HEAP
     void fix_large_allocation_area (BOOL for_gc_p);
     PER_HEAP
     void fix_older_allocation_area (generation* older_gen);
@@ -1623,7 +1661,7 @@ protected:
     PER_HEAP_ISOLATED
     void seg_mapping_table_remove_segment (heap_segment* seg);
     PER_HEAP
-    heap_segment* get_large_segment (size_t size, BOOL* did_full_compact_gc);
+    heap_segment* get_large_segment (size_t size, BOOL poh_p, BOOL* did_full_compact_gc);
     PER_HEAP
     void thread_loh_segment (heap_segment* new_seg);
     PER_HEAP_ISOLATED
@@ -1637,6 +1675,10 @@ protected:
     PER_HEAP
     void decommit_heap_segment_pages (heap_segment* seg, size_t extra_space);
     PER_HEAP
+    size_t gradual_decommit_slack (size_t target_slack);
+    PER_HEAP_ISOLATED
+    void decommit_standby_segments();
+    PER_HEAP
     void decommit_heap_segment (heap_segment* seg);
     PER_HEAP
     void clear_gen0_bricks();
@@ -1648,6 +1690,10 @@ protected:
     void rearrange_large_heap_segments();
     PER_HEAP
     void rearrange_heap_segments(BOOL compacting);
+    PER_HEAP_ISOLATED
+    void reset_write_watch_for_gc_heap (void* base_address, size_t region_size);
+    PER_HEAP_ISOLATED
+    void get_write_watch_for_gc_heap (bool reset, void* base_address, size_t region_size, void** dirty_pages, uintptr_t* dirty_page_count_ref, bool is_runtime_suspended);
     PER_HEAP
     void switch_one_quantum();
     PER_HEAP
@@ -1704,6 +1750,8 @@ protected:
     PER_HEAP
     void card_bundle_clear(size_t cardb);
     PER_HEAP
+    void card_bundle_set (size_t cardb);
+    PER_HEAP
     void card_bundles_set (size_t start_cardb, size_t end_cardb);
     PER_HEAP
     BOOL card_bundle_set_p (size_t cardb);
@@ -2175,6 +2223,9 @@ protected:
     PER_HEAP_ISOLATED
     BOOL should_compact_loh();
 
+    PER_HEAP
+    BOOL loh_incremental_compact_p();
+
     // If the LOH compaction mode is just to compact once,
     // we need to see if we should reset it back to not compact.
     // We would only reset if every heap's LOH was compacted.
@@ -2475,6 +2526,22 @@ protected:
     PER_HEAP_ISOLATED
     size_t joined_youngest_desired (size_t new_allocation);
 #endif // BIT64
+    PER_HEAP_ISOLATED
+    void record_gen0_tuning_start();
+    PER_HEAP_ISOLATED
+    size_t adapt_gen0_budget (size_t desired_per_heap);
+    PER_HEAP_ISOLATED
+    void record_pause_for_target();
+    PER_HEAP
+    void record_phase_time (gc_phase phase, int64_t start_ts);
+    PER_HEAP_ISOLATED
+    void record_gc_info();
+    PER_HEAP_ISOLATED
+    int get_gc_info_records (gc_info_record* records, gc_info_heap_record* heap_records, int max_records);
+    PER_HEAP_ISOLATED
+    uint64_t estimate_pause_us (int gen_number, BOOL compact_p, size_t condemned_size);
+    PER_HEAP_ISOLATED
+    BOOL pause_target_defers_gen2_p (BOOL blocking_p);
     PER_HEAP_ISOLATED
     size_t get_total_heap_size ();
     PER_HEAP_ISOLATED
@@ -2503,6 +2570,8 @@ protected:
     PER_HEAP
     void compute_new_dynamic_data (int gen_number);
     PER_HEAP
+    void compute_new_loh_dynamic_data();
+    PER_HEAP
     gc_history_per_heap* get_gc_data_per_heap();
     PER_HEAP
     size_t new_allocation_limit (size_t size, size_t free_size, int gen_number);
@@ -2529,6 +2598,8 @@ protected:
     PER_HEAP
     void sweep_large_objects ();
     PER_HEAP
+    void fire_loh_free_list_event ();
+    PER_HEAP
     void relocate_in_large_objects ();
     PER_HEAP
     void mark_through_cards_for_large_objects (card_fn fn, BOOL relocating);
@@ -2613,6 +2684,9 @@ protected:
     PER_HEAP
     void background_scan_dependent_handles (ScanContext *sc);
 
+    PER_HEAP
+    BOOL fgc_pending_p();
+
     PER_HEAP
     void allow_fgc();
 
@@ -2926,6 +3000,37 @@ public:
     PER_HEAP_ISOLATED
     size_t gc_gen0_desired_high;
 
+    // Time window in ms over which free memory is decommitted gradually, 
+    // 0 means it's decommitted right after each GC.
+    PER_HEAP_ISOLATED
+    size_t decommit_time_window;
+
+    // The highest ephemeral slack we wanted to keep committed in the current
+    // window and when that window started.
+    PER_HEAP
+    size_t decommit_peak_slack;
+
+    PER_HEAP
+    size_t decommit_peak_time;
+
+    // When we last decommitted part of the ephemeral slack.
+    PER_HEAP
+    size_t decommit_last_step_time;
+
+    // Set at the end of a GC if the ephemeral segment still has a lot more
+    // committed than the GC wanted, so an idle GC can give it back.
+    PER_HEAP
+    BOOL decommit_pending_p;
+
+    // When we last hoarded a segment on, or decommitted one from, the 
+    // standby list.
+    PER_HEAP_ISOLATED
+    size_t standby_decommit_time;
+
+    // Set if a segment on the standby list is still committed.
+    PER_HEAP_ISOLATED
+    BOOL standby_decommit_pending_p;
+
     PER_HEAP
     size_t gen0_big_free_spaces;
 
@@ -2954,12 +3059,168 @@ public:
     PER_HEAP_ISOLATED
     bool restricted_physical_memory_p;
 
+    // If this is non zero, it's the most the GC heap is allowed to commit. A commit that would
+    // go over it fails the same way an OS commit failure does, which gets us to do full
+    // compacting GCs before we throw OOM.
+    PER_HEAP_ISOLATED
+    size_t heap_hard_limit;
+
+    // What's committed for heap segments; only tracked when heap_hard_limit is set. Bookkeeping
+    // data structures (card table, brick table, mark array) are not included.
+    PER_HEAP_ISOLATED
+    size_t current_total_committed;
+
+    PER_HEAP_ISOLATED
+    CLRCriticalSection check_commit_cs;
+
+    // The size of the large pages we back the heap and its bookkeeping data structures with,
+    // or 0 if we are not using large pages (see GCLargePages). When we are, segments are
+    // large page aligned and we commit/decommit them in whole large pages.
+    PER_HEAP_ISOLATED
+    size_t large_page_size;
+
+    // When this is TRUE (see GCSegmentPromotion) SOH segments are promoted and released
+    // whole: when the ephemeral segment runs out of space we always start a new one and,
+    // if there's a lot on it, promote what's on the old one to gen2 in place instead of 
+    // copying survivors, and segments that become empty are decommitted and kept for reuse.
+    PER_HEAP_ISOLATED
+    BOOL segment_promotion_p;
+
+    // When this is TRUE (see GCGen0Adaptive and GCTargetPauseMs) the gen0 budget is tuned
+    // at the end of each blocking GC from the pause time and survival rate we measure,
+    // instead of staying anchored to the on die cache size.
+    PER_HEAP_ISOLATED
+    BOOL gen0_tuning_p;
+
+    // When this is TRUE (see GCAdaptiveAllocQuantum) each alloc context gets its own 
+    // quantum, sized from what it allocated since the previous GC.
+    PER_HEAP_ISOLATED
+    BOOL adaptive_alloc_quantum_p;
+
+    // The pause time (in us) we try to keep ephemeral GCs under, or 0 if there isn't one.
+    PER_HEAP_ISOLATED
+    uint64_t target_pause_us;
+
+    struct gen0_tuning_data_t
+    {
+        // QPC timestamp of when the current GC started.
+        uint64_t gc_start_ts;
+        // gen0 bytes allocated on all heaps since the previous GC.
+        size_t allocated;
+        // Smoothed pause (us), pause per MB of gen0 allocated (us) and gen0 survival rate (%).
+        uint64_t pause_us;
+        uint64_t cost_per_mb;
+        int surv_pct;
+        // cost_per_mb when we last moved the budget, and which way we moved it.
+        uint64_t prev_cost_per_mb;
+        int direction;
+        // Number of ephemeral GCs we've measured in total and since we last moved the budget.
+        size_t measured_gc_count;
+        int sample_count;
+        // The per heap gen0 budget floor we are steering, and the one we started with.
+        size_t min_budget;
+        size_t initial_min_budget;
+        // The largest per heap gen0 budget that keeps us within target_pause_us, or 0.
+        size_t target_budget;
+    };
+
+    PER_HEAP_ISOLATED
+    gen0_tuning_data_t gen0_tuning_data;
+
+    // With a pause target, the smoothed pause (us) of blocking GCs for each MB condemned on
+    // an average heap, for each condemned generation and for sweeping/compacting. 0 means 
+    // we haven't done that kind of GC yet.
+    PER_HEAP_ISOLATED
+    uint64_t pause_cost_per_mb[max_generation + 1][2];
+
+    // How many full blocking GCs in a row we've done as gen1 GCs to stay within the pause target.
+    PER_HEAP_ISOLATED
+    int gen2_deferred_count;
+
+    // When there's a hard limit, the largest the default segment size can be so each heap's
+    // segments fit in its share of the limit.
+    PER_HEAP_ISOLATED
+    size_t hard_limit_max_seg_size;
+
+    PER_HEAP_ISOLATED
+    bool virtual_commit (void* address, size_t size, int h_number);
+
+    PER_HEAP_ISOLATED
+    void virtual_decommit (void* address, size_t size);
+
+    PER_HEAP_ISOLATED
+    void release_committed_bytes (size_t size);
+
     PER_HEAP_ISOLATED
     size_t last_gc_index;
 
     PER_HEAP_ISOLATED
     size_t min_segment_size;
 
+    // Name prefix of heap snapshot files (GCHeapSnapshotFile), NULL if 
+    // heap snapshots are disabled.
+    PER_HEAP_ISOLATED
+    TCHAR* heap_snapshot_file_name;
+
+    // Write a heap snapshot every this many blocking gen2 GCs, 0 means
+    // only when one is requested.
+    PER_HEAP_ISOLATED
+    uint32_t heap_snapshot_interval;
+
+    PER_HEAP_ISOLATED
+    VOLATILE(BOOL) heap_snapshot_requested_p;
+
+    PER_HEAP_ISOLATED
+    size_t heap_snapshot_gen2_count;
+
+    // How many heap snapshots we've written, the current one included.
+    PER_HEAP_ISOLATED
+    size_t heap_snapshot_count;
+
+    // TRUE if this GC writes a heap snapshot.
+    PER_HEAP_ISOLATED
+    BOOL heap_snapshot_p;
+
+    // Snapshot files built in memory by the last GC, waiting to be written
+    // out once the EE is restarted.
+    PER_HEAP_ISOLATED
+    VOLATILE(heap_snapshot_file*) heap_snapshot_pending;
+
+#define max_gc_info_records 64
+
+    // The most recent GCs, returned by GCHeap::GetGCInfoRecords. Record r lives
+    // in slot r % max_gc_info_records.
+    PER_HEAP_ISOLATED
+    gc_info_record gc_info_records[max_gc_info_records];
+
+    // r + 1 once record r is complete, 0 while it's being written, so readers 
+    // outside of the GC can tell if they copied a torn record.
+    PER_HEAP_ISOLATED
+    int32_t gc_info_record_seq[max_gc_info_records];
+
+    // How many records were ever started.
+    PER_HEAP_ISOLATED
+    int32_t gc_info_record_count;
+
+    PER_HEAP
+    gc_info_heap_record gc_info_heap_records[max_gc_info_records];
+
+    PER_HEAP_ISOLATED
+    int64_t gc_info_start_ts;
+
+#ifdef BACKGROUND_GC
+    PER_HEAP_ISOLATED
+    int64_t bgc_info_start_ts;
+
+    // When the current BGC started blocking LOH allocations for its sweep and how 
+    // long (us) it blocked them.
+    PER_HEAP_ISOLATED
+    int64_t bgc_loh_alloc_blocked_start_ts;
+
+    PER_HEAP_ISOLATED
+    uint64_t bgc_loh_alloc_blocked_time;
+#endif //BACKGROUND_GC
+
     PER_HEAP
     uint8_t* lowest_address;
 
@@ -3014,6 +3275,11 @@ protected:
     PER_HEAP
     mark*       mark_stack_array;
 
+    // How many objects popped off the mark stack we queue up and prefetch
+    // before scanning them (see GCMarkPrefetchDepth), 0 means we don't.
+    PER_HEAP_ISOLATED
+    int         mark_prefetch_depth;
+
     PER_HEAP
     BOOL       verify_pinned_queue_p;
 
@@ -3044,6 +3310,17 @@ protected:
     PER_HEAP_ISOLATED
     gc_loh_compaction_mode loh_compaction_mode;
 
+    // Max bytes of large objects incremental LOH compaction moves on each heap
+    // in one full blocking GC (see GCLOHCompactBudget), 0 means it's disabled.
+    PER_HEAP_ISOLATED
+    size_t      loh_compaction_budget;
+
+    // TRUE when this GC's LOH compaction is the incremental kind, ie, only
+    // fragmented heaps compact and each one stops moving objects once it's
+    // used up loh_compaction_budget.
+    PER_HEAP_ISOLATED
+    BOOL        loh_compaction_incremental_p;
+
     // We may not compact LOH on every heap if we can't
     // grow the pinned queue. This is to indicate whether
     // this heap's LOH is compacted or not. So even if
@@ -3071,6 +3348,11 @@ protected:
     //mark the object as new since the start of gc.
 #endif //DACCESS_COMPILE && !MULTIPLE_HEAPS
 
+    // BGC sweeps LOH before SOH; once all heaps are done with LOH this is set
+    // so LOH allocations can proceed while SOH is still being swept.
+    PER_HEAP_ISOLATED
+    VOLATILE(BOOL) bgc_loh_swept_p;
+
     PER_HEAP_ISOLATED
     gc_mechanisms saved_bgc_settings;
 
@@ -3313,6 +3595,11 @@ protected:
     PER_HEAP
     size_t allocation_quantum;
 
+    // Upper bound on an alloc context's own quantum (see adapt_alloc_quantum) so the 
+    // contexts can't take more than their share of the gen0 budget between them.
+    PER_HEAP
+    size_t alloc_quantum_limit;
+
     PER_HEAP
     size_t alloc_contexts_used;
 
@@ -3419,8 +3706,12 @@ protected:
 
 #define NUM_LOH_ALIST (7)
 #define BASE_LOH_ALIST (64*1024)
+// Each power of 2 LOH bucket between BASE_LOH_ALIST and the last one is split 
+// this many ways so allocation can find a close fit.
+#define LOH_ALIST_SUB_BUCKETS (16)
+#define NUM_LOH_ALIST_BUCKETS ((NUM_LOH_ALIST - 2) * LOH_ALIST_SUB_BUCKETS + 2)
     PER_HEAP 
-    alloc_list loh_alloc_list[NUM_LOH_ALIST-1];
+    alloc_list loh_alloc_list[NUM_LOH_ALIST_BUCKETS-1];
 
 #define NUM_GEN2_ALIST (12)
 #ifdef BIT64
@@ -3521,6 +3812,13 @@ protected:
 #endif //FEATURE_PREMORTEM_FINALIZATION
 #endif // !MULTIPLE_HEAPS
 
+#ifdef FEATURE_PREMORTEM_FINALIZATION
+    // Set when memory load is high and the finalizer hasn't drained what earlier
+    // GCs queued. The finalizer uses this to put all its threads to work.
+    PER_HEAP_ISOLATED
+    BOOL finalization_backed_up_p;
+#endif //FEATURE_PREMORTEM_FINALIZATION
+
     PER_HEAP
     fgm_history fgm_result;
 
@@ -3669,10 +3967,55 @@ public:
     PER_HEAP
     BOOL        blocking_collection;
 
+    // How long (ms) no GC needs to happen before GCHeap::PerformIdleWork does one,
+    // 0 if it never does.
+    PER_HEAP_ISOLATED
+    size_t idle_gc_interval;
+
+    PER_HEAP_ISOLATED
+    BOOL idle_gc_needed_p();
+
 #ifdef MULTIPLE_HEAPS
     SVAL_DECL(int, n_heaps);
     SPTR_DECL(PTR_gc_heap, g_heaps);
 
+    // Allocations are balanced across heaps [0, n_active_heaps). This is n_heaps unless
+    // GCDynamicHeapCount is on, in which case it's adjusted at the end of blocking GCs.
+    // All n_heaps heaps still take part in every GC.
+    PER_HEAP_ISOLATED
+    int n_active_heaps;
+
+    PER_HEAP_ISOLATED
+    bool dynamic_heap_count_p;
+
+    struct dynamic_heap_count_data_t
+    {
+        // QPC timestamp of when the current GC started.
+        uint64_t gc_start_ts;
+        // QPC timestamp of when the current sample started.
+        uint64_t sample_start_ts;
+        // Time spent in GCs (QPC ticks) and number of GCs since the sample started.
+        uint64_t sample_gc_pause;
+        int sample_gc_count;
+        // Number of consecutive samples where we spent little enough time in GC to shrink.
+        int low_cost_samples;
+        // gen0 bytes allocated on all heaps between the GCs of the sample.
+        uint64_t sample_alloc_bytes;
+        // Allocation rate (bytes per ms), % of time in GC and active heaps of the sample 
+        // before we last shrank; 0 rate if we aren't checking the last shrink.
+        uint64_t alloc_rate_before_shrink;
+        int gc_pct_before_shrink;
+        int n_active_heaps_before_shrink;
+        // Number of samples left where we don't shrink because the last shrink cost throughput.
+        int shrink_backoff_samples;
+    };
+
+    PER_HEAP_ISOLATED
+    dynamic_heap_count_data_t dynamic_heap_count_data;
+
+    PER_HEAP_ISOLATED
+    void update_active_heap_count();
+
     static
     size_t*   g_promoted;
 #ifdef BACKGROUND_GC
@@ -4161,6 +4504,9 @@ struct loh_padding_obj
 // for segments whose mark array is only partially committed.
 #define heap_segment_flags_ma_pcommitted 128
 #endif //BACKGROUND_GC
+// a LOH segment that only services pinned object heap allocations; nothing
+// on it is ever moved.
+#define heap_segment_flags_poh          256
 
 //need to be careful to keep enough pad items to fit a relocation node
 //padded to QuadWord before the plug_skew
@@ -4242,6 +4588,12 @@ BOOL heap_segment_loh_p (heap_segment * inst)
     return !!(inst->flags & heap_segment_flags_loh);
 }
 
+inline
+BOOL heap_segment_poh_p (heap_segment * inst)
+{
+    return !!(inst->flags & heap_segment_flags_poh);
+}
+
 #ifdef BACKGROUND_GC
 inline
 BOOL heap_segment_decommitted_p (heap_segment * inst)
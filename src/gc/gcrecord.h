@@ -61,12 +61,13 @@ enum gc_condemn_reason_condition
     gen_induced_noforce_p = 14,
     gen_before_bgc = 15,
     gen_almost_max_alloc = 16,
-    gcrc_max = 17
+    gen_finalization_drained_p = 17,
+    gcrc_max = 18
 };
 
 #ifdef DT_LOG
 static char* record_condemn_reasons_gen_header = "[cg]i|f|a|t|";
-static char* record_condemn_reasons_condition_header = "[cc]i|e|h|v|l|l|e|m|m|m|m|g|o|s|n|b|a|";
+static char* record_condemn_reasons_condition_header = "[cc]i|e|h|v|l|l|e|m|m|m|m|g|o|s|n|b|a|d|";
 static char char_gen_number[4] = {'0', '1', '2', '3'};
 #endif //DT_LOG
 
@@ -223,6 +224,9 @@ static char* str_heap_expand_mechanisms[] =
 };
 #endif //DT_LOG
 
+// !!!!!!!!!!!!!!!!!!!!!!!
+// make sure you change GCCompactionReason in bcl\system\gc.cs 
+// if you change this!
 enum gc_heap_compact_reason
 {
     compact_low_ephemeral = 0,
@@ -314,6 +318,18 @@ static gc_mechanism_descr gc_mechanisms_descr[max_mechanism_per_heap] =
 int index_of_set_bit (size_t power2);
 
 #define mechanism_mask (1 << (sizeof (uint32_t) * 8 - 1))
+
+// The phases we record the time of for each GC. A BGC only has mark and sweep.
+enum gc_phase
+{
+    gc_phase_mark = 0,
+    gc_phase_plan = 1,
+    gc_phase_relocate = 2,
+    gc_phase_compact = 3,
+    gc_phase_sweep = 4,
+    max_gc_phase = 5
+};
+
 // interesting per heap data we want to record for each GC.
 class gc_history_per_heap
 {
@@ -343,6 +359,12 @@ public:
 
     size_t extra_gen0_committed;
 
+    // time spent in each phase on this heap, in microseconds.
+    uint64_t phase_time[max_gc_phase];
+
+    // number of pinned plugs the plan phase found.
+    size_t pinned_plug_count;
+
     void set_mechanism (gc_mechanism_per_heap mechanism_per_heap, uint32_t value);
 
     void set_mechanism_bit (gc_mechanism_bit_per_heap mech_bit)
@@ -75,6 +75,12 @@ void GCScan::GcDhInitialScan(promote_func* fn, int condemned, int max_gen, ScanC
     pDhContext->m_iMaxGen = max_gen;
     pDhContext->m_pScanContext = sc;
 
+    // Handles can only be remembered across scans while nothing else can free them, so concurrent scans
+    // always walk the whole table.
+    pDhContext->m_fCollectingPending = !sc->concurrent;
+    pDhContext->m_fPendingValid = false;
+    pDhContext->m_cPending = 0;
+
     // Look for dependent handle whose primary has been promoted but whose secondary has not. Promote the
     // secondary in those cases. Additionally this scan sets the m_fUnpromotedPrimaries and m_fPromoted state
     // flags in the DH context. The m_fUnpromotedPrimaries flag is the most interesting here: if this flag is
@@ -149,6 +155,11 @@ void GCScan::GcWeakPtrScanBySingleThread( int condemned, int max_gen, ScanContex
     GCToEEInterface::SyncBlockCacheWeakPtrScan(&CheckPromoted, (uintptr_t)sc, 0);
 }
 
+void GCScan::GcScanStrongHandlesBySingleThread(promote_func* fn, int max_gen, ScanContext* sc)
+{
+    Ref_ScanStrongPointers(max_gen, sc, fn);
+}
+
 void GCScan::GcScanSizedRefs(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
 {
     Ref_ScanSizedRefHandles(condemned, max_gen, sc, fn);
@@ -21,6 +21,12 @@
 // result we need to maintain a context between all the DH scanning methods called during a single mark phase.
 // The structure below describes this context. We allocate one of these per GC heap at Ref_Initialize time and
 // select between them based on the ScanContext passed to us by the GC during the mark phase.
+struct DhPendingHandle
+{
+    Object        **m_pPrimaryRef;              // Handle slot holding the primary
+    Object        **m_pSecondaryRef;            // Extra info slot holding the secondary (NULL once we're done with it)
+};
+
 struct DhContext
 {
     bool            m_fUnpromotedPrimaries;     // Did last scan find at least one non-null unpromoted primary?
@@ -29,6 +35,11 @@ struct DhContext
     int             m_iCondemned;               // The condemned generation
     int             m_iMaxGen;                  // The maximum generation
     ScanContext    *m_pScanContext;             // The GC's scan context for this phase
+    bool            m_fCollectingPending;       // Should the table scan record handles with unpromoted primaries?
+    bool            m_fPendingValid;            // Does m_pPending hold all handles that can still be promoted?
+    DhPendingHandle *m_pPending;                // Handles with unpromoted primaries, sorted by primary
+    size_t          m_cPending;                 // Number of entries in m_pPending
+    size_t          m_cPendingMax;              // Capacity of m_pPending (kept from one GC to the next)
 };
 
 class GCScan
@@ -61,6 +72,9 @@ class GCScan
     static void GcWeakPtrScan (promote_func* fn, int condemned, int max_gen, ScanContext*sc );
     static void GcWeakPtrScanBySingleThread (int condemned, int max_gen, ScanContext*sc );
 
+    // Report the referents of the handles that keep them alive, in all handle tables.
+    static void GcScanStrongHandlesBySingleThread (promote_func* fn, int max_gen, ScanContext* sc);
+
     // scan for dead weak pointers
     static void GcShortWeakPtrScan (promote_func* fn, int condemned, int max_gen, 
                                     ScanContext* sc);
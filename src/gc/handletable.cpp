@@ -208,6 +208,10 @@ void HndDestroyHandleTable(HHANDLETABLE hTable)
         pSegment = pNextSegment;
     }
 
+    // free the shared scan segment list
+    if (pTable->rgScanSegments)
+        delete [] pTable->rgScanSegments;
+
     // free the table's memory
     delete [] (uint8_t*) pTable;
 }
@@ -925,32 +929,19 @@ void HndEnumHandles(HHANDLETABLE hTable, const uint32_t *puType, uint32_t uTypeC
 }
 
 /*
- * HndScanHandlesForGC
- *
- * Multiple type scanning entrypoint for GC.
+ * GetGCScanProcs
  *
- * This entrypoint is provided for GC-time scnas of the handle table ONLY.  It
- * enables ephemeral scanning of the table, and optionally ages the write barrier
- * as it scans.
+ * Picks the segment iterator and block handler for a GC-time scan.
  *
  */
-void HndScanHandlesForGC(HHANDLETABLE hTable, HANDLESCANPROC scanProc, uintptr_t param1, uintptr_t param2,
-                         const uint32_t *types, uint32_t typeCount, uint32_t condemned, uint32_t maxgen, uint32_t flags)
+static void GetGCScanProcs(HANDLESCANPROC scanProc, BOOL enumUserData, uint32_t condemned, uint32_t maxgen, uint32_t flags,
+                           SEGMENTITERATOR *ppfnSegment, BLOCKSCANPROC *ppfnBlock)
 {
-    WRAPPER_NO_CONTRACT;
-
-    // fetch the table pointer
-    PTR_HandleTable pTable = Table(hTable);
+    LIMITED_METHOD_CONTRACT;
 
-    // per-segment and per-block callbacks
     SEGMENTITERATOR pfnSegment;
     BLOCKSCANPROC pfnBlock = NULL;
 
-    // do we need to support user data?
-    BOOL enumUserData =
-        ((flags & HNDGCF_EXTRAINFO) &&
-        TypesRequireUserDataScanning(pTable, types, typeCount));
-
     // what type of GC are we performing?
     if (condemned >= maxgen)
     {
@@ -1007,6 +998,39 @@ void HndScanHandlesForGC(HHANDLETABLE hTable, HANDLESCANPROC scanProc, uintptr_t
 #endif
     }
 
+    *ppfnSegment = pfnSegment;
+    *ppfnBlock = pfnBlock;
+}
+
+
+/*
+ * HndScanHandlesForGC
+ *
+ * Multiple type scanning entrypoint for GC.
+ *
+ * This entrypoint is provided for GC-time scnas of the handle table ONLY.  It
+ * enables ephemeral scanning of the table, and optionally ages the write barrier
+ * as it scans.
+ *
+ */
+void HndScanHandlesForGC(HHANDLETABLE hTable, HANDLESCANPROC scanProc, uintptr_t param1, uintptr_t param2,
+                         const uint32_t *types, uint32_t typeCount, uint32_t condemned, uint32_t maxgen, uint32_t flags)
+{
+    WRAPPER_NO_CONTRACT;
+
+    // fetch the table pointer
+    PTR_HandleTable pTable = Table(hTable);
+
+    // do we need to support user data?
+    BOOL enumUserData =
+        ((flags & HNDGCF_EXTRAINFO) &&
+        TypesRequireUserDataScanning(pTable, types, typeCount));
+
+    // per-segment and per-block callbacks
+    SEGMENTITERATOR pfnSegment;
+    BLOCKSCANPROC pfnBlock;
+    GetGCScanProcs(scanProc, enumUserData, condemned, maxgen, flags, &pfnSegment, &pfnBlock);
+
     // set up parameters for scan callbacks
     ScanCallbackInfo info;
 
@@ -1048,6 +1072,113 @@ void HndScanHandlesForGC(HHANDLETABLE hTable, HANDLESCANPROC scanProc, uintptr_t
 
 #ifndef DACCESS_COMPILE
 
+/*
+ * HndScanHandlesForGCShared
+ *
+ * Like HndScanHandlesForGC, but lets other server GC threads help with the table.
+ *
+ * The thread that owns the table (fOwner) runs the segment iterator - doing
+ * whatever maintenance it does - to collect the segments to scan, and publishes
+ * them under uScanId. Every thread scanning the table under the same uScanId,
+ * owner or not, then claims segments one at a time until there are none left.
+ * Other threads only help with a table once its owner has published it, so a
+ * table whose owner isn't taking part in the scan is left alone.
+ *
+ * All threads must be done with one shared scan before any owner starts the
+ * next one, which the joins between the GC phases doing these scans guarantee.
+ * Async scans aren't supported.
+ *
+ */
+void HndScanHandlesForGCShared(HHANDLETABLE hTable, HANDLESCANPROC scanProc, uintptr_t param1, uintptr_t param2,
+                               const uint32_t *types, uint32_t typeCount, uint32_t condemned, uint32_t maxgen, uint32_t flags,
+                               uint32_t uScanId, BOOL fOwner)
+{
+    WRAPPER_NO_CONTRACT;
+
+    _ASSERTE(!(flags & HNDGCF_ASYNC));
+    _ASSERTE(uScanId != 0);
+
+    // fetch the table pointer
+    HandleTable *pTable = Table(hTable);
+
+    // do we need to support user data?
+    BOOL enumUserData =
+        ((flags & HNDGCF_EXTRAINFO) &&
+        TypesRequireUserDataScanning(pTable, types, typeCount));
+
+    // per-segment and per-block callbacks
+    SEGMENTITERATOR pfnSegment;
+    BLOCKSCANPROC pfnBlock;
+    GetGCScanProcs(scanProc, enumUserData, condemned, maxgen, flags, &pfnSegment, &pfnBlock);
+
+    CrstHolderWithState ch(&pTable->Lock, FALSE);
+
+    if (fOwner)
+    {
+        pTable->uScanId = 0;
+
+        // collect the segments, letting the iterator do its maintenance as it goes
+        uint32_t uCount = 0;
+        PTR_TableSegment pSegment = NULL;
+        while ((pSegment = pfnSegment(pTable, pSegment, &ch)) != NULL)
+        {
+            if (uCount == pTable->uScanSegmentsMax)
+            {
+                uint32_t uNewMax = ((pTable->uScanSegmentsMax == 0) ? 16 : (pTable->uScanSegmentsMax * 2));
+                TableSegment **rgNewSegments = new (nothrow) TableSegment *[uNewMax];
+                if (rgNewSegments == NULL)
+                {
+                    // we can't share this table - scan it on our own
+                    HndScanHandlesForGC(hTable, scanProc, param1, param2, types, typeCount, condemned, maxgen, flags);
+                    return;
+                }
+
+                if (pTable->rgScanSegments)
+                {
+                    memcpy(rgNewSegments, pTable->rgScanSegments, uCount * sizeof(TableSegment *));
+                    delete [] pTable->rgScanSegments;
+                }
+
+                pTable->rgScanSegments = rgNewSegments;
+                pTable->uScanSegmentsMax = uNewMax;
+            }
+
+            pTable->rgScanSegments[uCount++] = pSegment;
+        }
+
+        // publish the segments
+        pTable->uScanSegmentCount = uCount;
+        pTable->lNextScanSegment = 0;
+        VolatileStore(&pTable->uScanId, uScanId);
+    }
+    else if (VolatileLoad(&pTable->uScanId) != uScanId)
+    {
+        // the owner hasn't published this table (yet) - it will scan it itself
+        return;
+    }
+
+    // set up parameters for scan callbacks
+    ScanCallbackInfo info;
+
+    info.uFlags          = flags;
+    info.fEnumUserData   = enumUserData;
+    info.dwAgeMask       = BuildAgeMask(condemned, maxgen);
+    info.pCurrentSegment = NULL;
+    info.pfnScan         = scanProc;
+    info.param1          = param1;
+    info.param2          = param2;
+
+#ifdef _DEBUG
+    info.DEBUG_BlocksScanned                = 0;
+    info.DEBUG_BlocksScannedNonTrivially    = 0;
+    info.DEBUG_HandleSlotsScanned           = 0;
+    info.DEBUG_HandlesActuallyScanned       = 0;
+#endif
+
+    // claim and scan segments until they've all been taken
+    TableScanHandles(pTable, types, typeCount, SharedSegmentIterator, pfnBlock, &info, &ch);
+}
+
 
 /*
  * HndResetAgeMap
@@ -133,6 +133,18 @@ void            HndScanHandlesForGC(HHANDLETABLE hTable,
                                     uint32_t maxgen,
                                     uint32_t flags);
 
+void            HndScanHandlesForGCShared(HHANDLETABLE hTable,
+                                          HANDLESCANPROC scanProc,
+                                          uintptr_t param1,
+                                          uintptr_t param2,
+                                          const uint32_t *types,
+                                          uint32_t typeCount,
+                                          uint32_t condemned,
+                                          uint32_t maxgen,
+                                          uint32_t flags,
+                                          uint32_t uScanId,
+                                          BOOL fOwner);
+
 void            HndResetAgeMap(HHANDLETABLE hTable, const uint32_t *types, uint32_t typeCount, uint32_t condemned, uint32_t maxgen, uint32_t flags);
 void            HndVerifyTable(HHANDLETABLE hTable, const uint32_t *types, uint32_t typeCount, uint32_t condemned, uint32_t maxgen, uint32_t flags);
 
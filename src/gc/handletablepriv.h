@@ -533,6 +533,15 @@ struct HandleTable
     int64_t _DEBUG_TotalHandlesActuallyScanned   [MAXSTATGEN];
 #endif
 
+    /*
+     * segments published for the current shared GC scan (see HndScanHandlesForGCShared)
+     */
+    TableSegment **rgScanSegments;
+    uint32_t uScanSegmentsMax;
+    uint32_t uScanSegmentCount;
+    int32_t lNextScanSegment;                               // interlocked ops used here
+    uint32_t uScanId;                                       // scan rgScanSegments is for, 0 if none
+
     /*
      * primary per-type handle cache
      */
@@ -992,6 +1001,16 @@ PTR_TableSegment CALLBACK StandardSegmentIterator(PTR_HandleTable pTable, PTR_Ta
 PTR_TableSegment CALLBACK FullSegmentIterator(PTR_HandleTable pTable, PTR_TableSegment pPrevSegment, CrstHolderWithState *pCrstHolder = 0);
 
 
+/*
+ * SharedSegmentIterator
+ *
+ * Returns the next segment to be scanned in a shared scanning loop,
+ * claiming it from the segments the table's owner published.
+ *
+ */
+PTR_TableSegment CALLBACK SharedSegmentIterator(PTR_HandleTable pTable, PTR_TableSegment pPrevSegment, CrstHolderWithState *pCrstHolder = 0);
+
+
 /*
  * BlockScanBlocksWithoutUserData
  *
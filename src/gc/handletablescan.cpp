@@ -1444,6 +1444,29 @@ PTR_TableSegment CALLBACK StandardSegmentIterator(PTR_HandleTable pTable, PTR_Ta
 }
 
 
+/*
+ * SharedSegmentIterator
+ *
+ * Returns the next segment to be scanned in a shared scanning loop.
+ *
+ * The segments were collected (and maintained) by the table's owner
+ * before it published them; any number of threads can claim them.
+ *
+ */
+PTR_TableSegment CALLBACK SharedSegmentIterator(PTR_HandleTable pTable, PTR_TableSegment, CrstHolderWithState *)
+{
+    LIMITED_METHOD_CONTRACT;
+
+#ifndef DACCESS_COMPILE
+    uint32_t uIndex = (uint32_t)(Interlocked::Increment(&pTable->lNextScanSegment) - 1);
+    if (uIndex < pTable->uScanSegmentCount)
+        return pTable->rgScanSegments[uIndex];
+#endif
+
+    return NULL;
+}
+
+
 /*
  * FullSegmentIterator
  *
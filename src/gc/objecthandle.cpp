@@ -172,6 +172,35 @@ void CALLBACK UpdateDependentHandle(_UNCHECKED_OBJECTREF *pObjRef, uintptr_t *pE
 #endif
 }
 
+// Record a dependent handle whose primary isn't promoted yet so later scans in this GC only need to look at
+// it and not the whole table. Returns false if we couldn't grow the list.
+static bool AddPendingDependentHandle(DhContext *pDhContext, Object **pPrimaryRef, Object **pSecondaryRef)
+{
+    LIMITED_METHOD_CONTRACT;
+
+    if (pDhContext->m_cPending == pDhContext->m_cPendingMax)
+    {
+        size_t cNewMax = ((pDhContext->m_cPendingMax == 0) ? 256 : (pDhContext->m_cPendingMax * 2));
+        DhPendingHandle *pNewPending = new (nothrow) DhPendingHandle[cNewMax];
+        if (pNewPending == NULL)
+            return false;
+
+        if (pDhContext->m_pPending)
+        {
+            memcpy (pNewPending, pDhContext->m_pPending, pDhContext->m_cPending * sizeof (DhPendingHandle));
+            delete [] pDhContext->m_pPending;
+        }
+
+        pDhContext->m_pPending = pNewPending;
+        pDhContext->m_cPendingMax = cNewMax;
+    }
+
+    DhPendingHandle *pEntry = &pDhContext->m_pPending[pDhContext->m_cPending++];
+    pEntry->m_pPrimaryRef = pPrimaryRef;
+    pEntry->m_pSecondaryRef = pSecondaryRef;
+    return true;
+}
+
 void CALLBACK PromoteDependentHandle(_UNCHECKED_OBJECTREF *pObjRef, uintptr_t *pExtraInfo, uintptr_t lp1, uintptr_t lp2)
 {
     LIMITED_METHOD_CONTRACT;
@@ -207,6 +236,14 @@ void CALLBACK PromoteDependentHandle(_UNCHECKED_OBJECTREF *pObjRef, uintptr_t *p
         // promoted handles, so there's no chance of finding an additional handle being promoted on a
         // subsequent scan).
         pDhContext->m_fUnpromotedPrimaries = true;
+
+        // On the first scan of a GC we also remember the handle so rescans don't have to walk the whole table.
+        // If we run out of memory for the list we go back to walking the table for the rest of this GC.
+        if (pDhContext->m_fCollectingPending &&
+            !AddPendingDependentHandle(pDhContext, pPrimaryRef, pSecondaryRef))
+        {
+            pDhContext->m_fCollectingPending = false;
+        }
     }
 }
     
@@ -698,6 +735,8 @@ bool Ref_Initialize()
         if (g_pDependentHandleContexts == NULL)
             goto CleanupAndFail;
 
+        ZeroMemory(g_pDependentHandleContexts, n_slots * sizeof(DhContext));
+
         return true;
     }
 
@@ -713,6 +752,13 @@ void Ref_Shutdown()
 
     if (g_pDependentHandleContexts)
     {
+        int n_slots = getNumberOfSlots();
+        for (int i = 0; i < n_slots; i++)
+        {
+            if (g_pDependentHandleContexts[i].m_pPending)
+                delete [] g_pDependentHandleContexts[i].m_pPending;
+        }
+
         delete [] g_pDependentHandleContexts;
         g_pDependentHandleContexts = NULL;
     }
@@ -1143,6 +1189,62 @@ void Ref_TracePinningRoots(uint32_t condemned, uint32_t maxgen, ScanContext* sc,
 }
 
 
+// Ids for the handle table scans server GC threads share (see ScanHandlesForGC).
+#define SHARED_SCAN_NORMAL_ROOTS    1
+#define SHARED_SCAN_UPDATE_POINTERS 2
+#define SHARED_SCAN_AGE_HANDLES     3
+
+// Scan the handle tables of this GC thread's slot. Under server GC (for non-concurrent scans) the thread then
+// goes on to help the other GC threads with the tables of their slots, so one slot with far more handles
+// than the others doesn't hold up the phase; see HndScanHandlesForGCShared.
+static void ScanHandlesForGC(ScanContext* sc, HANDLESCANPROC scanProc, uintptr_t param1, uintptr_t param2,
+                             const uint32_t *types, uint32_t typeCount, uint32_t condemned, uint32_t maxgen, uint32_t flags,
+                             uint32_t uSharedScan)
+{
+    WRAPPER_NO_CONTRACT;
+
+    int uCPUindex = getSlotNumber(sc);
+    int nSlots = 1;
+    uint32_t uScanId = 0;
+
+    if (GCHeap::IsServerHeap() && !(flags & HNDGCF_ASYNC) && !GCHeap::GetGCHeap()->IsConcurrentGCInProgress())
+    {
+        nSlots = GCHeap::GetGCHeap()->GetNumberOfHeaps();
+        uScanId = (GCHeap::GetGCHeap()->GetGcCount() << 2) | uSharedScan;
+    }
+
+    // start with our own slot
+    for (int iSlot = 0; iSlot < nSlots; iSlot++)
+    {
+        int uSlot = (uCPUindex + iSlot) % nSlots;
+
+        HandleTableMap *walk = &g_HandleTableMap;
+        while (walk) {
+            for (uint32_t i = 0; i < INITIAL_HANDLE_TABLE_ARRAY_SIZE; i ++)
+                if (walk->pBuckets[i] != NULL)
+                {
+                    HHANDLETABLE hTable = walk->pBuckets[i]->pTable[uSlot];
+                    if (hTable)
+                    {
+#ifdef FEATURE_APPDOMAIN_RESOURCE_MONITORING
+                        if (g_fEnableARM)
+                        {
+                            sc->pCurrentDomain = SystemDomain::GetAppDomainAtIndex(HndGetHandleTableADIndex(hTable));
+                        }
+#endif //FEATURE_APPDOMAIN_RESOURCE_MONITORING
+
+                        if (uScanId == 0)
+                            HndScanHandlesForGC(hTable, scanProc, param1, param2, types, typeCount, condemned, maxgen, flags);
+                        else
+                            HndScanHandlesForGCShared(hTable, scanProc, param1, param2, types, typeCount, condemned, maxgen, flags,
+                                                      uScanId, (uSlot == uCPUindex));
+                    }
+                }
+            walk = walk->pNext;
+        }
+    }
+}
+
 void Ref_TraceNormalRoots(uint32_t condemned, uint32_t maxgen, ScanContext* sc, Ref_promote_func* fn)
 {
     WRAPPER_NO_CONTRACT;
@@ -1155,26 +1257,7 @@ void Ref_TraceNormalRoots(uint32_t condemned, uint32_t maxgen, ScanContext* sc,
     uint32_t uTypeCount = (((condemned >= maxgen) && !GCHeap::GetGCHeap()->IsConcurrentGCInProgress()) ? 1 : _countof(types));
     uint32_t flags = (sc->concurrent) ? HNDGCF_ASYNC : HNDGCF_NORMAL;
 
-    HandleTableMap *walk = &g_HandleTableMap;
-    while (walk) {
-        for (uint32_t i = 0; i < INITIAL_HANDLE_TABLE_ARRAY_SIZE; i ++)
-            if (walk->pBuckets[i] != NULL)
-            {
-                HHANDLETABLE hTable = walk->pBuckets[i]->pTable[getSlotNumber(sc)];
-                if (hTable)
-                {
-#ifdef FEATURE_APPDOMAIN_RESOURCE_MONITORING
-                    if (g_fEnableARM)
-                    {
-                        sc->pCurrentDomain = SystemDomain::GetAppDomainAtIndex(HndGetHandleTableADIndex(hTable));
-                    }
-#endif //FEATURE_APPDOMAIN_RESOURCE_MONITORING
-
-                    HndScanHandlesForGC(hTable, PromoteObject, uintptr_t(sc), uintptr_t(fn), types, uTypeCount, condemned, maxgen, flags);
-                }
-            }
-        walk = walk->pNext;
-    }
+    ScanHandlesForGC(sc, PromoteObject, uintptr_t(sc), uintptr_t(fn), types, uTypeCount, condemned, maxgen, flags, SHARED_SCAN_NORMAL_ROOTS);
 
     // promote objects pointed to by variable handles whose dynamic type is VHT_STRONG
     TraceVariableHandles(PromoteObject, uintptr_t(sc), uintptr_t(fn), VHT_STRONG, condemned, maxgen, flags);
@@ -1186,7 +1269,7 @@ void Ref_TraceNormalRoots(uint32_t condemned, uint32_t maxgen, ScanContext* sc,
         // promote ref-counted handles
         uint32_t type = HNDTYPE_REFCOUNTED;
 
-        walk = &g_HandleTableMap;
+        HandleTableMap *walk = &g_HandleTableMap;
         while (walk) {
             for (uint32_t i = 0; i < INITIAL_HANDLE_TABLE_ARRAY_SIZE; i ++)
                 if (walk->pBuckets[i] != NULL)
@@ -1295,6 +1378,163 @@ DhContext *Ref_GetDependentHandleContext(ScanContext* sc)
     return &g_pDependentHandleContexts[getSlotNumber(sc)];
 }
 
+// Sort the pending handles by primary so we can find the handles for a given primary with a binary search.
+// The GC doesn't move objects while marking so the order stays valid for the rest of the mark phase.
+static void SortPendingDependentHandles(DhPendingHandle *pPending, size_t cPending)
+{
+    LIMITED_METHOD_CONTRACT;
+
+    // Heap sort: no recursion and no extra memory.
+    for (size_t iStart = cPending / 2; iStart > 0; iStart--)
+    {
+        size_t iRoot = iStart - 1;
+        while ((iRoot * 2 + 1) < cPending)
+        {
+            size_t iChild = iRoot * 2 + 1;
+            if (((iChild + 1) < cPending) && (*pPending[iChild].m_pPrimaryRef < *pPending[iChild + 1].m_pPrimaryRef))
+                iChild++;
+            if (!(*pPending[iRoot].m_pPrimaryRef < *pPending[iChild].m_pPrimaryRef))
+                break;
+            DhPendingHandle temp = pPending[iRoot];
+            pPending[iRoot] = pPending[iChild];
+            pPending[iChild] = temp;
+            iRoot = iChild;
+        }
+    }
+
+    for (size_t iEnd = cPending; iEnd > 1; iEnd--)
+    {
+        DhPendingHandle temp = pPending[0];
+        pPending[0] = pPending[iEnd - 1];
+        pPending[iEnd - 1] = temp;
+
+        size_t cHeap = iEnd - 1;
+        size_t iRoot = 0;
+        while ((iRoot * 2 + 1) < cHeap)
+        {
+            size_t iChild = iRoot * 2 + 1;
+            if (((iChild + 1) < cHeap) && (*pPending[iChild].m_pPrimaryRef < *pPending[iChild + 1].m_pPrimaryRef))
+                iChild++;
+            if (!(*pPending[iRoot].m_pPrimaryRef < *pPending[iChild].m_pPrimaryRef))
+                break;
+            temp = pPending[iRoot];
+            pPending[iRoot] = pPending[iChild];
+            pPending[iChild] = temp;
+            iRoot = iChild;
+        }
+    }
+}
+
+// Return the index of the first pending handle whose primary is pPrimary, or cPending if there isn't one.
+static size_t FindPendingDependentHandle(DhPendingHandle *pPending, size_t cPending, Object *pPrimary)
+{
+    LIMITED_METHOD_CONTRACT;
+
+    size_t iLow = 0;
+    size_t iHigh = cPending;
+    while (iLow < iHigh)
+    {
+        size_t iMid = iLow + (iHigh - iLow) / 2;
+        if (*pPending[iMid].m_pPrimaryRef < pPrimary)
+            iLow = iMid + 1;
+        else
+            iHigh = iMid;
+    }
+
+    return (((iLow < cPending) && (*pPending[iLow].m_pPrimaryRef == pPrimary)) ? iLow : cPending);
+}
+
+// The most handles we'll follow a chain of secondaries through before leaving the rest to the next pass.
+#define DH_PROMOTE_CHAIN_DEPTH 64
+
+// Promote the secondary of the pending handle at iIndex, whose primary has been promoted, and retire the
+// handle. If that secondary is itself the primary of other pending handles - which is what chained
+// ConditionalWeakTable entries look like - we promote their secondaries now rather than on another pass.
+// Returns true if we promoted anything.
+static bool PromotePendingDependentHandle(DhContext *pDhContext, size_t iIndex)
+{
+    LIMITED_METHOD_CONTRACT;
+
+    DhPendingHandle *pPending = pDhContext->m_pPending;
+    size_t cPending = pDhContext->m_cPending;
+    size_t rgStack[DH_PROMOTE_CHAIN_DEPTH];
+    int cStack = 0;
+    bool fPromoted = false;
+
+    rgStack[cStack++] = iIndex;
+    while (cStack > 0)
+    {
+        DhPendingHandle *pEntry = &pPending[rgStack[--cStack]];
+        Object **pSecondaryRef = pEntry->m_pSecondaryRef;
+        pEntry->m_pSecondaryRef = NULL;
+
+        Object *pSecondary = *pSecondaryRef;
+        if (pSecondary == NULL)
+            continue;
+
+        if (!GCHeap::GetGCHeap()->IsPromoted(pSecondary))
+        {
+            LOG((LF_GC|LF_ENC, LL_INFO10000, "\tPromoting secondary " LOG_OBJECT_CLASS(pSecondary)));
+            pDhContext->m_pfnPromoteFunction(pSecondaryRef, pDhContext->m_pScanContext, 0);
+            fPromoted = true;
+        }
+
+        for (size_t i = FindPendingDependentHandle(pPending, cPending, pSecondary);
+             (i < cPending) && (*pPending[i].m_pPrimaryRef == pSecondary) && (cStack < DH_PROMOTE_CHAIN_DEPTH);
+             i++)
+        {
+            if (pPending[i].m_pSecondaryRef != NULL)
+                rgStack[cStack++] = i;
+        }
+    }
+
+    return fPromoted;
+}
+
+// Rescan the handles the first scan of this GC found with unpromoted primaries. Each handle is retired once
+// its secondary is promoted (or its primary cleared), so every secondary is promoted once and each pass only
+// looks at the handles that are still pending.
+static bool ScanPendingDependentHandlesForPromotion(DhContext *pDhContext)
+{
+    LIMITED_METHOD_CONTRACT;
+
+    bool fAnyPromotions = false;
+    bool fPromoted;
+
+    do
+    {
+        fPromoted = false;
+
+        for (size_t i = 0; i < pDhContext->m_cPending; i++)
+        {
+            DhPendingHandle *pEntry = &pDhContext->m_pPending[i];
+            if ((pEntry->m_pSecondaryRef != NULL) && GCHeap::GetGCHeap()->IsPromoted(*pEntry->m_pPrimaryRef))
+            {
+                if (PromotePendingDependentHandle(pDhContext, i))
+                    fPromoted = true;
+            }
+        }
+
+        // Squeeze out the retired handles; this keeps the list sorted.
+        size_t cLive = 0;
+        for (size_t i = 0; i < pDhContext->m_cPending; i++)
+        {
+            if (pDhContext->m_pPending[i].m_pSecondaryRef != NULL)
+                pDhContext->m_pPending[cLive++] = pDhContext->m_pPending[i];
+        }
+        pDhContext->m_cPending = cLive;
+
+        if (fPromoted)
+            fAnyPromotions = true;
+
+    } while (fPromoted && (pDhContext->m_cPending != 0));
+
+    pDhContext->m_fUnpromotedPrimaries = (pDhContext->m_cPending != 0);
+    pDhContext->m_fPromoted = fAnyPromotions;
+
+    return fAnyPromotions;
+}
+
 // Scan the dependent handle table promoting any secondary object whose associated primary object is promoted.
 //
 // Multiple scans may be required since (a) secondary promotions made during one scan could cause the primary
@@ -1305,6 +1545,11 @@ DhContext *Ref_GetDependentHandleContext(ScanContext* sc)
 bool Ref_ScanDependentHandlesForPromotion(DhContext *pDhContext)
 {
     LOG((LF_GC, LL_INFO10000, "Checking liveness of referents of dependent handles in generation %u\n", pDhContext->m_iCondemned));
+
+    // Once the first scan has found all the handles that could still be promoted we only look at those.
+    if (pDhContext->m_fPendingValid)
+        return ScanPendingDependentHandlesForPromotion(pDhContext);
+
     uint32_t type = HNDTYPE_DEPENDENT;
     uint32_t flags = (pDhContext->m_pScanContext->concurrent) ? HNDGCF_ASYNC : HNDGCF_NORMAL;
     flags |= HNDGCF_EXTRAINFO;
@@ -1329,6 +1574,8 @@ bool Ref_ScanDependentHandlesForPromotion(DhContext *pDhContext)
         pDhContext->m_fUnpromotedPrimaries = false;
         pDhContext->m_fPromoted = false;
 
+        bool fCollectingPending = pDhContext->m_fCollectingPending;
+
         HandleTableMap *walk = &g_HandleTableMap;
         while (walk) 
         {
@@ -1356,6 +1603,29 @@ bool Ref_ScanDependentHandlesForPromotion(DhContext *pDhContext)
         if (pDhContext->m_fPromoted)
             fAnyPromotions = true;
 
+        if (fCollectingPending)
+        {
+            // If we managed to record every handle with an unpromoted primary, switch to rescanning just
+            // those. Otherwise keep walking the table.
+            if (pDhContext->m_fCollectingPending)
+            {
+                pDhContext->m_fCollectingPending = false;
+                SortPendingDependentHandles(pDhContext->m_pPending, pDhContext->m_cPending);
+                pDhContext->m_fPendingValid = true;
+
+                if (pDhContext->m_fUnpromotedPrimaries && pDhContext->m_fPromoted)
+                {
+                    ScanPendingDependentHandlesForPromotion(pDhContext);
+                }
+
+                // Callers look at the flags to decide whether to scan again.
+                pDhContext->m_fPromoted = fAnyPromotions;
+                break;
+            }
+
+            pDhContext->m_cPending = 0;
+        }
+
     } while (pDhContext->m_fUnpromotedPrimaries && pDhContext->m_fPromoted);
 
     return fAnyPromotions;
@@ -1604,17 +1874,7 @@ void Ref_UpdatePointers(uint32_t condemned, uint32_t maxgen, ScanContext* sc, Re
     // perform a multi-type scan that updates pointers
     uint32_t flags = (sc->concurrent) ? HNDGCF_ASYNC : HNDGCF_NORMAL;
 
-    HandleTableMap *walk = &g_HandleTableMap;
-    while (walk) {
-        for (uint32_t i = 0; i < INITIAL_HANDLE_TABLE_ARRAY_SIZE; i ++)
-            if (walk->pBuckets[i] != NULL)
-            {
-                HHANDLETABLE hTable = walk->pBuckets[i]->pTable[getSlotNumber(sc)];
-                if (hTable)
-                    HndScanHandlesForGC(hTable, UpdatePointer, uintptr_t(sc), uintptr_t(fn), types, _countof(types), condemned, maxgen, flags);
-            }
-        walk = walk->pNext;
-    }
+    ScanHandlesForGC(sc, UpdatePointer, uintptr_t(sc), uintptr_t(fn), types, _countof(types), condemned, maxgen, flags, SHARED_SCAN_UPDATE_POINTERS);
 
     // update pointers in variable handles whose dynamic type is VHT_WEAK_SHORT, VHT_WEAK_LONG or VHT_STRONG
     TraceVariableHandles(UpdatePointer, uintptr_t(sc), uintptr_t(fn), VHT_WEAK_SHORT | VHT_WEAK_LONG | VHT_STRONG, condemned, maxgen, flags);
@@ -1746,6 +2006,48 @@ void Ref_ScanPointers(uint32_t condemned, uint32_t maxgen, ScanContext* sc, Ref_
     TraceVariableHandlesBySingleThread(&ScanPointer, uintptr_t(sc), uintptr_t(fn), VHT_WEAK_SHORT | VHT_WEAK_LONG | VHT_STRONG, condemned, maxgen, flags);
 }
 
+// Enumerate the object references held by handles that keep their referents alive (ie, 
+// not the weak ones) in any of the handle tables in the system.
+void Ref_ScanStrongPointers(uint32_t maxgen, ScanContext* sc, Ref_promote_func* fn)
+{
+    WRAPPER_NO_CONTRACT;
+
+    uint32_t types[] =
+    {
+        HNDTYPE_STRONG,
+#if defined(FEATURE_COMINTEROP) || defined(FEATURE_REDHAWK)
+        HNDTYPE_REFCOUNTED,
+#endif // FEATURE_COMINTEROP || FEATURE_REDHAWK
+        HNDTYPE_PINNED,
+        HNDTYPE_ASYNCPINNED,
+        HNDTYPE_SIZEDREF,
+    };
+
+    uint32_t flags = HNDGCF_NORMAL;
+
+    for (HandleTableMap * walk = &g_HandleTableMap; 
+         walk != nullptr; 
+         walk = walk->pNext)
+    {
+        for (uint32_t i = 0; i < INITIAL_HANDLE_TABLE_ARRAY_SIZE; i++)
+        {
+            if (walk->pBuckets[i] != NULL)
+            {
+                // this is performed by a single thread in MULTI_HEAPS case, so we need to loop through all HT of the bucket
+                for (int uCPUindex = 0; uCPUindex < getNumberOfSlots(); uCPUindex++)
+                {
+                    HHANDLETABLE hTable = walk->pBuckets[i]->pTable[uCPUindex];
+                    if (hTable)
+                        HndScanHandlesForGC(hTable, &ScanPointer, uintptr_t(sc), uintptr_t(fn), types, _countof(types), maxgen, maxgen, flags);
+                }
+            }
+        }
+    }
+
+    // enumerate pointers in variable handles whose dynamic type is VHT_STRONG or VHT_PINNED
+    TraceVariableHandlesBySingleThread(&ScanPointer, uintptr_t(sc), uintptr_t(fn), VHT_STRONG | VHT_PINNED, maxgen, maxgen, flags);
+}
+
 void Ref_UpdatePinnedPointers(uint32_t condemned, uint32_t maxgen, ScanContext* sc, Ref_promote_func* fn)
 {
     WRAPPER_NO_CONTRACT;
@@ -1799,19 +2101,8 @@ void Ref_AgeHandles(uint32_t condemned, uint32_t maxgen, uintptr_t lp1)
         HNDTYPE_SIZEDREF,
     };
 
-    int uCPUindex = getSlotNumber((ScanContext*) lp1);
     // perform a multi-type scan that ages the handles
-    HandleTableMap *walk = &g_HandleTableMap;
-    while (walk) {
-        for (uint32_t i = 0; i < INITIAL_HANDLE_TABLE_ARRAY_SIZE; i ++)
-            if (walk->pBuckets[i] != NULL)
-            {
-                HHANDLETABLE hTable = walk->pBuckets[i]->pTable[uCPUindex];
-                if (hTable)
-                    HndScanHandlesForGC(hTable, NULL, 0, 0, types, _countof(types), condemned, maxgen, HNDGCF_AGE);
-            }
-        walk = walk->pNext;
-    }
+    ScanHandlesForGC((ScanContext*) lp1, NULL, 0, 0, types, _countof(types), condemned, maxgen, HNDGCF_AGE, SHARED_SCAN_AGE_HANDLES);
 }
 
 
@@ -0,0 +1,742 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+//
+// GCBench.cpp
+//
+
+//
+//  GC microbenchmarks on top of the sample GC environment, meant to catch throughput and
+//  pause time regressions in the GC without building the rest of CoreCLR.
+//
+//  Each scenario allocates a fixed volume of memory and keeps a fraction of the allocated
+//  objects alive by storing them into random slots of a rooted array, so survivors die
+//  again when their slot is reused:
+//
+//  * gen0_churn    - nothing survives
+//  * survive_10    - 10% of the allocations survive
+//  * survive_50    - 50% of the allocations survive
+//  * trees         - binary trees of small objects, 10% of the trees survive
+//  * pinning       - like survive_10, with a pinned handle on 10% of the survivors
+//  * loh_churn     - 100KB byte arrays, 10% survive
+//
+//  Usage: gcbench [-mb <MB allocated per scenario>] [-live <slots>]
+//                 [-baseline <file> [-threshold <percent>]] [scenario ...]
+//
+//  Every scenario prints one JSON object per line on stdout:
+//
+//  {"scenario":"survive_10","allocated_mb":512.0,"elapsed_ms":...,"alloc_mb_per_s":...,
+//   "gcs":...,"gen0_gcs":...,"gen1_gcs":...,"gen2_gcs":...,
+//   "pause_ms":{"p50":...,"p90":...,"p99":...,"max":...,"total":...},
+//   "phase_ms":{"mark":...,"plan":...,"relocate":...,"compact":...,"sweep":...},
+//   "peak_commit_mb":...,"heap_mb":...}
+//
+//  genN_gcs is the number of GCs that condemned generation N. Pauses are measured from
+//  SuspendEE to RestartEE. phase_ms is the time spent in each GC phase by the scenario's
+//  GCs, added up from each GC's info record when its pause ends. peak_commit_mb is the
+//  most the GC had committed for its segments at the end of a GC or of the scenario.
+//
+//  With -baseline, each scenario is also compared with its line in the output of an earlier
+//  run with the same options and scenarios. A metric that got worse by more than the
+//  threshold (25% by default, as pauses vary that much between runs) is reported on stderr
+//  and gcbench returns 1 once all the scenarios ran.
+//
+
+#include "common.h"
+
+#include "gcenv.h"
+
+#include "gc.h"
+#include "objecthandle.h"
+
+#include "gcdesc.h"
+
+#include <stdlib.h>
+
+//
+// Allocation and write barrier, see GCSample.cpp
+//
+
+inline size_t AlignObjectSize(size_t size)
+{
+    return (size + (DATA_ALIGNMENT - 1)) & ~(DATA_ALIGNMENT - 1);
+}
+
+Object * AllocateRaw(MethodTable * pMT, size_t size)
+{
+    alloc_context * acontext = GetThread()->GetAllocContext();
+    Object * pObject;
+
+    uint8_t* result = acontext->alloc_ptr;
+    uint8_t* advance = result + size;
+    if (advance <= acontext->alloc_limit)
+    {
+        acontext->alloc_ptr = advance;
+        pObject = (Object *)result;
+    }
+    else
+    {
+        pObject = GCHeap::GetGCHeap()->Alloc(acontext, size, 0);
+        if (pObject == NULL)
+            return NULL;
+    }
+
+    pObject->RawSetMethodTable(pMT);
+
+    return pObject;
+}
+
+Object * AllocateObject(MethodTable * pMT)
+{
+    return AllocateRaw(pMT, pMT->GetBaseSize());
+}
+
+ArrayBase * AllocateArray(MethodTable * pMT, uint32_t length)
+{
+    size_t size = AlignObjectSize(pMT->GetBaseSize() + (size_t)length * pMT->RawGetComponentSize());
+
+    ArrayBase * pArray = (ArrayBase *)AllocateRaw(pMT, size);
+    if (pArray == NULL)
+        return NULL;
+
+    *(uint32_t *)((uint8_t *)pArray + ArrayBase::GetOffsetOfNumComponents()) = length;
+
+    return pArray;
+}
+
+#if defined(BIT64)
+// Card byte shift is different on 64bit.
+#define card_byte_shift     11
+#else
+#define card_byte_shift     10
+#endif
+
+#define card_byte(addr) (((size_t)(addr)) >> card_byte_shift)
+
+inline void ErectWriteBarrier(Object ** dst, Object * ref)
+{
+    // if the dst is outside of the heap (unboxed value classes) then we
+    //      simply exit
+    if (((uint8_t*)dst < g_lowest_address) || ((uint8_t*)dst >= g_highest_address))
+        return;
+
+    if((uint8_t*)ref >= g_ephemeral_low && (uint8_t*)ref < g_ephemeral_high)
+    {
+        // volatile is used here to prevent fetch of g_card_table from being reordered
+        // with g_lowest/highest_address check above. See comment in code:gc_heap::grow_brick_card_tables.
+        uint8_t* pCardByte = (uint8_t *)*(volatile uint8_t **)(&g_card_table) + card_byte((uint8_t *)dst);
+        if(*pCardByte != 0xFF)
+            *pCardByte = 0xFF;
+    }
+}
+
+void WriteBarrier(Object ** dst, Object * ref)
+{
+    *dst = ref;
+    ErectWriteBarrier(dst, ref);
+}
+
+//
+// Types
+//
+
+// Laid out like an Object followed by its fields, but standard layout so that offsetof
+// can be used on it.
+struct Node
+{
+    MethodTable * m_pMethTab;
+    Object * m_pLeft;
+    Object * m_pRight;
+    size_t m_payload;
+};
+
+static struct Node_MethodTable
+{
+    CGCDescSeries m_series[1];
+    size_t m_numSeries;
+    MethodTable m_MT;
+}
+Node_MethodTable;
+
+// Arrays of object references, with a single series covering the elements
+static struct ObjectArray_MethodTable
+{
+    CGCDescSeries m_series[1];
+    size_t m_numSeries;
+    MethodTable m_MT;
+}
+ObjectArray_MethodTable;
+
+static MethodTable ByteArray_MethodTable;
+
+static void InitializeMethodTables()
+{
+    // Node has its two references next to each other, so they are described by one series.
+    Node_MethodTable.m_MT.m_baseSize = max((uint32_t)(sizeof(Node) + sizeof(ObjHeader)), (uint32_t)MIN_OBJECT_SIZE);
+    Node_MethodTable.m_MT.m_componentSize = 0;
+    Node_MethodTable.m_MT.m_flags = MTFlag_ContainsPointers;
+    Node_MethodTable.m_numSeries = 1;
+    Node_MethodTable.m_series[0].SetSeriesOffset(offsetof(Node, m_pLeft));
+    Node_MethodTable.m_series[0].SetSeriesCount(2);
+    Node_MethodTable.m_series[0].seriessize -= Node_MethodTable.m_MT.m_baseSize;
+
+    // The series of an array starts at the first element and its size is adjusted by the
+    // base size only, so it covers all the elements whatever the length.
+    uint32_t arrayBaseSize = (uint32_t)(sizeof(ArrayBase) + sizeof(ObjHeader));
+
+    ObjectArray_MethodTable.m_MT.m_baseSize = arrayBaseSize;
+    ObjectArray_MethodTable.m_MT.m_componentSize = sizeof(Object *);
+    ObjectArray_MethodTable.m_MT.m_flags = MTFlag_ContainsPointers | MTFlag_HasComponentSize | MTFlag_Category_Array;
+    ObjectArray_MethodTable.m_numSeries = 1;
+    ObjectArray_MethodTable.m_series[0].SetSeriesOffset(sizeof(ArrayBase));
+    ObjectArray_MethodTable.m_series[0].SetSeriesSize((size_t)0 - (size_t)arrayBaseSize);
+
+    ByteArray_MethodTable.m_baseSize = arrayBaseSize;
+    ByteArray_MethodTable.m_componentSize = 1;
+    ByteArray_MethodTable.m_flags = MTFlag_HasComponentSize | MTFlag_Category_Array;
+}
+
+inline Object ** GetArrayData(Object * pArray)
+{
+    return (Object **)((uint8_t *)pArray + sizeof(ArrayBase));
+}
+
+//
+// Measurements
+//
+
+// Pauses of the current scenario, growing as needed
+static int64_t * g_pauses;
+static size_t g_pauseCount;
+static size_t g_pauseCapacity;
+
+static size_t g_peakCommitted;
+
+static void SampleCommitted()
+{
+    size_t committed = GCHeap::GetGCHeap()->GetTotalCommittedBytes();
+    if (committed > g_peakCommitted)
+        g_peakCommitted = committed;
+}
+
+// Time spent in each phase by the GCs of the current scenario, in microseconds
+static uint64_t g_phaseTimes[5];
+// Index of the last GC whose phase times are in g_phaseTimes
+static uint64_t g_phaseGCIndex;
+
+// The GC info records are read into these at the end of each pause. A few records are
+// read each time in case a background GC ended between two pauses.
+const int PhaseRecordCount = 4;
+static gc_info_record g_phaseRecords[PhaseRecordCount];
+static gc_info_heap_record * g_phaseHeapRecords;
+
+// Adds the phase times of the GCs that ended since the last call
+static void AddPhaseTimes()
+{
+    if (g_phaseHeapRecords == NULL)
+        return;
+
+    int heapCount = GCHeap::GetGCHeap()->GetNumberOfHeaps();
+    int count = GCHeap::GetGCHeap()->GetGCInfoRecords(g_phaseRecords, g_phaseHeapRecords, PhaseRecordCount);
+
+    // The records are most recent first
+    for (int i = 0; (i < count) && (g_phaseRecords[i].index > g_phaseGCIndex); i++)
+    {
+        for (uint32_t heap = 0; heap < g_phaseRecords[i].heap_count; heap++)
+        {
+            gc_info_heap_record& heapRecord = g_phaseHeapRecords[i * heapCount + heap];
+            g_phaseTimes[0] += heapRecord.mark_time;
+            g_phaseTimes[1] += heapRecord.plan_time;
+            g_phaseTimes[2] += heapRecord.relocate_time;
+            g_phaseTimes[3] += heapRecord.compact_time;
+            g_phaseTimes[4] += heapRecord.sweep_time;
+        }
+    }
+
+    if ((count > 0) && (g_phaseRecords[0].index > g_phaseGCIndex))
+        g_phaseGCIndex = g_phaseRecords[0].index;
+}
+
+static void OnGCPause(int64_t pauseTicks)
+{
+    if (g_pauseCount == g_pauseCapacity)
+    {
+        size_t newCapacity = max(g_pauseCapacity * 2, (size_t)1024);
+        int64_t * newPauses = (int64_t *)realloc(g_pauses, newCapacity * sizeof(int64_t));
+        if (newPauses == NULL)
+            return;
+
+        g_pauses = newPauses;
+        g_pauseCapacity = newCapacity;
+    }
+
+    g_pauses[g_pauseCount++] = pauseTicks;
+    SampleCommitted();
+    AddPhaseTimes();
+}
+
+static int __cdecl ComparePauses(const void * p1, const void * p2)
+{
+    int64_t pause1 = *(const int64_t *)p1;
+    int64_t pause2 = *(const int64_t *)p2;
+    return (pause1 < pause2) ? -1 : ((pause1 > pause2) ? 1 : 0);
+}
+
+// Nearest rank percentile of the sorted pauses, in milliseconds
+static double PausePercentileMs(double percentile, double ticksPerMs)
+{
+    if (g_pauseCount == 0)
+        return 0.0;
+
+    size_t rank = (size_t)(percentile * g_pauseCount / 100.0 + 0.999999);
+    if (rank > 0)
+        rank--;
+    if (rank >= g_pauseCount)
+        rank = g_pauseCount - 1;
+
+    return g_pauses[rank] / ticksPerMs;
+}
+
+//
+// Comparison with a baseline
+//
+
+// The output of the baseline run, one scenario per line
+static char * g_baseline;
+static double g_regressionThreshold = 25.0;
+
+struct Metric
+{
+    const char * name;          // as printed by RunScenario
+    bool higherIsBetter;
+    // Smaller changes are noise however large they are relative to the baseline
+    double minimumChange;
+};
+
+static const Metric g_metrics[] =
+{
+    { "alloc_mb_per_s", true,  0.0 },
+    { "p50",            false, 0.1 },
+    { "p99",            false, 0.1 },
+    { "max",            false, 0.1 },
+    { "total",          false, 1.0 },
+    { "peak_commit_mb", false, 1.0 },
+};
+
+static bool LoadBaseline(const char * path)
+{
+    FILE * file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    g_baseline = (char *)malloc(length + 1);
+    bool read = (g_baseline != NULL) && (length >= 0) && (fread(g_baseline, 1, length, file) == (size_t)length);
+    fclose(file);
+
+    if (!read)
+        return false;
+
+    g_baseline[length] = '\0';
+    return true;
+}
+
+// Finds "name":<number> in the line starting at pLine
+static bool GetMetric(const char * pLine, const char * name, double * pValue)
+{
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\":", name);
+
+    const char * pEnd = strchr(pLine, '\n');
+    const char * pKey = strstr(pLine, key);
+    if ((pKey == NULL) || ((pEnd != NULL) && (pKey > pEnd)))
+        return false;
+
+    *pValue = atof(pKey + strlen(key));
+    return true;
+}
+
+// Returns whether the scenario regressed compared to the baseline
+static bool CompareWithBaseline(const char * scenarioName, const char * pLine)
+{
+    char key[64];
+    snprintf(key, sizeof(key), "{\"scenario\":\"%s\",", scenarioName);
+
+    const char * pBaselineLine = strstr(g_baseline, key);
+    if (pBaselineLine == NULL)
+    {
+        fprintf(stderr, "gcbench: %s: not in the baseline\n", scenarioName);
+        return false;
+    }
+
+    bool regressed = false;
+    for (size_t i = 0; i < _countof(g_metrics); i++)
+    {
+        const Metric& metric = g_metrics[i];
+
+        double value, baselineValue;
+        if (!GetMetric(pLine, metric.name, &value) || !GetMetric(pBaselineLine, metric.name, &baselineValue) ||
+            (baselineValue <= 0.0))
+            continue;
+
+        double change = metric.higherIsBetter ? (baselineValue - value) : (value - baselineValue);
+        double changePercent = change * 100.0 / baselineValue;
+        if ((change > metric.minimumChange) && (changePercent > g_regressionThreshold))
+        {
+            fprintf(stderr, "gcbench: %s: %s regressed by %.1f%% (%.3f, baseline %.3f)\n",
+                scenarioName, metric.name, changePercent, value, baselineValue);
+            regressed = true;
+        }
+    }
+
+    return regressed;
+}
+
+//
+// Scenarios
+//
+
+enum ScenarioKind
+{
+    Scenario_SmallObjects,
+    Scenario_Trees,
+    Scenario_LargeObjects,
+};
+
+struct Scenario
+{
+    const char * name;
+    ScenarioKind kind;
+    uint32_t survivalPercent;
+    uint32_t pinPercent;        // of the survivors
+};
+
+static const Scenario g_scenarios[] =
+{
+    { "gen0_churn", Scenario_SmallObjects,  0,  0 },
+    { "survive_10", Scenario_SmallObjects, 10,  0 },
+    { "survive_50", Scenario_SmallObjects, 50,  0 },
+    { "trees",      Scenario_Trees,        10,  0 },
+    { "pinning",    Scenario_SmallObjects, 10, 10 },
+    { "loh_churn",  Scenario_LargeObjects, 10,  0 },
+};
+
+const int TreeDepth = 5;                        // 63 nodes per tree
+const uint32_t LargeObjectLength = 100 * 1024;
+const size_t PinnedHandleCount = 256;
+
+// Deterministic so that runs are comparable
+static uint32_t g_random = 0x2545F491;
+
+inline uint32_t NextRandom()
+{
+    // xorshift32
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random;
+}
+
+// The trees under construction are rooted in this array, one slot per level, because
+// the sample does not report stack roots.
+static OBJECTHANDLE g_treeRoots;
+
+static Object * BuildTree(int depth, size_t * pAllocated)
+{
+    Object * pNode = AllocateObject(&Node_MethodTable.m_MT);
+    if (pNode == NULL)
+        return NULL;
+    *pAllocated += Node_MethodTable.m_MT.GetBaseSize();
+
+    if (depth == 0)
+        return pNode;
+
+    Object ** pSlot = &GetArrayData(ObjectFromHandle(g_treeRoots))[depth];
+    WriteBarrier(pSlot, pNode);
+
+    Object * pLeft = BuildTree(depth - 1, pAllocated);
+    if (pLeft == NULL)
+        return NULL;
+    pNode = GetArrayData(ObjectFromHandle(g_treeRoots))[depth];
+    WriteBarrier(&((Node *)pNode)->m_pLeft, pLeft);
+
+    Object * pRight = BuildTree(depth - 1, pAllocated);
+    if (pRight == NULL)
+        return NULL;
+    pNode = GetArrayData(ObjectFromHandle(g_treeRoots))[depth];
+    WriteBarrier(&((Node *)pNode)->m_pRight, pRight);
+
+    GetArrayData(ObjectFromHandle(g_treeRoots))[depth] = NULL;
+
+    return pNode;
+}
+
+static bool RunScenario(const Scenario& scenario, size_t allocationVolume, uint32_t liveSlots, bool * pRegressed)
+{
+    GCHeap * pGCHeap = GCHeap::GetGCHeap();
+
+    if (scenario.kind == Scenario_Trees)
+        liveSlots = max(liveSlots / 64, (uint32_t)1);
+    else if (scenario.kind == Scenario_LargeObjects)
+        liveSlots = max(liveSlots / 256, (uint32_t)1);
+
+    ArrayBase * pLiveArray = AllocateArray(&ObjectArray_MethodTable.m_MT, liveSlots);
+    if (pLiveArray == NULL)
+        return false;
+
+    OBJECTHANDLE ohLive = CreateGlobalHandle(pLiveArray);
+    if (ohLive == NULL)
+        return false;
+
+    static OBJECTHANDLE pinnedHandles[PinnedHandleCount];
+    size_t nextPinnedHandle = 0;
+
+    // Start every scenario from a clean heap
+    pGCHeap->GarbageCollect();
+
+    g_pauseCount = 0;
+    memset(g_phaseTimes, 0, sizeof(g_phaseTimes));
+    g_peakCommitted = 0;
+    SampleCommitted();
+
+    int collectionsBefore[3];
+    for (int gen = 0; gen < 3; gen++)
+        collectionsBefore[gen] = pGCHeap->CollectionCount(gen);
+
+    int64_t start = GCToOSInterface::QueryPerformanceCounter();
+
+    size_t allocated = 0;
+    while (allocated < allocationVolume)
+    {
+        Object * pObj;
+
+        switch (scenario.kind)
+        {
+        case Scenario_Trees:
+            pObj = BuildTree(TreeDepth, &allocated);
+            break;
+
+        case Scenario_LargeObjects:
+            pObj = AllocateArray(&ByteArray_MethodTable, LargeObjectLength);
+            allocated += AlignObjectSize(ByteArray_MethodTable.GetBaseSize() + LargeObjectLength);
+            break;
+
+        default:
+            pObj = AllocateObject(&Node_MethodTable.m_MT);
+            allocated += Node_MethodTable.m_MT.GetBaseSize();
+            break;
+        }
+
+        if (pObj == NULL)
+        {
+            fprintf(stderr, "gcbench: %s: out of memory\n", scenario.name);
+            return false;
+        }
+
+        if ((NextRandom() % 100) >= scenario.survivalPercent)
+            continue;
+
+        Object ** pSlot = &GetArrayData(ObjectFromHandle(ohLive))[NextRandom() % liveSlots];
+        WriteBarrier(pSlot, pObj);
+
+        if ((NextRandom() % 100) < scenario.pinPercent)
+        {
+            // Keep the most recent pinned survivors pinned
+            OBJECTHANDLE& ohPinned = pinnedHandles[nextPinnedHandle];
+            nextPinnedHandle = (nextPinnedHandle + 1) % PinnedHandleCount;
+
+            if (ohPinned != NULL)
+                DestroyGlobalTypedHandle(ohPinned);
+
+            ohPinned = CreateGlobalTypedHandle(pObj, HNDTYPE_PINNED);
+            if (ohPinned == NULL)
+                return false;
+        }
+    }
+
+    int64_t elapsed = GCToOSInterface::QueryPerformanceCounter() - start;
+
+    SampleCommitted();
+
+    double ticksPerMs = GCToOSInterface::QueryPerformanceFrequency() / 1000.0;
+    double elapsedMs = elapsed / ticksPerMs;
+    double allocatedMB = allocated / (1024.0 * 1024.0);
+
+    // Nothing allocates from here on, so the pauses can be sorted in place
+    size_t pauseCount = g_pauseCount;
+    qsort(g_pauses, pauseCount, sizeof(int64_t), ComparePauses);
+
+    int64_t totalPause = 0;
+    for (size_t i = 0; i < pauseCount; i++)
+        totalPause += g_pauses[i];
+
+    // CollectionCount(gen) counts the GCs that condemned gen or an older generation
+    int collections[3];
+    for (int gen = 0; gen < 3; gen++)
+        collections[gen] = pGCHeap->CollectionCount(gen) - collectionsBefore[gen];
+    for (int gen = 0; gen < 2; gen++)
+        collections[gen] -= collections[gen + 1];
+
+    // Pick up a background GC that ended after the last pause
+    AddPhaseTimes();
+
+    char line[1024];
+    snprintf(line, sizeof(line), "{\"scenario\":\"%s\",\"survival_pct\":%u,\"pinned_pct\":%u,"
+           "\"allocated_mb\":%.1f,\"elapsed_ms\":%.2f,\"alloc_mb_per_s\":%.1f,"
+           "\"gcs\":%u,\"gen0_gcs\":%d,\"gen1_gcs\":%d,\"gen2_gcs\":%d,"
+           "\"pause_ms\":{\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f,\"total\":%.2f},"
+           "\"phase_ms\":{\"mark\":%.2f,\"plan\":%.2f,\"relocate\":%.2f,\"compact\":%.2f,\"sweep\":%.2f},"
+           "\"peak_commit_mb\":%.1f,\"heap_mb\":%.1f}\n",
+        scenario.name, scenario.survivalPercent, scenario.pinPercent,
+        allocatedMB, elapsedMs, (elapsedMs > 0) ? (allocatedMB * 1000.0 / elapsedMs) : 0.0,
+        (uint32_t)pauseCount, collections[0], collections[1], collections[2],
+        PausePercentileMs(50, ticksPerMs),
+        PausePercentileMs(90, ticksPerMs),
+        PausePercentileMs(99, ticksPerMs),
+        PausePercentileMs(100, ticksPerMs),
+        totalPause / ticksPerMs,
+        g_phaseTimes[0] / 1000.0, g_phaseTimes[1] / 1000.0, g_phaseTimes[2] / 1000.0,
+        g_phaseTimes[3] / 1000.0, g_phaseTimes[4] / 1000.0,
+        g_peakCommitted / (1024.0 * 1024.0),
+        pGCHeap->GetTotalBytesInUse() / (1024.0 * 1024.0));
+    fputs(line, stdout);
+    fflush(stdout);
+
+    if ((g_baseline != NULL) && CompareWithBaseline(scenario.name, line))
+        *pRegressed = true;
+
+    for (size_t i = 0; i < PinnedHandleCount; i++)
+    {
+        if (pinnedHandles[i] != NULL)
+        {
+            DestroyGlobalTypedHandle(pinnedHandles[i]);
+            pinnedHandles[i] = NULL;
+        }
+    }
+
+    DestroyGlobalHandle(ohLive);
+
+    return true;
+}
+
+static void Usage()
+{
+    fprintf(stderr, "Usage: gcbench [-mb <MB allocated per scenario>] [-live <slots>]\n");
+    fprintf(stderr, "               [-baseline <file> [-threshold <percent>]] [scenario ...]\n");
+    fprintf(stderr, "Scenarios:");
+    for (size_t i = 0; i < _countof(g_scenarios); i++)
+        fprintf(stderr, " %s", g_scenarios[i].name);
+    fprintf(stderr, "\n");
+}
+
+int __cdecl main(int argc, char* argv[])
+{
+    size_t allocationVolumeMB = 512;
+    uint32_t liveSlots = 64 * 1024;
+    const Scenario * scenarios[_countof(g_scenarios)];
+    size_t scenarioCount = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-mb") == 0) && (i + 1 < argc))
+        {
+            allocationVolumeMB = (size_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-live") == 0) && (i + 1 < argc))
+        {
+            liveSlots = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-baseline") == 0) && (i + 1 < argc))
+        {
+            if (!LoadBaseline(argv[++i]))
+            {
+                fprintf(stderr, "gcbench: cannot read %s\n", argv[i]);
+                return -1;
+            }
+        }
+        else if ((strcmp(argv[i], "-threshold") == 0) && (i + 1 < argc))
+        {
+            g_regressionThreshold = atof(argv[++i]);
+        }
+        else
+        {
+            const Scenario * pScenario = NULL;
+            for (size_t j = 0; j < _countof(g_scenarios); j++)
+            {
+                if (strcmp(argv[i], g_scenarios[j].name) == 0)
+                    pScenario = &g_scenarios[j];
+            }
+
+            if ((pScenario == NULL) || (scenarioCount == _countof(scenarios)))
+            {
+                Usage();
+                return -1;
+            }
+
+            scenarios[scenarioCount++] = pScenario;
+        }
+    }
+
+    if ((allocationVolumeMB == 0) || (liveSlots == 0))
+    {
+        Usage();
+        return -1;
+    }
+
+    if (scenarioCount == 0)
+    {
+        for (size_t j = 0; j < _countof(g_scenarios); j++)
+            scenarios[scenarioCount++] = &g_scenarios[j];
+    }
+
+    //
+    // Initialize the GC the same way as GCSample.cpp
+    //
+    if (!GCToOSInterface::Initialize())
+        return -1;
+
+    static MethodTable freeObjectMT;
+    freeObjectMT.InitializeFreeObject();
+    g_pFreeObjectMethodTable = &freeObjectMT;
+
+    if (!Ref_Initialize())
+        return -1;
+
+    GCHeap *pGCHeap = GCHeap::CreateGCHeap();
+    if (!pGCHeap)
+        return -1;
+
+    if (FAILED(pGCHeap->Initialize()))
+        return -1;
+
+    ThreadStore::AttachCurrentThread();
+
+    InitializeMethodTables();
+
+    ArrayBase * pTreeRoots = AllocateArray(&ObjectArray_MethodTable.m_MT, TreeDepth + 1);
+    if (pTreeRoots == NULL)
+        return -1;
+
+    g_treeRoots = CreateGlobalHandle(pTreeRoots);
+    if (g_treeRoots == NULL)
+        return -1;
+
+    g_phaseHeapRecords = (gc_info_heap_record *)malloc(PhaseRecordCount * pGCHeap->GetNumberOfHeaps() * sizeof(gc_info_heap_record));
+    if (g_phaseHeapRecords == NULL)
+        return -1;
+
+    g_pGCPauseCallback = OnGCPause;
+
+    bool regressed = false;
+    for (size_t i = 0; i < scenarioCount; i++)
+    {
+        if (!RunScenario(*scenarios[i], allocationVolumeMB * 1024 * 1024, liveSlots, &regressed))
+            return -1;
+    }
+
+    return regressed ? 1 : 0;
+}
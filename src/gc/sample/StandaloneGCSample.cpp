@@ -0,0 +1,504 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+//
+// StandaloneGCSample.cpp
+//
+
+//
+//  Runs GCSample against the GC built as a separate library (see ../standalone) instead of
+//  the GC linked into the sample. It checks that the library can be loaded through
+//  gcinterface.h and that it collects the sample's objects:
+//
+//  * The library's version must match the interface the sample was built with
+//  * GC_Initialize returns the library's heap, which the sample allocates from
+//  * The library reaches the sample's execution engine, OS and handle table through the
+//    IGCToCLR and IGCToOS implementations here, which forward to the sample environment
+//    the same way vm/standalonegc.cpp forwards to the runtime
+//
+//  Usage: standalonegcsample [<path to the clrgc library>]
+//
+//  The library built along with the sample is used by default. Both are built when
+//  CLR_CMAKE_BUILD_STANDALONE_GC is on.
+//
+//  Prints "Done" and returns 0 if the weak handle to the sample's object got cleared by
+//  the library's GC.
+//
+
+#include "common.h"
+
+#include "gcenv.h"
+
+#include "gc.h"
+#include "gcscan.h"
+#include "gcinterface.h"
+#include "objecthandle.h"
+
+#include "gcdesc.h"
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif // !_WIN32
+
+//
+// Allocation and write barrier, see GCSample.cpp
+//
+
+Object * AllocateObject(MethodTable * pMT)
+{
+    alloc_context * acontext = GetThread()->GetAllocContext();
+    Object * pObject;
+
+    size_t size = pMT->GetBaseSize();
+
+    uint8_t* result = acontext->alloc_ptr;
+    uint8_t* advance = result + size;
+    if (advance <= acontext->alloc_limit)
+    {
+        acontext->alloc_ptr = advance;
+        pObject = (Object *)result;
+    }
+    else
+    {
+        pObject = GCHeap::GetGCHeap()->Alloc(acontext, size, 0);
+        if (pObject == NULL)
+            return NULL;
+    }
+
+    pObject->RawSetMethodTable(pMT);
+
+    return pObject;
+}
+
+#if defined(BIT64)
+#define card_byte_shift     11
+#else
+#define card_byte_shift     10
+#endif
+
+#define card_byte(addr) (((size_t)(addr)) >> card_byte_shift)
+
+inline void ErectWriteBarrier(Object ** dst, Object * ref)
+{
+    if (((uint8_t*)dst < g_lowest_address) || ((uint8_t*)dst >= g_highest_address))
+        return;
+
+    if((uint8_t*)ref >= g_ephemeral_low && (uint8_t*)ref < g_ephemeral_high)
+    {
+        uint8_t* pCardByte = (uint8_t *)*(volatile uint8_t **)(&g_card_table) + card_byte((uint8_t *)dst);
+        if(*pCardByte != 0xFF)
+            *pCardByte = 0xFF;
+    }
+}
+
+void WriteBarrier(Object ** dst, Object * ref)
+{
+    *dst = ref;
+    ErectWriteBarrier(dst, ref);
+}
+
+//
+// The sample environment as seen by the library
+//
+
+static EEConfig g_sampleConfig;
+
+class SampleGCToCLR : public IGCToCLR
+{
+public:
+    //
+    // GCToEEInterface
+    //
+
+    virtual void SuspendEE(GCToEEInterface::SUSPEND_REASON reason) { GCToEEInterface::SuspendEE(reason); }
+    virtual void RestartEE(bool bFinishedGC) { GCToEEInterface::RestartEE(bFinishedGC); }
+    virtual void GcScanRoots(promote_func* fn, int condemned, int max_gen, ScanContext* sc) { GCScan::GcScanRoots(fn, condemned, max_gen, sc); }
+    virtual void GcStartWork(int condemned, int max_gen) { GCToEEInterface::GcStartWork(condemned, max_gen); }
+    virtual void AfterGcScanRoots(int condemned, int max_gen, ScanContext* sc) { GCToEEInterface::AfterGcScanRoots(condemned, max_gen, sc); }
+    virtual void GcBeforeBGCSweepWork() { GCToEEInterface::GcBeforeBGCSweepWork(); }
+    virtual void GcDone(int condemned) { GCToEEInterface::GcDone(condemned); }
+    virtual bool RefCountedHandleCallbacks(Object * pObject) { return GCToEEInterface::RefCountedHandleCallbacks(pObject); }
+    virtual void SyncBlockCacheWeakPtrScan(HANDLESCANPROC scanProc, uintptr_t lp1, uintptr_t lp2) { GCToEEInterface::SyncBlockCacheWeakPtrScan(scanProc, lp1, lp2); }
+    virtual void SyncBlockCacheDemote(int max_gen) { GCToEEInterface::SyncBlockCacheDemote(max_gen); }
+    virtual void SyncBlockCachePromotionsGranted(int max_gen) { GCToEEInterface::SyncBlockCachePromotionsGranted(max_gen); }
+    virtual bool IsPreemptiveGCDisabled(Thread * pThread) { return GCToEEInterface::IsPreemptiveGCDisabled(pThread); }
+    virtual void EnablePreemptiveGC(Thread * pThread) { GCToEEInterface::EnablePreemptiveGC(pThread); }
+    virtual void DisablePreemptiveGC(Thread * pThread) { GCToEEInterface::DisablePreemptiveGC(pThread); }
+    virtual void SetGCSpecial(Thread * pThread) { GCToEEInterface::SetGCSpecial(pThread); }
+    virtual alloc_context * GetAllocContext(Thread * pThread) { return GCToEEInterface::GetAllocContext(pThread); }
+    virtual bool CatchAtSafePoint(Thread * pThread) { return GCToEEInterface::CatchAtSafePoint(pThread); }
+    virtual bool IsGCThread() { return GCToEEInterface::IsGCThread(); }
+    virtual void GcEnumAllocContexts(enum_alloc_context_func* fn, void* param) { GCToEEInterface::GcEnumAllocContexts(fn, param); }
+    virtual void AttachCurrentThread() { GCToEEInterface::AttachCurrentThread(); }
+
+    //
+    // Threads and finalization
+    //
+
+    virtual Thread * GetThread() { return ::GetThread(); }
+    virtual bool IsGCSpecialThread() { return ::IsGCSpecialThread(); }
+    virtual bool CreateBackgroundThread(GCBackgroundThreadFunction fn, void* param)
+    {
+        // Like the sample, no background GC.
+        return false;
+    }
+    virtual void DestroyThread(Thread * pThread) { }
+    virtual void EnableFinalization() { FinalizerThread::EnableFinalization(); }
+    virtual bool HaveExtraWorkForFinalizer() { return FinalizerThread::HaveExtraWorkForFinalizer(); }
+
+    //
+    // Write barrier
+    //
+
+    virtual void StompWriteBarrier(WriteBarrierParameters* args)
+    {
+        // The sample's write barrier reads the copies of the GC globals in gccommon.cpp.
+        g_card_table = args->card_table;
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+        g_card_bundle_table = args->card_bundle_table;
+#endif // FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+        g_lowest_address = args->lowest_address;
+        g_highest_address = args->highest_address;
+        g_ephemeral_low = args->ephemeral_low;
+        g_ephemeral_high = args->ephemeral_high;
+    }
+
+    //
+    // Handle table
+    //
+
+    virtual void GcScanHandles(promote_func* fn, int condemned, int max_gen, ScanContext* sc) { GCScan::GcScanHandles(fn, condemned, max_gen, sc); }
+    virtual void GcScanSizedRefs(promote_func* fn, int condemned, int max_gen, ScanContext* sc) { GCScan::GcScanSizedRefs(fn, condemned, max_gen, sc); }
+    virtual void GcShortWeakPtrScan(promote_func* fn, int condemned, int max_gen, ScanContext* sc) { GCScan::GcShortWeakPtrScan(fn, condemned, max_gen, sc); }
+    virtual void GcWeakPtrScan(promote_func* fn, int condemned, int max_gen, ScanContext* sc) { GCScan::GcWeakPtrScan(fn, condemned, max_gen, sc); }
+    virtual void GcWeakPtrScanBySingleThread(int condemned, int max_gen, ScanContext* sc) { GCScan::GcWeakPtrScanBySingleThread(condemned, max_gen, sc); }
+    virtual void GcScanStrongHandlesBySingleThread(promote_func* fn, int max_gen, ScanContext* sc) { GCScan::GcScanStrongHandlesBySingleThread(fn, max_gen, sc); }
+    virtual void GcDhInitialScan(promote_func* fn, int condemned, int max_gen, ScanContext* sc) { GCScan::GcDhInitialScan(fn, condemned, max_gen, sc); }
+    virtual bool GcDhUnpromotedHandlesExist(ScanContext* sc) { return GCScan::GcDhUnpromotedHandlesExist(sc); }
+    virtual bool GcDhReScan(ScanContext* sc) { return GCScan::GcDhReScan(sc); }
+    virtual void GcPromotionsGranted(int condemned, int max_gen, ScanContext* sc) { GCScan::GcPromotionsGranted(condemned, max_gen, sc); }
+    virtual void GcDemote(int condemned, int max_gen, ScanContext* sc) { GCScan::GcDemote(condemned, max_gen, sc); }
+    virtual void VerifyHandleTable(int condemned, int max_gen, ScanContext* sc) { GCScan::VerifyHandleTable(condemned, max_gen, sc); }
+    virtual void GcRuntimeStructuresValid(BOOL bValid) { GCScan::GcRuntimeStructuresValid(bValid); }
+    virtual bool GetGcRuntimeStructuresValid() { return GCScan::GetGcRuntimeStructuresValid(); }
+    virtual size_t AskForMoreReservedMemory(size_t old_size, size_t need_size) { return GCScan::AskForMoreReservedMemory(old_size, need_size); }
+
+    //
+    // Configuration
+    //
+
+    virtual size_t GetGCConfigValue(GCConfigValue value)
+    {
+        switch (value)
+        {
+        case GCConfig_HeapVerifyLevel:
+            return g_sampleConfig.GetHeapVerifyLevel();
+        case GCConfig_BreakOnOOM:
+            return g_sampleConfig.IsGCBreakOnOOMEnabled();
+        case GCConfig_Gen0Size:
+            return g_sampleConfig.GetGCgen0size();
+        case GCConfig_SegmentSize:
+            return g_sampleConfig.GetSegmentSize();
+        case GCConfig_HeapHardLimit:
+            return g_sampleConfig.GetGCHeapHardLimit();
+        case GCConfig_Concurrent:
+            return g_sampleConfig.GetGCconcurrent();
+        case GCConfig_LatencyMode:
+            return g_sampleConfig.GetGCLatencyMode();
+        case GCConfig_ForceCompact:
+            return g_sampleConfig.GetGCForceCompact();
+        case GCConfig_RetainVM:
+            return g_sampleConfig.GetGCRetainVM();
+        case GCConfig_TrimCommit:
+            return g_sampleConfig.GetGCTrimCommit();
+        case GCConfig_LOHCompactionMode:
+            return g_sampleConfig.GetGCLOHCompactionMode();
+        case GCConfig_AllowVeryLargeObjects:
+        case GCConfig_Conservative:
+        default:
+            return 0;
+        }
+    }
+
+    virtual uint32_t GetConfigDWORD(const char* name, uint32_t defaultValue)
+    {
+        // The sample has no config of its own.
+        return defaultValue;
+    }
+};
+
+class SampleGCToOS : public IGCToOS
+{
+public:
+    virtual void GetSystemInfo(uint32_t* numberOfProcessors, uint32_t* pageSize, uint32_t* allocationGranularity)
+    {
+        *numberOfProcessors = g_SystemInfo.dwNumberOfProcessors;
+        *pageSize = g_SystemInfo.dwPageSize;
+        *allocationGranularity = g_SystemInfo.dwAllocationGranularity;
+    }
+
+    virtual void* VirtualReserve(void *address, size_t size, size_t alignment, uint32_t flags) { return GCToOSInterface::VirtualReserve(address, size, alignment, flags); }
+    virtual bool VirtualRelease(void *address, size_t size) { return GCToOSInterface::VirtualRelease(address, size); }
+    virtual bool VirtualCommit(void *address, size_t size) { return GCToOSInterface::VirtualCommit(address, size); }
+    virtual bool VirtualDecommit(void *address, size_t size) { return GCToOSInterface::VirtualDecommit(address, size); }
+    virtual bool VirtualReset(void *address, size_t size, bool unlock) { return GCToOSInterface::VirtualReset(address, size, unlock); }
+    virtual size_t GetLargePageSize() { return GCToOSInterface::GetLargePageSize(); }
+    virtual bool SupportsWriteWatch() { return GCToOSInterface::SupportsWriteWatch(); }
+    virtual void ResetWriteWatch(void *address, size_t size) { GCToOSInterface::ResetWriteWatch(address, size); }
+    virtual bool GetWriteWatch(bool resetState, void* address, size_t size, void** pageAddresses, uintptr_t* pageAddressesCount) { return GCToOSInterface::GetWriteWatch(resetState, address, size, pageAddresses, pageAddressesCount); }
+    virtual bool CreateThread(GCThreadFunction function, void* param, GCThreadAffinity* affinity) { return GCToOSInterface::CreateThread(function, param, affinity); }
+    virtual void Sleep(uint32_t sleepMSec) { GCToOSInterface::Sleep(sleepMSec); }
+    virtual void YieldThread(uint32_t switchCount) { GCToOSInterface::YieldThread(switchCount); }
+    virtual uint32_t GetCurrentProcessorNumber() { return GCToOSInterface::GetCurrentProcessorNumber(); }
+    virtual bool CanGetCurrentProcessorNumber() { return GCToOSInterface::CanGetCurrentProcessorNumber(); }
+    virtual bool SetCurrentThreadIdealAffinity(GCThreadAffinity* affinity) { return GCToOSInterface::SetCurrentThreadIdealAffinity(affinity); }
+    virtual uint32_t GetCurrentThreadIdForLogging() { return GCToOSInterface::GetCurrentThreadIdForLogging(); }
+    virtual uint32_t GetCurrentProcessId() { return GCToOSInterface::GetCurrentProcessId(); }
+    virtual uint32_t GetLogicalCpuCount() { return GCToOSInterface::GetLogicalCpuCount(); }
+    virtual size_t GetLargestOnDieCacheSize(bool trueSize) { return GCToOSInterface::GetLargestOnDieCacheSize(trueSize); }
+    virtual uint32_t GetCurrentProcessCpuCount() { return GCToOSInterface::GetCurrentProcessCpuCount(); }
+    virtual bool GetCurrentProcessAffinityMask(uintptr_t *processMask, uintptr_t *systemMask) { return GCToOSInterface::GetCurrentProcessAffinityMask(processMask, systemMask); }
+    virtual uint64_t GetRestrictedPhysicalMemoryLimit() { return GCToOSInterface::GetRestrictedPhysicalMemoryLimit(); }
+    virtual size_t GetCurrentPhysicalMemory() { return GCToOSInterface::GetCurrentPhysicalMemory(); }
+
+    virtual void GetMemoryStatus(GCInterfaceMemoryStatus* ms)
+    {
+        GCMemoryStatus status;
+        GCToOSInterface::GetMemoryStatus(&status);
+
+        ms->dwMemoryLoad = status.dwMemoryLoad;
+        ms->ullTotalPhys = status.ullTotalPhys;
+        ms->ullAvailPhys = status.ullAvailPhys;
+        ms->ullTotalPageFile = status.ullTotalPageFile;
+        ms->ullAvailPageFile = status.ullAvailPageFile;
+        ms->ullTotalVirtual = status.ullTotalVirtual;
+        ms->ullAvailVirtual = status.ullAvailVirtual;
+    }
+
+    virtual void FlushProcessWriteBuffers() { GCToOSInterface::FlushProcessWriteBuffers(); }
+    virtual void DebugBreak() { GCToOSInterface::DebugBreak(); }
+    virtual int64_t QueryPerformanceCounter() { return GCToOSInterface::QueryPerformanceCounter(); }
+    virtual int64_t QueryPerformanceFrequency() { return GCToOSInterface::QueryPerformanceFrequency(); }
+    virtual uint32_t GetLowPrecisionTimeStamp() { return GCToOSInterface::GetLowPrecisionTimeStamp(); }
+
+    //
+    // Events
+    //
+
+    virtual void* CreateGCEvent(bool manualReset, bool initialState, bool osEvent)
+    {
+        CLREventStatic * pEvent = new (nothrow) CLREventStatic();
+        if (pEvent == NULL)
+            return NULL;
+
+        if (osEvent)
+        {
+            if (manualReset)
+                pEvent->CreateOSManualEvent(initialState);
+            else
+                pEvent->CreateOSAutoEvent(initialState);
+        }
+        else
+        {
+            if (manualReset)
+                pEvent->CreateManualEvent(initialState);
+            else
+                pEvent->CreateAutoEvent(initialState);
+        }
+
+        if (!pEvent->IsValid())
+        {
+            delete pEvent;
+            return NULL;
+        }
+
+        return pEvent;
+    }
+
+    virtual void CloseGCEvent(void* hEvent)
+    {
+        CLREventStatic * pEvent = (CLREventStatic *)hEvent;
+        pEvent->CloseEvent();
+        delete pEvent;
+    }
+
+    virtual bool SetGCEvent(void* hEvent) { return ((CLREventStatic *)hEvent)->Set(); }
+    virtual bool ResetGCEvent(void* hEvent) { return ((CLREventStatic *)hEvent)->Reset(); }
+    virtual uint32_t WaitGCEvent(void* hEvent, uint32_t dwMilliseconds, bool bAlertable) { return ((CLREventStatic *)hEvent)->Wait(dwMilliseconds, bAlertable); }
+};
+
+static SampleGCToCLR g_sampleGCToCLR;
+static SampleGCToOS g_sampleGCToOS;
+
+//
+// Loading the library, see LoadStandaloneGC in vm/standalonegc.cpp
+//
+
+static void * GetGCExport(void * hGC, const char * name)
+{
+#ifdef _WIN32
+    return (void *)GetProcAddress((HMODULE)hGC, name);
+#else
+    return dlsym(hGC, name);
+#endif // _WIN32
+}
+
+static GCHeap * LoadStandaloneGC(const char * gcPath)
+{
+#ifdef _WIN32
+    void * hGC = LoadLibraryA(gcPath);
+#else
+    void * hGC = dlopen(gcPath, RTLD_NOW | RTLD_LOCAL);
+#endif // _WIN32
+    if (hGC == NULL)
+    {
+        printf("Could not load %s\n", gcPath);
+        return NULL;
+    }
+
+    GC_VersionInfoFunction versionInfo = (GC_VersionInfoFunction)GetGCExport(hGC, GC_VERSION_INFO_FUNCTION_NAME);
+    GC_InitializeFunction initialize = (GC_InitializeFunction)GetGCExport(hGC, GC_INITIALIZE_FUNCTION_NAME);
+    if (versionInfo == NULL || initialize == NULL)
+    {
+        printf("%s does not export the GC interface\n", gcPath);
+        return NULL;
+    }
+
+    VersionInfo info;
+    versionInfo(&info);
+    printf("Loaded %s %d.%d.%d\n", info.Name, info.MajorVersion, info.MinorVersion, info.BuildVersion);
+    if (info.MajorVersion != GC_INTERFACE_MAJOR_VERSION || info.MinorVersion < GC_INTERFACE_MINOR_VERSION)
+    {
+        printf("Expected interface version %d.%d\n", GC_INTERFACE_MAJOR_VERSION, GC_INTERFACE_MINOR_VERSION);
+        return NULL;
+    }
+
+    GCRuntimeState state;
+    state.free_object_method_table = g_pFreeObjectMethodTable;
+    state.trap_returning_threads = &g_TrapReturningThreads;
+    state.finalizer_run_on_shutdown = &g_fFinalizerRunOnShutDown;
+    state.server_gc = false;
+
+    GCHeap * pGCHeap = NULL;
+    if (FAILED(initialize(&g_sampleGCToCLR, &g_sampleGCToOS, &state, &pGCHeap)))
+    {
+        printf("GC_Initialize failed\n");
+        return NULL;
+    }
+
+    return pGCHeap;
+}
+
+int __cdecl main(int argc, char* argv[])
+{
+    if (!GCToOSInterface::Initialize())
+    {
+        return -1;
+    }
+
+    static MethodTable freeObjectMT;
+    freeObjectMT.InitializeFreeObject();
+    g_pFreeObjectMethodTable = &freeObjectMT;
+
+    if (!Ref_Initialize())
+        return -1;
+
+    //
+    // Get the GC heap from the library instead of CreateGCHeap
+    //
+    const char * gcPath = (argc > 1) ? argv[1] : CLRGC_PATH;
+
+    GCHeap *pGCHeap = LoadStandaloneGC(gcPath);
+    if (!pGCHeap)
+        return -1;
+
+    // The handle table and the write barrier here use the sample's copy.
+    g_pGCHeap = pGCHeap;
+
+    if (FAILED(pGCHeap->Initialize()))
+        return -1;
+
+    ThreadStore::AttachCurrentThread();
+
+    //
+    // The same object layout as GCSample
+    //
+
+    class My : Object {
+    public:
+        Object * m_pOther1;
+        int dummy_inbetween;
+        Object * m_pOther2;
+    };
+
+    static struct My_MethodTable
+    {
+        CGCDescSeries m_series[2];
+        size_t m_numSeries;
+
+        MethodTable m_MT;
+    }
+    My_MethodTable;
+
+    uint32_t baseSize = sizeof(My);
+    baseSize = baseSize + sizeof(ObjHeader);
+    My_MethodTable.m_MT.m_baseSize = max(baseSize, MIN_OBJECT_SIZE);
+
+    My_MethodTable.m_MT.m_componentSize = 0;
+    My_MethodTable.m_MT.m_flags = MTFlag_ContainsPointers;
+
+    My_MethodTable.m_numSeries = 2;
+
+    My_MethodTable.m_series[0].SetSeriesOffset(offsetof(My, m_pOther2));
+    My_MethodTable.m_series[0].SetSeriesCount(1);
+    My_MethodTable.m_series[0].seriessize -= My_MethodTable.m_MT.m_baseSize;
+
+    My_MethodTable.m_series[1].SetSeriesOffset(offsetof(My, m_pOther1));
+    My_MethodTable.m_series[1].SetSeriesCount(1);
+    My_MethodTable.m_series[1].seriessize -= My_MethodTable.m_MT.m_baseSize;
+
+    MethodTable * pMyMethodTable = &My_MethodTable.m_MT;
+
+    Object * pObj = AllocateObject(pMyMethodTable);
+    if (pObj == NULL)
+        return -1;
+
+    OBJECTHANDLE oh = CreateGlobalHandle(pObj);
+    if (oh == NULL)
+        return -1;
+
+    // Enough allocations for the library to run a number of GCs on its own.
+    for (int i = 0; i < 1000000; i++)
+    {
+        Object * p = AllocateObject(pMyMethodTable);
+        if (p == NULL)
+            return -1;
+
+        WriteBarrier(&(((My *)ObjectFromHandle(oh))->m_pOther1), p);
+    }
+
+    if (pGCHeap->CollectionCount(0) == 0)
+    {
+        printf("The library did not collect while allocating\n");
+        return -1;
+    }
+
+    OBJECTHANDLE ohWeak = CreateGlobalWeakHandle(ObjectFromHandle(oh));
+    if (ohWeak == NULL)
+        return -1;
+
+    DestroyGlobalHandle(oh);
+
+    pGCHeap->GarbageCollect();
+
+    if (ObjectFromHandle(ohWeak) != NULL)
+    {
+        printf("The weak handle was not cleared by the library's GC\n");
+        return -1;
+    }
+
+    printf("Done\n");
+
+    return 0;
+}
@@ -4,95 +4,17 @@
 
 #include "common.h"
 
-#include "windows.h"
-
 #include "gcenv.h"
 #include "gc.h"
 
 EEConfig * g_pConfig;
 
-void CLREventStatic::CreateManualEvent(bool bInitialState)
-{
-    m_hEvent = CreateEventW(NULL, TRUE, bInitialState, NULL);
-    m_fInitialized = true;
-}
-
-void CLREventStatic::CreateAutoEvent(bool bInitialState)
-{
-    m_hEvent = CreateEventW(NULL, FALSE, bInitialState, NULL);
-    m_fInitialized = true;
-}
-
-void CLREventStatic::CreateOSManualEvent(bool bInitialState)
-{
-    m_hEvent = CreateEventW(NULL, TRUE, bInitialState, NULL);
-    m_fInitialized = true;
-}
-
-void CLREventStatic::CreateOSAutoEvent(bool bInitialState)
-{
-    m_hEvent = CreateEventW(NULL, FALSE, bInitialState, NULL);
-    m_fInitialized = true;
-}
-
-void CLREventStatic::CloseEvent()
-{
-    if (m_fInitialized && m_hEvent != INVALID_HANDLE_VALUE)
-    {
-        CloseHandle(m_hEvent);
-        m_hEvent = INVALID_HANDLE_VALUE;
-    }
-}
-
-bool CLREventStatic::IsValid() const
-{
-    return m_fInitialized && m_hEvent != INVALID_HANDLE_VALUE;
-}
-
-bool CLREventStatic::Set()
-{
-    if (!m_fInitialized)
-        return false;
-    return !!SetEvent(m_hEvent);
-}
-
-bool CLREventStatic::Reset()
-{
-    if (!m_fInitialized)
-        return false;
-    return !!ResetEvent(m_hEvent);
-}
-
-uint32_t CLREventStatic::Wait(uint32_t dwMilliseconds, bool bAlertable)
-{
-    DWORD result = WAIT_FAILED;
-
-    if (m_fInitialized)
-    {
-        bool        disablePreemptive = false;
-        Thread *    pCurThread = GetThread();
-
-        if (NULL != pCurThread)
-        {
-            if (GCToEEInterface::IsPreemptiveGCDisabled(pCurThread))
-            {
-                GCToEEInterface::EnablePreemptiveGC(pCurThread);
-                disablePreemptive = true;
-            }
-        }
-
-        result = WaitForSingleObjectEx(m_hEvent, dwMilliseconds, bAlertable);
-
-        if (disablePreemptive)
-        {
-            GCToEEInterface::DisablePreemptiveGC(pCurThread);
-        }
-    }
-
-    return result;
-}
-
-__declspec(thread) Thread * pCurrentThread;
+#ifdef _MSC_VER
+__declspec(thread)
+#else
+__thread
+#endif
+Thread * pCurrentThread;
 
 Thread * GetThread()
 {
@@ -121,8 +43,15 @@ void ThreadStore::AttachCurrentThread()
     g_pThreadList = pThread;
 }
 
+GCPauseCallback g_pGCPauseCallback = NULL;
+
+// Time stamp of the last SuspendEE, used to report the pause to g_pGCPauseCallback
+static int64_t g_suspendTimestamp;
+
 void GCToEEInterface::SuspendEE(GCToEEInterface::SUSPEND_REASON reason)
 {
+    g_suspendTimestamp = GCToOSInterface::QueryPerformanceCounter();
+
     GCHeap::GetGCHeap()->SetGCInProgress(TRUE);
 
     // TODO: Implement
@@ -133,6 +62,11 @@ void GCToEEInterface::RestartEE(bool bFinishedGC)
     // TODO: Implement
 
     GCHeap::GetGCHeap()->SetGCInProgress(FALSE);
+
+    if (g_pGCPauseCallback != NULL)
+    {
+        g_pGCPauseCallback(GCToOSInterface::QueryPerformanceCounter() - g_suspendTimestamp);
+    }
 }
 
 void GCToEEInterface::GcScanRoots(promote_func* fn,  int condemned, int max_gen, ScanContext* sc)
@@ -191,6 +125,11 @@ bool GCToEEInterface::CatchAtSafePoint(Thread * pThread)
     return pThread->CatchAtSafePoint();
 }
 
+bool GCToEEInterface::IsGCThread()
+{
+    return IsGCSpecialThread();
+}
+
 // does not acquire thread store lock
 void GCToEEInterface::AttachCurrentThread()
 {
@@ -249,6 +188,16 @@ void StompWriteBarrierResize(bool /*bReqUpperBoundsCheck*/)
 {
 }
 
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+void SwitchToWriteWatchBarrier(bool /*isRuntimeSuspended*/)
+{
+}
+
+void SwitchToNonWriteWatchBarrier(bool /*isRuntimeSuspended*/)
+{
+}
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
 void LogSpewAlways(const char * /*fmt*/, ...)
 {
 }
@@ -263,9 +212,21 @@ uint32_t CLRConfig::GetConfigValue(ConfigDWORDInfo eType)
     case UNSUPPORTED_BGCSpin:
         return 2;
 
+    case UNSUPPORTED_GCAdaptiveAllocQuantum:
+        return 0;
+
     case UNSUPPORTED_GCLogEnabled:
     case UNSUPPORTED_GCLogFile:
     case UNSUPPORTED_GCLogFileSize:
+    case UNSUPPORTED_GCDynamicHeapCount:
+    case UNSUPPORTED_GCLargePages:
+    case UNSUPPORTED_GCSegmentPromotion:
+    case UNSUPPORTED_GCGen0Adaptive:
+    case UNSUPPORTED_GCTargetPauseMs:
+    case UNSUPPORTED_GCLOHCompactBudget:
+    case UNSUPPORTED_GCMarkPrefetchDepth:
+    case UNSUPPORTED_GCHeapSnapshotInterval:
+    case UNSUPPORTED_GCDecommitTimeWindow:
     case EXTERNAL_GCStressStart:
     case INTERNAL_GCStressStartAtJit:
     case INTERNAL_DbgDACSkipVerifyDlls:
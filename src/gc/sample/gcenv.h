@@ -87,6 +87,12 @@ public:
     static void AttachCurrentThread();
 };
 
+// Called by RestartEE with the length of the pause that just ended, in units of
+// GCToOSInterface::QueryPerformanceCounter. Lets a host such as GCBench measure
+// GC pause times.
+typedef void (*GCPauseCallback)(int64_t pauseTicks);
+extern GCPauseCallback g_pGCPauseCallback;
+
 // -----------------------------------------------------------------------------------------------------------
 // Config file enumulation
 //
@@ -132,6 +138,7 @@ public:
     bool    IsGCBreakOnOOMEnabled()         const { return false; }
     int     GetGCgen0size()               const { return 0; }
     int     GetSegmentSize()               const { return 0; }
+    size_t  GetGCHeapHardLimit()           const { return 0; }
     int     GetGCconcurrent()               const { return 1; }
     int     GetGCLatencyMode()              const { return 1; }
     int     GetGCForceCompact()             const { return 0; }
@@ -11,452 +11,665 @@
 #include "gcenv.h"
 #include "gc.h"
 
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
 #include <sys/mman.h>
-#include <sys/time.h>
 
-int32_t FastInterlockIncrement(int32_t volatile *lpAddend)
+MethodTable * g_pFreeObjectMethodTable;
+
+int32_t g_TrapReturningThreads;
+
+bool g_fFinalizerRunOnShutDown;
+
+GCSystemInfo g_SystemInfo;
+
+// Initialize the interface implementation
+// Return:
+//  true if it has succeeded, false if it has failed
+bool GCToOSInterface::Initialize()
 {
-    return __sync_add_and_fetch(lpAddend, 1);
+    long numberOfProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (numberOfProcessors <= 0 || pageSize <= 0)
+    {
+        return false;
+    }
+
+    g_SystemInfo.dwNumberOfProcessors = (uint32_t)numberOfProcessors;
+    g_SystemInfo.dwPageSize = (uint32_t)pageSize;
+    g_SystemInfo.dwAllocationGranularity = (uint32_t)pageSize;
+
+    return true;
 }
 
-int32_t FastInterlockDecrement(int32_t volatile *lpAddend)
+// Shutdown the interface implementation
+void GCToOSInterface::Shutdown()
 {
-    return __sync_sub_and_fetch(lpAddend, 1);
 }
 
-int32_t FastInterlockExchange(int32_t volatile *Target, int32_t Value)
+// Get numeric id of the current thread if possible on the
+// current platform. It is indended for logging purposes only.
+// Return:
+//  Numeric id of the current thread or 0 if the
+uint32_t GCToOSInterface::GetCurrentThreadIdForLogging()
 {
-    return __sync_swap(Target, Value);
+    return (uint32_t)(size_t)pthread_self();
 }
 
-int32_t FastInterlockCompareExchange(int32_t volatile *Destination, int32_t Exchange, int32_t Comperand)
+// Get id of the process
+// Return:
+//  Id of the current process
+uint32_t GCToOSInterface::GetCurrentProcessId()
 {
-    return __sync_val_compare_and_swap(Destination, Comperand, Exchange);
+    return (uint32_t)getpid();
 }
 
-int32_t FastInterlockExchangeAdd(int32_t volatile *Addend, int32_t Value)
+// Set ideal affinity for the current thread
+// Parameters:
+//  affinity - ideal processor affinity for the thread
+// Return:
+//  true if it has succeeded, false if it has failed
+bool GCToOSInterface::SetCurrentThreadIdealAffinity(GCThreadAffinity* affinity)
 {
-    return __sync_fetch_and_add(Addend, Value);
+    // There is no notion of an ideal processor on Unix.
+    return false;
 }
 
-void * _FastInterlockExchangePointer(void * volatile *Target, void * Value)
+// Get the number of the current processor
+uint32_t GCToOSInterface::GetCurrentProcessorNumber()
 {
-    return __sync_swap(Target, Value);
+    _ASSERTE(GCToOSInterface::CanGetCurrentProcessorNumber());
+#ifdef __linux__
+    int processorNumber = sched_getcpu();
+    _ASSERTE(processorNumber >= 0);
+    return (uint32_t)processorNumber;
+#else
+    return 0;
+#endif
 }
 
-void * _FastInterlockCompareExchangePointer(void * volatile *Destination, void * Exchange, void * Comperand)
+// Check if the OS supports getting current processor number
+bool GCToOSInterface::CanGetCurrentProcessorNumber()
 {
-    return __sync_val_compare_and_swap(Destination, Comperand, Exchange);
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
 }
 
-void FastInterlockOr(uint32_t volatile *p, uint32_t msk)
+// Flush write buffers of processors that are executing threads of the current process
+void GCToOSInterface::FlushProcessWriteBuffers()
 {
-    __sync_fetch_and_or(p, msk);
+    // The sample runs the GC on the thread that allocates, a full barrier on this
+    // thread is enough.
+    __sync_synchronize();
 }
 
-void FastInterlockAnd(uint32_t volatile *p, uint32_t msk)
+// Break into a debugger
+void GCToOSInterface::DebugBreak()
 {
-    __sync_fetch_and_and(p, msk);
+    raise(SIGTRAP);
 }
 
-
-void UnsafeInitializeCriticalSection(CRITICAL_SECTION * lpCriticalSection)
+// Get number of logical processors
+uint32_t GCToOSInterface::GetLogicalCpuCount()
 {
-    pthread_mutex_init(&lpCriticalSection->mutex, NULL);
+    return g_SystemInfo.dwNumberOfProcessors;
 }
 
-void UnsafeEEEnterCriticalSection(CRITICAL_SECTION *lpCriticalSection)
+// Causes the calling thread to sleep for the specified number of milliseconds
+// Parameters:
+//  sleepMSec   - time to sleep before switching to another thread
+void GCToOSInterface::Sleep(uint32_t sleepMSec)
 {
-    pthread_mutex_lock(&lpCriticalSection->mutex);
+    struct timespec requested;
+    requested.tv_sec = sleepMSec / 1000;
+    requested.tv_nsec = (sleepMSec % 1000) * 1000000;
+
+    struct timespec remaining;
+    while (nanosleep(&requested, &remaining) == -1 && errno == EINTR)
+    {
+        requested = remaining;
+    }
 }
 
-void UnsafeEELeaveCriticalSection(CRITICAL_SECTION * lpCriticalSection)
+// Causes the calling thread to yield execution to another thread that is ready to run on the current processor.
+// Parameters:
+//  switchCount - number of times the YieldThread was called in a loop
+void GCToOSInterface::YieldThread(uint32_t switchCount)
 {
-    pthread_mutex_unlock(&lpCriticalSection->mutex);
+    sched_yield();
 }
 
-void UnsafeDeleteCriticalSection(CRITICAL_SECTION *lpCriticalSection)
+// Reserve virtual memory range.
+// Parameters:
+//  address   - starting virtual address, it can be NULL to let the function choose the starting address
+//  size      - size of the virtual memory range
+//  alignment - requested memory alignment
+//  flags     - flags to control special settings like write watching
+// Return:
+//  Starting virtual address of the reserved range
+void* GCToOSInterface::VirtualReserve(void* address, size_t size, size_t alignment, uint32_t flags)
 {
-    pthread_mutex_destroy(&lpCriticalSection->mutex);
+    // Write watch is not supported, see SupportsWriteWatch.
+    if (alignment == 0)
+    {
+        alignment = OS_PAGE_SIZE;
+    }
+
+    // Reserve extra space so the range can be aligned, then give back the ends.
+    size_t alignedSize = size + (alignment - OS_PAGE_SIZE);
+    void* pRetVal = mmap(address, alignedSize, PROT_NONE, MAP_ANON | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+    if (pRetVal == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    void* pAlignedRetVal = (void*)(((size_t)pRetVal + (alignment - 1)) & ~(alignment - 1));
+    size_t startPadding = (size_t)pAlignedRetVal - (size_t)pRetVal;
+    if (startPadding != 0)
+    {
+        munmap(pRetVal, startPadding);
+    }
+
+    size_t endPadding = alignedSize - (startPadding + size);
+    if (endPadding != 0)
+    {
+        munmap((void*)((size_t)pAlignedRetVal + size), endPadding);
+    }
+
+    return pAlignedRetVal;
 }
 
-#if 0
-void CLREventStatic::CreateManualEvent(bool bInitialState)
+// Get the size of the large pages VirtualReserve can back memory with.
+// Return:
+//  The large page size, or 0 if large pages are not supported
+size_t GCToOSInterface::GetLargePageSize()
 {
-    // TODO: Implement
-    m_fInitialized = true;
+    return 0;
 }
 
-void CLREventStatic::CreateAutoEvent(bool bInitialState)
+// Release virtual memory range previously reserved using VirtualReserve
+// Parameters:
+//  address - starting virtual address
+//  size    - size of the virtual memory range
+// Return:
+//  true if it has succeeded, false if it has failed
+bool GCToOSInterface::VirtualRelease(void* address, size_t size)
 {
-    // TODO: Implement
-    m_fInitialized = true;
+    return munmap(address, size) == 0;
 }
 
-void CLREventStatic::CreateOSManualEvent(bool bInitialState)
+// Commit virtual memory range. It must be part of a range reserved using VirtualReserve.
+// Parameters:
+//  address - starting virtual address
+//  size    - size of the virtual memory range
+// Return:
+//  true if it has succeeded, false if it has failed
+bool GCToOSInterface::VirtualCommit(void* address, size_t size)
 {
-    CreateManualEvent(bInitialState);
+    return mprotect(address, size, PROT_READ | PROT_WRITE) == 0;
 }
 
-void CLREventStatic::CreateOSAutoEvent (bool bInitialState)
+// Decomit virtual memory range.
+// Parameters:
+//  address - starting virtual address
+//  size    - size of the virtual memory range
+// Return:
+//  true if it has succeeded, false if it has failed
+bool GCToOSInterface::VirtualDecommit(void* address, size_t size)
 {
-    CreateAutoEvent(bInitialState);
+    // Mapping the range again drops its pages and leaves it reserved.
+    void* pRetVal = mmap(address, size, PROT_NONE, MAP_FIXED | MAP_ANON | MAP_PRIVATE | MAP_NORESERVE, -1, 0);
+    return pRetVal != MAP_FAILED;
 }
 
-void CLREventStatic::CloseEvent()
+// Reset virtual memory range. Indicates that data in the memory range specified by address and size is no
+// longer of interest, but it should not be decommitted.
+// Parameters:
+//  address - starting virtual address
+//  size    - size of the virtual memory range
+//  unlock  - true if the memory range should also be unlocked
+// Return:
+//  true if it has succeeded, false if it has failed
+bool GCToOSInterface::VirtualReset(void * address, size_t size, bool unlock)
 {
-    if (m_fInitialized)
-    {
-        // TODO: Implement
-        m_fInitialized = false;
-    }
+#ifdef MADV_FREE
+    int st = madvise(address, size, MADV_FREE);
+#else
+    int st = madvise(address, size, MADV_DONTNEED);
+#endif
+    return st == 0;
 }
 
-bool CLREventStatic::IsValid() const
+// Check if the OS supports write watching
+bool GCToOSInterface::SupportsWriteWatch()
 {
-    return m_fInitialized; 
+    return false;
 }
 
-bool CLREventStatic::Set()
+// Reset the write tracking state for the specified virtual memory range.
+// Parameters:
+//  address - starting virtual address
+//  size    - size of the virtual memory range
+void GCToOSInterface::ResetWriteWatch(void* address, size_t size)
 {
-    if (!m_fInitialized)
-        return false;
-    // TODO: Implement
-    return true; 
 }
 
-bool CLREventStatic::Reset()
+// Retrieve addresses of the pages that are written to in a region of virtual memory
+// Parameters:
+//  resetState         - true indicates to reset the write tracking state
+//  address            - starting virtual address
+//  size               - size of the virtual memory range
+//  pageAddresses      - buffer that receives an array of page addresses in the memory region
+//  pageAddressesCount - on input, size of the lpAddresses array, in array elements
+//                       on output, the number of page addresses that are returned in the array.
+// Return:
+//  true if it has succeeded, false if it has failed
+bool GCToOSInterface::GetWriteWatch(bool resetState, void* address, size_t size, void** pageAddresses, uintptr_t* pageAddressesCount)
 {
-    if (!m_fInitialized)
-        return false;
-    // TODO: Implement
-    return true;
+    return false;
 }
 
-uint32_t CLREventStatic::Wait(uint32_t dwMilliseconds, bool bAlertable)
+// Get size of the largest cache on the processor die
+// Parameters:
+//  trueSize - true to return true cache size, false to return scaled up size based on
+//             the processor architecture
+// Return:
+//  Size of the cache
+size_t GCToOSInterface::GetLargestOnDieCacheSize(bool trueSize)
 {
-    DWORD result = WAIT_FAILED;
+    long cacheSize = 0;
 
-    if (m_fInitialized)
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    cacheSize = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    if (cacheSize <= 0)
     {
-        bool        disablePreemptive = false;
-        Thread *    pCurThread  = GetThread();
-
-        if (NULL != pCurThread)
-        {
-            if (pCurThread->PreemptiveGCDisabled())
-            {
-                pCurThread->EnablePreemptiveGC();
-                disablePreemptive = true;
-            }
-        }
-
-        // TODO: Implement
-        result = WAIT_OBJECT_0;
-
-        if (disablePreemptive)
-        {
-            pCurThread->DisablePreemptiveGC();
-        }
+        cacheSize = sysconf(_SC_LEVEL2_CACHE_SIZE);
     }
+#endif
 
-    return result;
+    return (cacheSize > 0) ? (size_t)cacheSize : 0;
 }
-#endif // 0
 
-void DestroyThread(Thread * pThread)
+// Get affinity mask of the current process
+// Parameters:
+//  processMask - affinity mask for the specified process
+//  systemMask  - affinity mask for the system
+// Return:
+//  true if it has succeeded, false if it has failed
+// Remarks:
+//  A process affinity mask is a bit vector in which each bit represents the processors that
+//  a process is allowed to run on. A system affinity mask is a bit vector in which each bit
+//  represents the processors that are configured into a system.
+//  A process affinity mask is a subset of the system affinity mask. A process is only allowed
+//  to run on the processors configured into a system. Therefore, the process affinity mask cannot
+//  specify a 1 bit for a processor when the system affinity mask specifies a 0 bit for that processor.
+bool GCToOSInterface::GetCurrentProcessAffinityMask(uintptr_t* processMask, uintptr_t* systemMask)
 {
-    // TODO: implement
+    return false;
 }
 
-bool __SwitchToThread(uint32_t dwSleepMSec, uint32_t dwSwitchCount)
+// Get number of processors assigned to the current process
+// Return:
+//  The number of processors
+uint32_t GCToOSInterface::GetCurrentProcessCpuCount()
 {
-    return sched_yield() == 0;
+    return g_SystemInfo.dwNumberOfProcessors;
 }
 
-static int W32toUnixAccessControl(uint32_t flProtect)
+// If the process's memory is restricted (ie, beyond what's available on the machine), return that limit.
+// Return:
+//  non zero if it has succeeded, 0 if it has failed
+// Remarks:
+//  If a process runs with a restricted memory limit, and we are successful at getting
+//  that limit, it returns the limit. If there's no limit specified, or there's an error
+//  at getting that limit, it returns 0.
+uint64_t GCToOSInterface::GetRestrictedPhysicalMemoryLimit()
 {
-    int prot = 0;
+    return 0;
+}
 
-    switch (flProtect & 0xff)
+// Get the current physical memory this process is using.
+// Return:
+//  non zero if it has succeeded, 0 if it has failed
+size_t GCToOSInterface::GetCurrentPhysicalMemory()
+{
+#ifdef __linux__
+    // The second field of statm is the resident set size in pages.
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm != NULL)
     {
-    case PAGE_NOACCESS:
-        prot = PROT_NONE;
-        break;
-    case PAGE_READWRITE:
-        prot = PROT_READ | PROT_WRITE;
-        break;
-    default:
-        _ASSERTE(false);
-        break;
-    }
-    return prot;
-}
+        unsigned long long totalPages = 0;
+        unsigned long long residentPages = 0;
+        int fields = fscanf(statm, "%llu %llu", &totalPages, &residentPages);
+        fclose(statm);
 
-MethodTable * g_pFreeObjectMethodTable;
+        if (fields == 2)
+        {
+            return (size_t)(residentPages * g_SystemInfo.dwPageSize);
+        }
+    }
+#endif // __linux__
 
-GCSystemInfo g_SystemInfo;
+    return 0;
+}
 
-void InitializeSystemInfo()
+// Get global memory status
+// Parameters:
+//  ms - pointer to the structure that will be filled in with the memory status
+void GCToOSInterface::GetMemoryStatus(GCMemoryStatus* ms)
 {
-    // TODO: Implement
-    g_SystemInfo.dwNumberOfProcessors = 4;
+    uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t totalPhys = (uint64_t)sysconf(_SC_PHYS_PAGES) * pageSize;
+    uint64_t availPhys = 0;
+#ifdef _SC_AVPHYS_PAGES
+    availPhys = (uint64_t)sysconf(_SC_AVPHYS_PAGES) * pageSize;
+#endif
 
-    g_SystemInfo.dwPageSize = OS_PAGE_SIZE;
-    g_SystemInfo.dwAllocationGranularity = OS_PAGE_SIZE;
+    ms->dwMemoryLoad = (totalPhys != 0) ? (uint32_t)(((totalPhys - availPhys) * 100) / totalPhys) : 0;
+    ms->ullTotalPhys = totalPhys;
+    ms->ullAvailPhys = availPhys;
+    ms->ullTotalPageFile = 0;
+    ms->ullAvailPageFile = 0;
+    // The user mode address space available to the process.
+    ms->ullTotalVirtual = (sizeof(void*) == 8) ? ((uint64_t)1 << 47) : ((uint64_t)1 << 31);
+    ms->ullAvailVirtual = ms->ullTotalVirtual;
 }
 
-int32_t g_TrapReturningThreads;
-
-bool g_fFinalizerRunOnShutDown;
+// Get a high precision performance counter
+// Return:
+//  The counter value
+int64_t GCToOSInterface::QueryPerformanceCounter()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+    {
+        _ASSERTE(!"Fatal Error - cannot query performance counter.");
+        abort();
+    }
 
-#if 0
-#ifdef _MSC_VER
-__declspec(thread)
-#else
-__thread
-#endif
-Thread * pCurrentThread;
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
 
-Thread * GetThread()
+// Get a frequency of the high precision performance counter
+// Return:
+//  The counter frequency
+int64_t GCToOSInterface::QueryPerformanceFrequency()
 {
-    return pCurrentThread;
+    // QueryPerformanceCounter returns nanoseconds.
+    return 1000000000;
 }
 
-Thread * g_pThreadList = NULL;
-
-Thread * ThreadStore::GetThreadList(Thread * pThread)
+// Get a time stamp with a low precision
+// Return:
+//  Time stamp in milliseconds
+uint32_t GCToOSInterface::GetLowPrecisionTimeStamp()
 {
-    if (pThread == NULL)
-        return g_pThreadList;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-    return pThread->m_pNext;
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
 }
 
-void ThreadStore::AttachCurrentThread(bool fAcquireThreadStoreLock)
+// Parameters of the GC thread stub
+struct GCThreadStubParam
 {
-    // TODO: Locks
-
-    Thread * pThread = new Thread();
-    pThread->GetAllocContext()->init();
-    pCurrentThread = pThread;
+    GCThreadFunction Function;
+    void* GCThreadParam;
+};
 
-    pThread->m_pNext = g_pThreadList;
-    g_pThreadList = pThread;
-}
-#endif // 0
-void DestroyThread(Thread * pThread)
+// GC thread stub to convert GC thread function to an OS specific thread function
+static void* GCThreadStub(void* param)
 {
-    // TODO: Implement
-}
+    GCThreadStubParam *stubParam = (GCThreadStubParam*)param;
+    GCThreadFunction function = stubParam->Function;
+    void* threadParam = stubParam->GCThreadParam;
 
-#if 0 
-void GCToEEInterface::SuspendEE(GCToEEInterface::SUSPEND_REASON reason)
-{
-    GCHeap::GetGCHeap()->SetGCInProgress(TRUE);
+    delete stubParam;
 
-    // TODO: Implement
+    function(threadParam);
+
+    return NULL;
 }
 
-void GCToEEInterface::RestartEE(bool bFinishedGC)
+// Create a new thread
+// Parameters:
+//  function - the function to be executed by the thread
+//  param    - parameters of the thread
+//  affinity - processor affinity of the thread
+// Return:
+//  true if it has succeeded, false if it has failed
+bool GCToOSInterface::CreateThread(GCThreadFunction function, void* param, GCThreadAffinity* affinity)
 {
-    // TODO: Implement
+    GCThreadStubParam* stubParam = new (nothrow) GCThreadStubParam();
+    if (stubParam == NULL)
+    {
+        return false;
+    }
 
-    GCHeap::GetGCHeap()->SetGCInProgress(FALSE);
-}
+    stubParam->Function = function;
+    stubParam->GCThreadParam = param;
 
-void GCToEEInterface::GcScanRoots(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
-{
-    // TODO: Implement - Scan stack roots
-}
+    pthread_attr_t attrs;
+    pthread_attr_init(&attrs);
+    pthread_attr_setdetachstate(&attrs, PTHREAD_CREATE_DETACHED);
 
-void GCToEEInterface::GcStartWork(int condemned, int max_gen)
-{
-}
+    pthread_t gc_thread;
+    int st = pthread_create(&gc_thread, &attrs, GCThreadStub, stubParam);
 
-void GCToEEInterface::AfterGcScanRoots(int condemned, int max_gen, ScanContext* sc)
-{
+    pthread_attr_destroy(&attrs);
+
+    if (st != 0)
+    {
+        delete stubParam;
+        return false;
+    }
+
+    return true;
 }
 
-void GCToEEInterface::GcBeforeBGCSweepWork()
+// Initialize the critical section
+void CLRCriticalSection::Initialize()
 {
+    pthread_mutexattr_t mutexAttributes;
+    pthread_mutexattr_init(&mutexAttributes);
+    // Critical sections are recursive.
+    pthread_mutexattr_settype(&mutexAttributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&m_cs.mutex, &mutexAttributes);
+    pthread_mutexattr_destroy(&mutexAttributes);
 }
 
-void GCToEEInterface::GcDone(int condemned)
+// Destroy the critical section
+void CLRCriticalSection::Destroy()
 {
+    pthread_mutex_destroy(&m_cs.mutex);
 }
 
-void FinalizerThread::EnableFinalization()
+// Enter the critical section. Blocks until the section can be entered.
+void CLRCriticalSection::Enter()
 {
-    // Signal to finalizer thread that there are objects to finalize
-    // TODO: Implement for finalization
+    pthread_mutex_lock(&m_cs.mutex);
 }
 
-bool PalStartBackgroundGCThread(BackgroundCallback callback, void* pCallbackContext)
+// Leave the critical section
+void CLRCriticalSection::Leave()
 {
-    // TODO: Implement for background GC
-    return false;
+    pthread_mutex_unlock(&m_cs.mutex);
 }
 
-bool IsGCSpecialThread()
+//
+// Events
+//
+
+// The state behind the event handle, a manual or auto reset event built on a
+// mutex and a condition variable.
+struct UnixEvent
 {
-    // TODO: Implement for background GC
-    return false;
-}
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_condition;
+    bool m_manualReset;
+    bool m_state;
+};
 
-#endif // 0
-
-WINBASEAPI
-UINT
-WINAPI
-GetWriteWatch(
-    DWORD dwFlags,
-    PVOID lpBaseAddress,
-    SIZE_T dwRegionSize,
-    PVOID *lpAddresses,
-    uintptr_t * lpdwCount,
-    uint32_t * lpdwGranularity
-    )
-{
-    // TODO: Implement for background GC
-    *lpAddresses = NULL;
-    *lpdwCount = 0;
-    // Until it is implemented, return non-zero value as an indicator of failure
-    return 1;
-}
-
-WINBASEAPI
-UINT
-WINAPI
-ResetWriteWatch(
-    LPVOID lpBaseAddress,
-    SIZE_T dwRegionSize
-    )
-{
-    // TODO: Implement for background GC
-    // Until it is implemented, return non-zero value as an indicator of failure
-    return 1;
-}
-
-const int tccSecondsToMillieSeconds = 1000;
-const int tccSecondsToMicroSeconds = 1000000;
-const int tccMillieSecondsToMicroSeconds = 1000;       // 10^3
-
-WINBASEAPI
-DWORD
-WINAPI
-GetTickCount()
-{
-    // TODO: More efficient, platform-specific implementation
-    struct timeval tv;
-    if (gettimeofday(&tv, NULL) == -1)
-    {
-        _ASSERTE(!"gettimeofday() failed");
-        return 0;
-    }
-    return (tv.tv_sec * tccSecondsToMillieSeconds) + (tv.tv_usec / tccMillieSecondsToMicroSeconds);
-}
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
 
-WINBASEAPI
-BOOL
-WINAPI
-QueryPerformanceCounter(LARGE_INTEGER *lpPerformanceCount)
+static HANDLE CreateUnixEvent(bool manualReset, bool initialState)
 {
-    // TODO: More efficient, platform-specific implementation
-    struct timeval tv;
-    if (gettimeofday(&tv, NULL) == -1)
+    UnixEvent* pEvent = new (nothrow) UnixEvent();
+    if (pEvent == NULL)
     {
-        _ASSERTE(!"gettimeofday() failed");
-        return FALSE;
+        return INVALID_HANDLE_VALUE;
     }
-    lpPerformanceCount->QuadPart =
-        (int64_t) tv.tv_sec * (int64_t) tccSecondsToMicroSeconds + (int64_t) tv.tv_usec;
-    return TRUE;
+
+    pthread_mutex_init(&pEvent->m_mutex, NULL);
+    pthread_cond_init(&pEvent->m_condition, NULL);
+    pEvent->m_manualReset = manualReset;
+    pEvent->m_state = initialState;
+
+    return (HANDLE)pEvent;
 }
 
-WINBASEAPI
-BOOL
-WINAPI
-QueryPerformanceFrequency(LARGE_INTEGER *lpFrequency)
+void CLREventStatic::CreateManualEvent(bool bInitialState)
 {
-    lpFrequency->QuadPart = (int64_t) tccSecondsToMicroSeconds;
-    return TRUE;
+    m_hEvent = CreateUnixEvent(true, bInitialState);
+    m_fInitialized = true;
 }
 
-WINBASEAPI
-DWORD
-WINAPI
-GetCurrentThreadId(
-    void)
+void CLREventStatic::CreateAutoEvent(bool bInitialState)
 {
-    // TODO: Implement
-    return 1;
+    m_hEvent = CreateUnixEvent(false, bInitialState);
+    m_fInitialized = true;
 }
 
-WINBASEAPI
-void
-WINAPI
-YieldProcessor()
+void CLREventStatic::CreateOSManualEvent(bool bInitialState)
 {
-    // TODO: Implement
+    CreateManualEvent(bInitialState);
 }
 
-WINBASEAPI
-void
-WINAPI
-DebugBreak()
+void CLREventStatic::CreateOSAutoEvent(bool bInitialState)
 {
-    // TODO: Implement
+    CreateAutoEvent(bInitialState);
 }
 
-WINBASEAPI
-void
-WINAPI
-MemoryBarrier()
+void CLREventStatic::CloseEvent()
 {
-    // TODO: Implement
+    if (m_fInitialized && m_hEvent != INVALID_HANDLE_VALUE)
+    {
+        UnixEvent* pEvent = (UnixEvent*)m_hEvent;
+        pthread_cond_destroy(&pEvent->m_condition);
+        pthread_mutex_destroy(&pEvent->m_mutex);
+        delete pEvent;
+        m_hEvent = INVALID_HANDLE_VALUE;
+    }
 }
 
-// File I/O - Used for tracking only
+bool CLREventStatic::IsValid() const
+{
+    return m_fInitialized && m_hEvent != INVALID_HANDLE_VALUE;
+}
 
-WINBASEAPI
-BOOL
-WINAPI
-FlushFileBuffers(
-    HANDLE hFile)
+bool CLREventStatic::Set()
 {
-    // TODO: Reimplement callers using CRT
-    return FALSE;
+    if (!IsValid())
+        return false;
+
+    UnixEvent* pEvent = (UnixEvent*)m_hEvent;
+    pthread_mutex_lock(&pEvent->m_mutex);
+    pEvent->m_state = true;
+    if (pEvent->m_manualReset)
+        pthread_cond_broadcast(&pEvent->m_condition);
+    else
+        pthread_cond_signal(&pEvent->m_condition);
+    pthread_mutex_unlock(&pEvent->m_mutex);
+
+    return true;
 }
 
-WINBASEAPI
-BOOL
-WINAPI
-WriteFile(
-    HANDLE hFile,
-    LPCVOID lpBuffer,
-    DWORD nNumberOfBytesToWrite,
-    DWORD * lpNumberOfBytesWritten,
-    PVOID lpOverlapped)
+bool CLREventStatic::Reset()
 {
-    // TODO: Reimplement callers using CRT
-    return FALSE;
+    if (!IsValid())
+        return false;
+
+    UnixEvent* pEvent = (UnixEvent*)m_hEvent;
+    pthread_mutex_lock(&pEvent->m_mutex);
+    pEvent->m_state = false;
+    pthread_mutex_unlock(&pEvent->m_mutex);
+
+    return true;
 }
 
-WINBASEAPI
-BOOL
-WINAPI
-CloseHandle(
-    HANDLE hObject)
+uint32_t CLREventStatic::Wait(uint32_t dwMilliseconds, bool bAlertable)
 {
-    // TODO: Reimplement callers using CRT
-    return FALSE;
+    uint32_t result = WAIT_FAILED;
+
+    if (IsValid())
+    {
+        bool        disablePreemptive = false;
+        Thread *    pCurThread = GetThread();
+
+        if (NULL != pCurThread)
+        {
+            if (GCToEEInterface::IsPreemptiveGCDisabled(pCurThread))
+            {
+                GCToEEInterface::EnablePreemptiveGC(pCurThread);
+                disablePreemptive = true;
+            }
+        }
+
+        UnixEvent* pEvent = (UnixEvent*)m_hEvent;
+
+        struct timespec deadline;
+        if (dwMilliseconds != INFINITE)
+        {
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            uint64_t nanoseconds = (uint64_t)deadline.tv_nsec + (uint64_t)(dwMilliseconds % 1000) * 1000000;
+            deadline.tv_sec += dwMilliseconds / 1000 + (time_t)(nanoseconds / 1000000000);
+            deadline.tv_nsec = (long)(nanoseconds % 1000000000);
+        }
+
+        pthread_mutex_lock(&pEvent->m_mutex);
+
+        int st = 0;
+        while (!pEvent->m_state && st == 0)
+        {
+            if (dwMilliseconds == INFINITE)
+                st = pthread_cond_wait(&pEvent->m_condition, &pEvent->m_mutex);
+            else
+                st = pthread_cond_timedwait(&pEvent->m_condition, &pEvent->m_mutex, &deadline);
+        }
+
+        if (pEvent->m_state)
+        {
+            if (!pEvent->m_manualReset)
+                pEvent->m_state = false;
+            result = WAIT_OBJECT_0;
+        }
+        else
+        {
+            result = (st == ETIMEDOUT) ? WAIT_TIMEOUT : WAIT_FAILED;
+        }
+
+        pthread_mutex_unlock(&pEvent->m_mutex);
+
+        if (disablePreemptive)
+        {
+            GCToEEInterface::DisablePreemptiveGC(pCurThread);
+        }
+    }
+
+    return result;
 }
 
-WINBASEAPI
-DWORD
-WINAPI
-GetLastError()
+void DestroyThread(Thread * pThread)
 {
-    return 1;
+    // TODO: implement
 }
@@ -9,6 +9,7 @@
 #include "common.h"
 
 #include "windows.h"
+#include "psapi.h"
 
 #include "gcenv.h"
 #include "gc.h"
@@ -161,6 +162,16 @@ void* GCToOSInterface::VirtualReserve(void* address, size_t size, size_t alignme
     return ::VirtualAlloc(0, size, memFlags, PAGE_READWRITE);
 }
 
+// Get the size of the large pages VirtualReserve can back memory with.
+// Return:
+//  The large page size, or 0 if large pages are not supported
+size_t GCToOSInterface::GetLargePageSize()
+{
+    // Large pages on Windows need to be committed when they are reserved, which the GC
+    // doesn't do.
+    return 0;
+}
+
 // Release virtual memory range previously reserved using VirtualReserve
 // Parameters:
 //  address - starting virtual address
@@ -299,7 +310,11 @@ uint64_t GCToOSInterface::GetRestrictedPhysicalMemoryLimit()
 //  non zero if it has succeeded, 0 if it has failed
 size_t GCToOSInterface::GetCurrentPhysicalMemory()
 {
-    return 0;
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!::GetProcessMemoryInfo(::GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return 0;
+
+    return pmc.WorkingSetSize;
 }
 
 // Get global memory status
@@ -457,6 +472,87 @@ void CLRCriticalSection::Leave()
     ::LeaveCriticalSection(&m_cs);
 }
 
+void CLREventStatic::CreateManualEvent(bool bInitialState)
+{
+    m_hEvent = CreateEventW(NULL, TRUE, bInitialState, NULL);
+    m_fInitialized = true;
+}
+
+void CLREventStatic::CreateAutoEvent(bool bInitialState)
+{
+    m_hEvent = CreateEventW(NULL, FALSE, bInitialState, NULL);
+    m_fInitialized = true;
+}
+
+void CLREventStatic::CreateOSManualEvent(bool bInitialState)
+{
+    m_hEvent = CreateEventW(NULL, TRUE, bInitialState, NULL);
+    m_fInitialized = true;
+}
+
+void CLREventStatic::CreateOSAutoEvent(bool bInitialState)
+{
+    m_hEvent = CreateEventW(NULL, FALSE, bInitialState, NULL);
+    m_fInitialized = true;
+}
+
+void CLREventStatic::CloseEvent()
+{
+    if (m_fInitialized && m_hEvent != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_hEvent);
+        m_hEvent = INVALID_HANDLE_VALUE;
+    }
+}
+
+bool CLREventStatic::IsValid() const
+{
+    return m_fInitialized && m_hEvent != INVALID_HANDLE_VALUE;
+}
+
+bool CLREventStatic::Set()
+{
+    if (!m_fInitialized)
+        return false;
+    return !!SetEvent(m_hEvent);
+}
+
+bool CLREventStatic::Reset()
+{
+    if (!m_fInitialized)
+        return false;
+    return !!ResetEvent(m_hEvent);
+}
+
+uint32_t CLREventStatic::Wait(uint32_t dwMilliseconds, bool bAlertable)
+{
+    DWORD result = WAIT_FAILED;
+
+    if (m_fInitialized)
+    {
+        bool        disablePreemptive = false;
+        Thread *    pCurThread = GetThread();
+
+        if (NULL != pCurThread)
+        {
+            if (GCToEEInterface::IsPreemptiveGCDisabled(pCurThread))
+            {
+                GCToEEInterface::EnablePreemptiveGC(pCurThread);
+                disablePreemptive = true;
+            }
+        }
+
+        result = WaitForSingleObjectEx(m_hEvent, dwMilliseconds, bAlertable);
+
+        if (disablePreemptive)
+        {
+            GCToEEInterface::DisablePreemptiveGC(pCurThread);
+        }
+    }
+
+    return result;
+}
+
 void DestroyThread(Thread * pThread)
 {
     // TODO: implement
@@ -0,0 +1,127 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "common.h"
+
+#include "gcenv.h"
+#include "gc.h"
+#include "softwarewritewatch.h"
+
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+#ifndef DACCESS_COMPILE
+
+static_assert((static_cast<size_t>(1) << SOFTWARE_WRITE_WATCH_AddressToTableByteIndexShift) == OS_PAGE_SIZE, "Unexpected OS_PAGE_SIZE");
+
+extern "C"
+{
+    uint8_t *g_sw_ww_table = nullptr;
+    bool g_sw_ww_enabled_for_gc_heap = false;
+}
+
+void SoftwareWriteWatch::SetResizedUntranslatedTable(
+    uint8_t *untranslatedTable,
+    void *heapStartAddress,
+    void *heapEndAddress)
+{
+    // The runtime needs to be suspended during this call, and background GC threads need to synchronize calls to ClearDirty()
+    // and GetDirty() such that they are not called concurrently with this function. The current heap range is still in
+    // g_lowest_address and g_highest_address, the caller updates them after this call.
+
+    VerifyCreated();
+    assert(untranslatedTable != nullptr);
+    assert(((size_t)untranslatedTable & (sizeof(size_t) - 1)) == 0);
+    assert(heapStartAddress <= g_lowest_address);
+    assert(heapEndAddress >= g_highest_address);
+
+    if (IsEnabledForGCHeap())
+    {
+        // Carry the dirty state over to the new table. The old table is released along with the card table it was
+        // allocated with.
+        uint8_t *oldUntranslatedTable = GetUntranslatedTable();
+        size_t oldTableByteSize = GetTableByteIndex(g_highest_address - 1) - GetTableByteIndex(g_lowest_address) + 1;
+        memcpy(
+            &untranslatedTable[GetTableByteIndex(g_lowest_address) - GetTableByteIndex(heapStartAddress)],
+            oldUntranslatedTable,
+            oldTableByteSize);
+    }
+
+    g_sw_ww_table = TranslateTableToExcludeHeapStartAddress(untranslatedTable, heapStartAddress);
+}
+
+void SoftwareWriteWatch::GetDirty(
+    void *baseAddress,
+    size_t regionByteSize,
+    void **dirtyPages,
+    size_t *dirtyPageCountRef,
+    bool clearDirty,
+    bool isRuntimeSuspended)
+{
+    VerifyCreated();
+    VerifyMemoryRegion(baseAddress, regionByteSize);
+    assert(dirtyPages != nullptr);
+    assert(dirtyPageCountRef != nullptr);
+
+    size_t dirtyPageCount = *dirtyPageCountRef;
+    if (dirtyPageCount == 0)
+    {
+        return;
+    }
+
+    if (!isRuntimeSuspended)
+    {
+        // When a page is marked as dirty, a memory barrier is not issued after the write most of the time. Issue a memory
+        // barrier on all active threads of the process now to make recent changes to dirty state visible to this thread.
+        GCToOSInterface::FlushProcessWriteBuffers();
+    }
+
+    uint8_t *tableRegionStart;
+    size_t tableRegionByteSize;
+    TranslateToTableRegion(baseAddress, regionByteSize, &tableRegionStart, &tableRegionByteSize);
+    uint8_t *tableRegionEnd = tableRegionStart + tableRegionByteSize;
+
+    size_t dirtyPageIndex = 0;
+    uint8_t *tableByte = tableRegionStart;
+    while (tableByte < tableRegionEnd)
+    {
+        // Most of the table is clean, skip over it a block at a time where possible
+        if ((((size_t)tableByte & (sizeof(size_t) - 1)) == 0) &&
+            (tableByte + sizeof(size_t) <= tableRegionEnd) &&
+            (VolatileLoadWithoutBarrier((size_t *)tableByte) == 0))
+        {
+            tableByte += sizeof(size_t);
+            continue;
+        }
+
+        if (VolatileLoadWithoutBarrier(tableByte) != 0)
+        {
+            if (clearDirty)
+            {
+                *tableByte = 0;
+            }
+
+            dirtyPages[dirtyPageIndex] = GetPageAddress(tableByte - g_sw_ww_table);
+            ++dirtyPageIndex;
+            if (dirtyPageIndex == dirtyPageCount)
+            {
+                break;
+            }
+        }
+
+        ++tableByte;
+    }
+
+    if (clearDirty && dirtyPageIndex != 0 && !isRuntimeSuspended)
+    {
+        // The write barrier does not mark a page dirty again if it is already dirty, so a thread that read the dirty state
+        // just before it was cleared above may write to the page without marking it. Issue a memory barrier on all active
+        // threads so that any such write is complete, and visible to the GC's subsequent scan of the page, before the
+        // dirty state is used.
+        GCToOSInterface::FlushProcessWriteBuffers();
+    }
+
+    *dirtyPageCountRef = dirtyPageIndex;
+}
+
+#endif // !DACCESS_COMPILE
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
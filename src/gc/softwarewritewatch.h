@@ -0,0 +1,247 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#ifndef __SOFTWARE_WRITE_WATCH_H__
+#define __SOFTWARE_WRITE_WATCH_H__
+
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+#ifndef DACCESS_COMPILE
+
+// Implemented by the VM, these switch the JIT_WriteBarrier helper to and from the version that updates the write watch
+// table. isRuntimeSuspended indicates whether the caller has already suspended the runtime.
+extern void SwitchToWriteWatchBarrier(bool isRuntimeSuspended);
+extern void SwitchToNonWriteWatchBarrier(bool isRuntimeSuspended);
+
+// The write watch table contains one byte per OS page of the GC heap range. The byte for an address is at
+// g_sw_ww_table[address >> SOFTWARE_WRITE_WATCH_AddressToTableByteIndexShift]. This constant is shared with the write
+// barrier helpers, which hard-code it.
+#define SOFTWARE_WRITE_WATCH_AddressToTableByteIndexShift 0xc
+
+extern "C"
+{
+    // Table containing the dirty state. The table is translated so that indexing it with the shifted address of any byte
+    // in [g_lowest_address, g_highest_address) gives the byte representing that address' page (see
+    // TranslateTableToExcludeHeapStartAddress).
+    extern uint8_t *g_sw_ww_table;
+
+    // Write watch is only needed while a background GC is in progress. When this is false, the write barrier helpers do
+    // not touch the table.
+    extern bool g_sw_ww_enabled_for_gc_heap;
+}
+
+//
+// SoftwareWriteWatch tracks writes to the GC heap for platforms whose OS does not support write watch
+// (MEM_WRITE_WATCH). It is used by background GC in place of GetWriteWatch/ResetWriteWatch to find the pages that were
+// written to during the concurrent phases of the GC.
+//
+// Writes are recorded by the write barrier helpers, and by the GC itself when it copies memory. Recording a write only
+// marks the byte for the page as dirty; no memory barrier is issued, so the GC flushes the write buffers of the other
+// threads (or suspends the runtime) before it relies on the dirty state being complete.
+//
+class SoftwareWriteWatch
+{
+private:
+    static const size_t AddressToTableByteIndexShift = SOFTWARE_WRITE_WATCH_AddressToTableByteIndexShift;
+
+#ifdef _DEBUG
+    static void VerifyCreated()
+    {
+        assert(g_sw_ww_table != nullptr);
+        assert(g_lowest_address != nullptr);
+        assert(g_highest_address != nullptr);
+    }
+
+    static void VerifyMemoryRegion(void *baseAddress, size_t regionByteSize)
+    {
+        VerifyMemoryRegion(baseAddress, regionByteSize, g_lowest_address, g_highest_address);
+    }
+
+    static void VerifyMemoryRegion(void *baseAddress, size_t regionByteSize, void *heapStartAddress, void *heapEndAddress)
+    {
+        assert(baseAddress != nullptr);
+        assert(heapStartAddress != nullptr);
+        assert(heapStartAddress >= g_lowest_address);
+        assert(heapEndAddress != nullptr);
+        assert(heapEndAddress <= g_highest_address);
+        assert(baseAddress >= heapStartAddress);
+        assert(baseAddress < heapEndAddress);
+        assert(regionByteSize != 0);
+        assert(regionByteSize <= reinterpret_cast<size_t>(heapEndAddress) - reinterpret_cast<size_t>(baseAddress));
+    }
+#else
+    static void VerifyCreated() {}
+    static void VerifyMemoryRegion(void *, size_t) {}
+    static void VerifyMemoryRegion(void *, size_t, void *, void *) {}
+#endif //_DEBUG
+
+public:
+    static uint8_t *GetTable()
+    {
+        return g_sw_ww_table;
+    }
+
+private:
+    static uint8_t *GetUntranslatedTable()
+    {
+        VerifyCreated();
+        return GetUntranslatedTable(g_sw_ww_table, g_lowest_address);
+    }
+
+    static uint8_t *GetUntranslatedTable(uint8_t *table, void *heapStartAddress)
+    {
+        assert(table != nullptr);
+        assert(heapStartAddress != nullptr);
+        return &table[GetTableByteIndex(heapStartAddress)];
+    }
+
+    static uint8_t *TranslateTableToExcludeHeapStartAddress(uint8_t *table, void *heapStartAddress)
+    {
+        assert(table != nullptr);
+        assert(heapStartAddress != nullptr);
+
+        // Exclude the table byte index corresponding to the heap start address from the table pointer, so that each lookup
+        // does not have to calculate a table byte index relative to the heap start address
+        return table - GetTableByteIndex(heapStartAddress);
+    }
+
+    static void TranslateToTableRegion(void *baseAddress, size_t regionByteSize, uint8_t **tableBaseAddressRef, size_t *tableRegionByteSizeRef)
+    {
+        VerifyCreated();
+        VerifyMemoryRegion(baseAddress, regionByteSize);
+        assert(tableBaseAddressRef != nullptr);
+        assert(tableRegionByteSizeRef != nullptr);
+
+        size_t baseAddressTableByteIndex = GetTableByteIndex(baseAddress);
+        *tableBaseAddressRef = &g_sw_ww_table[baseAddressTableByteIndex];
+        *tableRegionByteSizeRef =
+            GetTableByteIndex(reinterpret_cast<uint8_t *>(baseAddress) + (regionByteSize - 1)) - baseAddressTableByteIndex + 1;
+    }
+
+    static void *GetPageAddress(size_t tableByteIndex)
+    {
+        assert(tableByteIndex != 0);
+        return reinterpret_cast<void *>(tableByteIndex << AddressToTableByteIndexShift);
+    }
+
+public:
+    static size_t GetTableByteIndex(void *address)
+    {
+        assert(address != nullptr);
+        return reinterpret_cast<size_t>(address) >> AddressToTableByteIndexShift;
+    }
+
+    // Size of the table covering [heapStartAddress, heapEndAddress), rounded up so that anything placed after the table
+    // stays pointer-aligned.
+    static size_t GetTableByteSize(void *heapStartAddress, void *heapEndAddress)
+    {
+        assert(heapStartAddress != nullptr);
+        assert(heapEndAddress > heapStartAddress);
+
+        size_t tableByteSize =
+            GetTableByteIndex(reinterpret_cast<uint8_t *>(heapEndAddress) - 1) - GetTableByteIndex(heapStartAddress) + 1;
+        return (tableByteSize + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+    }
+
+    // The table is scanned a pointer-sized block at a time, so it starts on a pointer-aligned offset in the memory it is
+    // placed in. Returns the offset at which to place the table given the number of bytes that precede it.
+    static size_t GetTableStartByteOffset(size_t byteSizeBeforeTable)
+    {
+        return (byteSizeBeforeTable + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+    }
+
+    static void InitializeUntranslatedTable(uint8_t *untranslatedTable, void *heapStartAddress)
+    {
+        assert(g_sw_ww_table == nullptr);
+        assert(untranslatedTable != nullptr);
+        assert(((size_t)untranslatedTable & (sizeof(size_t) - 1)) == 0);
+
+        g_sw_ww_table = TranslateTableToExcludeHeapStartAddress(untranslatedTable, heapStartAddress);
+    }
+
+    static void SetResizedUntranslatedTable(uint8_t *untranslatedTable, void *heapStartAddress, void *heapEndAddress);
+
+    static bool IsEnabledForGCHeap()
+    {
+        return g_sw_ww_enabled_for_gc_heap;
+    }
+
+    static void EnableForGCHeap()
+    {
+        // The runtime needs to be suspended during this call, and background GC threads need to synchronize calls to
+        // ClearDirty() and GetDirty() such that they are not called concurrently with this function
+        VerifyCreated();
+        assert(!IsEnabledForGCHeap());
+
+        g_sw_ww_enabled_for_gc_heap = true;
+        SwitchToWriteWatchBarrier(true);
+    }
+
+    static void DisableForGCHeap()
+    {
+        // The runtime needs to be suspended during this call, and background GC threads need to synchronize calls to
+        // ClearDirty() and GetDirty() such that they are not called concurrently with this function
+        VerifyCreated();
+        assert(IsEnabledForGCHeap());
+
+        g_sw_ww_enabled_for_gc_heap = false;
+        SwitchToNonWriteWatchBarrier(true);
+    }
+
+    static void ClearDirty(void *baseAddress, size_t regionByteSize)
+    {
+        VerifyCreated();
+        VerifyMemoryRegion(baseAddress, regionByteSize);
+
+        uint8_t *tableBaseAddress;
+        size_t tableRegionByteSize;
+        TranslateToTableRegion(baseAddress, regionByteSize, &tableBaseAddress, &tableRegionByteSize);
+        memset(tableBaseAddress, 0, tableRegionByteSize);
+    }
+
+    static void SetDirty(void *address, size_t writeByteSize)
+    {
+        VerifyCreated();
+        VerifyMemoryRegion(address, writeByteSize);
+        assert(address != nullptr);
+        assert(writeByteSize <= sizeof(void *));
+
+        size_t tableByteIndex = GetTableByteIndex(address);
+        assert(GetTableByteIndex(reinterpret_cast<uint8_t *>(address) + (writeByteSize - 1)) == tableByteIndex);
+
+        // Check before writing to avoid dirtying the cache line holding the table byte when the page is already dirty
+        uint8_t *tableByteAddress = &g_sw_ww_table[tableByteIndex];
+        if (*tableByteAddress == 0)
+        {
+            *tableByteAddress = 0xff;
+        }
+    }
+
+    static void SetDirtyRegion(void *baseAddress, size_t regionByteSize)
+    {
+        VerifyCreated();
+        VerifyMemoryRegion(baseAddress, regionByteSize);
+
+        uint8_t *tableBaseAddress;
+        size_t tableRegionByteSize;
+        TranslateToTableRegion(baseAddress, regionByteSize, &tableBaseAddress, &tableRegionByteSize);
+        memset(tableBaseAddress, ~0, tableRegionByteSize);
+    }
+
+    // Equivalent of GCToOSInterface::GetWriteWatch. Fills dirtyPages with up to *dirtyPageCountRef page addresses of dirty
+    // pages in the region, in address order, and returns the number filled in *dirtyPageCountRef. When clearDirty is
+    // true, the reported pages are cleared. isRuntimeSuspended indicates whether other threads may be running write
+    // barriers concurrently.
+    static void GetDirty(
+        void *baseAddress,
+        size_t regionByteSize,
+        void **dirtyPages,
+        size_t *dirtyPageCountRef,
+        bool clearDirty,
+        bool isRuntimeSuspended);
+};
+
+#endif // !DACCESS_COMPILE
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
+#endif // __SOFTWARE_WRITE_WATCH_H__
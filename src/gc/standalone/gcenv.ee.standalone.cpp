@@ -0,0 +1,452 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+//
+// Execution engine side of the GC environment for the GC built as a separate
+// library, and the functions the library exports. Everything here forwards to
+// the runtime through the IGCToCLR it passed to GC_Initialize.
+//
+
+#include "common.h"
+
+#include "gcenv.h"
+#include "gc.h"
+#include "gcscan.h"
+#include "gcinterface.h"
+#include "softwarewritewatch.h"
+
+#ifdef _MSC_VER
+#define GC_EXPORT extern "C" __declspec(dllexport)
+#else
+#define GC_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+IGCToCLR * g_theGCToCLR;
+extern IGCToOS * g_theGCToOS;
+
+static EEConfig g_config;
+EEConfig * g_pConfig;
+
+MethodTable * g_pFreeObjectMethodTable;
+
+int32_t * g_pTrapReturningThreads;
+
+bool * g_pFinalizerRunOnShutDown;
+
+void InitializeSystemInfo();
+
+void EEConfig::Initialize()
+{
+    m_heapVerifyLevel = (int)g_theGCToCLR->GetGCConfigValue(GCConfig_HeapVerifyLevel);
+    m_breakOnOOM = g_theGCToCLR->GetGCConfigValue(GCConfig_BreakOnOOM) != 0;
+    m_gen0size = (int)g_theGCToCLR->GetGCConfigValue(GCConfig_Gen0Size);
+    m_segmentSize = (int)g_theGCToCLR->GetGCConfigValue(GCConfig_SegmentSize);
+    m_heapHardLimit = g_theGCToCLR->GetGCConfigValue(GCConfig_HeapHardLimit);
+    m_concurrent = (int)g_theGCToCLR->GetGCConfigValue(GCConfig_Concurrent);
+    m_latencyMode = (int)g_theGCToCLR->GetGCConfigValue(GCConfig_LatencyMode);
+    m_forceCompact = (int)g_theGCToCLR->GetGCConfigValue(GCConfig_ForceCompact);
+    m_retainVM = (int)g_theGCToCLR->GetGCConfigValue(GCConfig_RetainVM);
+    m_trimCommit = (int)g_theGCToCLR->GetGCConfigValue(GCConfig_TrimCommit);
+    m_lohCompactionMode = (int)g_theGCToCLR->GetGCConfigValue(GCConfig_LOHCompactionMode);
+    m_allowVeryLargeObjects = g_theGCToCLR->GetGCConfigValue(GCConfig_AllowVeryLargeObjects) != 0;
+    m_conservative = g_theGCToCLR->GetGCConfigValue(GCConfig_Conservative) != 0;
+}
+
+//
+// GCToEEInterface
+//
+
+void GCToEEInterface::SuspendEE(GCToEEInterface::SUSPEND_REASON reason)
+{
+    g_theGCToCLR->SuspendEE(reason);
+}
+
+void GCToEEInterface::RestartEE(bool bFinishedGC)
+{
+    g_theGCToCLR->RestartEE(bFinishedGC);
+}
+
+void GCToEEInterface::GcScanRoots(promote_func* fn,  int condemned, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->GcScanRoots(fn, condemned, max_gen, sc);
+}
+
+void GCToEEInterface::GcStartWork(int condemned, int max_gen)
+{
+    g_theGCToCLR->GcStartWork(condemned, max_gen);
+}
+
+void GCToEEInterface::AfterGcScanRoots(int condemned, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->AfterGcScanRoots(condemned, max_gen, sc);
+}
+
+void GCToEEInterface::GcBeforeBGCSweepWork()
+{
+    g_theGCToCLR->GcBeforeBGCSweepWork();
+}
+
+void GCToEEInterface::GcDone(int condemned)
+{
+    g_theGCToCLR->GcDone(condemned);
+}
+
+bool GCToEEInterface::RefCountedHandleCallbacks(Object * pObject)
+{
+    return g_theGCToCLR->RefCountedHandleCallbacks(pObject);
+}
+
+void GCToEEInterface::SyncBlockCacheWeakPtrScan(HANDLESCANPROC scanProc, uintptr_t lp1, uintptr_t lp2)
+{
+    g_theGCToCLR->SyncBlockCacheWeakPtrScan(scanProc, lp1, lp2);
+}
+
+void GCToEEInterface::SyncBlockCacheDemote(int max_gen)
+{
+    g_theGCToCLR->SyncBlockCacheDemote(max_gen);
+}
+
+void GCToEEInterface::SyncBlockCachePromotionsGranted(int max_gen)
+{
+    g_theGCToCLR->SyncBlockCachePromotionsGranted(max_gen);
+}
+
+bool GCToEEInterface::IsPreemptiveGCDisabled(Thread * pThread)
+{
+    return g_theGCToCLR->IsPreemptiveGCDisabled(pThread);
+}
+
+void GCToEEInterface::EnablePreemptiveGC(Thread * pThread)
+{
+    g_theGCToCLR->EnablePreemptiveGC(pThread);
+}
+
+void GCToEEInterface::DisablePreemptiveGC(Thread * pThread)
+{
+    g_theGCToCLR->DisablePreemptiveGC(pThread);
+}
+
+void GCToEEInterface::SetGCSpecial(Thread * pThread)
+{
+    g_theGCToCLR->SetGCSpecial(pThread);
+}
+
+alloc_context * GCToEEInterface::GetAllocContext(Thread * pThread)
+{
+    return g_theGCToCLR->GetAllocContext(pThread);
+}
+
+bool GCToEEInterface::CatchAtSafePoint(Thread * pThread)
+{
+    return g_theGCToCLR->CatchAtSafePoint(pThread);
+}
+
+bool GCToEEInterface::IsGCThread()
+{
+    return g_theGCToCLR->IsGCThread();
+}
+
+void GCToEEInterface::GcEnumAllocContexts (enum_alloc_context_func* fn, void* param)
+{
+    g_theGCToCLR->GcEnumAllocContexts(fn, param);
+}
+
+// does not acquire thread store lock
+void GCToEEInterface::AttachCurrentThread()
+{
+    g_theGCToCLR->AttachCurrentThread();
+}
+
+//
+// Threads and finalization
+//
+
+Thread * GetThread()
+{
+    return g_theGCToCLR->GetThread();
+}
+
+bool IsGCSpecialThread()
+{
+    return g_theGCToCLR->IsGCSpecialThread();
+}
+
+bool REDHAWK_PALAPI PalStartBackgroundGCThread(BackgroundCallback callback, void* pCallbackContext)
+{
+    return g_theGCToCLR->CreateBackgroundThread(callback, pCallbackContext);
+}
+
+void DestroyThread(Thread * pThread)
+{
+    g_theGCToCLR->DestroyThread(pThread);
+}
+
+void FinalizerThread::EnableFinalization()
+{
+    g_theGCToCLR->EnableFinalization();
+}
+
+bool FinalizerThread::HaveExtraWorkForFinalizer()
+{
+    return g_theGCToCLR->HaveExtraWorkForFinalizer();
+}
+
+//
+// Write barrier
+//
+
+static void StompWriteBarrier(WriteBarrierOp operation, bool requiresUpperBoundsCheck, bool isRuntimeSuspended)
+{
+    WriteBarrierParameters args;
+    args.operation = operation;
+    args.requires_upper_bounds_check = requiresUpperBoundsCheck;
+    args.is_runtime_suspended = isRuntimeSuspended;
+    args.card_table = g_card_table;
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    args.card_bundle_table = g_card_bundle_table;
+#else
+    args.card_bundle_table = NULL;
+#endif //FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    args.lowest_address = g_lowest_address;
+    args.highest_address = g_highest_address;
+    args.ephemeral_low = g_ephemeral_low;
+    args.ephemeral_high = g_ephemeral_high;
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    args.write_watch_table = g_sw_ww_table;
+    args.write_watch_enabled = g_sw_ww_enabled_for_gc_heap;
+#else
+    args.write_watch_table = NULL;
+    args.write_watch_enabled = false;
+#endif //FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
+    g_theGCToCLR->StompWriteBarrier(&args);
+}
+
+void StompWriteBarrierEphemeral()
+{
+    StompWriteBarrier(WriteBarrierOp_StompEphemeral, false, false);
+}
+
+void StompWriteBarrierResize(bool bReqUpperBoundsCheck)
+{
+    StompWriteBarrier(WriteBarrierOp_StompResize, bReqUpperBoundsCheck, false);
+}
+
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+void SwitchToWriteWatchBarrier(bool isRuntimeSuspended)
+{
+    StompWriteBarrier(WriteBarrierOp_SwitchToWriteWatch, false, isRuntimeSuspended);
+}
+
+void SwitchToNonWriteWatchBarrier(bool isRuntimeSuspended)
+{
+    StompWriteBarrier(WriteBarrierOp_SwitchToNonWriteWatch, false, isRuntimeSuspended);
+}
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
+//
+// Handle table, which stays in the runtime.
+//
+
+void GCScan::GcScanSizedRefs(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->GcScanSizedRefs(fn, condemned, max_gen, sc);
+}
+
+void GCScan::GcScanRoots(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->GcScanRoots(fn, condemned, max_gen, sc);
+}
+
+void GCScan::GcScanHandles(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->GcScanHandles(fn, condemned, max_gen, sc);
+}
+
+void GCScan::GcRuntimeStructuresValid(BOOL bValid)
+{
+    g_theGCToCLR->GcRuntimeStructuresValid(bValid);
+}
+
+bool GCScan::GetGcRuntimeStructuresValid()
+{
+    return g_theGCToCLR->GetGcRuntimeStructuresValid();
+}
+
+void GCScan::GcWeakPtrScan(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->GcWeakPtrScan(fn, condemned, max_gen, sc);
+}
+
+void GCScan::GcWeakPtrScanBySingleThread(int condemned, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->GcWeakPtrScanBySingleThread(condemned, max_gen, sc);
+}
+
+void GCScan::GcScanStrongHandlesBySingleThread(promote_func* fn, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->GcScanStrongHandlesBySingleThread(fn, max_gen, sc);
+}
+
+void GCScan::GcShortWeakPtrScan(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->GcShortWeakPtrScan(fn, condemned, max_gen, sc);
+}
+
+void GCScan::GcDhInitialScan(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->GcDhInitialScan(fn, condemned, max_gen, sc);
+}
+
+bool GCScan::GcDhUnpromotedHandlesExist(ScanContext* sc)
+{
+    return g_theGCToCLR->GcDhUnpromotedHandlesExist(sc);
+}
+
+bool GCScan::GcDhReScan(ScanContext* sc)
+{
+    return g_theGCToCLR->GcDhReScan(sc);
+}
+
+void GCScan::GcPromotionsGranted(int condemned, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->GcPromotionsGranted(condemned, max_gen, sc);
+}
+
+void GCScan::GcDemote(int condemned, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->GcDemote(condemned, max_gen, sc);
+}
+
+size_t GCScan::AskForMoreReservedMemory(size_t old_size, size_t need_size)
+{
+    return g_theGCToCLR->AskForMoreReservedMemory(old_size, need_size);
+}
+
+void GCScan::VerifyHandleTable(int condemned, int max_gen, ScanContext* sc)
+{
+    g_theGCToCLR->VerifyHandleTable(condemned, max_gen, sc);
+}
+
+//
+// Configuration
+//
+
+void LogSpewAlways(const char * /*fmt*/, ...)
+{
+}
+
+uint32_t CLRConfig::GetConfigValue(ConfigDWORDInfo eType)
+{
+    // Names and defaults as in clrconfigvalues.h.
+    switch (eType)
+    {
+    case UNSUPPORTED_GCLogEnabled:
+        return g_theGCToCLR->GetConfigDWORD("GCLogEnabled", 0);
+    case UNSUPPORTED_GCLogFileSize:
+        return g_theGCToCLR->GetConfigDWORD("GCLogFileSize", 0);
+    case UNSUPPORTED_GCConfigLogEnabled:
+        return g_theGCToCLR->GetConfigDWORD("GCConfigLogEnabled", 0);
+    case UNSUPPORTED_BGCSpinCount:
+        return g_theGCToCLR->GetConfigDWORD("BGCSpinCount", 140);
+    case UNSUPPORTED_BGCSpin:
+        return g_theGCToCLR->GetConfigDWORD("BGCSpin", 2);
+    case UNSUPPORTED_GCDynamicHeapCount:
+        return g_theGCToCLR->GetConfigDWORD("GCDynamicHeapCount", 0);
+    case UNSUPPORTED_GCLargePages:
+        return g_theGCToCLR->GetConfigDWORD("GCLargePages", 0);
+    case UNSUPPORTED_GCSegmentPromotion:
+        return g_theGCToCLR->GetConfigDWORD("GCSegmentPromotion", 0);
+    case UNSUPPORTED_GCGen0Adaptive:
+        return g_theGCToCLR->GetConfigDWORD("GCGen0Adaptive", 0);
+    case UNSUPPORTED_GCTargetPauseMs:
+        return g_theGCToCLR->GetConfigDWORD("GCTargetPauseMs", 0);
+    case UNSUPPORTED_GCAdaptiveAllocQuantum:
+        return g_theGCToCLR->GetConfigDWORD("GCAdaptiveAllocQuantum", 0);
+    case UNSUPPORTED_GCLOHCompactBudget:
+        return g_theGCToCLR->GetConfigDWORD("GCLOHCompactBudget", 0);
+    case UNSUPPORTED_GCMarkPrefetchDepth:
+        return g_theGCToCLR->GetConfigDWORD("GCMarkPrefetchDepth", 0);
+    case UNSUPPORTED_GCHeapSnapshotInterval:
+        return g_theGCToCLR->GetConfigDWORD("GCHeapSnapshotInterval", 0);
+    case UNSUPPORTED_GCDecommitTimeWindow:
+        return g_theGCToCLR->GetConfigDWORD("GCDecommitTimeWindow", 0);
+
+    // GC stress is driven by the runtime.
+    case EXTERNAL_GCStressStart:
+    case INTERNAL_GCStressStartAtJit:
+    case INTERNAL_DbgDACSkipVerifyDlls:
+        return 0;
+
+    // String configs.
+    case UNSUPPORTED_GCLogFile:
+    case UNSUPPORTED_GCConfigLogFile:
+    case UNSUPPORTED_GCHeapSnapshotFile:
+    case Config_COUNT:
+    default:
+#ifdef _MSC_VER
+#pragma warning(suppress:4127) // Constant conditional expression in ASSERT below
+#endif
+        ASSERT(!"Unknown config value type");
+        return 0;
+    }
+}
+
+HRESULT CLRConfig::GetConfigValue(ConfigStringInfo /*eType*/, TCHAR * * outVal)
+{
+    // String configs (the GC log and heap snapshot files) are not passed through
+    // the interface, so those features are off in a standalone GC.
+    *outVal = NULL;
+    return 0;
+}
+
+//
+// Exports
+//
+
+GC_EXPORT void GC_VersionInfo(VersionInfo* info)
+{
+    info->MajorVersion = GC_INTERFACE_MAJOR_VERSION;
+    info->MinorVersion = GC_INTERFACE_MINOR_VERSION;
+    info->BuildVersion = 0;
+    info->Name = "Standalone CoreCLR GC";
+}
+
+GC_EXPORT HRESULT GC_Initialize(
+    IGCToCLR* clrToGC,
+    IGCToOS* osToGC,
+    GCRuntimeState* runtimeState,
+    GCHeap** gcHeap)
+{
+    g_theGCToCLR = clrToGC;
+    g_theGCToOS = osToGC;
+
+    g_pFreeObjectMethodTable = runtimeState->free_object_method_table;
+    g_pTrapReturningThreads = runtimeState->trap_returning_threads;
+    g_pFinalizerRunOnShutDown = runtimeState->finalizer_run_on_shutdown;
+
+    InitializeSystemInfo();
+
+    g_config.Initialize();
+    g_pConfig = &g_config;
+
+#ifndef FEATURE_SVR_GC
+    // The library is built with the workstation GC only, like the GC sample.
+    if (runtimeState->server_gc)
+    {
+        return E_NOTIMPL;
+    }
+#endif // !FEATURE_SVR_GC
+
+    GCHeap::InitializeHeapType(runtimeState->server_gc);
+
+    GCHeap* pGCHeap = GCHeap::CreateGCHeap();
+    if (!pGCHeap)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    *gcHeap = pGCHeap;
+    return S_OK;
+}
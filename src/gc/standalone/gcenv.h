@@ -0,0 +1,128 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+//
+// GC environment for the GC built as a separate library (see gcinterface.h). It
+// is the environment of the GC sample, except that the execution engine and OS
+// services are forwarded to the runtime that loaded the library.
+//
+
+#if defined(_DEBUG)
+#ifndef _DEBUG_IMPL
+#define _DEBUG_IMPL 1
+#endif
+#define ASSERT(_expr) assert(_expr)
+#else
+#define ASSERT(_expr)
+#endif
+
+#ifndef _ASSERTE
+#define _ASSERTE(_expr) ASSERT(_expr)
+#endif
+
+// These are runtime globals the GC reads and writes in place, the runtime passes
+// their addresses to GC_Initialize.
+#define g_TrapReturningThreads (*g_pTrapReturningThreads)
+#define g_fFinalizerRunOnShutDown (*g_pFinalizerRunOnShutDown)
+
+#include "gcenv.structs.h"
+#include "gcenv.base.h"
+#include "gcenv.ee.h"
+#include "gcenv.os.h"
+#include "gcenv.interlocked.h"
+#include "gcenv.interlocked.inl"
+#include "gcenv.object.h"
+#include "gcenv.sync.h"
+
+#define MAX_LONGPATH 1024
+
+//
+// Thread
+//
+// Threads belong to the runtime, the GC only passes them back to it.
+//
+
+class Thread;
+
+// -----------------------------------------------------------------------------------------------------------
+// Config file enumulation
+//
+
+class EEConfig
+{
+public:
+    enum HeapVerifyFlags {
+        HEAPVERIFY_NONE = 0,
+        HEAPVERIFY_GC = 1,   // Verify the heap at beginning and end of GC
+        HEAPVERIFY_BARRIERCHECK = 2,   // Verify the brick table
+        HEAPVERIFY_SYNCBLK = 4,   // Verify sync block scanning
+
+                                  // the following options can be used to mitigate some of the overhead introduced
+                                  // by heap verification.  some options might cause heap verifiction to be less
+                                  // effective depending on the scenario.
+
+        HEAPVERIFY_NO_RANGE_CHECKS = 0x10,   // Excludes checking if an OBJECTREF is within the bounds of the managed heap
+        HEAPVERIFY_NO_MEM_FILL = 0x20,   // Excludes filling unused segment portions with fill pattern
+        HEAPVERIFY_POST_GC_ONLY = 0x40,   // Performs heap verification post-GCs only (instead of before and after each GC)
+        HEAPVERIFY_DEEP_ON_COMPACT = 0x80    // Performs deep object verfication only on compacting GCs.
+    };
+
+    enum  GCStressFlags {
+        GCSTRESS_NONE = 0,
+        GCSTRESS_ALLOC = 1,    // GC on all allocs and 'easy' places
+        GCSTRESS_TRANSITION = 2,    // GC on transitions to preemtive GC
+        GCSTRESS_INSTR_JIT = 4,    // GC on every allowable JITed instr
+        GCSTRESS_INSTR_NGEN = 8,    // GC on every allowable NGEN instr
+        GCSTRESS_UNIQUE = 16,   // GC only on a unique stack trace
+    };
+
+    // Reads the settings from the runtime, see GCConfigValue.
+    void Initialize();
+
+    int     GetHeapVerifyLevel() { return m_heapVerifyLevel; }
+    bool    IsHeapVerifyEnabled() { return GetHeapVerifyLevel() != 0; }
+
+    // GC stress is driven by the runtime, which calls into the GC's own StressHeap.
+    GCStressFlags GetGCStressLevel()        const { return GCSTRESS_NONE; }
+    bool    IsGCStressMix()                 const { return false; }
+
+    int     GetGCtraceStart()               const { return 0; }
+    int     GetGCtraceEnd()               const { return 0; }//1000000000; }
+    int     GetGCtraceFac()               const { return 0; }
+    int     GetGCprnLvl()               const { return 0; }
+    bool    IsGCBreakOnOOMEnabled()         const { return m_breakOnOOM; }
+    int     GetGCgen0size()               const { return m_gen0size; }
+    int     GetSegmentSize()               const { return m_segmentSize; }
+    size_t  GetGCHeapHardLimit()           const { return m_heapHardLimit; }
+    int     GetGCconcurrent()               const { return m_concurrent; }
+    int     GetGCLatencyMode()              const { return m_latencyMode; }
+    int     GetGCForceCompact()             const { return m_forceCompact; }
+    int     GetGCRetainVM()                const { return m_retainVM; }
+    int     GetGCTrimCommit()               const { return m_trimCommit; }
+    int     GetGCLOHCompactionMode()        const { return m_lohCompactionMode; }
+
+    bool    GetGCAllowVeryLargeObjects()   const { return m_allowVeryLargeObjects; }
+
+    bool    GetGCConservative()             const { return m_conservative; }
+
+private:
+    int     m_heapVerifyLevel;
+    bool    m_breakOnOOM;
+    int     m_gen0size;
+    int     m_segmentSize;
+    size_t  m_heapHardLimit;
+    int     m_concurrent;
+    int     m_latencyMode;
+    int     m_forceCompact;
+    int     m_retainVM;
+    int     m_trimCommit;
+    int     m_lohCompactionMode;
+    bool    m_allowVeryLargeObjects;
+    bool    m_conservative;
+};
+
+extern EEConfig * g_pConfig;
+
+#include "etmdummy.h"
+#define ETW_EVENT_ENABLED(e,f) false
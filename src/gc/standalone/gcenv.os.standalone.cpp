@@ -0,0 +1,334 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+//
+// OS side of the GC environment for the GC built as a separate library. The OS
+// services and events come from the runtime through the IGCToOS it passed to
+// GC_Initialize, critical sections are implemented here.
+//
+
+#include "common.h"
+
+#ifndef PLATFORM_UNIX
+#include "windows.h"
+#endif // !PLATFORM_UNIX
+
+#include "gcenv.h"
+#include "gc.h"
+#include "gcinterface.h"
+
+IGCToOS * g_theGCToOS;
+
+GCSystemInfo g_SystemInfo;
+
+void InitializeSystemInfo()
+{
+    g_theGCToOS->GetSystemInfo(
+        &g_SystemInfo.dwNumberOfProcessors,
+        &g_SystemInfo.dwPageSize,
+        &g_SystemInfo.dwAllocationGranularity);
+}
+
+// Initialize the interface implementation
+// Return:
+//  true if it has succeeded, false if it has failed
+bool GCToOSInterface::Initialize()
+{
+    // The runtime has initialized its side before loading the GC.
+    return true;
+}
+
+// Shutdown the interface implementation
+void GCToOSInterface::Shutdown()
+{
+}
+
+void* GCToOSInterface::VirtualReserve(void* address, size_t size, size_t alignment, uint32_t flags)
+{
+    return g_theGCToOS->VirtualReserve(address, size, alignment, flags);
+}
+
+bool GCToOSInterface::VirtualRelease(void* address, size_t size)
+{
+    return g_theGCToOS->VirtualRelease(address, size);
+}
+
+bool GCToOSInterface::VirtualCommit(void* address, size_t size)
+{
+    return g_theGCToOS->VirtualCommit(address, size);
+}
+
+bool GCToOSInterface::VirtualDecommit(void* address, size_t size)
+{
+    return g_theGCToOS->VirtualDecommit(address, size);
+}
+
+bool GCToOSInterface::VirtualReset(void * address, size_t size, bool unlock)
+{
+    return g_theGCToOS->VirtualReset(address, size, unlock);
+}
+
+size_t GCToOSInterface::GetLargePageSize()
+{
+    return g_theGCToOS->GetLargePageSize();
+}
+
+bool GCToOSInterface::SupportsWriteWatch()
+{
+    return g_theGCToOS->SupportsWriteWatch();
+}
+
+void GCToOSInterface::ResetWriteWatch(void* address, size_t size)
+{
+    g_theGCToOS->ResetWriteWatch(address, size);
+}
+
+bool GCToOSInterface::GetWriteWatch(bool resetState, void* address, size_t size, void** pageAddresses, uintptr_t* pageAddressesCount)
+{
+    return g_theGCToOS->GetWriteWatch(resetState, address, size, pageAddresses, pageAddressesCount);
+}
+
+bool GCToOSInterface::CreateThread(GCThreadFunction function, void* param, GCThreadAffinity* affinity)
+{
+    return g_theGCToOS->CreateThread(function, param, affinity);
+}
+
+void GCToOSInterface::Sleep(uint32_t sleepMSec)
+{
+    g_theGCToOS->Sleep(sleepMSec);
+}
+
+void GCToOSInterface::YieldThread(uint32_t switchCount)
+{
+    g_theGCToOS->YieldThread(switchCount);
+}
+
+uint32_t GCToOSInterface::GetCurrentProcessorNumber()
+{
+    return g_theGCToOS->GetCurrentProcessorNumber();
+}
+
+bool GCToOSInterface::CanGetCurrentProcessorNumber()
+{
+    return g_theGCToOS->CanGetCurrentProcessorNumber();
+}
+
+bool GCToOSInterface::SetCurrentThreadIdealAffinity(GCThreadAffinity* affinity)
+{
+    return g_theGCToOS->SetCurrentThreadIdealAffinity(affinity);
+}
+
+uint32_t GCToOSInterface::GetCurrentThreadIdForLogging()
+{
+    return g_theGCToOS->GetCurrentThreadIdForLogging();
+}
+
+uint32_t GCToOSInterface::GetCurrentProcessId()
+{
+    return g_theGCToOS->GetCurrentProcessId();
+}
+
+uint32_t GCToOSInterface::GetLogicalCpuCount()
+{
+    return g_theGCToOS->GetLogicalCpuCount();
+}
+
+size_t GCToOSInterface::GetLargestOnDieCacheSize(bool trueSize)
+{
+    return g_theGCToOS->GetLargestOnDieCacheSize(trueSize);
+}
+
+uint32_t GCToOSInterface::GetCurrentProcessCpuCount()
+{
+    return g_theGCToOS->GetCurrentProcessCpuCount();
+}
+
+bool GCToOSInterface::GetCurrentProcessAffinityMask(uintptr_t* processMask, uintptr_t* systemMask)
+{
+    return g_theGCToOS->GetCurrentProcessAffinityMask(processMask, systemMask);
+}
+
+uint64_t GCToOSInterface::GetRestrictedPhysicalMemoryLimit()
+{
+    return g_theGCToOS->GetRestrictedPhysicalMemoryLimit();
+}
+
+size_t GCToOSInterface::GetCurrentPhysicalMemory()
+{
+    return g_theGCToOS->GetCurrentPhysicalMemory();
+}
+
+void GCToOSInterface::GetMemoryStatus(GCMemoryStatus* ms)
+{
+    GCInterfaceMemoryStatus status;
+    g_theGCToOS->GetMemoryStatus(&status);
+
+    ms->dwMemoryLoad = status.dwMemoryLoad;
+    ms->ullTotalPhys = status.ullTotalPhys;
+    ms->ullAvailPhys = status.ullAvailPhys;
+    ms->ullTotalPageFile = status.ullTotalPageFile;
+    ms->ullAvailPageFile = status.ullAvailPageFile;
+    ms->ullTotalVirtual = status.ullTotalVirtual;
+    ms->ullAvailVirtual = status.ullAvailVirtual;
+}
+
+void GCToOSInterface::FlushProcessWriteBuffers()
+{
+    g_theGCToOS->FlushProcessWriteBuffers();
+}
+
+void GCToOSInterface::DebugBreak()
+{
+    g_theGCToOS->DebugBreak();
+}
+
+int64_t GCToOSInterface::QueryPerformanceCounter()
+{
+    return g_theGCToOS->QueryPerformanceCounter();
+}
+
+int64_t GCToOSInterface::QueryPerformanceFrequency()
+{
+    return g_theGCToOS->QueryPerformanceFrequency();
+}
+
+uint32_t GCToOSInterface::GetLowPrecisionTimeStamp()
+{
+    return g_theGCToOS->GetLowPrecisionTimeStamp();
+}
+
+//
+// Events
+//
+
+void CLREventStatic::CreateManualEvent(bool bInitialState)
+{
+    m_hEvent = g_theGCToOS->CreateGCEvent(true, bInitialState, false);
+    m_fInitialized = (m_hEvent != NULL);
+}
+
+void CLREventStatic::CreateAutoEvent(bool bInitialState)
+{
+    m_hEvent = g_theGCToOS->CreateGCEvent(false, bInitialState, false);
+    m_fInitialized = (m_hEvent != NULL);
+}
+
+void CLREventStatic::CreateOSManualEvent(bool bInitialState)
+{
+    m_hEvent = g_theGCToOS->CreateGCEvent(true, bInitialState, true);
+    m_fInitialized = (m_hEvent != NULL);
+}
+
+void CLREventStatic::CreateOSAutoEvent(bool bInitialState)
+{
+    m_hEvent = g_theGCToOS->CreateGCEvent(false, bInitialState, true);
+    m_fInitialized = (m_hEvent != NULL);
+}
+
+void CLREventStatic::CloseEvent()
+{
+    if (m_fInitialized)
+    {
+        g_theGCToOS->CloseGCEvent(m_hEvent);
+        m_hEvent = NULL;
+        m_fInitialized = false;
+    }
+}
+
+bool CLREventStatic::IsValid() const
+{
+    return m_fInitialized;
+}
+
+bool CLREventStatic::Set()
+{
+    if (!m_fInitialized)
+        return false;
+    return g_theGCToOS->SetGCEvent(m_hEvent);
+}
+
+bool CLREventStatic::Reset()
+{
+    if (!m_fInitialized)
+        return false;
+    return g_theGCToOS->ResetGCEvent(m_hEvent);
+}
+
+uint32_t CLREventStatic::Wait(uint32_t dwMilliseconds, bool bAlertable)
+{
+    uint32_t result = WAIT_FAILED;
+
+    if (m_fInitialized)
+    {
+        bool        disablePreemptive = false;
+        Thread *    pCurThread = GetThread();
+
+        if (NULL != pCurThread)
+        {
+            if (GCToEEInterface::IsPreemptiveGCDisabled(pCurThread))
+            {
+                GCToEEInterface::EnablePreemptiveGC(pCurThread);
+                disablePreemptive = true;
+            }
+        }
+
+        result = g_theGCToOS->WaitGCEvent(m_hEvent, dwMilliseconds, bAlertable);
+
+        if (disablePreemptive)
+        {
+            GCToEEInterface::DisablePreemptiveGC(pCurThread);
+        }
+    }
+
+    return result;
+}
+
+//
+// Critical sections
+//
+
+// Initialize the critical section
+void CLRCriticalSection::Initialize()
+{
+#ifdef PLATFORM_UNIX
+    pthread_mutexattr_t mutexAttributes;
+    pthread_mutexattr_init(&mutexAttributes);
+    // Critical sections are recursive.
+    pthread_mutexattr_settype(&mutexAttributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&m_cs.mutex, &mutexAttributes);
+    pthread_mutexattr_destroy(&mutexAttributes);
+#else // PLATFORM_UNIX
+    ::InitializeCriticalSection(&m_cs);
+#endif // PLATFORM_UNIX
+}
+
+// Destroy the critical section
+void CLRCriticalSection::Destroy()
+{
+#ifdef PLATFORM_UNIX
+    pthread_mutex_destroy(&m_cs.mutex);
+#else // PLATFORM_UNIX
+    ::DeleteCriticalSection(&m_cs);
+#endif // PLATFORM_UNIX
+}
+
+// Enter the critical section. Blocks until the section can be entered.
+void CLRCriticalSection::Enter()
+{
+#ifdef PLATFORM_UNIX
+    pthread_mutex_lock(&m_cs.mutex);
+#else // PLATFORM_UNIX
+    ::EnterCriticalSection(&m_cs);
+#endif // PLATFORM_UNIX
+}
+
+// Leave the critical section
+void CLRCriticalSection::Leave()
+{
+#ifdef PLATFORM_UNIX
+    pthread_mutex_unlock(&m_cs.mutex);
+#else // PLATFORM_UNIX
+    ::LeaveCriticalSection(&m_cs);
+#endif // PLATFORM_UNIX
+}
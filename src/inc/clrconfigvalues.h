@@ -131,6 +131,7 @@ RETAIL_CONFIG_STRING_INFO_EX(INTERNAL_AppContextSwitchOverrides, W("AppContextSw
 #define DEFAULT_FinalizeOnShutdown (1)
 #endif
 RETAIL_CONFIG_DWORD_INFO(EXTERNAL_FinalizeOnShutdown, W("FinalizeOnShutdown"), DEFAULT_FinalizeOnShutdown, "When enabled, on shutdown, blocks all user threads and calls finalizers for all finalizable objects, including live objects")
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_FinalizerThreadCount, W("FinalizerThreadCount"), 1, "Specifies how many threads run non critical finalizers, including the finalizer thread")
 
 //
 // ARM
@@ -337,6 +338,7 @@ RETAIL_CONFIG_STRING_INFO_EX(EXTERNAL_NewGCCalc, W("NewGCCalc"), "", CLRConfig::
 RETAIL_CONFIG_DWORD_INFO_DIRECT_ACCESS(UNSUPPORTED_GCprnLvl, W("GCprnLvl"), "Specifies the maximum level of GC logging")
 RETAIL_CONFIG_DWORD_INFO_DIRECT_ACCESS(UNSUPPORTED_GCRetainVM, W("GCRetainVM"), "When set we put the segments that should be deleted on a standby list (instead of releasing them back to the OS) which will be considered to satisfy new segment requests (note that the same thing can be specified via API which is the supported way)")
 RETAIL_CONFIG_DWORD_INFO_DIRECT_ACCESS(UNSUPPORTED_GCSegmentSize, W("GCSegmentSize"), "Specifies the managed heap segment size")
+RETAIL_CONFIG_DWORD_INFO_DIRECT_ACCESS(UNSUPPORTED_GCHeapHardLimit, W("GCHeapHardLimit"), "Specifies the maximum commit size for the GC heap")
 RETAIL_CONFIG_DWORD_INFO_DIRECT_ACCESS(UNSUPPORTED_GCLOHCompact, W("GCLOHCompact"), "Specifies the LOH compaction mode")
 RETAIL_CONFIG_DWORD_INFO(EXTERNAL_gcAllowVeryLargeObjects, W("gcAllowVeryLargeObjects"), 0, "allow allocation of 2GB+ objects on GC heap")
 RETAIL_CONFIG_DWORD_INFO_EX(EXTERNAL_GCStress, W("GCStress"), 0, "trigger GCs at regular intervals", CLRConfig::REGUTIL_default)
@@ -349,6 +351,18 @@ RETAIL_CONFIG_DWORD_INFO_DIRECT_ACCESS(UNSUPPORTED_GCtraceStart, W("GCtraceStart
 RETAIL_CONFIG_DWORD_INFO_DIRECT_ACCESS(EXTERNAL_gcTrimCommitOnLowMemory, W("gcTrimCommitOnLowMemory"), "When set we trim the committed space more aggressively for the ephemeral seg. This is used for running many instances of server processes where they want to keep as little memory committed as possible")
 RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_BGCSpinCount, W("BGCSpinCount"), 140, "Specifies the bgc spin count")
 RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_BGCSpin, W("BGCSpin"), 2, "Specifies the bgc spin time")
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_GCLargePages, W("GCLargePages"), 0, "Specifies if the GC heap is backed by large pages where the OS supports it")
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_GCDynamicHeapCount, W("GCDynamicHeapCount"), 0, "Specifies if Server GC adjusts the number of heaps allocations are balanced across")
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_GCSegmentPromotion, W("GCSegmentPromotion"), 0, "Specifies if a full ephemeral segment is replaced by a new one and promoted to gen2 in place, and empty small object heap segments are kept for reuse")
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_GCGen0Adaptive, W("GCGen0Adaptive"), 0, "Specifies if the gen0 budget is tuned from the measured GC cost and survival rate")
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_GCTargetPauseMs, W("GCTargetPauseMs"), 0, "Specifies the pause time in ms the GC tries to keep ephemeral GCs under, 0 means no target")
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_GCAdaptiveAllocQuantum, W("GCAdaptiveAllocQuantum"), 0, "Specifies if each thread's allocation context is sized from the thread's allocation rate instead of all getting the same size")
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_GCLOHCompactBudget, W("GCLOHCompactBudget"), 0, "Specifies how many MB of large objects each heap may move per compacting full blocking GC to reduce LOH fragmentation, 0 disables it")
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_GCMarkPrefetchDepth, W("GCMarkPrefetchDepth"), 0, "Specifies how many objects popped off the mark stack are prefetched ahead of being scanned, 0 disables it. Only used when the GC is built with PREFETCH")
+RETAIL_CONFIG_STRING_INFO(UNSUPPORTED_GCHeapSnapshotFile, W("GCHeapSnapshotFile"), "Specifies the name prefix of heap snapshot files, heap snapshots are only written when this is set")
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_GCHeapSnapshotInterval, W("GCHeapSnapshotInterval"), 0, "Specifies to write a heap snapshot every this many blocking gen2 GCs, 0 means only when one is requested")
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_GCDecommitTimeWindow, W("GCDecommitTimeWindow"), 0, "Specifies in milliseconds the time window over which free GC memory is decommitted gradually, 0 means it is decommitted right after each GC")
+RETAIL_CONFIG_STRING_INFO(EXTERNAL_GCName, W("GCName"), "Specifies the path of a GC library to load in place of the GC built into the runtime")
 RETAIL_CONFIG_DWORD_INFO_DIRECT_ACCESS(UNSUPPORTED_HeapVerify, W("HeapVerify"), "When set verifies the integrity of the managed heap on entry and exit of each GC")
 RETAIL_CONFIG_STRING_INFO_EX(EXTERNAL_SetupGcCoverage, W("SetupGcCoverage"), "This doesn't appear to be a config flag", CLRConfig::REGUTIL_default)
 RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_GCNumaAware, W("GCNumaAware"), 1, "Specifies if to enable GC NUMA aware")
@@ -882,6 +896,10 @@ RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_ProfAPI_ValidateNGENInstrumentation, W("Pro
 RETAIL_CONFIG_DWORD_INFO_EX(EXTERNAL_PerfMapEnabled, W("PerfMapEnabled"), 0, "This flag is used on Linux to enable writing /tmp/perf-$pid.map. It is disabled by default", CLRConfig::REGUTIL_default)
 #endif
 
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_AllocationSamplingRate, W("AllocationSamplingRate"), 0, "Mean number of bytes allocated by a thread between two allocation samples, 0 disables allocation sampling")
+RETAIL_CONFIG_DWORD_INFO(UNSUPPORTED_AllocationSamplingBufferSize, W("AllocationSamplingBufferSize"), 4096, "Number of allocation samples kept in the in-process ring buffer")
+RETAIL_CONFIG_STRING_INFO(UNSUPPORTED_AllocationSamplingFile, W("AllocationSamplingFile"), "Specifies the name prefix of allocation sample dump files, dumps are written by GC.WriteAllocationSamples and at shutdown")
+
 //
 // Shim
 //
@@ -61,6 +61,132 @@ namespace System {
         NotApplicable = 4
     }
 
+    // !!!!!!!!!!!!!!!!!!!!!!!
+    // make sure you change the def in gc\gcrecord.h 
+    // if you change this!
+    [Serializable]
+    public enum GCCompactionReason
+    {
+        None = -1,
+        LowEphemeral = 0,
+        HighFragmentation = 1,
+        NoGaps = 2,
+        LOHForced = 3,
+        LastGC = 4,
+        InducedCompacting = 5,
+        FragmentedGen0 = 6,
+        HighMemoryLoad = 7,
+        HighMemoryFragmentation = 8,
+        VeryHighMemoryFragmentation = 9,
+        NoGCRegion = 10
+    }
+
+    // !!!!!!!!!!!!!!!!!!!!!!!
+    // make sure you change the def in gc\gcimpl.h 
+    // if you change this!
+    [Serializable]
+    public enum GCReason
+    {
+        AllocSmall = 0,
+        Induced = 1,
+        LowMemory = 2,
+        Empty = 3,
+        AllocLarge = 4,
+        OutOfSpaceSmall = 5,
+        OutOfSpaceLarge = 6,
+        InducedNotForced = 7,
+        GCStress = 8,
+        LowMemoryBlocking = 9,
+        InducedCompacting = 10,
+        LowMemoryHost = 11,
+        Idle = 12
+    }
+
+    // !!!!!!!!!!!!!!!!!!!!!!!
+    // make sure you change the def in gc\gc.h 
+    // if you change this!
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct GCInfoRecord
+    {
+        internal ulong index;
+        internal ulong duration;
+        internal ulong lohAllocBlockedTime;
+        internal uint generation;
+        internal uint reason;
+        internal uint flags;
+        internal uint heapCount;
+
+        internal const uint Compacting = 0x1;
+        internal const uint Concurrent = 0x2;
+    }
+
+    // !!!!!!!!!!!!!!!!!!!!!!!
+    // make sure you change the def in gc\gc.h 
+    // if you change this!
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct GCInfoHeapRecord
+    {
+        internal ulong markTime;
+        internal ulong planTime;
+        internal ulong relocateTime;
+        internal ulong compactTime;
+        internal ulong sweepTime;
+        internal ulong promotedBytes;
+        internal ulong fragmentation;
+        internal uint pinnedPlugCount;
+        internal int compactReason;
+    }
+
+    // What a GC did on one of the GC heaps.
+    public struct GCHeapInfo
+    {
+        private GCInfoHeapRecord record;
+
+        internal GCHeapInfo(GCInfoHeapRecord record)
+        {
+            this.record = record;
+        }
+
+        public TimeSpan MarkTime { get { return TimeSpan.FromTicks((long)record.markTime * 10); } }
+        public TimeSpan PlanTime { get { return TimeSpan.FromTicks((long)record.planTime * 10); } }
+        public TimeSpan RelocateTime { get { return TimeSpan.FromTicks((long)record.relocateTime * 10); } }
+        public TimeSpan CompactTime { get { return TimeSpan.FromTicks((long)record.compactTime * 10); } }
+        public TimeSpan SweepTime { get { return TimeSpan.FromTicks((long)record.sweepTime * 10); } }
+        public long PromotedBytes { get { return (long)record.promotedBytes; } }
+        // Free space left in the heap after the GC.
+        public long FragmentedBytes { get { return (long)record.fragmentation; } }
+        public int PinnedPlugCount { get { return (int)record.pinnedPlugCount; } }
+        public GCCompactionReason CompactionReason { get { return (GCCompactionReason)record.compactReason; } }
+    }
+
+    // Describes one of the most recent GCs, see GC.GetGCInfo.
+    public sealed class GCInfo
+    {
+        private GCInfoRecord record;
+        private GCHeapInfo[] heaps;
+
+        internal GCInfo(GCInfoRecord record, GCHeapInfo[] heaps)
+        {
+            this.record = record;
+            this.heaps = heaps;
+        }
+
+        public long Index { get { return (long)record.index; } }
+        public int Generation { get { return (int)record.generation; } }
+        public GCReason Reason { get { return (GCReason)record.reason; } }
+        public bool Compacted { get { return (record.flags & GCInfoRecord.Compacting) != 0; } }
+        public bool Concurrent { get { return (record.flags & GCInfoRecord.Concurrent) != 0; } }
+        public TimeSpan Duration { get { return TimeSpan.FromTicks((long)record.duration * 10); } }
+        // For a background GC, how long large object allocations had to wait for it to 
+        // sweep; zero for other GCs.
+        public TimeSpan LohAllocationBlockedTime { get { return TimeSpan.FromTicks((long)record.lohAllocBlockedTime * 10); } }
+
+        public GCHeapInfo[] Heaps
+        {
+            get { return (GCHeapInfo[])heaps.Clone(); }
+        }
+    }
+
     public static class GC 
     {
         [System.Security.SecurityCritical]  // auto-generated
@@ -81,6 +207,30 @@ namespace System {
         [SuppressUnmanagedCodeSecurity]
         internal static extern int _EndNoGCRegion();
 
+        [System.Security.SecurityCritical]  // auto-generated
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern int _GetNumberOfHeaps();
+
+        [System.Security.SecurityCritical]  // auto-generated
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern byte[] _AllocatePinnedByteArray(int length);
+
+        [System.Security.SecurityCritical]  // auto-generated
+        [DllImport(JitHelpers.QCall, CharSet = CharSet.Unicode)]
+        [SuppressUnmanagedCodeSecurity]
+        private static extern unsafe int _GetGCInfoRecords(GCInfoRecord* records, GCInfoHeapRecord* heapRecords, int maxRecords);
+
+        [System.Security.SecurityCritical]  // auto-generated
+        [DllImport(JitHelpers.QCall, CharSet = CharSet.Unicode)]
+        [SuppressUnmanagedCodeSecurity]
+        private static extern void _WriteHeapSnapshot();
+
+        [System.Security.SecurityCritical]  // auto-generated
+        [DllImport(JitHelpers.QCall, CharSet = CharSet.Unicode)]
+        [SuppressUnmanagedCodeSecurity]
+        [return: MarshalAs(UnmanagedType.Bool)]
+        private static extern bool _WriteAllocationSamples();
+
         [System.Security.SecurityCritical]  // auto-generated
         [MethodImplAttribute(MethodImplOptions.InternalCall)]
         internal static extern int GetLOHCompactionMode();
@@ -539,6 +689,76 @@ namespace System {
         {
             EndNoGCRegionWorker();
         }
+
+        // Allocates a byte array on the pinned object heap. The GC never moves it, so 
+        // pinning it, e.g. for the lifetime of a buffer used for IO, is free and doesn't
+        // fragment gen0 and gen1. It's collected like any other gen2 object.
+        [System.Security.SecuritySafeCritical]
+        public static byte[] AllocatePinnedByteArray(int length)
+        {
+            if (length < 0)
+                throw new ArgumentOutOfRangeException("length", Environment.GetResourceString("ArgumentOutOfRange_NeedNonNegNum"));
+            Contract.EndContractBlock();
+
+            return _AllocatePinnedByteArray(length);
+        }
+
+        // Returns what up to count of the most recent GCs did, most recent first. The GC
+        // only keeps the last 64 so fewer may be returned.
+        [System.Security.SecuritySafeCritical]
+        public static unsafe GCInfo[] GetGCInfo(int count)
+        {
+            if (count < 0)
+                throw new ArgumentOutOfRangeException("count", Environment.GetResourceString("ArgumentOutOfRange_NeedNonNegNum"));
+            Contract.EndContractBlock();
+
+            int heapCount = _GetNumberOfHeaps();
+            GCInfoRecord[] records = new GCInfoRecord[count];
+            GCInfoHeapRecord[] heapRecords = new GCInfoHeapRecord[count * heapCount];
+
+            int recordCount = 0;
+            if (count > 0)
+            {
+                fixed (GCInfoRecord* pRecords = records)
+                fixed (GCInfoHeapRecord* pHeapRecords = heapRecords)
+                {
+                    recordCount = _GetGCInfoRecords(pRecords, pHeapRecords, count);
+                }
+            }
+
+            GCInfo[] infos = new GCInfo[recordCount];
+            for (int i = 0; i < recordCount; i++)
+            {
+                GCHeapInfo[] heaps = new GCHeapInfo[records[i].heapCount];
+                for (int heap = 0; heap < heaps.Length; heap++)
+                {
+                    heaps[heap] = new GCHeapInfo(heapRecords[i * heapCount + heap]);
+                }
+
+                infos[i] = new GCInfo(records[i], heaps);
+            }
+
+            return infos;
+        }
+
+        // Does a full blocking GC and takes a heap snapshot at the end of it. Snapshots
+        // are only taken when the GCHeapSnapshotFile config is set, otherwise this 
+        // is just a full blocking GC. The files are written out on another thread 
+        // so they may not be complete yet when this returns.
+        [System.Security.SecuritySafeCritical]
+        public static void WriteHeapSnapshot()
+        {
+            _WriteHeapSnapshot();
+        }
+
+        // Writes the allocation samples taken so far (see the AllocationSamplingRate
+        // config) to a new <AllocationSamplingFile>.<pid>.<n>.allocs file. Returns false
+        // if allocation sampling isn't on or the file couldn't be written.
+        [System.Security.SecuritySafeCritical]
+        public static bool WriteAllocationSamples()
+        {
+            return _WriteAllocationSamples();
+        }
     }
 
 #if !FEATURE_CORECLR
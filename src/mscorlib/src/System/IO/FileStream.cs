@@ -1277,6 +1277,14 @@ namespace System.IO {
             }
         }
 
+        // With overlapped IO our buffer gets pinned for every read and write it's
+        // used for, so we put it on the pinned object heap where being pinned 
+        // doesn't keep the GC from compacting around it.
+        private byte[] AllocateBuffer()
+        {
+            return _isAsync ? GC.AllocatePinnedByteArray(_bufferSize) : new byte[_bufferSize];
+        }
+
         // Reading is done by blocks from the file, but someone could read
         // 1 byte from the buffer then write.  At that point, the OS's file
         // pointer is out of sync with the stream's position.  All write 
@@ -1443,7 +1451,7 @@ namespace System.IO {
                     _readLen = 0;
                     return n;
                 }
-                if (_buffer == null) _buffer = new byte[_bufferSize];
+                if (_buffer == null) _buffer = AllocateBuffer();
                 n = ReadCore(_buffer, 0, _bufferSize);
                 if (n == 0) return 0;
                 isBlocked = n < _bufferSize;
@@ -1730,7 +1738,7 @@ namespace System.IO {
             }
             else if (count == 0)
                 return;  // Don't allocate a buffer then call memcpy for 0 bytes.
-            if (_buffer==null) _buffer = new byte[_bufferSize];
+            if (_buffer == null) _buffer = AllocateBuffer();
             // Copy remaining bytes into buffer, to write at a later date.
             Buffer.InternalBlockCopy(array, offset, _buffer, _writePos, count);
             _writePos = count;
@@ -1861,7 +1869,7 @@ namespace System.IO {
 
                 if (numBytes < _bufferSize)
                 {
-                    if (_buffer == null) _buffer = new byte[_bufferSize];
+                    if (_buffer == null) _buffer = AllocateBuffer();
                     IAsyncResult bufferRead = BeginReadCore(_buffer, 0, _bufferSize, null, null, 0);
                     _readLen = EndRead(bufferRead);
                     int n = _readLen;
@@ -2063,7 +2071,7 @@ namespace System.IO {
             if (_readPos == _readLen) {
                 if (_writePos > 0) FlushWrite(false);
                 Contract.Assert(_bufferSize > 0, "_bufferSize > 0");
-                if (_buffer == null) _buffer = new byte[_bufferSize];
+                if (_buffer == null) _buffer = AllocateBuffer();
                 _readLen = ReadCore(_buffer, 0, _bufferSize);
                 _readPos = 0;
             }
@@ -2295,7 +2303,7 @@ namespace System.IO {
                 _readPos = 0;
                 _readLen = 0;
                 Contract.Assert(_bufferSize > 0, "_bufferSize > 0");
-                if (_buffer==null) _buffer = new byte[_bufferSize];
+                if (_buffer == null) _buffer = AllocateBuffer();
             }
             if (_writePos == _bufferSize)
                 FlushWrite(false);
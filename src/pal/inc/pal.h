@@ -3262,6 +3262,26 @@ size_t
 PALAPI
 PAL_GetLogicalProcessorCacheSizeFromOS();
 
+PALIMPORT
+size_t
+PALAPI
+PAL_GetRestrictedPhysicalMemoryLimit();
+
+PALIMPORT
+BOOL
+PALAPI
+PAL_GetPhysicalMemoryUsed(size_t* val);
+
+PALIMPORT
+BOOL
+PALAPI
+PAL_GetCpuLimit(UINT* val);
+
+PALIMPORT
+size_t
+PALAPI
+PAL_GetLargePageSize();
+
 typedef BOOL (*ReadMemoryWordCallback)(SIZE_T address, SIZE_T *value);
 
 PALIMPORT BOOL PALAPI PAL_VirtualUnwind(CONTEXT *context, KNONVOLATILE_CONTEXT_POINTERS *contextPointers);
@@ -3372,6 +3392,7 @@ SetErrorMode(
 #define MEM_MAPPED                      0x40000
 #define MEM_TOP_DOWN                    0x100000
 #define MEM_WRITE_WATCH                 0x200000
+#define MEM_LARGE_PAGES                 0x20000000 // back the reservation with transparent huge pages where supported
 #define MEM_RESERVE_EXECUTABLE          0x40000000 // reserve memory using executable memory allocator
 
 PALIMPORT
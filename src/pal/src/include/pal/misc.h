@@ -76,6 +76,25 @@ Function :
 --*/
 void MsgBoxCleanup( void );
 
+/*++
+Function :
+    InitializeCGroup
+
+    Find the cgroup of the current process, which is used to
+    read the memory limits imposed on it.
+
+--*/
+void InitializeCGroup( void );
+
+/*++
+Function :
+    CleanupCGroup
+
+    Free the resources allocated by InitializeCGroup.
+
+--*/
+void CleanupCGroup( void );
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
@@ -58,6 +58,15 @@ typedef struct FREE_BLOCK {
 // The first node in our list of allocated blocks.
 static PCMI pVirtualMemory;
 
+#define THP_ENABLED_FILENAME "/sys/kernel/mm/transparent_hugepage/enabled"
+#define THP_PAGE_SIZE_FILENAME "/sys/kernel/mm/transparent_hugepage/hpage_pmd_size"
+
+// Size of the transparent huge pages MEM_LARGE_PAGES reservations ask for, read
+// once at init. 0 if the kernel doesn't have them or they are turned off.
+static SIZE_T s_largePageSize = 0;
+
+static SIZE_T VIRTUALReadLargePageSize();
+
 #if MMAP_IGNORES_HINT
 // The first node in our list of freed blocks.
 static FREE_BLOCK *pFreeMemory;
@@ -130,6 +139,8 @@ VIRTUALInitialize(bool initializeExecutableMemoryAllocator)
 
     pVirtualMemory = NULL;
 
+    s_largePageSize = VIRTUALReadLargePageSize();
+
     if (initializeExecutableMemoryAllocator)
     {
         g_executableMemoryAllocator.Initialize();
@@ -1063,6 +1074,129 @@ done:
     return pRetVal;
 }
 
+/******
+ *
+ *  VIRTUALReadLargePageSize() - Reads the size of the transparent huge pages
+ *  from sysfs. Returns 0 if they are set to "never", since madvise(MADV_HUGEPAGE)
+ *  then has no effect, or if the size isn't a power of 2 multiple of the page
+ *  size, since callers align reservations on it.
+ *
+ */
+static SIZE_T VIRTUALReadLargePageSize()
+{
+#ifdef MADV_HUGEPAGE
+    char enabled[64];
+    unsigned long long size = 0;
+
+    FILE *enabledFile = fopen(THP_ENABLED_FILENAME, "r");
+    if (enabledFile == nullptr)
+    {
+        return 0;
+    }
+
+    bool never = (fgets(enabled, sizeof(enabled), enabledFile) == nullptr) ||
+                 (strstr(enabled, "[never]") != nullptr);
+    fclose(enabledFile);
+    if (never)
+    {
+        return 0;
+    }
+
+    FILE *sizeFile = fopen(THP_PAGE_SIZE_FILENAME, "r");
+    if (sizeFile == nullptr)
+    {
+        return 0;
+    }
+
+    if (fscanf(sizeFile, "%llu", &size) != 1)
+    {
+        size = 0;
+    }
+    fclose(sizeFile);
+
+    if ((size <= VIRTUAL_PAGE_SIZE) || ((size & (size - 1)) != 0) || (size > SIZE_MAX))
+    {
+        return 0;
+    }
+
+    return (SIZE_T)size;
+#else  // MADV_HUGEPAGE
+    return 0;
+#endif // MADV_HUGEPAGE
+}
+
+/******
+ *
+ *  VIRTUALAdviseLargePages() - Asks for the committed range to be backed by
+ *  transparent huge pages. Unlike large pages on Windows, these don't need
+ *  to be committed when the region is reserved; the kernel uses them for the
+ *  parts of the range committed in whole, aligned huge pages. Committing
+ *  replaces the mapping, so this is done on every commit. It's only a hint,
+ *  so failing to set it doesn't fail the commit.
+ *
+ */
+static void VIRTUALAdviseLargePages(LPVOID lpAddress, SIZE_T dwSize)
+{
+#ifdef MADV_HUGEPAGE
+    if (madvise(lpAddress, dwSize, MADV_HUGEPAGE) != 0)
+    {
+        WARN("madvise(MADV_HUGEPAGE) failed! Error(%d)=%s\n", errno, strerror(errno));
+    }
+#else  // MADV_HUGEPAGE
+    WARN("Ignoring MEM_LARGE_PAGES, huge pages are not supported.\n");
+#endif // MADV_HUGEPAGE
+}
+
+/******
+ *
+ *  VIRTUALResetMemory() - Helper function that resets the memory. The pages
+ *  stay committed but their contents are no longer of interest, so the
+ *  kernel can reclaim them without writing them out. With MADV_FREE this is
+ *  done lazily, only under memory pressure, and a page written to again
+ *  before that is simply kept; otherwise MADV_DONTNEED frees the pages
+ *  right away and they are zero filled on the next access.
+ *
+ */
+static LPVOID VIRTUALResetMemory(
+                IN CPalThread *pthrCurrent, /* Currently executing thread */
+                IN LPVOID lpAddress,        /* Region to reset */
+                IN SIZE_T dwSize)           /* Size of Region */
+{
+    LPVOID pRetVal = NULL;
+    UINT_PTR StartBoundary;
+    SIZE_T MemSize;
+    int st;
+
+    TRACE( "Resetting the memory now..\n");
+
+    StartBoundary = (UINT_PTR)lpAddress & ~VIRTUAL_PAGE_MASK;
+    /* Add the sizes, and round down to the nearest page boundary. */
+    MemSize = ( ((UINT_PTR)lpAddress + dwSize + VIRTUAL_PAGE_MASK) & ~VIRTUAL_PAGE_MASK ) -
+               StartBoundary;
+
+#ifdef MADV_FREE
+    // MADV_FREE is only supported from Linux 4.5 on, so fall back to
+    // MADV_DONTNEED when the kernel rejects it.
+    st = madvise((LPVOID)StartBoundary, MemSize, MADV_FREE);
+    if (st != 0)
+#endif // MADV_FREE
+    {
+        st = madvise((LPVOID)StartBoundary, MemSize, MADV_DONTNEED);
+    }
+
+    if (st == 0)
+    {
+        pRetVal = lpAddress;
+    }
+    else
+    {
+        ERROR("madvise failed to reset the memory! Error(%d)=%s\n", errno, strerror(errno));
+        pthrCurrent->SetLastError(ERROR_INVALID_ADDRESS);
+    }
+
+    return pRetVal;
+}
+
 /******
  *
  *  VIRTUALCommitMemory() - Helper function that actually commits the memory.
@@ -1207,6 +1341,10 @@ static LPVOID VIRTUALCommitMemory(
 #endif // MMAP_DOESNOT_ALLOW_REMAP
             if (pRet != MAP_FAILED)
             {
+                if (pInformation->allocationType & MEM_LARGE_PAGES)
+                {
+                    VIRTUALAdviseLargePages((void *) StartBoundary, MemSize);
+                }
 #if MMAP_DOESNOT_ALLOW_REMAP
                 SIZE_T i;
                 char *temp = (char *) StartBoundary;
@@ -1614,6 +1752,8 @@ Function:
 Note:
   MEM_TOP_DOWN, MEM_PHYSICAL, MEM_WRITE_WATCH are not supported.
   Unsupported flags are ignored.
+  MEM_RESET is implemented with madvise and can't be combined with other
+  flags.
   
   Page size on i386 is set to 4k.
 
@@ -1642,11 +1782,27 @@ VirtualAlloc(
         goto done;
     }
 
+    if ( flAllocationType & MEM_RESET )
+    {
+        if ( flAllocationType != MEM_RESET )
+        {
+            ERROR( "MEM_RESET cannot be used with other allocation flags!\n" );
+            pthrCurrent->SetLastError( ERROR_INVALID_PARAMETER );
+            goto done;
+        }
+
+        InternalEnterCriticalSection(pthrCurrent, &virtual_critsec);
+        pRetVal = VIRTUALResetMemory( pthrCurrent, lpAddress, dwSize );
+        InternalLeaveCriticalSection(pthrCurrent, &virtual_critsec);
+
+        goto done;
+    }
+
     /* Test for un-supported flags. */
-    if ( ( flAllocationType & ~( MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_RESERVE_EXECUTABLE ) ) != 0 )
+    if ( ( flAllocationType & ~( MEM_COMMIT | MEM_RESERVE | MEM_TOP_DOWN | MEM_RESERVE_EXECUTABLE | MEM_LARGE_PAGES ) ) != 0 )
     {
         ASSERT( "flAllocationType can be one, or any combination of MEM_COMMIT, \
-               MEM_RESERVE, MEM_TOP_DOWN, or MEM_RESERVE_EXECUTABLE.\n" );
+               MEM_RESERVE, MEM_TOP_DOWN, MEM_RESERVE_EXECUTABLE, or MEM_LARGE_PAGES.\n" );
         pthrCurrent->SetLastError( ERROR_INVALID_PARAMETER );
         goto done;
     }
@@ -2352,6 +2508,25 @@ ResetWriteWatch(
     return 1;
 }
 
+/*++
+Function:
+  PAL_GetLargePageSize
+
+Gets the size of the transparent huge pages that memory reserved with
+MEM_LARGE_PAGES is backed with once it's committed in whole, aligned pages
+of that size.
+
+Return value:
+  The large page size, or 0 if transparent huge pages are not available.
+
+--*/
+size_t
+PALAPI
+PAL_GetLargePageSize()
+{
+    return s_largePageSize;
+}
+
 /*++
 Function :
     ReserveMemoryFromExecutableAllocator
@@ -0,0 +1,693 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+/*++
+
+
+
+Module Name:
+
+    cgroup.cpp
+
+Abstract:
+    Read the memory and CPU limits imposed on the current process by the
+    cgroups (control groups) it belongs to. Both the v1 (one hierarchy per controller)
+    and the v2 (unified hierarchy) layouts are supported.
+
+
+
+--*/
+
+#include "pal/palinternal.h"
+#include "pal/dbgmsg.h"
+#include "pal/misc.h"
+#include "pal/malloc.hpp"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace CorUnix;
+
+SET_DEFAULT_DEBUG_CHANNEL(MISC);
+
+#define PROC_MOUNTINFO_FILENAME "/proc/self/mountinfo"
+#define PROC_CGROUP_FILENAME "/proc/self/cgroup"
+#define PROC_STATM_FILENAME "/proc/self/statm"
+
+#define CGROUP1_MEMORY_LIMIT_FILENAME "/memory.limit_in_bytes"
+#define CGROUP1_MEMORY_USAGE_FILENAME "/memory.usage_in_bytes"
+#define CGROUP1_MEMORY_STAT_INACTIVE_FIELD "total_inactive_file "
+#define CGROUP2_MEMORY_LIMIT_FILENAME "/memory.max"
+#define CGROUP2_MEMORY_USAGE_FILENAME "/memory.current"
+#define CGROUP2_MEMORY_STAT_INACTIVE_FIELD "inactive_file "
+#define CGROUP_MEMORY_STAT_FILENAME "/memory.stat"
+#define CGROUP1_CPU_QUOTA_FILENAME "/cpu.cfs_quota_us"
+#define CGROUP1_CPU_PERIOD_FILENAME "/cpu.cfs_period_us"
+#define CGROUP2_CPU_MAX_FILENAME "/cpu.max"
+
+class CGroup
+{
+    // Directory of the memory cgroup of the current process, or NULL if the
+    // memory controller is not mounted or the process is not in a cgroup.
+    static char *s_memory_cgroup_path;
+
+    // Mount point of the hierarchy containing s_memory_cgroup_path. Limits are
+    // inherited from ancestor cgroups, so they are looked up to this directory.
+    static char *s_memory_cgroup_mount;
+
+    static bool s_memory_cgroup_v2;
+
+    // Same as above, for the cpu controller.
+    static char *s_cpu_cgroup_path;
+    static char *s_cpu_cgroup_mount;
+    static bool s_cpu_cgroup_v2;
+
+    // The CPU limit doesn't change while the process runs, and it's asked for
+    // on hot paths (Environment.ProcessorCount), so it's read once at init.
+    static bool s_cpu_limit_found;
+    static UINT s_cpu_limit;
+
+public:
+    static void Initialize()
+    {
+        FindCGroupPath("memory", &s_memory_cgroup_path, &s_memory_cgroup_mount, &s_memory_cgroup_v2);
+        FindCGroupPath("cpu", &s_cpu_cgroup_path, &s_cpu_cgroup_mount, &s_cpu_cgroup_v2);
+        s_cpu_limit_found = ReadCpuLimit(&s_cpu_limit);
+    }
+
+    static void Cleanup()
+    {
+        InternalFree(s_memory_cgroup_path);
+        InternalFree(s_memory_cgroup_mount);
+        InternalFree(s_cpu_cgroup_path);
+        InternalFree(s_cpu_cgroup_mount);
+        s_memory_cgroup_path = nullptr;
+        s_memory_cgroup_mount = nullptr;
+        s_cpu_cgroup_path = nullptr;
+        s_cpu_cgroup_mount = nullptr;
+        s_cpu_limit_found = false;
+    }
+
+    // Get the smallest memory limit set on the cgroup of the process or on
+    // any of its ancestors. Returns false if no limit is set.
+    static bool GetPhysicalMemoryLimit(size_t *val)
+    {
+        if (s_memory_cgroup_path == nullptr)
+            return false;
+
+        const char *limitFilename = s_memory_cgroup_v2 ? CGROUP2_MEMORY_LIMIT_FILENAME : CGROUP1_MEMORY_LIMIT_FILENAME;
+        size_t mountLen = strlen(s_memory_cgroup_mount);
+        size_t pathLen = strlen(s_memory_cgroup_path);
+        size_t limitFilenameLen = strlen(limitFilename);
+
+        char *filename = (char *)InternalMalloc(pathLen + limitFilenameLen + 1);
+        if (filename == nullptr)
+            return false;
+
+        bool foundLimit = false;
+        size_t limit = SIZE_MAX;
+
+        // Walk from the cgroup of the process up to the root of the hierarchy.
+        for (;;)
+        {
+            memcpy(filename, s_memory_cgroup_path, pathLen);
+            memcpy(filename + pathLen, limitFilename, limitFilenameLen + 1);
+
+            size_t levelLimit;
+            if (ReadMemoryValueFromFile(filename, &levelLimit) && levelLimit < limit)
+            {
+                limit = levelLimit;
+                foundLimit = true;
+            }
+
+            if (!MoveToParentCGroup(filename, &pathLen, mountLen))
+                break;
+        }
+
+        InternalFree(filename);
+
+        if (foundLimit)
+            *val = limit;
+        return foundLimit;
+    }
+
+    // Get the CPU limit read by Initialize (see ReadCpuLimit). Returns false if
+    // no quota is set.
+    static bool GetCpuLimit(UINT *val)
+    {
+        if (s_cpu_limit_found)
+            *val = s_cpu_limit;
+        return s_cpu_limit_found;
+    }
+
+    // Get the memory charged to the cgroup of the process, not counting file
+    // pages that the kernel can reclaim without writing them out.
+    static bool GetPhysicalMemoryUsage(size_t *val)
+    {
+        if (s_memory_cgroup_path == nullptr)
+            return false;
+
+        size_t usage;
+        if (!ReadMemoryValueFromCGroupFile(
+                s_memory_cgroup_v2 ? CGROUP2_MEMORY_USAGE_FILENAME : CGROUP1_MEMORY_USAGE_FILENAME,
+                &usage))
+        {
+            return false;
+        }
+
+        size_t inactive;
+        if (ReadStatValueFromCGroupFile(
+                CGROUP_MEMORY_STAT_FILENAME,
+                s_memory_cgroup_v2 ? CGROUP2_MEMORY_STAT_INACTIVE_FIELD : CGROUP1_MEMORY_STAT_INACTIVE_FIELD,
+                &inactive) &&
+            inactive < usage)
+        {
+            usage -= inactive;
+        }
+
+        *val = usage;
+        return true;
+    }
+
+private:
+    // Get the number of CPUs the CFS bandwidth quota set on the cgroup of the
+    // process, or on any of its ancestors, allows it to use; a fractional
+    // quota is rounded up. Returns false if no quota is set.
+    static bool ReadCpuLimit(UINT *val)
+    {
+        if (s_cpu_cgroup_path == nullptr)
+            return false;
+
+        size_t mountLen = strlen(s_cpu_cgroup_mount);
+        size_t pathLen = strlen(s_cpu_cgroup_path);
+
+        char *path = (char *)InternalMalloc(pathLen + 1);
+        if (path == nullptr)
+            return false;
+        memcpy(path, s_cpu_cgroup_path, pathLen + 1);
+
+        bool foundLimit = false;
+        UINT limit = UINT_MAX;
+
+        for (;;)
+        {
+            path[pathLen] = '\0';
+
+            long long quota;
+            long long period;
+            if (ReadCpuQuotaAndPeriod(path, &quota, &period))
+            {
+                unsigned long long cpus = ((unsigned long long)quota + (unsigned long long)period - 1) / (unsigned long long)period;
+                UINT levelLimit = (cpus > UINT_MAX) ? UINT_MAX : (UINT)cpus;
+                if (levelLimit < limit)
+                {
+                    limit = levelLimit;
+                    foundLimit = true;
+                }
+            }
+
+            if (!MoveToParentCGroup(path, &pathLen, mountLen))
+                break;
+        }
+
+        InternalFree(path);
+
+        if (foundLimit)
+            *val = (limit == 0) ? 1 : limit;
+        return foundLimit;
+    }
+
+    // Shorten the cgroup directory held in the first *pathLen characters of
+    // path to its parent. Returns false once the mount point of the hierarchy
+    // has been reached.
+    static bool MoveToParentCGroup(char *path, size_t *pathLen, size_t mountLen)
+    {
+        size_t len = *pathLen;
+        if (len <= mountLen)
+            return false;
+
+        while (len > mountLen && path[len - 1] != '/')
+            len--;
+        if (len > mountLen)
+            len--;
+
+        *pathLen = len;
+        return true;
+    }
+
+    // Read the CFS bandwidth quota and period of a cgroup directory. v1 keeps
+    // them in two files, with a quota of -1 meaning no quota; v2 has a single
+    // "quota period" line where the quota is "max" when there is none.
+    static bool ReadCpuQuotaAndPeriod(const char *cgroupDir, long long *quota, long long *period)
+    {
+        bool result = false;
+
+        if (s_cpu_cgroup_v2)
+        {
+            char *filename = ConcatPath(cgroupDir, CGROUP2_CPU_MAX_FILENAME);
+            if (filename == nullptr)
+                return false;
+
+            FILE *file = fopen(filename, "r");
+            InternalFree(filename);
+            if (file == nullptr)
+                return false;
+
+            result = (fscanf(file, "%lld %lld", quota, period) == 2);
+            fclose(file);
+        }
+        else
+        {
+            result = ReadLongLongFromCGroupFile(cgroupDir, CGROUP1_CPU_QUOTA_FILENAME, quota) &&
+                     ReadLongLongFromCGroupFile(cgroupDir, CGROUP1_CPU_PERIOD_FILENAME, period);
+        }
+
+        return result && *quota > 0 && *period > 0;
+    }
+
+    static bool ReadLongLongFromCGroupFile(const char *cgroupDir, const char *filename, long long *val)
+    {
+        char *fullFilename = ConcatPath(cgroupDir, filename);
+        if (fullFilename == nullptr)
+            return false;
+
+        FILE *file = fopen(fullFilename, "r");
+        InternalFree(fullFilename);
+        if (file == nullptr)
+            return false;
+
+        bool result = (fscanf(file, "%lld", val) == 1);
+        fclose(file);
+        return result;
+    }
+
+    static bool IsControllerInList(const char *list, size_t listLen, const char *controller)
+    {
+        size_t controllerLen = strlen(controller);
+        const char *end = list + listLen;
+
+        while (list < end)
+        {
+            const char *sep = (const char *)memchr(list, ',', end - list);
+            size_t itemLen = (sep != nullptr) ? (size_t)(sep - list) : (size_t)(end - list);
+            if (itemLen == controllerLen && strncmp(list, controller, controllerLen) == 0)
+                return true;
+
+            if (sep == nullptr)
+                break;
+            list = sep + 1;
+        }
+
+        return false;
+    }
+
+    // Find the mount point and root of the hierarchy the controller is attached
+    // to. A v1 hierarchy is preferred over the unified v2 hierarchy, which is
+    // what the kernel does in hybrid setups.
+    static bool FindHierarchyMount(const char *controller, char **pMountRoot, char **pMountPath, bool *pIsV2)
+    {
+        FILE *mountinfoFile = fopen(PROC_MOUNTINFO_FILENAME, "r");
+        if (mountinfoFile == nullptr)
+            return false;
+
+        char *line = nullptr;
+        size_t lineLen = 0;
+        bool found = false;
+
+        while (!found && getline(&line, &lineLen, mountinfoFile) != -1)
+        {
+            // Each line looks like:
+            //   36 35 98:0 /root /mount/point rw,noatime master:1 - cgroup cgroup rw,memory
+            // with a variable number of optional fields before the " - " separator.
+            char *separator = strstr(line, " - ");
+            if (separator == nullptr)
+                continue;
+
+            char fsType[64];
+            char superOptions[512];
+            if (sscanf(separator + 3, "%63s %*s %511s", fsType, superOptions) != 2)
+                continue;
+
+            bool isV2 = (strcmp(fsType, "cgroup2") == 0);
+            if (isV2)
+            {
+                // Remember the unified hierarchy, but keep looking for a v1 one.
+                if (*pMountPath != nullptr)
+                    continue;
+            }
+            else if (strcmp(fsType, "cgroup") != 0 ||
+                     !IsControllerInList(superOptions, strlen(superOptions), controller))
+            {
+                continue;
+            }
+
+            char mountRoot[PATH_MAX];
+            char mountPath[PATH_MAX];
+            if (sscanf(line, "%*s %*s %*s %4095s %4095s", mountRoot, mountPath) != 2)
+                continue;
+
+            InternalFree(*pMountRoot);
+            InternalFree(*pMountPath);
+            *pMountRoot = (char *)InternalMalloc(strlen(mountRoot) + 1);
+            *pMountPath = (char *)InternalMalloc(strlen(mountPath) + 1);
+            if (*pMountRoot == nullptr || *pMountPath == nullptr)
+                break;
+
+            strcpy(*pMountRoot, mountRoot);
+            strcpy(*pMountPath, mountPath);
+            *pIsV2 = isV2;
+            found = !isV2;
+        }
+
+        free(line);
+        fclose(mountinfoFile);
+
+        if (*pMountRoot == nullptr || *pMountPath == nullptr)
+        {
+            InternalFree(*pMountRoot);
+            InternalFree(*pMountPath);
+            *pMountRoot = nullptr;
+            *pMountPath = nullptr;
+            return false;
+        }
+
+        return true;
+    }
+
+    // Find the path of the cgroup of the process, relative to the root of its
+    // hierarchy, from /proc/self/cgroup.
+    static char *FindCGroupPathInHierarchy(const char *controller, bool isV2)
+    {
+        FILE *cgroupFile = fopen(PROC_CGROUP_FILENAME, "r");
+        if (cgroupFile == nullptr)
+            return nullptr;
+
+        char *line = nullptr;
+        size_t lineLen = 0;
+        char *cgroupPath = nullptr;
+
+        while (getline(&line, &lineLen, cgroupFile) != -1)
+        {
+            // Each line looks like "hierarchy-ID:controller-list:cgroup-path".
+            // The unified hierarchy has ID 0 and an empty controller list.
+            char *controllers = strchr(line, ':');
+            if (controllers == nullptr)
+                continue;
+            controllers++;
+
+            char *path = strchr(controllers, ':');
+            if (path == nullptr)
+                continue;
+
+            bool match = isV2 ?
+                (strncmp(line, "0::", 3) == 0) :
+                IsControllerInList(controllers, path - controllers, controller);
+            if (!match)
+                continue;
+
+            path++;
+            size_t pathLen = strlen(path);
+            if (pathLen > 0 && path[pathLen - 1] == '\n')
+                path[--pathLen] = '\0';
+
+            cgroupPath = (char *)InternalMalloc(pathLen + 1);
+            if (cgroupPath != nullptr)
+                strcpy(cgroupPath, path);
+            break;
+        }
+
+        free(line);
+        fclose(cgroupFile);
+        return cgroupPath;
+    }
+
+    static void FindCGroupPath(const char *controller, char **pCGroupPath, char **pMountPath, bool *pIsV2)
+    {
+        char *mountRoot = nullptr;
+        char *mountPath = nullptr;
+        char *cgroupPath = nullptr;
+        char *fullPath = nullptr;
+        bool isV2 = false;
+
+        *pCGroupPath = nullptr;
+        *pMountPath = nullptr;
+
+        if (!FindHierarchyMount(controller, &mountRoot, &mountPath, &isV2))
+            goto done;
+
+        cgroupPath = FindCGroupPathInHierarchy(controller, isV2);
+        if (cgroupPath == nullptr)
+            goto done;
+
+        {
+            // Inside a container, the root of the mounted hierarchy is usually
+            // the cgroup of the container itself, so the part of the cgroup
+            // path that it already covers has to be skipped.
+            const char *relativePath = cgroupPath;
+            size_t mountRootLen = strlen(mountRoot);
+            if (strcmp(mountRoot, "/") != 0 &&
+                strncmp(cgroupPath, mountRoot, mountRootLen) == 0 &&
+                (cgroupPath[mountRootLen] == '/' || cgroupPath[mountRootLen] == '\0'))
+            {
+                relativePath = cgroupPath + mountRootLen;
+            }
+
+            size_t mountPathLen = strlen(mountPath);
+            size_t relativePathLen = strlen(relativePath);
+            if (relativePathLen == 1 && relativePath[0] == '/')
+                relativePathLen = 0;
+
+            fullPath = (char *)InternalMalloc(mountPathLen + relativePathLen + 1);
+            if (fullPath == nullptr)
+                goto done;
+
+            memcpy(fullPath, mountPath, mountPathLen);
+            memcpy(fullPath + mountPathLen, relativePath, relativePathLen);
+            fullPath[mountPathLen + relativePathLen] = '\0';
+        }
+
+        *pCGroupPath = fullPath;
+        *pMountPath = mountPath;
+        *pIsV2 = isV2;
+        mountPath = nullptr;
+
+    done:
+        InternalFree(mountRoot);
+        InternalFree(mountPath);
+        InternalFree(cgroupPath);
+    }
+
+    // Read a single number from a cgroup file. A value of "max" means that no
+    // limit is set, and is reported as a failure.
+    static bool ReadMemoryValueFromFile(const char *filename, size_t *val)
+    {
+        FILE *file = fopen(filename, "r");
+        if (file == nullptr)
+            return false;
+
+        char *line = nullptr;
+        size_t lineLen = 0;
+        bool result = false;
+
+        if (getline(&line, &lineLen, file) != -1 && strncmp(line, "max", 3) != 0)
+        {
+            char *endptr;
+            errno = 0;
+            unsigned long long num = strtoull(line, &endptr, 10);
+            if (endptr != line && errno == 0)
+            {
+                *val = (num > SIZE_MAX) ? SIZE_MAX : (size_t)num;
+                result = true;
+            }
+        }
+
+        free(line);
+        fclose(file);
+        return result;
+    }
+
+    static bool ReadMemoryValueFromCGroupFile(const char *filename, size_t *val)
+    {
+        char *fullFilename = ConcatPath(s_memory_cgroup_path, filename);
+        if (fullFilename == nullptr)
+            return false;
+
+        bool result = ReadMemoryValueFromFile(fullFilename, val);
+        InternalFree(fullFilename);
+        return result;
+    }
+
+    // Read the value of a "key value" line from a cgroup file such as memory.stat.
+    static bool ReadStatValueFromCGroupFile(const char *filename, const char *field, size_t *val)
+    {
+        char *fullFilename = ConcatPath(s_memory_cgroup_path, filename);
+        if (fullFilename == nullptr)
+            return false;
+
+        FILE *file = fopen(fullFilename, "r");
+        InternalFree(fullFilename);
+        if (file == nullptr)
+            return false;
+
+        char *line = nullptr;
+        size_t lineLen = 0;
+        size_t fieldLen = strlen(field);
+        bool result = false;
+
+        while (getline(&line, &lineLen, file) != -1)
+        {
+            if (strncmp(line, field, fieldLen) == 0)
+            {
+                char *endptr;
+                errno = 0;
+                unsigned long long num = strtoull(line + fieldLen, &endptr, 10);
+                if (endptr != line + fieldLen && errno == 0)
+                {
+                    *val = (num > SIZE_MAX) ? SIZE_MAX : (size_t)num;
+                    result = true;
+                }
+                break;
+            }
+        }
+
+        free(line);
+        fclose(file);
+        return result;
+    }
+
+    static char *ConcatPath(const char *path, const char *filename)
+    {
+        size_t pathLen = strlen(path);
+        size_t filenameLen = strlen(filename);
+        char *fullFilename = (char *)InternalMalloc(pathLen + filenameLen + 1);
+        if (fullFilename != nullptr)
+        {
+            memcpy(fullFilename, path, pathLen);
+            memcpy(fullFilename + pathLen, filename, filenameLen + 1);
+        }
+        return fullFilename;
+    }
+};
+
+char *CGroup::s_memory_cgroup_path = nullptr;
+char *CGroup::s_memory_cgroup_mount = nullptr;
+bool CGroup::s_memory_cgroup_v2 = false;
+char *CGroup::s_cpu_cgroup_path = nullptr;
+char *CGroup::s_cpu_cgroup_mount = nullptr;
+bool CGroup::s_cpu_cgroup_v2 = false;
+bool CGroup::s_cpu_limit_found = false;
+UINT CGroup::s_cpu_limit = 0;
+
+void InitializeCGroup()
+{
+    CGroup::Initialize();
+}
+
+void CleanupCGroup()
+{
+    CGroup::Cleanup();
+}
+
+/*++
+Function:
+  PAL_GetRestrictedPhysicalMemoryLimit
+
+Gets the memory limit imposed on the current process by its cgroup.
+
+Return value:
+  The limit in bytes, or 0 if the process is not restricted to less than
+  the physical memory of the machine.
+
+--*/
+size_t
+PALAPI
+PAL_GetRestrictedPhysicalMemoryLimit()
+{
+    size_t physical_memory_limit;
+
+    if (!CGroup::GetPhysicalMemoryLimit(&physical_memory_limit))
+        return 0;
+
+    // A cgroup without a limit reports a very large number; anything at or
+    // above the physical memory of the machine does not restrict us.
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGE_SIZE);
+    if (pages != -1 && pageSize != -1 &&
+        physical_memory_limit >= (size_t)pages * (size_t)pageSize)
+    {
+        return 0;
+    }
+
+    return physical_memory_limit;
+}
+
+/*++
+Function:
+  PAL_GetPhysicalMemoryUsed
+
+Gets the physical memory in use by the current process. When the process
+is in a memory cgroup, this is the memory charged to the cgroup, which is
+what its limit is enforced against; otherwise it is the resident set size.
+
+Return value:
+  TRUE if the value was retrieved, FALSE otherwise.
+
+--*/
+BOOL
+PALAPI
+PAL_GetPhysicalMemoryUsed(size_t *val)
+{
+    if (val == nullptr)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+
+    if (CGroup::GetPhysicalMemoryUsage(val))
+        return TRUE;
+
+    // The second field of statm is the resident set size in pages.
+    FILE *statmFile = fopen(PROC_STATM_FILENAME, "r");
+    if (statmFile == nullptr)
+        return FALSE;
+
+    BOOL result = FALSE;
+    unsigned long long residentPages;
+    long pageSize = sysconf(_SC_PAGE_SIZE);
+    if (fscanf(statmFile, "%*s %llu", &residentPages) == 1 && pageSize != -1)
+    {
+        *val = (size_t)(residentPages * (unsigned long long)pageSize);
+        result = TRUE;
+    }
+
+    fclose(statmFile);
+    return result;
+}
+
+/*++
+Function:
+  PAL_GetCpuLimit
+
+Gets the number of CPUs the CPU quota of the cgroup of the current process
+allows it to use, rounded up to a whole number of CPUs.
+
+Return value:
+  TRUE if the process has a CPU quota, FALSE otherwise.
+
+--*/
+BOOL
+PALAPI
+PAL_GetCpuLimit(UINT *val)
+{
+    if (val == nullptr)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+
+    return CGroup::GetCpuLimit(val) ? TRUE : FALSE;
+}
@@ -0,0 +1,72 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+/*=============================================================
+**
+** Source:  virtualalloc.c
+**
+** Purpose: Positive test the VirtualAlloc API.
+**          Ensure that committed memory can be reset with MEM_RESET,
+**          that it stays committed and accessible afterwards, and
+**          that MEM_RESET combined with other flags fails.
+**
+**
+**============================================================*/
+#include <palsuite.h>
+
+#define REGION_SIZE (16 * 4096)
+
+int __cdecl main(int argc, char *argv[])
+{
+    int err;
+    char *ptr;
+    LPVOID result;
+
+    //Initialize the PAL environment
+    err = PAL_Initialize(argc, argv);
+    if(0 != err)
+    {
+        ExitProcess(FAIL);
+    }
+
+    ptr = (char *) VirtualAlloc(NULL, REGION_SIZE, MEM_COMMIT | MEM_RESERVE,
+                                PAGE_READWRITE);
+    if (ptr == NULL)
+    {
+        Fail("VirtualAlloc failed to commit the memory!\n");
+    }
+    memset(ptr, 0x5a, REGION_SIZE);
+
+    result = VirtualAlloc(ptr, REGION_SIZE, MEM_RESET, PAGE_READWRITE);
+    if (result != ptr)
+    {
+        VirtualFree(ptr, 0, MEM_RELEASE);
+        Fail("VirtualAlloc failed to reset the memory!\n");
+    }
+
+    // The contents are undefined after a reset, but the memory must
+    // still be writable and keep what's written to it.
+    ptr[0] = 1;
+    ptr[REGION_SIZE - 1] = 2;
+    if (ptr[0] != 1 || ptr[REGION_SIZE - 1] != 2)
+    {
+        VirtualFree(ptr, 0, MEM_RELEASE);
+        Fail("Memory reset with MEM_RESET is not usable!\n");
+    }
+
+    result = VirtualAlloc(ptr, REGION_SIZE, MEM_RESET | MEM_COMMIT, PAGE_READWRITE);
+    if (result != NULL)
+    {
+        VirtualFree(ptr, 0, MEM_RELEASE);
+        Fail("VirtualAlloc accepted MEM_RESET combined with MEM_COMMIT!\n");
+    }
+
+    if (!VirtualFree(ptr, 0, MEM_RELEASE))
+    {
+        Fail("VirtualFree failed to release the memory!\n");
+    }
+
+    PAL_Terminate();
+    return PASS;
+}
@@ -1242,8 +1242,18 @@ int GetCurrentProcessCpuCount()
 
     SYSTEM_INFO sysInfo;
     ::GetSystemInfo(&sysInfo);
-    cCPUs = sysInfo.dwNumberOfProcessors;
-    return sysInfo.dwNumberOfProcessors;
+    DWORD count = sysInfo.dwNumberOfProcessors;
+
+#ifdef FEATURE_PAL
+    // A CPU quota (e.g. a container started with --cpus) limits how much of the
+    // machine the process gets to use even though it can run on every processor.
+    UINT cpuLimit;
+    if (PAL_GetCpuLimit(&cpuLimit) && cpuLimit < count)
+        count = cpuLimit;
+#endif // FEATURE_PAL
+
+    cCPUs = count;
+    return count;
 
 #endif // !FEATURE_CORESYSTEM
 }
@@ -0,0 +1,285 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+// ===========================================================================
+// File: allocationsampling.cpp
+//
+
+#include "common.h"
+
+#ifndef DACCESS_COMPILE
+#include "allocationsampling.h"
+#include "typestring.h"
+#include "fstream.h"
+#include <math.h>
+
+SIZE_T AllocationSampler::s_MeanBytes = 0;
+AllocationSampler::Sample * AllocationSampler::s_Samples = NULL;
+DWORD AllocationSampler::s_SampleCount = 0;
+Volatile<LONG> AllocationSampler::s_NextSample = 0;
+LPWSTR AllocationSampler::s_FileName = NULL;
+DWORD AllocationSampler::s_DumpCount = 0;
+
+// Initialize the sampler for the process - called from EEStartupHelper.
+void AllocationSampler::Initialize()
+{
+    STANDARD_VM_CONTRACT;
+
+    DWORD meanBytes = CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_AllocationSamplingRate);
+    DWORD sampleCount = CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_AllocationSamplingBufferSize);
+
+    // Only enable sampling if requested.
+    if ((meanBytes == 0) || (sampleCount == 0))
+    {
+        return;
+    }
+
+    s_Samples = new (nothrow) Sample[sampleCount];
+    if (s_Samples == NULL)
+    {
+        return;
+    }
+    memset(s_Samples, 0, sampleCount * sizeof(Sample));
+
+    s_SampleCount = sampleCount;
+    s_FileName = CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_AllocationSamplingFile);
+    s_MeanBytes = meanBytes;
+}
+
+// Pick the number of bytes the thread allocates before its next sample. The
+// distances are exponentially distributed so that sampling is a Poisson process
+// over allocated bytes, which does not alias with allocation patterns.
+UINT64 AllocationSampler::NextSampleDistance(Thread * pThread)
+{
+    LIMITED_METHOD_CONTRACT;
+
+    DWORD x = pThread->m_allocSampleRandom;
+    if (x == 0)
+    {
+        x = ((pThread->GetOSThreadId() * 2654435761U) ^ GetTickCount()) | 1;
+    }
+
+    // xorshift32
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    pThread->m_allocSampleRandom = x;
+
+    // Uniform in (0, 1], so the distance is at most about 17 times the mean.
+    double u = (double)((x >> 8) + 1) / (double)(1 << 24);
+    return (UINT64)(-log(u) * (double)s_MeanBytes) + 1;
+}
+
+void AllocationSampler::OnAllocationWorker(Object * pObject)
+{
+    CONTRACTL
+    {
+        NOTHROW;
+        GC_NOTRIGGER;
+        MODE_COOPERATIVE;
+        PRECONDITION(pObject != NULL);
+    }
+    CONTRACTL_END;
+
+    Thread * pThread = GetThread();
+
+    // The context's byte counts include the part of it that has not been used yet.
+    alloc_context * acontext = pThread->GetAllocContext();
+    INT64 allocated = acontext->alloc_bytes + acontext->alloc_bytes_loh -
+                      (INT64)(acontext->alloc_limit - acontext->alloc_ptr);
+    if (allocated < 0)
+    {
+        allocated = 0;
+    }
+
+    if (pThread->m_allocSampleThreshold == 0)
+    {
+        pThread->m_allocSampleThreshold = (UINT64)allocated + NextSampleDistance(pThread);
+        return;
+    }
+
+    if ((UINT64)allocated < pThread->m_allocSampleThreshold)
+    {
+        return;
+    }
+
+    pThread->m_allocSampleThreshold = (UINT64)allocated + NextSampleDistance(pThread);
+    TakeSample(pThread, pObject);
+}
+
+StackWalkAction AllocationSampler::CaptureFrameCallback(CrawlFrame * pCF, VOID * pData)
+{
+    LIMITED_METHOD_CONTRACT;
+
+    Sample * pSample = (Sample *)pData;
+    _ASSERTE(pSample->m_FrameCount < MaxStackFrames);
+    MethodDesc * pFunc = pCF->GetFunction();
+
+    // Methods of collectible types can be gone by the time the buffer is dumped.
+    if ((pFunc == NULL) || pFunc->GetMethodTable()->Collectible())
+    {
+        return SWA_CONTINUE;
+    }
+
+    pSample->m_Frames[pSample->m_FrameCount++] = pFunc;
+    return (pSample->m_FrameCount == MaxStackFrames) ? SWA_ABORT : SWA_CONTINUE;
+}
+
+void AllocationSampler::TakeSample(Thread * pThread, Object * pObject)
+{
+    CONTRACTL
+    {
+        NOTHROW;
+        GC_NOTRIGGER;
+        MODE_COOPERATIVE;
+    }
+    CONTRACTL_END;
+
+    MethodTable * pMT = pObject->GetMethodTable();
+    if (pMT->Collectible())
+    {
+        return;
+    }
+
+    // The stack is captured into a sample of our own - once the buffer wraps
+    // another thread can be given the same slot, see below.
+    Sample sample;
+    sample.m_pMT = pMT;
+    sample.m_Size = pObject->GetSize();
+    sample.m_ThreadId = pThread->GetOSThreadId();
+    sample.m_FrameCount = 0;
+
+    pThread->StackWalkFrames(CaptureFrameCallback, &sample, FUNCTIONSONLY | QUICKUNWIND);
+
+    LONG index = FastInterlockIncrement((LONG *)&s_NextSample) - 1;
+    Sample * pSlot = &s_Samples[(DWORD)index % s_SampleCount];
+
+    // Once the buffer wraps, a thread given an earlier index for this slot may 
+    // still be writing it, or one given a later index may have written it 
+    // already. We only take the slot if it holds an older sample and nobody is
+    // writing it, and claim it with a CAS so there's only ever one writer - 
+    // otherwise this sample is dropped. Marking it as being written also makes 
+    // a concurrent dump skip it.
+    LONG sequence = pSlot->m_Sequence;
+    if ((sequence == SampleBeingWritten) || (sequence > index) ||
+        (FastInterlockCompareExchange((LONG *)&pSlot->m_Sequence, SampleBeingWritten, sequence) != sequence))
+    {
+        return;
+    }
+
+    pSlot->m_pMT = sample.m_pMT;
+    pSlot->m_Size = sample.m_Size;
+    pSlot->m_ThreadId = sample.m_ThreadId;
+    pSlot->m_FrameCount = sample.m_FrameCount;
+    memcpy(pSlot->m_Frames, sample.m_Frames, sample.m_FrameCount * sizeof(MethodDesc *));
+    pSlot->m_Sequence = index + 1;
+}
+
+static void WriteDumpLine(CFileStream * pStream, SString & line)
+{
+    STANDARD_VM_CONTRACT;
+
+    StackScratchBuffer scratch;
+    const char * strLine = line.GetANSI(scratch);
+    ULONG outCount;
+    pStream->Write(strLine, (ULONG)strlen(strLine), &outCount);
+}
+
+// Write the ring buffer as text, oldest sample first, followed by a summary:
+//
+// sample <os thread id> <size> <type>
+//     at <method>
+// ...
+// # samples <written> taken <total> rate <mean bytes>
+//
+BOOL AllocationSampler::WriteDump()
+{
+    CONTRACTL
+    {
+        NOTHROW;
+        GC_TRIGGERS;
+        MODE_ANY;
+    }
+    CONTRACTL_END;
+
+    if ((s_Samples == NULL) || (s_FileName == NULL))
+    {
+        return FALSE;
+    }
+
+    BOOL fWritten = FALSE;
+
+    GCX_PREEMP();
+
+    // Dumping failures should not cause any exceptions to flow upstream.
+    EX_TRY
+    {
+        DWORD dumpIndex = FastInterlockIncrement((LONG *)&s_DumpCount) - 1;
+
+        SString path;
+        path.Printf("%S.%d.%u.allocs", s_FileName, GetCurrentProcessId(), dumpIndex);
+
+        CFileStream stream;
+        if (SUCCEEDED(stream.OpenForWrite(path.GetUnicode())))
+        {
+            DWORD total = (DWORD)(LONG)s_NextSample;
+            DWORD first = (total > s_SampleCount) ? (total - s_SampleCount) : 0;
+            DWORD written = 0;
+
+            SString line;
+            for (DWORD i = first; i < total; i++)
+            {
+                Sample * pSlot = &s_Samples[i % s_SampleCount];
+
+                // Copy the slot out and skip it if a thread was writing it meanwhile.
+                Sample sample;
+                LONG sequence = pSlot->m_Sequence;
+                memcpy(&sample, pSlot, sizeof(Sample));
+                if ((sequence != (LONG)(i + 1)) || (pSlot->m_Sequence != sequence))
+                {
+                    continue;
+                }
+
+                SString typeName;
+                TypeString::AppendType(typeName, TypeHandle(sample.m_pMT));
+
+                StackScratchBuffer scratch;
+                line.Printf("sample %u %I64u %s\n", sample.m_ThreadId, (UINT64)sample.m_Size, typeName.GetANSI(scratch));
+                WriteDumpLine(&stream, line);
+
+                for (DWORD frame = 0; frame < sample.m_FrameCount; frame++)
+                {
+                    SString methodName;
+                    TypeString::AppendMethodInternal(methodName, sample.m_Frames[frame],
+                                                     TypeString::FormatNamespace | TypeString::FormatFullInst);
+
+                    StackScratchBuffer methodScratch;
+                    line.Printf("    at %s\n", methodName.GetANSI(methodScratch));
+                    WriteDumpLine(&stream, line);
+                }
+
+                written++;
+            }
+
+            line.Printf("# samples %u taken %u rate %u\n", written, total, (DWORD)s_MeanBytes);
+            WriteDumpLine(&stream, line);
+            fWritten = TRUE;
+        }
+    }
+    EX_CATCH{} EX_END_CATCH(SwallowAllExceptions);
+
+    return fWritten;
+}
+
+// Write a final dump of the process - called from EEShutdownHelper.
+void AllocationSampler::Shutdown()
+{
+    WRAPPER_NO_CONTRACT;
+
+    if (IsEnabled())
+    {
+        WriteDump();
+    }
+}
+
+#endif // !DACCESS_COMPILE
@@ -0,0 +1,97 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+// ===========================================================================
+// File: allocationsampling.h
+//
+// Sampling allocation profiler. Each thread takes a sample once it has
+// allocated a random number of bytes since its previous sample, the distances
+// between samples being exponentially distributed with a mean of
+// AllocationSamplingRate bytes. A sample records the type and size of the
+// object being allocated and the managed stack allocating it, and goes into
+// an in-process ring buffer that is written to
+// <AllocationSamplingFile>.<pid>.<n>.allocs by GC.WriteAllocationSamples and
+// at shutdown.
+//
+// Samples are taken on the allocation slow paths in gchelpers.cpp, which a
+// thread goes through at least whenever its allocation context runs out, so a
+// sample is attributed to the allocation that triggered the refill after the
+// threshold was crossed rather than to the exact byte that crossed it.
+//
+#ifndef ALLOCATIONSAMPLING_H
+#define ALLOCATIONSAMPLING_H
+
+#ifndef DACCESS_COMPILE
+
+class AllocationSampler
+{
+public:
+    // The number of managed frames captured for each sample.
+    static const DWORD MaxStackFrames = 16;
+
+private:
+    static const LONG SampleBeingWritten = -1;
+
+    struct Sample
+    {
+        // Index + 1 of the sample this slot holds, 0 if it never held one and
+        // SampleBeingWritten while a thread is writing it.
+        Volatile<LONG> m_Sequence;
+        MethodTable * m_pMT;
+        SIZE_T m_Size;
+        DWORD m_ThreadId;
+        DWORD m_FrameCount;
+        MethodDesc * m_Frames[MaxStackFrames];
+    };
+
+    // Mean number of bytes between two samples on a thread, 0 when disabled.
+    static SIZE_T s_MeanBytes;
+
+    // The ring buffer and the index of the next sample to write.
+    static Sample * s_Samples;
+    static DWORD s_SampleCount;
+    static Volatile<LONG> s_NextSample;
+
+    // The dump file name prefix and the number of dumps written so far.
+    static LPWSTR s_FileName;
+    static DWORD s_DumpCount;
+
+    static UINT64 NextSampleDistance(Thread * pThread);
+    static void TakeSample(Thread * pThread, Object * pObject);
+    static StackWalkAction CaptureFrameCallback(CrawlFrame * pCF, VOID * pData);
+
+public:
+    // Read the configuration - called from EEStartupHelper.
+    static void Initialize();
+
+    static BOOL IsEnabled()
+    {
+        LIMITED_METHOD_CONTRACT;
+        return (s_MeanBytes != 0);
+    }
+
+    // Called for each object allocated on the slow paths, decides whether the
+    // current thread is due to take a sample and takes it.
+    static void OnAllocation(Object * pObject)
+    {
+        WRAPPER_NO_CONTRACT;
+
+        if (IsEnabled())
+        {
+            OnAllocationWorker(pObject);
+        }
+    }
+
+    static void OnAllocationWorker(Object * pObject);
+
+    // Write the current contents of the ring buffer to a new dump file, returns
+    // FALSE if sampling or dumping isn't enabled or the file couldn't be written.
+    static BOOL WriteDump();
+
+    // Write a final dump - called from EEShutdownHelper.
+    static void Shutdown();
+};
+
+#endif // !DACCESS_COMPILE
+
+#endif // ALLOCATIONSAMPLING_H
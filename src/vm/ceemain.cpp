@@ -195,6 +195,7 @@
 #include "finalizerthread.h"
 #include "threadsuspend.h"
 #include "disassembler.h"
+#include "standalonegc.h"
 
 #ifndef FEATURE_PAL
 #include "dwreport.h"
@@ -256,6 +257,8 @@
 #include "perfmap.h"
 #endif
 
+#include "allocationsampling.h"
+
 #ifndef FEATURE_PAL
 // Included for referencing __security_cookie
 #include "process.h"
@@ -938,6 +941,10 @@ void EEStartupHelper(COINITIEE fFlags)
         PerfMap::Initialize();
 #endif
 
+#ifndef CROSSGEN_COMPILE
+        AllocationSampler::Initialize();
+#endif
+
         STRESS_LOG0(LF_STARTUP, LL_ALWAYS, "===================EEStartup Starting===================");
 
 #ifndef CROSSGEN_COMPILE
@@ -1947,6 +1954,11 @@ void STDMETHODCALLTYPE EEShutDownHelper(BOOL fIsDllUnloading)
         PerfMap::Destroy();
 #endif
 
+#ifndef CROSSGEN_COMPILE
+        // Write out whatever allocation samples are left in the ring buffer.
+        AllocationSampler::Shutdown();
+#endif
+
 #ifdef FEATURE_PREJIT
         // If we're doing basic block profiling, we need to write the log files to disk.
 
@@ -3741,9 +3753,29 @@ void InitializeGarbageCollector()
     g_pFreeObjectMethodTable->SetBaseSize(ObjSizeOf (ArrayBase));
     g_pFreeObjectMethodTable->SetComponentSize(1);
 
-    GCHeap *pGCHeap = GCHeap::CreateGCHeap();
-    if (!pGCHeap)
-        ThrowOutOfMemory();
+    GCHeap *pGCHeap;
+
+#ifdef FEATURE_STANDALONE_GC
+    // Use the GC library the user asked for in place of the built-in GC.
+    NewArrayHolder<WCHAR> gcName(CLRConfig::GetConfigValue(CLRConfig::EXTERNAL_GCName));
+    if (gcName != NULL)
+    {
+        hr = LoadStandaloneGC(gcName);
+        if (FAILED(hr))
+        {
+            LOG((LF_GC, LL_FATALERROR, "Failed to load GC %S, hr=%x\n", (LPCWSTR)gcName, hr));
+        }
+        IfFailThrow(hr);
+
+        pGCHeap = GCHeap::GetGCHeap();
+    }
+    else
+#endif // FEATURE_STANDALONE_GC
+    {
+        pGCHeap = GCHeap::CreateGCHeap();
+        if (!pGCHeap)
+            ThrowOutOfMemory();
+    }
 
     hr = pGCHeap->Initialize();
     IfFailThrow(hr);
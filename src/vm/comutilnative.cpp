@@ -34,6 +34,7 @@
 #include "typestring.h"
 #include "sha1.h"
 #include "finalizerthread.h"
+#include "allocationsampling.h"
 
 #ifdef FEATURE_COMINTEROP
     #include "comcallablewrapper.h"
@@ -1803,6 +1804,107 @@ int QCALLTYPE GCInterface::EndNoGCRegion()
     return retVal;
 }
 
+/*===============================GetNumberOfHeaps===============================
+**Action: Returns the number of GC heaps
+**Returns: The number of GC heaps, 1 unless server GC is used
+**Arguments: None
+**Exceptions: None
+==============================================================================*/
+FCIMPL0(int, GCInterface::GetNumberOfHeaps)
+{
+    FCALL_CONTRACT;
+
+    return GCHeap::GetGCHeap()->GetNumberOfHeaps();
+}
+FCIMPLEND
+
+/*===========================AllocatePinnedByteArray============================
+**Action: Allocates a byte array on the pinned object heap. It never moves, so it can
+**        stay pinned for IO without keeping the GC from compacting gen0 and gen1
+**Returns: The new array
+**Arguments: length -- the number of elements, the caller checked it's not negative
+**Exceptions: OutOfMemoryException
+==============================================================================*/
+FCIMPL1(Object*, GCInterface::AllocatePinnedByteArray, INT32 length)
+{
+    FCALL_CONTRACT;
+
+    OBJECTREF array = NULL;
+
+    HELPER_METHOD_FRAME_BEGIN_RET_1(array);
+
+    _ASSERTE(length >= 0);
+    array = AllocatePrimitiveArray(ELEMENT_TYPE_U1, (DWORD)length, FALSE, TRUE);
+
+    HELPER_METHOD_FRAME_END();
+
+    return OBJECTREFToObject(array);
+}
+FCIMPLEND
+
+/*===============================GetGCInfoRecords===============================
+**Action: Copies the records the GC keeps of the most recent GCs, most recent first
+**Returns: The number of records copied
+**Arguments: records -- room for maxRecords records
+**           heapRecords -- room for maxRecords * GetNumberOfHeaps() heap records
+**Exceptions: None
+==============================================================================*/
+int QCALLTYPE GCInterface::GetGCInfoRecords(gc_info_record* records, gc_info_heap_record* heapRecords, INT32 maxRecords)
+{
+    QCALL_CONTRACT;
+
+    int retVal = 0;
+
+    BEGIN_QCALL;
+
+    retVal = GCHeap::GetGCHeap()->GetGCInfoRecords(records, heapRecords, maxRecords);
+
+    END_QCALL;
+
+    return retVal;
+}
+
+/*==============================WriteHeapSnapshot===============================
+**Action: Does a full blocking GC that writes a heap snapshot when it's done
+**Returns: void
+**Arguments: None
+**Exceptions: None
+==============================================================================*/
+void QCALLTYPE GCInterface::WriteHeapSnapshot()
+{
+    QCALL_CONTRACT;
+
+    BEGIN_QCALL;
+
+    GCX_COOP();
+    GCHeap::GetGCHeap()->RequestHeapSnapshot();
+    GCHeap::GetGCHeap()->GarbageCollect(-1, FALSE, collection_blocking);
+
+    END_QCALL;
+}
+
+/*============================WriteAllocationSamples============================
+**Action: Writes the allocation samples taken so far to a new dump file
+**Returns: FALSE if allocation sampling isn't on (see AllocationSamplingRate and
+**         AllocationSamplingFile) or the file couldn't be written
+**Arguments: None
+**Exceptions: None
+==============================================================================*/
+BOOL QCALLTYPE GCInterface::WriteAllocationSamples()
+{
+    QCALL_CONTRACT;
+
+    BOOL retVal = FALSE;
+
+    BEGIN_QCALL;
+
+    retVal = AllocationSampler::WriteDump();
+
+    END_QCALL;
+
+    return retVal;
+}
+
 /*===============================GetGenerationWR================================
 **Action: Returns the generation in which the object pointed to by a WeakReference is found.
 **Returns:
@@ -190,6 +190,18 @@ public:
     static 
     int QCALLTYPE EndNoGCRegion();
 
+    static FCDECL0(int,     GetNumberOfHeaps);
+    static FCDECL1(Object*, AllocatePinnedByteArray, INT32 length);
+
+    static
+    int QCALLTYPE GetGCInfoRecords(gc_info_record* records, gc_info_heap_record* heapRecords, INT32 maxRecords);
+
+    static
+    void QCALLTYPE WriteHeapSnapshot();
+
+    static
+    BOOL QCALLTYPE WriteAllocationSamples();
+
     static
     void QCALLTYPE _AddMemoryPressure(UINT64 bytesAllocated);
     
@@ -1582,6 +1582,11 @@ FCFuncStart(gGCInterfaceFuncs)
     FCFuncElement("SetLOHCompactionMode", GCInterface::SetLOHCompactionMode)
     QCFuncElement("_StartNoGCRegion", GCInterface::StartNoGCRegion)
     QCFuncElement("_EndNoGCRegion", GCInterface::EndNoGCRegion)
+    FCFuncElement("_GetNumberOfHeaps", GCInterface::GetNumberOfHeaps)
+    FCFuncElement("_AllocatePinnedByteArray", GCInterface::AllocatePinnedByteArray)
+    QCFuncElement("_GetGCInfoRecords", GCInterface::GetGCInfoRecords)
+    QCFuncElement("_WriteHeapSnapshot", GCInterface::WriteHeapSnapshot)
+    QCFuncElement("_WriteAllocationSamples", GCInterface::WriteAllocationSamples)
     FCFuncElement("IsServerGC", SystemNative::IsServerGC)
     QCFuncElement("_AddMemoryPressure", GCInterface::_AddMemoryPressure)
     QCFuncElement("_RemoveMemoryPressure", GCInterface::_RemoveMemoryPressure)
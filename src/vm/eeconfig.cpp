@@ -230,6 +230,7 @@ HRESULT EEConfig::Init()
     fGCBreakOnOOM = false;
     iGCgen0size = 0;
     iGCSegmentSize = 0;
+    iGCHeapHardLimit = 0;
     iGCconcurrent = 0;
 #ifdef _DEBUG
     iGCLatencyMode = -1;
@@ -893,9 +894,11 @@ HRESULT EEConfig::sync()
 #ifdef _WIN64
     if (!iGCSegmentSize) iGCSegmentSize =  GetConfigULONGLONG_DontUse_(CLRConfig::UNSUPPORTED_GCSegmentSize, iGCSegmentSize);
     if (!iGCgen0size) iGCgen0size = GetConfigULONGLONG_DontUse_(CLRConfig::UNSUPPORTED_GCgen0size, iGCgen0size);
+    iGCHeapHardLimit = GetConfigULONGLONG_DontUse_(CLRConfig::UNSUPPORTED_GCHeapHardLimit, iGCHeapHardLimit);
 #else
     if (!iGCSegmentSize) iGCSegmentSize =  GetConfigDWORD_DontUse_(CLRConfig::UNSUPPORTED_GCSegmentSize, iGCSegmentSize);
     if (!iGCgen0size) iGCgen0size = GetConfigDWORD_DontUse_(CLRConfig::UNSUPPORTED_GCgen0size, iGCgen0size);
+    iGCHeapHardLimit = GetConfigDWORD_DontUse_(CLRConfig::UNSUPPORTED_GCHeapHardLimit, iGCHeapHardLimit);
 #endif //_WIN64
 
     if (g_IGCHoardVM)
@@ -683,6 +683,7 @@ public:
     void    SetGCgen0size  (size_t iSize)   {LIMITED_METHOD_CONTRACT; iGCgen0size = iSize;   }
     size_t  GetSegmentSize ()               const {LIMITED_METHOD_CONTRACT;  return iGCSegmentSize; }
     void    SetSegmentSize (size_t iSize)   {LIMITED_METHOD_CONTRACT;  iGCSegmentSize = iSize; }
+    size_t  GetGCHeapHardLimit ()           const {LIMITED_METHOD_CONTRACT;  return iGCHeapHardLimit; }
 
     int     GetGCconcurrent()               const {LIMITED_METHOD_CONTRACT;  return iGCconcurrent; }
     void    SetGCconcurrent(int val)              {LIMITED_METHOD_CONTRACT;  iGCconcurrent = val;  }
@@ -1069,6 +1070,7 @@ private: //----------------------------------------------------------------
 #define DEFAULT_GC_PRN_LVL 3
     size_t iGCgen0size;
     size_t iGCSegmentSize;
+    size_t iGCHeapHardLimit;
     int  iGCconcurrent;
 #ifdef _DEBUG
     int  iGCLatencyMode;
@@ -29,6 +29,17 @@ CLREvent * FinalizerThread::hEventFinalizerDone = NULL;
 CLREvent * FinalizerThread::hEventShutDownToFinalizer = NULL;
 CLREvent * FinalizerThread::hEventFinalizerToShutDown = NULL;
 
+DWORD FinalizerThread::cHelperThreads = 0;
+Thread * volatile * FinalizerThread::HelperThreads = NULL;
+CLREvent ** FinalizerThread::hEventHelperWork = NULL;
+CLREvent * FinalizerThread::hEventHelpersDone = NULL;
+LONG FinalizerThread::cActiveHelpers = 0;
+LONG * FinalizerThread::fHelperBusy = NULL;
+
+// Unless the GC says finalization is backed up we only wake a helper for every
+// this many objects waiting to be finalized.
+#define FINALIZER_HELPER_BATCH_SIZE 256
+
 HANDLE FinalizerThread::MHandles[kHandleCount];
 
 BOOL FinalizerThread::IsCurrentThreadFinalizer()
@@ -336,6 +347,154 @@ Object * FinalizerThread::FinalizeAllObjects(Object* fobj, int bitToCheck)
     return fobj;
 }
 
+// Runs non critical finalizers until the queues have none left. This is what the
+// helper threads do, and what the finalizer thread does while they run. Critical
+// finalizers are left for FinalizeAllObjects so they still run after the non 
+// critical ones.
+//
+// Helpers only exist with a single AppDomain so every object can be finalized 
+// without a domain transition.
+//
+// Each thread fires its own GCFinalizersBegin/End pair so the events still account
+// for every finalizer that ran.
+void FinalizerThread::FinalizeNonCriticalObjects(int startHeap)
+{
+    STATIC_CONTRACT_THROWS;
+    STATIC_CONTRACT_GC_TRIGGERS;
+    STATIC_CONTRACT_MODE_COOPERATIVE;
+
+    FireEtwGCFinalizersBegin_V1(GetClrInstanceId());
+
+    unsigned int fcount = 0;
+    Thread *pThread = GetThread();
+
+#ifdef FEATURE_PROFAPI_ATTACH_DETACH
+    ULONGLONG ui64TimestampLastCheckedProfAttachEventMs = 0;
+    BOOL fFinalizerThread = IsCurrentThreadFinalizer();
+#endif //FEATURE_PROFAPI_ATTACH_DETACH
+
+    while (true)
+    {
+#ifdef FEATURE_PROFAPI_ATTACH_DETACH
+        if (fFinalizerThread)
+        {
+            ProcessProfilerAttachIfNecessary(&ui64TimestampLastCheckedProfAttachEventMs);
+        }
+#endif // FEATURE_PROFAPI_ATTACH_DETACH
+
+        Object *fobj = GCHeap::GetGCHeap()->GetNextFinalizableFrom(startHeap, TRUE);
+        if (fobj == NULL)
+        {
+            break;
+        }
+
+        _ASSERTE(fobj->GetAppDomain() == NULL || fobj->GetAppDomain() == pThread->GetDomain());
+        {
+            ThreadLocaleHolder localeHolder;
+            CallFinalizer(fobj);
+        }
+        pThread->InternalReset(FALSE);
+        fcount++;
+    }
+
+    FireEtwGCFinalizersEnd_V1(fcount, GetClrInstanceId());
+}
+
+DWORD FinalizerThread::GetHelperIndex(Thread *pThread)
+{
+    LIMITED_METHOD_CONTRACT;
+
+    for (DWORD i = 0; i < cHelperThreads; i++)
+    {
+        if (HelperThreads[i] == pThread)
+        {
+            return i;
+        }
+    }
+
+    _ASSERTE(!"Not a finalizer helper thread");
+    return 0;
+}
+
+void FinalizerThread::HelperFinishedWork(DWORD index)
+{
+    WRAPPER_NO_CONTRACT;
+
+    // A helper that came out of its drain on an exception gets here a second
+    // time, the busy flag makes sure it's only counted once.
+    if (FastInterlockExchange(&fHelperBusy[index], FALSE))
+    {
+        if (FastInterlockDecrement(&cActiveHelpers) == 0)
+        {
+            hEventHelpersDone->Set();
+        }
+    }
+}
+
+// Called on the finalizer thread before it runs the finalizers the usual way. 
+// Wakes as many helpers as the backlog calls for, runs non critical finalizers 
+// with them and waits till they are all done.
+void FinalizerThread::RunFinalizersOnHelpers()
+{
+    STATIC_CONTRACT_THROWS;
+    STATIC_CONTRACT_GC_TRIGGERS;
+    STATIC_CONTRACT_MODE_COOPERATIVE;
+
+    _ASSERTE(IsCurrentThreadFinalizer());
+
+    DWORD cWake = cHelperThreads;
+    if (!GCHeap::GetGCHeap()->IsFinalizationBackedUp())
+    {
+        size_t cWaiting = GCHeap::GetGCHeap()->GetNumberOfFinalizable();
+        if ((cWaiting / FINALIZER_HELPER_BATCH_SIZE) < cWake)
+        {
+            cWake = (DWORD)(cWaiting / FINALIZER_HELPER_BATCH_SIZE);
+        }
+    }
+
+    if (cWake == 0)
+    {
+        return;
+    }
+
+    LOG((LF_GC, LL_INFO100, "***** Running finalizers on %d helper threads\n", cWake));
+
+    // We hold one count ourselves so helpers can't signal done while we are
+    // still waking the rest.
+    hEventHelpersDone->Reset();
+    cActiveHelpers = 1;
+    DWORD cWoken = 0;
+    for (DWORD i = 0; (i < cHelperThreads) && (cWoken < cWake); i++)
+    {
+        // Skip helpers whose thread never started.
+        if (HelperThreads[i] == NULL)
+        {
+            continue;
+        }
+
+        FastInterlockIncrement(&cActiveHelpers);
+        FastInterlockExchange(&fHelperBusy[i], TRUE);
+        if (HelperThreads[i] == NULL)
+        {
+            // It failed to start after we looked and may not have seen it was busy.
+            HelperFinishedWork(i);
+            continue;
+        }
+
+        hEventHelperWork[i]->Set();
+        cWoken++;
+    }
+
+    FinalizeNonCriticalObjects(0);
+
+    if (FastInterlockDecrement(&cActiveHelpers) != 0)
+    {
+        GetFinalizerThread()->EnablePreemptiveGC();
+        hEventHelpersDone->Wait(INFINITE, FALSE);
+        GetFinalizerThread()->DisablePreemptiveGC();
+    }
+}
+
 
 #ifdef FEATURE_PROFAPI_ATTACH_DETACH
 
@@ -430,6 +589,24 @@ void FinalizerThread::ProcessProfilerAttachIfNecessary(ULONGLONG * pui64Timestam
 
 #endif // FEATURE_PROFAPI_ATTACH_DETACH
 
+// We have nothing to do, let the GC do its idle work. Returns how long (ms) we can wait
+// before doing this again.
+static DWORD PerformGCIdleWork()
+{
+    WRAPPER_NO_CONTRACT;
+
+    if (!g_fEEStarted)
+    {
+        // Check again once the EE has started.
+        return 2000;
+    }
+
+    GetFinalizerThread()->DisablePreemptiveGC();
+    DWORD idleTimeout = GCHeap::GetGCHeap()->PerformIdleWork();
+    GetFinalizerThread()->EnablePreemptiveGC();
+    return idleTimeout;
+}
+
 void FinalizerThread::WaitForFinalizerEvent (CLREvent *event)
 {
     // TODO wwl: merge the following two blocks
@@ -505,11 +682,13 @@ void FinalizerThread::WaitForFinalizerEvent (CLREvent *event)
             }
 #endif //FEATURE_PROFAPI_ATTACH_DETACH 
 
+            DWORD idleTimeout = PerformGCIdleWork();
+
             switch (WaitForMultipleObjectsEx(
                 cEventsForWait,                           // # objects to wait on
                 &(MHandles[uiEventIndexOffsetForWait]),   // array of objects to wait on
                 FALSE,          // bWaitAll == FALSE, so wait for first signal
-                INFINITE,       // timeout
+                idleTimeout,    // timeout
                 FALSE)          // alertable
                 
                 // Adjust the returned array index for the offset we used, so the return
@@ -540,6 +719,9 @@ void FinalizerThread::WaitForFinalizerEvent (CLREvent *event)
                 ProfilingAPIAttachDetach::ProcessSignaledAttachEvent();
                 break;
 #endif // FEATURE_PROFAPI_ATTACH_DETACH 
+            case (WAIT_TIMEOUT):
+                // Time for the GC's idle work again.
+                break;
             default:
                 //what's wrong?
                 _ASSERTE (!"Bad return code from WaitForMultipleObjects");
@@ -565,6 +747,13 @@ void FinalizerThread::WaitForFinalizerEvent (CLREvent *event)
                 timeout = 2000;
 
             }
+
+            DWORD idleTimeout = PerformGCIdleWork();
+            if (idleTimeout < timeout)
+            {
+                timeout = idleTimeout;
+            }
+
             switch (event->Wait(timeout, FALSE))
             {
             case (WAIT_OBJECT_0):
@@ -688,6 +877,11 @@ VOID FinalizerThread::FinalizerThreadWorker(void *args)
         FastInterlockExchange ((LONG*)&g_FinalizerIsRunning, TRUE);
         AppDomain::EnableADUnloadWorkerForFinalizer();
 
+        if (cHelperThreads != 0)
+        {
+            RunFinalizersOnHelpers();
+        }
+
         do
         {
             FinalizeAllObjects(NULL, 0);
@@ -810,6 +1004,10 @@ DWORD __stdcall FinalizerThread::FinalizerThreadStart(void *args)
 #endif
             GetFinalizerThread()->SetBackground(TRUE);
 
+            GetFinalizerThread()->EnablePreemptiveGC();
+            CreateHelperThreads();
+            GetFinalizerThread()->DisablePreemptiveGC();
+
 #ifdef FEATURE_PROFAPI_ATTACH_DETACH 
             // Add the Profiler Attach Event to the array of event handles that the
             // finalizer thread waits on. If the process is not enabled for profiler
@@ -946,6 +1144,154 @@ DWORD __stdcall FinalizerThread::FinalizerThreadStart(void *args)
     return 0;
 }
 
+VOID FinalizerThread::FinalizerHelperThreadWorker(void *args)
+{
+    STATIC_CONTRACT_THROWS;
+    STATIC_CONTRACT_GC_TRIGGERS;
+    STATIC_CONTRACT_MODE_COOPERATIVE;
+
+    Thread *pThread = GetThread();
+    DWORD index = GetHelperIndex(pThread);
+
+    while (!fQuitFinalizer)
+    {
+        _ASSERTE(pThread->PreemptiveGCDisabled());
+        pThread->EnablePreemptiveGC();
+        hEventHelperWork[index]->Wait(INFINITE, FALSE);
+        pThread->DisablePreemptiveGC();
+
+        if (pThread->IsAbortRequested())
+        {
+            pThread->EEResetAbort(Thread::TAR_ALL);
+        }
+
+        // Start at the heap after the finalizer thread's (it starts at 0) and 
+        // each helper's own, so at first each queue is drained by one thread.
+        FinalizeNonCriticalObjects((int)index + 1);
+
+        if (pThread->IsAbortRequested())
+        {
+            pThread->EEResetAbort(Thread::TAR_ALL);
+        }
+
+        HelperFinishedWork(index);
+    }
+}
+
+DWORD __stdcall FinalizerThread::FinalizerHelperThreadStart(void *args)
+{
+    STATIC_CONTRACT_THROWS;
+    STATIC_CONTRACT_GC_TRIGGERS;
+
+    DWORD index = (DWORD)(size_t)args;
+    Thread *pThread = HelperThreads[index];
+
+    LOG((LF_GC, LL_INFO10, "Finalizer helper thread %d starting...\n", index));
+
+    if (!pThread->HasStarted())
+    {
+        // The finalizer thread won't wake us if it sees this; if it already did
+        // it shouldn't wait for us.
+        HelperThreads[index] = NULL;
+        HelperFinishedWork(index);
+    }
+    else
+    {
+        _ASSERTE(GetThread() == pThread);
+        _ASSERTE(pThread->GetDomain()->IsDefaultDomain());
+
+        INSTALL_UNHANDLED_MANAGED_EXCEPTION_TRAP;
+
+        pThread->SetBackground(TRUE);
+
+        while (!fQuitFinalizer)
+        {
+            // Same as the finalizer thread - apply the policy for swallowing exceptions
+            // without letting the thread go away.
+            ManagedThreadBase::FinalizerBase(FinalizerHelperThreadWorker);
+
+            // If we came out on an exception the finalizer thread may still be waiting 
+            // on us.
+            HelperFinishedWork(index);
+        }
+
+        UNINSTALL_UNHANDLED_MANAGED_EXCEPTION_TRAP;
+
+        pThread->EnablePreemptiveGC();
+    }
+
+    return 0;
+}
+
+// Helpers are only used with a single AppDomain (so finalizers never need a domain
+// transition, which relies on state only the finalizer thread has) and when the
+// host doesn't schedule our threads.
+void FinalizerThread::CreateHelperThreads()
+{
+    CONTRACTL
+    {
+        NOTHROW;
+        GC_TRIGGERS;
+        MODE_PREEMPTIVE;
+    }
+    CONTRACTL_END;
+
+    DWORD cThreads = CLRConfig::GetConfigValue(CLRConfig::UNSUPPORTED_FinalizerThreadCount);
+    DWORD cCpus = (DWORD)GetCurrentProcessCpuCount();
+    if (cThreads > cCpus)
+    {
+        cThreads = cCpus;
+    }
+
+    if ((cThreads <= 1) || !IsSingleAppDomain() || CLRHosted())
+    {
+        return;
+    }
+
+    DWORD cHelpers = cThreads - 1;
+
+    EX_TRY
+    {
+        HelperThreads = new Thread* volatile[cHelpers];
+        hEventHelperWork = new CLREvent*[cHelpers];
+        fHelperBusy = new LONG[cHelpers];
+        hEventHelpersDone = new CLREvent();
+        hEventHelpersDone->CreateManualEvent(FALSE);
+
+        for (DWORD i = 0; i < cHelpers; i++)
+        {
+            hEventHelperWork[i] = new CLREvent();
+            hEventHelperWork[i]->CreateAutoEvent(FALSE);
+            fHelperBusy[i] = FALSE;
+
+            Thread *pThread = SetupUnstartedThread();
+            HelperThreads[i] = pThread;
+
+            if (!pThread->CreateNewThread(0, &FinalizerHelperThreadStart, (void *)(size_t)i))
+            {
+                HelperThreads[i] = NULL;
+                pThread->DecExternalCount(FALSE);
+                break;
+            }
+
+            // We don't want the thread block disappearing under us -- even if the
+            // actual thread terminates.
+            pThread->IncExternalCount();
+
+            // Only count a helper once its thread exists so we never wake one
+            // that isn't there.
+            cHelperThreads = i + 1;
+            pThread->StartThread();
+        }
+    }
+    EX_CATCH
+    {
+    }
+    EX_END_CATCH(SwallowAllExceptions);
+
+    LOG((LF_GC, LL_INFO10, "Created %d finalizer helper threads\n", cHelperThreads));
+}
+
 DWORD FinalizerThread::FinalizerThreadCreate()
 {
     DWORD   dwRet = 0;
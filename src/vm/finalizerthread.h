@@ -17,6 +17,16 @@ class FinalizerThread
     static CLREvent *hEventShutDownToFinalizer;
     static CLREvent *hEventFinalizerToShutDown;
 
+    // Helper threads (see FinalizerThreadCount) that run non critical finalizers 
+    // alongside the finalizer thread. Each one starts draining at a different 
+    // heap's finalization queue.
+    static DWORD cHelperThreads;
+    static Thread * volatile *HelperThreads;
+    static CLREvent **hEventHelperWork;
+    static CLREvent *hEventHelpersDone;
+    static LONG cActiveHelpers;
+    static LONG *fHelperBusy;
+
     // Note: This enum makes it easier to read much of the code that deals with the
     // array of events that the finalizer thread waits on.  However, the ordering
     // is important.
@@ -48,6 +58,14 @@ class FinalizerThread
     static void FinalizeAllObjects_Wrapper(void *ptr);
     static Object * FinalizeAllObjects(Object* fobj, int bitToCheck);
 
+    static void CreateHelperThreads();
+    static DWORD GetHelperIndex(Thread *pThread);
+    static void FinalizeNonCriticalObjects(int startHeap);
+    static void RunFinalizersOnHelpers();
+    static void HelperFinishedWork(DWORD index);
+    static VOID FinalizerHelperThreadWorker(void *args);
+    static DWORD __stdcall FinalizerHelperThreadStart(void *args);
+
 public:
     static Thread* GetFinalizerThread() 
     {
@@ -713,6 +713,12 @@ bool GCToEEInterface::CatchAtSafePoint(Thread * pThread)
     return !!pThread->CatchAtSafePoint();
 }
 
+bool GCToEEInterface::IsGCThread()
+{
+    WRAPPER_NO_CONTRACT;
+    return !!::IsGCThread();
+}
+
 void GCToEEInterface::GcEnumAllocContexts(enum_alloc_context_func* fn, void* param)
 {
     CONTRACTL
@@ -165,6 +165,12 @@ void* GCToOSInterface::VirtualReserve(void* address, size_t size, size_t alignme
     LIMITED_METHOD_CONTRACT;
 
     DWORD memFlags = (flags & VirtualReserveFlags::WriteWatch) ? (MEM_RESERVE | MEM_WRITE_WATCH) : MEM_RESERVE;
+#ifdef FEATURE_PAL
+    if (flags & VirtualReserveFlags::LargePages)
+    {
+        memFlags |= MEM_LARGE_PAGES;
+    }
+#endif // FEATURE_PAL
     if (alignment == 0)
     {
         return ::ClrVirtualAlloc(0, size, memFlags, PAGE_READWRITE);
@@ -175,6 +181,23 @@ void* GCToOSInterface::VirtualReserve(void* address, size_t size, size_t alignme
     }
 }
 
+// Get the size of the large pages VirtualReserve can back memory with.
+// Return:
+//  The large page size, or 0 if large pages are not supported
+size_t GCToOSInterface::GetLargePageSize()
+{
+    LIMITED_METHOD_CONTRACT;
+
+#ifdef FEATURE_PAL
+    // The PAL asks for transparent huge pages; their size depends on the platform.
+    return PAL_GetLargePageSize();
+#else
+    // Large pages on Windows need to be committed when they are reserved and locked in
+    // memory, which doesn't fit how the GC commits and decommits segments.
+    return 0;
+#endif // FEATURE_PAL
+}
+
 // Release virtual memory range previously reserved using VirtualReserve
 // Parameters:
 //  address - starting virtual address
@@ -377,7 +400,7 @@ uint64_t GCToOSInterface::GetRestrictedPhysicalMemoryLimit()
     LIMITED_METHOD_CONTRACT;
 
 #ifdef FEATURE_PAL
-    return 0;
+    return PAL_GetRestrictedPhysicalMemoryLimit();
 #else
     size_t job_physical_memory_limit = (size_t)MAX_PTR;
     BOOL in_job_p = FALSE;
@@ -507,6 +530,10 @@ size_t GCToOSInterface::GetCurrentPhysicalMemory()
     PROCESS_MEMORY_COUNTERS pmc;
     if (GCGetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
         return pmc.WorkingSetSize;
+#else
+    size_t physical_memory_used;
+    if (PAL_GetPhysicalMemoryUsed(&physical_memory_used))
+        return physical_memory_used;
 #endif 
 
     return 0;
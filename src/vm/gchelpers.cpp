@@ -25,6 +25,7 @@
 #include "dynamicmethod.h"
 #include "stubhelpers.h"
 #include "eventtrace.h"
+#include "allocationsampling.h"
 
 #include "excep.h"
 
@@ -36,6 +37,10 @@
 
 #include "rcwwalker.h"
 
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+#include "softwarewritewatch.h"
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
 //========================================================================
 //
 //      ALLOCATION HELPERS
@@ -67,6 +72,7 @@ inline alloc_context* GetThreadAllocContext()
 //     * Call code:Alloc - When the jit helpers fall back, or we do allocations within the runtime code
 //         itself, we ultimately call here.
 //     * Call code:AllocLHeap - Used very rarely to force allocation to be on the large object heap.
+//     * Call code:AllocPinned - Used for objects that will stay pinned for most of their lifetime.
 //     
 // While this is a choke point into allocating an object, it is primitive (it does not want to know about
 // MethodTable and thus does not initialize that poitner. It also does not know if the object is finalizable
@@ -106,6 +112,11 @@ inline Object* Alloc(size_t size, BOOL bFinalize, BOOL bContainsPointers )
     else
         retVal = GCHeap::GetGCHeap()->Alloc(size, flags);
     END_INTERIOR_STACK_PROBE;
+#ifdef FEATURE_STANDALONE_GC
+    // Unlike the built-in GC, a GC library reports OOM by returning NULL.
+    if (retVal == NULL)
+        ThrowOutOfMemory();
+#endif // FEATURE_STANDALONE_GC
     return retVal;
 }
 
@@ -135,6 +146,11 @@ inline Object* AllocAlign8(size_t size, BOOL bFinalize, BOOL bContainsPointers,
         retVal = GCHeap::GetGCHeap()->AllocAlign8(size, flags);
 
     END_INTERIOR_STACK_PROBE;
+#ifdef FEATURE_STANDALONE_GC
+    // Unlike the built-in GC, a GC library reports OOM by returning NULL.
+    if (retVal == NULL)
+        ThrowOutOfMemory();
+#endif // FEATURE_STANDALONE_GC
     return retVal;
 }
 #endif // FEATURE_64BIT_ALIGNMENT
@@ -174,6 +190,54 @@ inline Object* AllocLHeap(size_t size, BOOL bFinalize, BOOL bContainsPointers )
     INTERIOR_STACK_PROBE_FOR(GetThread(), static_cast<unsigned>(DEFAULT_ENTRY_PROBE_AMOUNT * 1.5));
     retVal = GCHeap::GetGCHeap()->AllocLHeap(size, flags);
     END_INTERIOR_STACK_PROBE;
+#ifdef FEATURE_STANDALONE_GC
+    // Unlike the built-in GC, a GC library reports OOM by returning NULL.
+    if (retVal == NULL)
+        ThrowOutOfMemory();
+#endif // FEATURE_STANDALONE_GC
+    return retVal;
+}
+
+// This variation allocates the object on the pinned object heap, which is logically part of gen2 and is
+// never compacted. Use it for buffers that are pinned for most of their lifetime (eg, I/O buffers) so they
+// don't fragment the ephemeral generations.
+inline Object* AllocPinned(size_t size, BOOL bFinalize, BOOL bContainsPointers )
+{
+    CONTRACTL {
+        THROWS;
+        GC_TRIGGERS;
+        MODE_COOPERATIVE; // returns an objref without pinning it => cooperative
+    } CONTRACTL_END;
+
+    _ASSERTE(!NingenEnabled() && "You cannot allocate managed objects inside the ngen compilation process.");
+
+#ifdef _DEBUG
+    if (g_pConfig->ShouldInjectFault(INJECTFAULT_GCHEAP))
+    {
+        char *a = new char;
+        delete a;
+    }
+#endif
+
+    DWORD flags = ((bContainsPointers ? GC_ALLOC_CONTAINS_REF : 0) |
+                   (bFinalize ? GC_ALLOC_FINALIZE : 0) |
+                   GC_ALLOC_PINNED_OBJECT_HEAP);
+
+    Object *retVal = NULL;
+
+    // We don't want to throw an SO during the GC, so make sure we have plenty
+    // of stack before calling in.
+    INTERIOR_STACK_PROBE_FOR(GetThread(), static_cast<unsigned>(DEFAULT_ENTRY_PROBE_AMOUNT * 1.5));
+    if (GCHeap::UseAllocationContexts())
+        retVal = GCHeap::GetGCHeap()->Alloc(GetThreadAllocContext(), size, flags);
+    else
+        retVal = GCHeap::GetGCHeap()->Alloc(size, flags);
+    END_INTERIOR_STACK_PROBE;
+#ifdef FEATURE_STANDALONE_GC
+    // Unlike the built-in GC, a GC library reports OOM by returning NULL.
+    if (retVal == NULL)
+        ThrowOutOfMemory();
+#endif // FEATURE_STANDALONE_GC
     return retVal;
 }
 
@@ -477,6 +541,8 @@ OBJECTREF AllocateArrayEx(TypeHandle arrayType, INT32 *pArgs, DWORD dwNumArgs, B
     }
 #endif // FEATURE_EVENT_TRACE
 
+    AllocationSampler::OnAllocation(orArray);
+
     if (kind != ELEMENT_TYPE_ARRAY)
     {
         // Handle allocating multiple jagged array dimensions at once
@@ -526,7 +592,7 @@ OBJECTREF AllocateArrayEx(TypeHandle arrayType, INT32 *pArgs, DWORD dwNumArgs, B
 /*
  * Allocates a single dimensional array of primitive types.
  */
-OBJECTREF   AllocatePrimitiveArray(CorElementType type, DWORD cElements, BOOL bAllocateInLargeHeap)
+OBJECTREF   AllocatePrimitiveArray(CorElementType type, DWORD cElements, BOOL bAllocateInLargeHeap, BOOL bAllocatePinned)
 {
     CONTRACTL
     {
@@ -552,14 +618,14 @@ OBJECTREF   AllocatePrimitiveArray(CorElementType type, DWORD cElements, BOOL bA
         TypeHandle typHnd = ClassLoader::LoadArrayTypeThrowing(elemType, ELEMENT_TYPE_SZARRAY, 0);
         g_pPredefinedArrayTypes[type] = typHnd.AsArray();
     }
-    return FastAllocatePrimitiveArray(g_pPredefinedArrayTypes[type]->GetMethodTable(), cElements, bAllocateInLargeHeap);
+    return FastAllocatePrimitiveArray(g_pPredefinedArrayTypes[type]->GetMethodTable(), cElements, bAllocateInLargeHeap, bAllocatePinned);
 }
 
 /*
  * Allocates a single dimensional array of primitive types.
  */
 
-OBJECTREF   FastAllocatePrimitiveArray(MethodTable* pMT, DWORD cElements, BOOL bAllocateInLargeHeap)
+OBJECTREF   FastAllocatePrimitiveArray(MethodTable* pMT, DWORD cElements, BOOL bAllocateInLargeHeap, BOOL bAllocatePinned)
 {
     CONTRACTL {
         THROWS;
@@ -594,10 +660,16 @@ OBJECTREF   FastAllocatePrimitiveArray(MethodTable* pMT, DWORD cElements, BOOL b
 
     size_t totalSize = safeTotalSize.Value();
 
-    BOOL bPublish = bAllocateInLargeHeap;
+    BOOL bPublish = (bAllocateInLargeHeap || bAllocatePinned);
 
     ArrayBase* orObject;
-    if (bAllocateInLargeHeap)
+    if (bAllocatePinned)
+    {
+        // The pinned object heap always gives out 8 byte aligned objects so no need
+        // to special case arrays of doubles here.
+        orObject = (ArrayBase*) AllocPinned(totalSize, FALSE, FALSE);
+    }
+    else if (bAllocateInLargeHeap)
     {
         orObject = (ArrayBase*) AllocLHeap(totalSize, FALSE, FALSE);
     }
@@ -672,6 +744,8 @@ OBJECTREF   FastAllocatePrimitiveArray(MethodTable* pMT, DWORD cElements, BOOL b
     }
 #endif // FEATURE_EVENT_TRACE
 
+    AllocationSampler::OnAllocation(orObject);
+
     // IBC Log MethodTable access
     g_IBCLogger.LogMethodTableAccess(pMT);
 
@@ -881,6 +955,8 @@ STRINGREF SlowAllocateString( DWORD cchStringLength )
     }
 #endif // FEATURE_EVENT_TRACE
 
+    AllocationSampler::OnAllocation(orObject);
+
     LogAlloc(ObjectSize, g_pStringClass, orObject);
 
 #if CHECK_APP_DOMAIN_LEAKS
@@ -1033,6 +1109,8 @@ OBJECTREF AllocateObject(MethodTable *pMT
         }
 #endif // FEATURE_EVENT_TRACE
 
+        AllocationSampler::OnAllocation(orObject);
+
         LogAlloc(pMT->GetBaseSize(), pMT, orObject);
 
         oref = OBJECTREF_TO_UNCHECKED_OBJECTREF(orObject);
@@ -1058,6 +1136,20 @@ OBJECTREF AllocateObject(MethodTable *pMT
 #define card_byte(addr) (((size_t)(addr)) >> card_byte_shift)
 #define card_bit(addr)  (1 << ((((size_t)(addr)) >> (card_byte_shift - 3)) & 7))
 
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+// The card bundles are not tracked by write watch, so every card set by a
+// barrier must set its card bundle as well.
+inline void SetCardBundleByte(BYTE* addr)
+{
+    LIMITED_METHOD_CONTRACT;
+
+    BYTE* pCardBundleByte = (BYTE *)VolatileLoadWithoutBarrier(&g_card_bundle_table) +
+                            (((size_t)addr) >> CARD_BUNDLE_AddressToTableByteIndexShift);
+    if (*pCardBundleByte != 0xFF)
+        *pCardBundleByte = 0xFF;
+}
+#endif // FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+
 
 #ifdef FEATURE_USE_ASM_GC_WRITE_BARRIERS
 
@@ -1182,6 +1274,13 @@ extern "C" HCIMPL2_RAW(VOID, JIT_CheckedWriteBarrier, Object **dst, Object *ref)
     updateGCShadow(dst, ref);     // support debugging write barrier
 #endif
 
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    if (SoftwareWriteWatch::IsEnabledForGCHeap())
+    {
+        SoftwareWriteWatch::SetDirty(dst, sizeof(*dst));
+    }
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
 #ifdef FEATURE_COUNT_GC_WRITE_BARRIERS
     if((BYTE*) dst >= g_ephemeral_low && (BYTE*) dst < g_ephemeral_high)
     {
@@ -1202,6 +1301,9 @@ extern "C" HCIMPL2_RAW(VOID, JIT_CheckedWriteBarrier, Object **dst, Object *ref)
             CheckedAfterAlreadyDirtyFilter++;
 #endif
             *pCardByte = 0xFF;
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+            SetCardBundleByte((BYTE *)dst);
+#endif
         }
     }
 }
@@ -1232,6 +1334,13 @@ extern "C" HCIMPL2_RAW(VOID, JIT_WriteBarrier, Object **dst, Object *ref)
     updateGCShadow(dst, ref);     // support debugging write barrier
 #endif
     
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    if (SoftwareWriteWatch::IsEnabledForGCHeap())
+    {
+        SoftwareWriteWatch::SetDirty(dst, sizeof(*dst));
+    }
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
 #ifdef FEATURE_COUNT_GC_WRITE_BARRIERS
     if((BYTE*) dst >= g_ephemeral_low && (BYTE*) dst < g_ephemeral_high)
     {
@@ -1250,6 +1359,9 @@ extern "C" HCIMPL2_RAW(VOID, JIT_WriteBarrier, Object **dst, Object *ref)
             UncheckedAfterAlreadyDirtyFilter++;
 #endif
             *pCardByte = 0xFF;
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+            SetCardBundleByte((BYTE *)dst);
+#endif
         }
     }
 }
@@ -1293,13 +1405,25 @@ void ErectWriteBarrier(OBJECTREF *dst, OBJECTREF ref)
     updateGCShadow((Object**) dst, OBJECTREFToObject(ref));     // support debugging write barrier
 #endif
     
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    if (SoftwareWriteWatch::IsEnabledForGCHeap())
+    {
+        SoftwareWriteWatch::SetDirty(dst, sizeof(*dst));
+    }
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
     if((BYTE*) OBJECTREFToObject(ref) >= g_ephemeral_low && (BYTE*) OBJECTREFToObject(ref) < g_ephemeral_high)
     {
         // VolatileLoadWithoutBarrier() is used here to prevent fetch of g_card_table from being reordered 
         // with g_lowest/highest_address check above. See comment in code:gc_heap::grow_brick_card_tables.
         BYTE* pCardByte = (BYTE *)VolatileLoadWithoutBarrier(&g_card_table) + card_byte((BYTE *)dst);
         if(*pCardByte != 0xFF)
+        {
             *pCardByte = 0xFF;
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+            SetCardBundleByte((BYTE *)dst);
+#endif
+        }
     }
 }        
 #include <optdefault.h>
@@ -1317,6 +1441,13 @@ void ErectWriteBarrierForMT(MethodTable **dst, MethodTable *ref)
     updateGCShadow((Object **)dst, (Object *)ref);     // support debugging write barrier, updateGCShadow only cares that these are pointers
 #endif
     
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    if (SoftwareWriteWatch::IsEnabledForGCHeap())
+    {
+        SoftwareWriteWatch::SetDirty(dst, sizeof(*dst));
+    }
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
     if (ref->Collectible())
     {
         BYTE *refObject = *(BYTE **)((MethodTable*)ref)->GetLoaderAllocatorObjectHandle();
@@ -1327,6 +1458,9 @@ void ErectWriteBarrierForMT(MethodTable **dst, MethodTable *ref)
             if( !((*pCardByte) & card_bit((BYTE *)dst)) )
             {
                 *pCardByte = 0xFF;
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+                SetCardBundleByte((BYTE *)dst);
+#endif
             }
         }
     }
@@ -25,7 +25,7 @@ OBJECTREF AllocateValueSzArray(TypeHandle elementType, INT32 length);
 OBJECTREF AllocateArrayEx(TypeHandle arrayClass, INT32 *pArgs, DWORD dwNumArgs, BOOL bAllocateInLargeHeap = FALSE
                           DEBUG_ARG(BOOL bDontSetAppDomain = FALSE));
     // Optimized verion of above
-OBJECTREF FastAllocatePrimitiveArray(MethodTable* arrayType, DWORD cElements, BOOL bAllocateInLargeHeap = FALSE);
+OBJECTREF FastAllocatePrimitiveArray(MethodTable* arrayType, DWORD cElements, BOOL bAllocateInLargeHeap = FALSE, BOOL bAllocatePinned = FALSE);
 
 
 #if defined(_TARGET_X86_)
@@ -44,7 +44,7 @@ extern FastPrimitiveArrayAllocatorFuncPtr fastPrimitiveArrayAllocator;
 OBJECTREF AllocatePrimitiveArray(CorElementType type, DWORD cElements);
 
     // The slow version is distinguished via overloading by an additional parameter
-OBJECTREF AllocatePrimitiveArray(CorElementType type, DWORD cElements, BOOL bAllocateInLargeHeap);
+OBJECTREF AllocatePrimitiveArray(CorElementType type, DWORD cElements, BOOL bAllocateInLargeHeap, BOOL bAllocatePinned = FALSE);
 
 
 // Allocate SD array of object pointers.  StubLinker-generated asm code might
@@ -75,8 +75,8 @@ STRINGREF SlowAllocateString( DWORD cchStringLength );
 
 // On other platforms, go to the (somewhat less efficient) implementations in gcscan.cpp
 
-    // Create a SD array of primitive types
-OBJECTREF AllocatePrimitiveArray(CorElementType type, DWORD cElements, BOOL bAllocateInLargeHeap = FALSE);
+    // Create a SD array of primitive types. bAllocatePinned puts the array on the pinned object heap.
+OBJECTREF AllocatePrimitiveArray(CorElementType type, DWORD cElements, BOOL bAllocateInLargeHeap = FALSE, BOOL bAllocatePinned = FALSE);
 
     // Allocate SD array of object pointers
 OBJECTREF AllocateObjectArray(DWORD cElements, TypeHandle ElementType, BOOL bAllocateInLargeHeap = FALSE);
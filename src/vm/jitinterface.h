@@ -273,6 +273,11 @@ public:
         WRITE_BARRIER_SVR32         = 5,
         WRITE_BARRIER_SVR64         = 6,
         WRITE_BARRIER_BUFFER        = 7,
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+        WRITE_BARRIER_WRITE_WATCH_PREGROW64     = 8,
+        WRITE_BARRIER_WRITE_WATCH_POSTGROW64    = 9,
+        WRITE_BARRIER_WRITE_WATCH_SVR64         = 10,
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
     };
 
     WriteBarrierManager();
@@ -281,6 +286,11 @@ public:
     void UpdateEphemeralBounds();
     void UpdateCardTableLocation(BOOL bReqUpperBoundsCheck);
 
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    void SwitchToWriteWatchBarrier(bool isRuntimeSuspended);
+    void SwitchToNonWriteWatchBarrier(bool isRuntimeSuspended);
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
 protected:
     size_t GetCurrentWriteBarrierSize();
     size_t GetSpecificWriteBarrierSize(WriteBarrierType writeBarrier);
@@ -298,6 +308,12 @@ private:
     PBYTE   m_pCardTableImmediate;      // PREGROW32 | PREGROW64 | POSTGROW32 | POSTGROW64 | SVR32 |
     PBYTE   m_pUpperBoundImmediate;     //           |           | POSTGROW32 | POSTGROW64 |       |
     PBYTE   m_pCardTableImmediate2;     // PREGROW32 |           | POSTGROW32 |            | SVR32 |
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    PBYTE   m_pWriteWatchTableImmediate;    // WRITE_WATCH_PREGROW64 | WRITE_WATCH_POSTGROW64 | WRITE_WATCH_SVR64
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    PBYTE   m_pCardBundleTableImmediate;    // PREGROW64 | POSTGROW64 | SVR64 and their WRITE_WATCH versions
+#endif // FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
 };
 
 #endif // _TARGET_AMD64_
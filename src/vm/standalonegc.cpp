@@ -0,0 +1,826 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+/*
+ * STANDALONEGC.CPP
+ *
+ * Loading a GC built as a separate library. The library reaches the execution
+ * engine and the OS through the IGCToCLR and IGCToOS implementations here, which
+ * forward to the GCToEEInterface, GCScan and GCToOSInterface implementations
+ * used by the built-in GC.
+ *
+ */
+
+#include "common.h"
+
+#ifdef FEATURE_STANDALONE_GC
+
+#include "gcenv.h"
+#include "gcscan.h"
+#include "gcinterface.h"
+#include "softwarewritewatch.h"
+#include "standalonegc.h"
+
+#include "threadsuspend.h"
+
+class StandaloneGCToCLR : public IGCToCLR
+{
+public:
+    //
+    // GCToEEInterface
+    //
+
+    virtual void SuspendEE(GCToEEInterface::SUSPEND_REASON reason)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::SuspendEE(reason);
+    }
+
+    virtual void RestartEE(bool bFinishedGC)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::RestartEE(bFinishedGC);
+    }
+
+    virtual void GcScanRoots(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCScan::GcScanRoots(fn, condemned, max_gen, sc);
+    }
+
+    virtual void GcStartWork(int condemned, int max_gen)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::GcStartWork(condemned, max_gen);
+    }
+
+    virtual void AfterGcScanRoots(int condemned, int max_gen, ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::AfterGcScanRoots(condemned, max_gen, sc);
+    }
+
+    virtual void GcBeforeBGCSweepWork()
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::GcBeforeBGCSweepWork();
+    }
+
+    virtual void GcDone(int condemned)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::GcDone(condemned);
+    }
+
+    virtual bool RefCountedHandleCallbacks(Object * pObject)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToEEInterface::RefCountedHandleCallbacks(pObject);
+    }
+
+    virtual void SyncBlockCacheWeakPtrScan(HANDLESCANPROC scanProc, uintptr_t lp1, uintptr_t lp2)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::SyncBlockCacheWeakPtrScan(scanProc, lp1, lp2);
+    }
+
+    virtual void SyncBlockCacheDemote(int max_gen)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::SyncBlockCacheDemote(max_gen);
+    }
+
+    virtual void SyncBlockCachePromotionsGranted(int max_gen)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::SyncBlockCachePromotionsGranted(max_gen);
+    }
+
+    virtual bool IsPreemptiveGCDisabled(Thread * pThread)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToEEInterface::IsPreemptiveGCDisabled(pThread);
+    }
+
+    virtual void EnablePreemptiveGC(Thread * pThread)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::EnablePreemptiveGC(pThread);
+    }
+
+    virtual void DisablePreemptiveGC(Thread * pThread)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::DisablePreemptiveGC(pThread);
+    }
+
+    virtual void SetGCSpecial(Thread * pThread)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::SetGCSpecial(pThread);
+    }
+
+    virtual alloc_context * GetAllocContext(Thread * pThread)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToEEInterface::GetAllocContext(pThread);
+    }
+
+    virtual bool CatchAtSafePoint(Thread * pThread)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToEEInterface::CatchAtSafePoint(pThread);
+    }
+
+    virtual bool IsGCThread()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToEEInterface::IsGCThread();
+    }
+
+    virtual void GcEnumAllocContexts(enum_alloc_context_func* fn, void* param)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToEEInterface::GcEnumAllocContexts(fn, param);
+    }
+
+    virtual void AttachCurrentThread()
+    {
+        LIMITED_METHOD_CONTRACT;
+        // Background GC threads are set up by the thread proc of
+        // CreateBackgroundThread before the GC runs on them.
+    }
+
+    //
+    // Threads and finalization
+    //
+
+    virtual Thread * GetThread()
+    {
+        WRAPPER_NO_CONTRACT;
+        return ::GetThread();
+    }
+
+    virtual bool IsGCSpecialThread()
+    {
+        WRAPPER_NO_CONTRACT;
+        return !!::IsGCSpecialThread();
+    }
+
+    virtual bool CreateBackgroundThread(GCBackgroundThreadFunction fn, void* param)
+    {
+        CONTRACTL
+        {
+            NOTHROW;
+            GC_TRIGGERS;
+        }
+        CONTRACTL_END;
+
+        BackgroundThreadStartContext * pContext = new (nothrow) BackgroundThreadStartContext;
+        if (pContext == NULL)
+        {
+            return false;
+        }
+
+        Thread * pThread = NULL;
+        bool fCreated = false;
+
+        EX_TRY
+        {
+            pThread = SetupUnstartedThread(FALSE);
+        }
+        EX_CATCH
+        {
+        }
+        EX_END_CATCH(SwallowAllExceptions);
+
+        if (pThread != NULL)
+        {
+            pContext->m_pThread = pThread;
+            pContext->m_pRealStartRoutine = fn;
+            pContext->m_pRealContext = param;
+
+            if (pThread->CreateNewThread(0, &BackgroundThreadStub, pContext))
+            {
+                pThread->SetBackground(TRUE, FALSE);
+                pThread->StartThread();
+                fCreated = true;
+            }
+            else
+            {
+                pThread->DecExternalCount(FALSE);
+            }
+        }
+
+        if (!fCreated)
+        {
+            delete pContext;
+        }
+
+        return fCreated;
+    }
+
+    virtual void DestroyThread(Thread * pThread)
+    {
+        WRAPPER_NO_CONTRACT;
+        ::DestroyThread(pThread);
+    }
+
+    virtual void EnableFinalization()
+    {
+        WRAPPER_NO_CONTRACT;
+        FinalizerThread::EnableFinalization();
+    }
+
+    virtual bool HaveExtraWorkForFinalizer()
+    {
+        WRAPPER_NO_CONTRACT;
+        return !!FinalizerThread::HaveExtraWorkForFinalizer();
+    }
+
+    //
+    // Write barrier
+    //
+
+    virtual void StompWriteBarrier(WriteBarrierParameters* args)
+    {
+        WRAPPER_NO_CONTRACT;
+
+        // The write barrier and the JIT helpers read the runtime's copies of
+        // the GC globals, update them in the order the built-in GC does: the
+        // tables before the bounds that let the barrier reach them.
+        g_card_table = args->card_table;
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+        g_card_bundle_table = args->card_bundle_table;
+#endif // FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+        g_sw_ww_table = args->write_watch_table;
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
+        GCToOSInterface::FlushProcessWriteBuffers();
+
+        g_lowest_address = args->lowest_address;
+        VolatileStore(&g_highest_address, args->highest_address);
+        g_ephemeral_low = args->ephemeral_low;
+        g_ephemeral_high = args->ephemeral_high;
+
+        switch (args->operation)
+        {
+        case WriteBarrierOp_StompResize:
+            ::StompWriteBarrierResize(args->requires_upper_bounds_check);
+            break;
+        case WriteBarrierOp_StompEphemeral:
+            ::StompWriteBarrierEphemeral();
+            break;
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+        case WriteBarrierOp_SwitchToWriteWatch:
+            g_sw_ww_enabled_for_gc_heap = true;
+            ::SwitchToWriteWatchBarrier(args->is_runtime_suspended);
+            break;
+        case WriteBarrierOp_SwitchToNonWriteWatch:
+            g_sw_ww_enabled_for_gc_heap = false;
+            ::SwitchToNonWriteWatchBarrier(args->is_runtime_suspended);
+            break;
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+        default:
+            _ASSERTE(!"Unexpected write barrier operation");
+            break;
+        }
+    }
+
+    //
+    // Handle table
+    //
+
+    virtual void GcScanHandles(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCScan::GcScanHandles(fn, condemned, max_gen, sc);
+    }
+
+    virtual void GcScanSizedRefs(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCScan::GcScanSizedRefs(fn, condemned, max_gen, sc);
+    }
+
+    virtual void GcShortWeakPtrScan(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCScan::GcShortWeakPtrScan(fn, condemned, max_gen, sc);
+    }
+
+    virtual void GcWeakPtrScan(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCScan::GcWeakPtrScan(fn, condemned, max_gen, sc);
+    }
+
+    virtual void GcWeakPtrScanBySingleThread(int condemned, int max_gen, ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCScan::GcWeakPtrScanBySingleThread(condemned, max_gen, sc);
+    }
+
+    virtual void GcScanStrongHandlesBySingleThread(promote_func* fn, int max_gen, ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCScan::GcScanStrongHandlesBySingleThread(fn, max_gen, sc);
+    }
+
+    virtual void GcDhInitialScan(promote_func* fn, int condemned, int max_gen, ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCScan::GcDhInitialScan(fn, condemned, max_gen, sc);
+    }
+
+    virtual bool GcDhUnpromotedHandlesExist(ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCScan::GcDhUnpromotedHandlesExist(sc);
+    }
+
+    virtual bool GcDhReScan(ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCScan::GcDhReScan(sc);
+    }
+
+    virtual void GcPromotionsGranted(int condemned, int max_gen, ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCScan::GcPromotionsGranted(condemned, max_gen, sc);
+    }
+
+    virtual void GcDemote(int condemned, int max_gen, ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCScan::GcDemote(condemned, max_gen, sc);
+    }
+
+    virtual void VerifyHandleTable(int condemned, int max_gen, ScanContext* sc)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCScan::VerifyHandleTable(condemned, max_gen, sc);
+    }
+
+    virtual void GcRuntimeStructuresValid(BOOL bValid)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCScan::GcRuntimeStructuresValid(bValid);
+    }
+
+    virtual bool GetGcRuntimeStructuresValid()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCScan::GetGcRuntimeStructuresValid();
+    }
+
+    virtual size_t AskForMoreReservedMemory(size_t old_size, size_t need_size)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCScan::AskForMoreReservedMemory(old_size, need_size);
+    }
+
+    //
+    // Configuration
+    //
+
+    virtual size_t GetGCConfigValue(GCConfigValue value)
+    {
+        WRAPPER_NO_CONTRACT;
+
+        switch (value)
+        {
+        case GCConfig_HeapVerifyLevel:
+#ifdef VERIFY_HEAP
+            return g_pConfig->GetHeapVerifyLevel();
+#else
+            return 0;
+#endif // VERIFY_HEAP
+        case GCConfig_BreakOnOOM:
+            return g_pConfig->IsGCBreakOnOOMEnabled();
+        case GCConfig_Gen0Size:
+            return g_pConfig->GetGCgen0size();
+        case GCConfig_SegmentSize:
+            return g_pConfig->GetSegmentSize();
+        case GCConfig_HeapHardLimit:
+            return g_pConfig->GetGCHeapHardLimit();
+        case GCConfig_Concurrent:
+            return g_pConfig->GetGCconcurrent();
+        case GCConfig_LatencyMode:
+#ifdef _DEBUG
+            return g_pConfig->GetGCLatencyMode();
+#else
+            return 0;
+#endif //_DEBUG
+        case GCConfig_ForceCompact:
+            return g_pConfig->GetGCForceCompact();
+        case GCConfig_RetainVM:
+            return g_pConfig->GetGCRetainVM();
+        case GCConfig_TrimCommit:
+#ifdef GCTRIMCOMMIT
+            return g_pConfig->GetGCTrimCommit();
+#else
+            return 0;
+#endif // GCTRIMCOMMIT
+        case GCConfig_LOHCompactionMode:
+            return g_pConfig->GetGCLOHCompactionMode();
+        case GCConfig_AllowVeryLargeObjects:
+#ifdef _WIN64
+            return g_pConfig->GetGCAllowVeryLargeObjects();
+#else
+            return 0;
+#endif // _WIN64
+        case GCConfig_Conservative:
+#ifdef FEATURE_CONSERVATIVE_GC
+            return g_pConfig->GetGCConservative();
+#else
+            return 0;
+#endif // FEATURE_CONSERVATIVE_GC
+        default:
+            _ASSERTE(!"Unknown GC config value");
+            return 0;
+        }
+    }
+
+    virtual uint32_t GetConfigDWORD(const char* name, uint32_t defaultValue)
+    {
+        CONTRACTL
+        {
+            NOTHROW;
+            GC_NOTRIGGER;
+        }
+        CONTRACTL_END;
+
+        WCHAR wszName[128];
+        if (MultiByteToWideChar(CP_UTF8, 0, name, -1, wszName, _countof(wszName)) == 0)
+        {
+            return defaultValue;
+        }
+
+        CLRConfig::ConfigDWORDInfo info = { wszName, defaultValue, CLRConfig::REGUTIL_default };
+        return CLRConfig::GetConfigValue(info);
+    }
+
+private:
+    struct BackgroundThreadStartContext
+    {
+        Thread * m_pThread;
+        GCBackgroundThreadFunction m_pRealStartRoutine;
+        void * m_pRealContext;
+    };
+
+    static DWORD WINAPI BackgroundThreadStub(void * arg)
+    {
+        BackgroundThreadStartContext * pContext = (BackgroundThreadStartContext *)arg;
+        Thread * pThread = pContext->m_pThread;
+        GCBackgroundThreadFunction pRealStartRoutine = pContext->m_pRealStartRoutine;
+        void * pRealContext = pContext->m_pRealContext;
+        delete pContext;
+
+        // Set up the Thread before the GC runs on it, the GC finds it with
+        // GetThread and exits right away if this failed.
+        pThread->HasStarted(FALSE);
+
+        return pRealStartRoutine(pRealContext);
+    }
+};
+
+class StandaloneGCToOS : public IGCToOS
+{
+public:
+    virtual void GetSystemInfo(uint32_t* numberOfProcessors, uint32_t* pageSize, uint32_t* allocationGranularity)
+    {
+        LIMITED_METHOD_CONTRACT;
+        *numberOfProcessors = g_SystemInfo.dwNumberOfProcessors;
+        *pageSize = g_SystemInfo.dwPageSize;
+        *allocationGranularity = g_SystemInfo.dwAllocationGranularity;
+    }
+
+    virtual void* VirtualReserve(void *address, size_t size, size_t alignment, uint32_t flags)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::VirtualReserve(address, size, alignment, flags);
+    }
+
+    virtual bool VirtualRelease(void *address, size_t size)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::VirtualRelease(address, size);
+    }
+
+    virtual bool VirtualCommit(void *address, size_t size)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::VirtualCommit(address, size);
+    }
+
+    virtual bool VirtualDecommit(void *address, size_t size)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::VirtualDecommit(address, size);
+    }
+
+    virtual bool VirtualReset(void *address, size_t size, bool unlock)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::VirtualReset(address, size, unlock);
+    }
+
+    virtual size_t GetLargePageSize()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::GetLargePageSize();
+    }
+
+    virtual bool SupportsWriteWatch()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::SupportsWriteWatch();
+    }
+
+    virtual void ResetWriteWatch(void *address, size_t size)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToOSInterface::ResetWriteWatch(address, size);
+    }
+
+    virtual bool GetWriteWatch(bool resetState, void* address, size_t size, void** pageAddresses, uintptr_t* pageAddressesCount)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::GetWriteWatch(resetState, address, size, pageAddresses, pageAddressesCount);
+    }
+
+    virtual bool CreateThread(GCThreadFunction function, void* param, GCThreadAffinity* affinity)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::CreateThread(function, param, affinity);
+    }
+
+    virtual void Sleep(uint32_t sleepMSec)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToOSInterface::Sleep(sleepMSec);
+    }
+
+    virtual void YieldThread(uint32_t switchCount)
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToOSInterface::YieldThread(switchCount);
+    }
+
+    virtual uint32_t GetCurrentProcessorNumber()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::GetCurrentProcessorNumber();
+    }
+
+    virtual bool CanGetCurrentProcessorNumber()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::CanGetCurrentProcessorNumber();
+    }
+
+    virtual bool SetCurrentThreadIdealAffinity(GCThreadAffinity* affinity)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::SetCurrentThreadIdealAffinity(affinity);
+    }
+
+    virtual uint32_t GetCurrentThreadIdForLogging()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::GetCurrentThreadIdForLogging();
+    }
+
+    virtual uint32_t GetCurrentProcessId()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::GetCurrentProcessId();
+    }
+
+    virtual uint32_t GetLogicalCpuCount()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::GetLogicalCpuCount();
+    }
+
+    virtual size_t GetLargestOnDieCacheSize(bool trueSize)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::GetLargestOnDieCacheSize(trueSize);
+    }
+
+    virtual uint32_t GetCurrentProcessCpuCount()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::GetCurrentProcessCpuCount();
+    }
+
+    virtual bool GetCurrentProcessAffinityMask(uintptr_t *processMask, uintptr_t *systemMask)
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::GetCurrentProcessAffinityMask(processMask, systemMask);
+    }
+
+    virtual uint64_t GetRestrictedPhysicalMemoryLimit()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::GetRestrictedPhysicalMemoryLimit();
+    }
+
+    virtual size_t GetCurrentPhysicalMemory()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::GetCurrentPhysicalMemory();
+    }
+
+    virtual void GetMemoryStatus(GCInterfaceMemoryStatus* ms)
+    {
+        WRAPPER_NO_CONTRACT;
+
+        GCMemoryStatus status;
+        GCToOSInterface::GetMemoryStatus(&status);
+
+        ms->dwMemoryLoad = status.dwMemoryLoad;
+        ms->ullTotalPhys = status.ullTotalPhys;
+        ms->ullAvailPhys = status.ullAvailPhys;
+        ms->ullTotalPageFile = status.ullTotalPageFile;
+        ms->ullAvailPageFile = status.ullAvailPageFile;
+        ms->ullTotalVirtual = status.ullTotalVirtual;
+        ms->ullAvailVirtual = status.ullAvailVirtual;
+    }
+
+    virtual void FlushProcessWriteBuffers()
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToOSInterface::FlushProcessWriteBuffers();
+    }
+
+    virtual void DebugBreak()
+    {
+        WRAPPER_NO_CONTRACT;
+        GCToOSInterface::DebugBreak();
+    }
+
+    virtual int64_t QueryPerformanceCounter()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::QueryPerformanceCounter();
+    }
+
+    virtual int64_t QueryPerformanceFrequency()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::QueryPerformanceFrequency();
+    }
+
+    virtual uint32_t GetLowPrecisionTimeStamp()
+    {
+        WRAPPER_NO_CONTRACT;
+        return GCToOSInterface::GetLowPrecisionTimeStamp();
+    }
+
+    //
+    // Events
+    //
+
+    virtual void* CreateGCEvent(bool manualReset, bool initialState, bool osEvent)
+    {
+        CONTRACTL
+        {
+            NOTHROW;
+            GC_NOTRIGGER;
+        }
+        CONTRACTL_END;
+
+        CLREvent * pEvent = new (nothrow) CLREvent();
+        if (pEvent == NULL)
+        {
+            return NULL;
+        }
+
+        bool fCreated = false;
+        EX_TRY
+        {
+            if (osEvent)
+            {
+                if (manualReset)
+                    pEvent->CreateOSManualEvent(initialState);
+                else
+                    pEvent->CreateOSAutoEvent(initialState);
+            }
+            else
+            {
+                if (manualReset)
+                    pEvent->CreateManualEvent(initialState);
+                else
+                    pEvent->CreateAutoEvent(initialState);
+            }
+            fCreated = true;
+        }
+        EX_CATCH
+        {
+        }
+        EX_END_CATCH(SwallowAllExceptions);
+
+        if (!fCreated)
+        {
+            delete pEvent;
+            return NULL;
+        }
+
+        return pEvent;
+    }
+
+    virtual void CloseGCEvent(void* hEvent)
+    {
+        WRAPPER_NO_CONTRACT;
+        CLREvent * pEvent = (CLREvent *)hEvent;
+        pEvent->CloseEvent();
+        delete pEvent;
+    }
+
+    virtual bool SetGCEvent(void* hEvent)
+    {
+        WRAPPER_NO_CONTRACT;
+        return !!((CLREvent *)hEvent)->Set();
+    }
+
+    virtual bool ResetGCEvent(void* hEvent)
+    {
+        WRAPPER_NO_CONTRACT;
+        return !!((CLREvent *)hEvent)->Reset();
+    }
+
+    virtual uint32_t WaitGCEvent(void* hEvent, uint32_t dwMilliseconds, bool bAlertable)
+    {
+        WRAPPER_NO_CONTRACT;
+        return ((CLREvent *)hEvent)->Wait(dwMilliseconds, bAlertable);
+    }
+};
+
+static StandaloneGCToCLR g_standaloneGCToCLR;
+static StandaloneGCToOS g_standaloneGCToOS;
+
+HRESULT LoadStandaloneGC(LPCWSTR gcPath)
+{
+    CONTRACTL
+    {
+        NOTHROW;
+        GC_NOTRIGGER;
+    }
+    CONTRACTL_END;
+
+#ifdef STRESS_HEAP
+    // The library has no StressHeap, so GC stress would silently do nothing.
+    if (g_pConfig->GetGCStressLevel() != 0)
+    {
+        LOG((LF_GC, LL_FATALERROR, "GC stress is not supported with a standalone GC\n"));
+        return E_NOTIMPL;
+    }
+#endif // STRESS_HEAP
+
+    HMODULE hGC = CLRLoadLibrary(gcPath);
+    if (hGC == NULL)
+    {
+        return HRESULT_FROM_GetLastError();
+    }
+
+    GC_VersionInfoFunction versionInfo = (GC_VersionInfoFunction)GetProcAddress(hGC, GC_VERSION_INFO_FUNCTION_NAME);
+    GC_InitializeFunction initialize = (GC_InitializeFunction)GetProcAddress(hGC, GC_INITIALIZE_FUNCTION_NAME);
+    if (versionInfo == NULL || initialize == NULL)
+    {
+        return COR_E_DLLNOTFOUND;
+    }
+
+    // The library must implement the same major version of the interface and at
+    // least the minor version this runtime was built against.
+    VersionInfo info;
+    versionInfo(&info);
+    LOG((LF_GC, LL_INFO10, "Loaded GC %s %d.%d.%d\n", info.Name, info.MajorVersion, info.MinorVersion, info.BuildVersion));
+    if (info.MajorVersion != GC_INTERFACE_MAJOR_VERSION || info.MinorVersion < GC_INTERFACE_MINOR_VERSION)
+    {
+        return COR_E_BADIMAGEFORMAT;
+    }
+
+    GCRuntimeState state;
+    state.free_object_method_table = g_pFreeObjectMethodTable;
+    state.trap_returning_threads = (int32_t *)&g_TrapReturningThreads;
+    state.finalizer_run_on_shutdown = &g_fFinalizerRunOnShutDown;
+    state.server_gc = GCHeap::IsServerHeap();
+
+    GCHeap * pGCHeap = NULL;
+    HRESULT hr = initialize(&g_standaloneGCToCLR, &g_standaloneGCToOS, &state, &pGCHeap);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    g_pGCHeap = pGCHeap;
+    return S_OK;
+}
+
+#endif // FEATURE_STANDALONE_GC
@@ -0,0 +1,25 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+/*
+ * STANDALONEGC.H
+ *
+ * Loading a GC built as a separate library (see gc/gcinterface.h)
+ *
+ */
+
+#ifndef _STANDALONEGC_H_
+#define _STANDALONEGC_H_
+
+#ifdef FEATURE_STANDALONE_GC
+
+// Loads the GC library at the given path, checks that it implements a version of
+// the GC interface this runtime can use and initializes it. On success the GC
+// heap of the library replaces the built-in one as g_pGCHeap; it still has to
+// be initialized by GCHeap::Initialize like the built-in one.
+HRESULT LoadStandaloneGC(LPCWSTR gcPath);
+
+#endif // FEATURE_STANDALONE_GC
+
+#endif // _STANDALONEGC_H_
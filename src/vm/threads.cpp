@@ -1939,6 +1939,8 @@ Thread::Thread()
 
     m_alloc_context.init();
     m_thAllocContextObj = 0;
+    m_allocSampleThreshold = 0;
+    m_allocSampleRandom = 0;
 
     m_UserInterrupt = 0;
     m_WaitEventLink.m_Next = NULL;
@@ -11710,6 +11712,7 @@ void Thread::FullResetThread()
     ResetSecurityInfo();
 
     m_alloc_context.alloc_bytes = 0;
+    m_allocSampleThreshold = 0;
     m_fPromoted = FALSE;
 }
 
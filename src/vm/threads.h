@@ -1752,6 +1752,12 @@ public:
     // we fire the AllocationTick event. It's only for tooling purpose.
     TypeHandle m_thAllocContextObj;
 
+    // The number of bytes this thread will have allocated when it takes its next 
+    // allocation sample (0 when one has not been picked yet) and the state of its 
+    // sampling random number generator. See code:AllocationSampler.
+    UINT64 m_allocSampleThreshold;
+    DWORD m_allocSampleRandom;
+
 #ifndef FEATURE_PAL    
 private:
     _NT_TIB *m_pTEB;
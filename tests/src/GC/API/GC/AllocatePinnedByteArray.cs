@@ -0,0 +1,91 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+// Tests GC.AllocatePinnedByteArray(int)
+
+using System;
+using System.Reflection;
+using System.Runtime;
+
+public class Test {
+    const int ArrayCount = 1000;
+
+    // GC.AllocatePinnedByteArray isn't in the reference assemblies the tests build against.
+    static MethodInfo allocatePinned = typeof(GC).GetTypeInfo().GetDeclaredMethod("AllocatePinnedByteArray");
+
+    static byte[] AllocatePinned(int length) {
+        return (byte[])allocatePinned.Invoke(null, new object[] { length });
+    }
+
+    static unsafe IntPtr AddressOf(byte[] array) {
+        fixed (byte* p = array) {
+            return (IntPtr)p;
+        }
+    }
+
+    // Small and large arrays, so they go both where the allocator pads small ones
+    // and where it doesn't.
+    static int LengthOf(int i) {
+        return ((i % 10) == 0) ? (90 * 1024 + i) : (i + 1);
+    }
+
+    public static int Main() {
+        byte[][] arrays = new byte[ArrayCount][];
+        IntPtr[] addresses = new IntPtr[ArrayCount];
+        WeakReference[] weakRefs = new WeakReference[ArrayCount];
+        object[] garbage = new object[ArrayCount];
+
+        // Interleave them with normal allocations that we drop, so a compacting GC 
+        // would move them if they weren't on the pinned object heap.
+        for (int i = 0; i < ArrayCount; i++) {
+            garbage[i] = new byte[LengthOf(i)];
+            arrays[i] = AllocatePinned(LengthOf(i));
+            arrays[i][0] = (byte)i;
+            arrays[i][arrays[i].Length - 1] = (byte)(i >> 8);
+            addresses[i] = AddressOf(arrays[i]);
+            weakRefs[i] = new WeakReference(arrays[i]);
+        }
+
+        // Drop the garbage and every other pinned array.
+        garbage = null;
+        for (int i = 0; i < ArrayCount; i += 2) {
+            arrays[i] = null;
+        }
+
+        GCSettings.LargeObjectHeapCompactionMode = GCLargeObjectHeapCompactionMode.CompactOnce;
+        GC.Collect(2, GCCollectionMode.Forced, true, true);
+        GC.Collect(2, GCCollectionMode.Forced, true, true);
+
+        for (int i = 0; i < ArrayCount; i++) {
+            if ((i % 2) == 0) {
+                // gen2 GCs collect dead pinned arrays like any other object.
+                if (weakRefs[i].IsAlive) {
+                    Console.WriteLine("Test for GC.AllocatePinnedByteArray() failed: dead array " + i + " is still alive");
+                    return 1;
+                }
+                continue;
+            }
+
+            byte[] array = arrays[i];
+            if (!weakRefs[i].IsAlive || (GC.GetGeneration(array) != GC.MaxGeneration)) {
+                Console.WriteLine("Test for GC.AllocatePinnedByteArray() failed: array " + i + " isn't alive in gen2");
+                return 1;
+            }
+
+            if (AddressOf(array) != addresses[i]) {
+                Console.WriteLine("Test for GC.AllocatePinnedByteArray() failed: array " + i + " moved");
+                return 1;
+            }
+
+            if ((array.Length != LengthOf(i)) || (array[0] != (byte)i) || (array[array.Length - 1] != (byte)(i >> 8))) {
+                Console.WriteLine("Test for GC.AllocatePinnedByteArray() failed: array " + i + " is corrupt");
+                return 1;
+            }
+        }
+
+        GC.KeepAlive(arrays);
+
+        Console.WriteLine("Test for GC.AllocatePinnedByteArray() passed!");
+        return 100;
+    }
+}
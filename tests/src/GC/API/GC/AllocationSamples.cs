@@ -0,0 +1,72 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+// Tests GC.WriteAllocationSamples()
+// The test is run with COMPlus_AllocationSamplingRate and COMPlus_AllocationSamplingFile
+// set (see AllocationSamples.csproj).
+
+using System;
+using System.IO;
+using System.Reflection;
+
+public class Test {
+    // GC.WriteAllocationSamples isn't in the reference assemblies the tests build against.
+    static bool WriteAllocationSamples() {
+        MethodInfo method = typeof(GC).GetTypeInfo().GetDeclaredMethod("WriteAllocationSamples");
+        return (bool)method.Invoke(null, null);
+    }
+
+    public static int Main() {
+        foreach (string file in Directory.GetFiles(".", "allocsamples.*.allocs")) {
+            File.Delete(file);
+        }
+
+        // With a mean of 4KB between samples this takes a couple thousand samples.
+        byte[][] arrays = new byte[64][];
+        for (int i = 0; i < 10000; i++) {
+            arrays[i % arrays.Length] = new byte[1000];
+        }
+        GC.KeepAlive(arrays);
+
+        if (!WriteAllocationSamples()) {
+            Console.WriteLine("Test for GC.WriteAllocationSamples() failed: no dump written");
+            return 1;
+        }
+
+        string[] files = Directory.GetFiles(".", "allocsamples.*.allocs");
+        if (files.Length != 1) {
+            Console.WriteLine("Test for GC.WriteAllocationSamples() failed: found " + files.Length + " dumps");
+            return 1;
+        }
+
+        int samples = 0;
+        bool sawByteArray = false;
+        bool sawMain = false;
+        string summary = null;
+        using (StreamReader reader = new StreamReader(File.OpenRead(files[0]))) {
+            string line;
+            while ((line = reader.ReadLine()) != null) {
+                if (line.StartsWith("sample ")) {
+                    samples++;
+                    sawByteArray |= line.EndsWith(" System.Byte[]");
+                }
+                else if (line.StartsWith("    at ")) {
+                    sawMain |= line.Contains("Test.Main");
+                }
+                else if (line.StartsWith("# samples ")) {
+                    summary = line;
+                }
+            }
+        }
+
+        Console.WriteLine(samples + " samples, " + summary);
+
+        if ((samples == 0) || !sawByteArray || !sawMain || (summary == null)) {
+            Console.WriteLine("Test for GC.WriteAllocationSamples() failed!");
+            return 1;
+        }
+
+        Console.WriteLine("Test for GC.WriteAllocationSamples() passed!");
+        return 100;
+    }
+}
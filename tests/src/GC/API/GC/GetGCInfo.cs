@@ -0,0 +1,89 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+// Tests GC.GetGCInfo(int)
+
+using System;
+using System.Reflection;
+
+public class Test {
+    // GC.GetGCInfo and GCInfo aren't in the reference assemblies the tests build against.
+    static Array GetGCInfo(int count) {
+        MethodInfo method = typeof(GC).GetTypeInfo().GetDeclaredMethod("GetGCInfo");
+        return (Array)method.Invoke(null, new object[] { count });
+    }
+
+    static object GetProperty(object obj, string name) {
+        return obj.GetType().GetTypeInfo().GetDeclaredProperty(name).GetValue(obj);
+    }
+
+    static bool CheckInfo(object info, int generation) {
+        int infoGeneration = (int)GetProperty(info, "Generation");
+        int reason = Convert.ToInt32(GetProperty(info, "Reason"));
+        bool concurrent = (bool)GetProperty(info, "Concurrent");
+        TimeSpan duration = (TimeSpan)GetProperty(info, "Duration");
+        Array heaps = (Array)GetProperty(info, "Heaps");
+
+        Console.WriteLine("GC#" + GetProperty(info, "Index") + ": gen" + infoGeneration + ", reason " + 
+                          GetProperty(info, "Reason") + ", " + duration.TotalMilliseconds + "ms, " + heaps.Length + " heaps");
+
+        // Both GCs are induced (GCReason.Induced) and blocking.
+        if ((infoGeneration != generation) || (reason != 1) || concurrent || (duration < TimeSpan.Zero) || (heaps.Length == 0)) {
+            return false;
+        }
+
+        foreach (object heap in heaps) {
+            if (((TimeSpan)GetProperty(heap, "MarkTime") < TimeSpan.Zero) || ((long)GetProperty(heap, "PromotedBytes") < 0)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Returns the index of the most recent record of an induced GC of the given generation
+    // that is older than the record at start, -1 if there is none.
+    static int FindInducedGC(Array infos, int start, int generation) {
+        for (int i = start; i < infos.Length; i++) {
+            object info = infos.GetValue(i);
+            if (((int)GetProperty(info, "Generation") == generation) && (Convert.ToInt32(GetProperty(info, "Reason")) == 1)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    public static int Main() {
+        GC.Collect(2, GCCollectionMode.Forced, true);
+        GC.Collect(0, GCCollectionMode.Forced, true);
+
+        // Other GCs, e.g. a background GC the runtime started, can be recorded between
+        // the two so look them up rather than expecting them to be the last two.
+        // The records are most recent first.
+        Array infos = GetGCInfo(64);
+        if (infos.Length < 2) {
+            Console.WriteLine("Test for GC.GetGCInfo() failed: got " + infos.Length + " records");
+            return 1;
+        }
+
+        int gen0Record = FindInducedGC(infos, 0, 0);
+        int gen2Record = (gen0Record >= 0) ? FindInducedGC(infos, gen0Record + 1, 2) : -1;
+        if (gen2Record < 0) {
+            Console.WriteLine("Test for GC.GetGCInfo() failed: the induced GCs weren't recorded");
+            return 1;
+        }
+
+        object gen0Info = infos.GetValue(gen0Record);
+        object gen2Info = infos.GetValue(gen2Record);
+        long gen0Index = (long)GetProperty(gen0Info, "Index");
+        long gen2Index = (long)GetProperty(gen2Info, "Index");
+
+        if ((gen2Index <= 0) || (gen0Index <= gen2Index) || !CheckInfo(gen0Info, 0) || !CheckInfo(gen2Info, 2)) {
+            Console.WriteLine("Test for GC.GetGCInfo() failed!");
+            return 1;
+        }
+
+        Console.WriteLine("Test for GC.GetGCInfo() passed!");
+        return 100;
+    }
+}
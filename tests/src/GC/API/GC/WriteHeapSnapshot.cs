@@ -0,0 +1,234 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+// Tests GC.WriteHeapSnapshot()
+// The test is run with COMPlus_GCHeapSnapshotFile set (see WriteHeapSnapshot.csproj).
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Reflection;
+using System.Threading;
+
+public class Node {
+    public Node Next;
+}
+
+// Reads a .gcsnap file. Returns false if it isn't completely written yet.
+public class SnapshotFile {
+    const uint Magic = 0x53484347;
+    const int HeaderSize = 24;
+
+    public uint HeapIndex;
+    public uint HeapCount;
+    public ulong GCIndex;
+    public int Roots;
+    // object address -> its references
+    public Dictionary<long, long[]> Objects = new Dictionary<long, long[]>();
+
+    byte[] data;
+    int pos;
+
+    ulong ReadUInt() {
+        ulong v = 0;
+        int shift = 0;
+        while (true) {
+            byte b = data[pos++];
+            v |= (ulong)(b & 0x7f) << shift;
+            if (b < 0x80) {
+                return v;
+            }
+            shift += 7;
+        }
+    }
+
+    long ReadInt() {
+        ulong v = ReadUInt();
+        return (long)(v >> 1) ^ -(long)(v & 1);
+    }
+
+    public bool Read(string path) {
+        using (FileStream fs = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite)) {
+            data = new byte[fs.Length];
+            int read = 0;
+            while (read < data.Length) {
+                int n = fs.Read(data, read, data.Length - read);
+                if (n == 0) {
+                    return false;
+                }
+                read += n;
+            }
+        }
+
+        if (data.Length < HeaderSize) {
+            return false;
+        }
+
+        if ((BitConverter.ToUInt32(data, 0) != Magic) ||
+            (BitConverter.ToUInt16(data, 4) != 1) ||
+            (BitConverter.ToUInt16(data, 6) != IntPtr.Size)) {
+            throw new Exception(path + " has a bad header");
+        }
+        HeapIndex = BitConverter.ToUInt32(data, 8);
+        HeapCount = BitConverter.ToUInt32(data, 12);
+        GCIndex = BitConverter.ToUInt64(data, 16);
+
+        pos = HeaderSize;
+        long lastObject = 0;
+        long records = 0;
+        long totalSize = 0;
+        try {
+            while (true) {
+                byte kind = data[pos++];
+                if (kind == 0) {
+                    long expectedRecords = (long)ReadUInt();
+                    long expectedSize = (long)ReadUInt();
+                    if ((expectedRecords != records) || (expectedSize != totalSize) || (pos != data.Length)) {
+                        throw new Exception(path + " has a bad end record");
+                    }
+                    return true;
+                }
+                else if (kind == 1) {
+                    lastObject += ReadInt();
+                    ReadUInt(); // method table
+                    totalSize += (long)ReadUInt();
+                    long[] refs = new long[ReadUInt()];
+                    for (int i = 0; i < refs.Length; i++) {
+                        refs[i] = lastObject + ReadInt();
+                    }
+                    Objects[lastObject] = refs;
+                }
+                else if (kind == 2) {
+                    pos++; // root kind
+                    ReadUInt();
+                    Roots++;
+                }
+                else {
+                    throw new Exception(path + " has a bad record kind " + kind);
+                }
+                records++;
+            }
+        }
+        catch (IndexOutOfRangeException) {
+            // Still being written.
+            return false;
+        }
+    }
+}
+
+public class Test {
+    const int ListLength = 1000;
+
+    static Node list;
+
+    // GC.WriteHeapSnapshot isn't in the reference assemblies the tests build against.
+    static void WriteHeapSnapshot() {
+        MethodInfo method = typeof(GC).GetTypeInfo().GetDeclaredMethod("WriteHeapSnapshot");
+        method.Invoke(null, null);
+    }
+
+    // The snapshot is written out after the GC on another thread so wait for it.
+    static SnapshotFile ReadWhenWritten(string path) {
+        for (int i = 0; i < 600; i++) {
+            if (File.Exists(path)) {
+                SnapshotFile file = new SnapshotFile();
+                if (file.Read(path)) {
+                    return file;
+                }
+            }
+            Thread.Sleep(100);
+        }
+        throw new Exception(path + " wasn't written");
+    }
+
+    static string FindRootsFile() {
+        for (int i = 0; i < 600; i++) {
+            string[] files = Directory.GetFiles(".", "heapsnapshot.*.roots.gcsnap");
+            if (files.Length > 1) {
+                throw new Exception("found " + files.Length + " snapshots");
+            }
+            if (files.Length == 1) {
+                return files[0];
+            }
+            Thread.Sleep(100);
+        }
+        throw new Exception("no snapshot written");
+    }
+
+    public static int Main() {
+        foreach (string file in Directory.GetFiles(".", "heapsnapshot.*.gcsnap")) {
+            File.Delete(file);
+        }
+
+        for (int i = 0; i < ListLength; i++) {
+            Node n = new Node();
+            n.Next = list;
+            list = n;
+        }
+
+        try {
+            WriteHeapSnapshot();
+
+            string rootsPath = FindRootsFile();
+            SnapshotFile roots = ReadWhenWritten(rootsPath);
+            if (roots.Roots == 0) {
+                throw new Exception("no roots in " + rootsPath);
+            }
+
+            // <prefix>.<pid>.<snapshot>.roots.gcsnap -> <prefix>.<pid>.<snapshot>.
+            string prefix = rootsPath.Substring(0, rootsPath.Length - "roots.gcsnap".Length);
+            Dictionary<long, long[]> objects = new Dictionary<long, long[]>();
+            for (uint h = 0; h < roots.HeapCount; h++) {
+                SnapshotFile heap = ReadWhenWritten(prefix + h + ".gcsnap");
+                if ((heap.HeapIndex != h) || (heap.HeapCount != roots.HeapCount) || (heap.GCIndex != roots.GCIndex)) {
+                    throw new Exception("heap " + h + " is from a different snapshot");
+                }
+                foreach (KeyValuePair<long, long[]> o in heap.Objects) {
+                    objects[o.Key] = o.Value;
+                }
+            }
+
+            // The list shows up as a chain of objects with one reference each.
+            int longestChain = 0;
+            Dictionary<long, int> chainLength = new Dictionary<long, int>();
+            foreach (long start in objects.Keys) {
+                List<long> chain = new List<long>();
+                long o = start;
+                int length = 0;
+                while (true) {
+                    int known;
+                    if (chainLength.TryGetValue(o, out known)) {
+                        length = known;
+                        break;
+                    }
+                    long[] refs;
+                    if (!objects.TryGetValue(o, out refs) || (refs.Length != 1) || (chain.Count > ListLength * 2)) {
+                        break;
+                    }
+                    chain.Add(o);
+                    o = refs[0];
+                }
+                for (int i = chain.Count - 1; i >= 0; i--) {
+                    length++;
+                    chainLength[chain[i]] = length;
+                }
+                longestChain = Math.Max(longestChain, length);
+            }
+
+            Console.WriteLine("{0} heaps, {1} objects, {2} roots, longest chain {3}",
+                roots.HeapCount, objects.Count, roots.Roots, longestChain);
+
+            if (longestChain < ListLength - 1) {
+                throw new Exception("the list isn't in the snapshot");
+            }
+        }
+        catch (Exception e) {
+            Console.WriteLine("Test for GC.WriteHeapSnapshot() failed: " + e.Message);
+            return 1;
+        }
+
+        GC.KeepAlive(list);
+        Console.WriteLine("Test for GC.WriteHeapSnapshot() passed!");
+        return 100;
+    }
+}
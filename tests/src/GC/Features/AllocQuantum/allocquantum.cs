@@ -0,0 +1,184 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System;
+using System.Threading;
+
+namespace AllocQuantumTest
+{
+    // Runs with COMPlus_GCAdaptiveAllocQuantum=1 (allocquantum.csproj) so each thread's
+    // alloc context gets its own quantum, and with it set to 0 (allocquantum_off.csproj)
+    // for comparison.
+    //
+    // First many threads allocate a single object between GCs. The space their contexts
+    // got counts as in use until the next GC retires them, so with adaptive quanta the
+    // heap grows less and less in each round as their quanta shrink, while it grows the
+    // same every time without.
+    //
+    // Then a few threads allocate as fast as they can while the rest only allocate now and
+    // then, so their quanta grow and shrink over the GCs. Every thread keeps a list of the
+    // objects it allocated and checks them at the end.
+    class AllocQuantum
+    {
+        class Node
+        {
+            public Node Next;
+            public int Value;
+            public byte[] Payload;
+        }
+
+        static int iterations = 200000;
+        static volatile bool failed = false;
+
+        static void Allocate(object param)
+        {
+            int id = (int)param;
+            bool hot = (id % 8) == 0;
+            Node head = null;
+            int count = 0;
+
+            for (int i = 0; i < iterations; i++)
+            {
+                if (!hot && ((i % 64) != 0))
+                {
+                    Thread.Yield();
+                    continue;
+                }
+
+                Node node = new Node();
+                node.Value = i;
+                node.Payload = new byte[(i % 100) + 1];
+                node.Payload[node.Payload.Length - 1] = (byte)i;
+                node.Next = head;
+                head = node;
+                count++;
+
+                // Drop most of the list now and then so there's garbage to collect.
+                if (count == 1000)
+                {
+                    head.Next = null;
+                    count = 1;
+                }
+            }
+
+            for (Node node = head; node != null; node = node.Next)
+            {
+                if ((node.Payload.Length != (node.Value % 100) + 1) || 
+                    (node.Payload[node.Payload.Length - 1] != (byte)node.Value))
+                {
+                    Console.WriteLine("Thread {0}: object {1} is corrupt", id, node.Value);
+                    failed = true;
+                    return;
+                }
+            }
+        }
+
+        const int IdleThreads = 128;
+        const int Rounds = 8;
+
+        static ManualResetEvent[] roundStarted = new ManualResetEvent[Rounds];
+        static int[] allocatedInRound = new int[Rounds];
+        static object[] idleObjects = new object[IdleThreads];
+
+        static void AllocateOncePerRound(object param)
+        {
+            int id = (int)param;
+            for (int round = 0; round < Rounds; round++)
+            {
+                roundStarted[round].WaitOne();
+                idleObjects[id] = new object();
+                Interlocked.Increment(ref allocatedInRound[round]);
+            }
+        }
+
+        // Returns whether the idle threads' quanta adapted as expected.
+        static bool CheckIdleQuanta(bool adaptive)
+        {
+            for (int round = 0; round < Rounds; round++)
+            {
+                roundStarted[round] = new ManualResetEvent(false);
+            }
+
+            Thread[] threads = new Thread[IdleThreads];
+            for (int i = 0; i < IdleThreads; i++)
+            {
+                threads[i] = new Thread(AllocateOncePerRound);
+                threads[i].Start(i);
+            }
+
+            long[] growth = new long[Rounds];
+            for (int round = 0; round < Rounds; round++)
+            {
+                // Retires every context, which is when their quanta are adapted.
+                GC.Collect(0, GCCollectionMode.Forced, true);
+
+                long before = GC.GetTotalMemory(false);
+                roundStarted[round].Set();
+                while (Volatile.Read(ref allocatedInRound[round]) < IdleThreads)
+                {
+                    Thread.Sleep(1);
+                }
+                growth[round] = GC.GetTotalMemory(false) - before;
+                Console.WriteLine("Round {0}: the heap grew by {1} bytes", round, growth[round]);
+            }
+
+            for (int i = 0; i < IdleThreads; i++)
+            {
+                threads[i].Join();
+            }
+
+            // The quanta halve at each GC down to a minimum, which they reach at least 4 times
+            // smaller than in the first round. Only half is expected to leave room for noise.
+            long first = growth[0];
+            long last = (growth[Rounds - 2] + growth[Rounds - 1]) / 2;
+            if (adaptive ? (last * 2 > first) : (last * 2 < first))
+            {
+                Console.WriteLine("Expected the growth to {0}: {1} bytes at first, {2} bytes in the end",
+                                  adaptive ? "shrink" : "stay", first, last);
+                return false;
+            }
+
+            return true;
+        }
+
+        static int Main(string[] args)
+        {
+            if (args.Length > 0)
+                iterations = Int32.Parse(args[0]);
+
+            bool adaptive = (Environment.GetEnvironmentVariable("COMPlus_GCAdaptiveAllocQuantum") == "1");
+            if (!CheckIdleQuanta(adaptive))
+            {
+                Console.WriteLine("Test Failed");
+                return 1;
+            }
+
+            int gen0Count = GC.CollectionCount(0);
+
+            int numThreads = 32;
+            Thread[] threads = new Thread[numThreads];
+            for (int i = 0; i < numThreads; i++)
+            {
+                threads[i] = new Thread(Allocate);
+                threads[i].Start(i);
+            }
+
+            for (int i = 0; i < numThreads; i++)
+            {
+                threads[i].Join();
+            }
+
+            Console.WriteLine("{0} gen0 GCs", GC.CollectionCount(0) - gen0Count);
+
+            if (failed)
+            {
+                Console.WriteLine("Test Failed");
+                return 1;
+            }
+
+            Console.WriteLine("Test Passed");
+            return 100;
+        }
+    }
+}
@@ -0,0 +1,122 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System;
+using System.Reflection;
+using System.Threading;
+
+namespace LohAllocBlocked
+{
+    // A background GC sweeps the large object heap before gen2, so large object allocations
+    // only wait for the LOH sweep instead of the whole sweep. We make gen2 big so sweeping it
+    // takes a while, keep allocating large objects during a background GC and then check in
+    // GC.GetGCInfo that large object allocations were blocked for less time than the sweep 
+    // took.
+    class LohAllocBlocked
+    {
+        const int Gen2Objects = 4000000;
+
+        static object[] gen2;
+        static volatile bool done = false;
+        static long maxLohAllocTicks = 0;
+
+        // GC.GetGCInfo and GCInfo aren't in the reference assemblies the tests build against.
+        static Array GetGCInfo(int count)
+        {
+            MethodInfo method = typeof(GC).GetTypeInfo().GetDeclaredMethod("GetGCInfo");
+            return (Array)method.Invoke(null, new object[] { count });
+        }
+
+        static object GetProperty(object obj, string name)
+        {
+            return obj.GetType().GetTypeInfo().GetDeclaredProperty(name).GetValue(obj);
+        }
+
+        static void AllocateLarge()
+        {
+            byte[][] kept = new byte[16][];
+            int i = 0;
+            while (!done)
+            {
+                long start = DateTime.UtcNow.Ticks;
+                kept[i++ % kept.Length] = new byte[100 * 1024];
+                long elapsed = DateTime.UtcNow.Ticks - start;
+                if (elapsed > maxLohAllocTicks)
+                {
+                    maxLohAllocTicks = elapsed;
+                }
+            }
+        }
+
+        static int Main()
+        {
+            // Every other object is garbage, so the sweep has free space to thread.
+            gen2 = new object[Gen2Objects];
+            for (int i = 0; i < Gen2Objects; i++)
+            {
+                gen2[i] = new byte[(i % 32) + 1];
+            }
+            GC.Collect();
+            for (int i = 0; i < Gen2Objects; i += 2)
+            {
+                gen2[i] = null;
+            }
+
+            Thread allocator = new Thread(AllocateLarge);
+            allocator.Start();
+
+            GC.Collect(2, GCCollectionMode.Forced, false);
+
+            // A BGC's record is written when it's done.
+            object bgcInfo = null;
+            for (int wait = 0; (wait < 600) && (bgcInfo == null); wait++)
+            {
+                Thread.Sleep(100);
+                foreach (object info in GetGCInfo(64))
+                {
+                    if ((bool)GetProperty(info, "Concurrent"))
+                    {
+                        bgcInfo = info;
+                        break;
+                    }
+                }
+            }
+
+            done = true;
+            allocator.Join();
+            GC.KeepAlive(gen2);
+
+            if (bgcInfo != null)
+            {
+                TimeSpan blocked = (TimeSpan)GetProperty(bgcInfo, "LohAllocationBlockedTime");
+                TimeSpan sweep = TimeSpan.Zero;
+                foreach (object heap in (Array)GetProperty(bgcInfo, "Heaps"))
+                {
+                    TimeSpan heapSweep = (TimeSpan)GetProperty(heap, "SweepTime");
+                    if (heapSweep > sweep)
+                    {
+                        sweep = heapSweep;
+                    }
+                }
+
+                Console.WriteLine("BGC#{0}: sweep took {1}ms, LOH allocations were blocked for {2}ms, longest LOH allocation took {3}ms",
+                    GetProperty(bgcInfo, "Index"), sweep.TotalMilliseconds, blocked.TotalMilliseconds, 
+                    TimeSpan.FromTicks(maxLohAllocTicks).TotalMilliseconds);
+
+                if (blocked >= sweep)
+                {
+                    Console.WriteLine("Test Failed: LOH allocations were blocked for the whole sweep");
+                    return 1;
+                }
+
+                Console.WriteLine("Test Passed");
+                return 100;
+            }
+
+            // With concurrent GC off there's nothing to measure.
+            Console.WriteLine("No background GC happened");
+            return 100;
+        }
+    }
+}
@@ -0,0 +1,121 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System;
+using System.Reflection;
+using System.Threading;
+
+namespace DecommitTest
+{
+    // Runs with COMPlus_GCDecommitTimeWindow=1000 (ms) (see decommitidle.csproj). 
+    // Bursts of allocation where a lot survives gen0 grow its budget, then bursts where
+    // nothing survives shrink it again, so the GC keeps more of the ephemeral segment 
+    // committed than it needs and gives it back a bit at a time. Idle GCs 
+    // (GCReason.Idle) may then give back the rest once the process stops allocating, 
+    // but they must stop once there's nothing left to give back, and what we kept alive
+    // must survive all of it.
+    class DecommitIdle
+    {
+        const int IdleReason = 12;
+        const int IdleWaitSeconds = 30;
+        // At most this many idle GCs while we wait - with nothing to give back 
+        // there'd be one every 5s.
+        const int MaxIdleGCs = 3;
+
+        static object[] survivors = new object[1024];
+
+        // GC.GetGCInfo and GCInfo aren't in the reference assemblies the tests build against.
+        static Array GetGCInfo(int count)
+        {
+            MethodInfo method = typeof(GC).GetTypeInfo().GetDeclaredMethod("GetGCInfo");
+            return (Array)method.Invoke(null, new object[] { count });
+        }
+
+        static object GetProperty(object obj, string name)
+        {
+            return obj.GetType().GetTypeInfo().GetDeclaredProperty(name).GetValue(obj);
+        }
+
+        static long LastGCIndex()
+        {
+            Array infos = GetGCInfo(1);
+            return (infos.Length == 0) ? 0 : (long)GetProperty(infos.GetValue(0), "Index");
+        }
+
+        static int IdleGCsSince(long after)
+        {
+            int count = 0;
+            foreach (object info in GetGCInfo(64))
+            {
+                if (((long)GetProperty(info, "Index") > after) && 
+                    (Convert.ToInt32(GetProperty(info, "Reason")) == IdleReason))
+                {
+                    count++;
+                }
+            }
+            return count;
+        }
+
+        // Keeps the last 64K objects alive so a lot survives each gen0 GC.
+        static void SurvivingBurst(int round)
+        {
+            object[] window = new object[64 * 1024];
+            for (int i = 0; i < 1024 * 1024; i++)
+            {
+                window[i % window.Length] = new byte[100];
+            }
+            survivors[round % survivors.Length] = window;
+        }
+
+        static void GarbageBurst()
+        {
+            for (int i = 0; i < 1024 * 1024; i++)
+            {
+                byte[] b = new byte[100];
+                b[0] = 1;
+            }
+        }
+
+        static int Main()
+        {
+            for (int round = 0; round < 4; round++)
+            {
+                SurvivingBurst(round);
+                survivors[round % survivors.Length] = null;
+                GarbageBurst();
+                GC.Collect(1);
+                Thread.Sleep(500);
+            }
+
+            byte[] kept = new byte[1000];
+            for (int i = 0; i < kept.Length; i++)
+            {
+                kept[i] = (byte)i;
+            }
+
+            long start = LastGCIndex();
+            Thread.Sleep(IdleWaitSeconds * 1000);
+            int idleGCs = IdleGCsSince(start);
+            Console.WriteLine("{0} idle GCs in {1}s", idleGCs, IdleWaitSeconds);
+
+            for (int i = 0; i < kept.Length; i++)
+            {
+                if (kept[i] != (byte)i)
+                {
+                    Console.WriteLine("Test Failed: object kept alive is corrupt");
+                    return 1;
+                }
+            }
+
+            if (idleGCs > MaxIdleGCs)
+            {
+                Console.WriteLine("Test Failed: idle GCs didn't stop");
+                return 1;
+            }
+
+            Console.WriteLine("Test Passed");
+            return 100;
+        }
+    }
+}
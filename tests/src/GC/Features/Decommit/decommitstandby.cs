@@ -0,0 +1,117 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System;
+using System.Reflection;
+using System.Threading;
+
+namespace DecommitTest
+{
+    // Runs with COMPlus_GCDecommitTimeWindow=1000 (ms) and COMPlus_GCRetainVM=1 (see 
+    // decommitstandby.csproj). We fill a few LOH segments and let them go, so a full GC
+    // puts them on the standby list. With the window set they stay committed, and once
+    // the process is idle the GC should do idle GCs (GCReason.Idle) to decommit them, one 
+    // per window, and then stop.
+    class DecommitStandby
+    {
+        const int IdleReason = 12;
+        const int ArraySize = 1024 * 1024;
+        const int ArrayCount = 384;
+        const int IdleWaitSeconds = 60;
+        // How long no idle GC has to happen for us to say they stopped.
+        const int QuietSeconds = 12;
+
+        // GC.GetGCInfo and GCInfo aren't in the reference assemblies the tests build against.
+        static Array GetGCInfo(int count)
+        {
+            MethodInfo method = typeof(GC).GetTypeInfo().GetDeclaredMethod("GetGCInfo");
+            return (Array)method.Invoke(null, new object[] { count });
+        }
+
+        static object GetProperty(object obj, string name)
+        {
+            return obj.GetType().GetTypeInfo().GetDeclaredProperty(name).GetValue(obj);
+        }
+
+        static long LastGCIndex()
+        {
+            Array infos = GetGCInfo(1);
+            return (infos.Length == 0) ? 0 : (long)GetProperty(infos.GetValue(0), "Index");
+        }
+
+        // Counts the idle GCs after GC# after.
+        static int IdleGCsSince(long after)
+        {
+            int count = 0;
+            foreach (object info in GetGCInfo(64))
+            {
+                if (((long)GetProperty(info, "Index") > after) && 
+                    (Convert.ToInt32(GetProperty(info, "Reason")) == IdleReason))
+                {
+                    count++;
+                }
+            }
+            return count;
+        }
+
+        static void FillLOH()
+        {
+            byte[][] arrays = new byte[ArrayCount][];
+            for (int i = 0; i < ArrayCount; i++)
+            {
+                arrays[i] = new byte[ArraySize];
+                arrays[i][0] = (byte)i;
+            }
+
+            for (int i = 0; i < ArrayCount; i++)
+            {
+                if (arrays[i][0] != (byte)i)
+                {
+                    throw new Exception("array " + i + " is corrupt");
+                }
+            }
+        }
+
+        static int Main()
+        {
+            FillLOH();
+            GC.Collect();
+
+            long start = LastGCIndex();
+            int idleGCs = 0;
+            int quiet = 0;
+            int seconds = 0;
+            for (; seconds < IdleWaitSeconds; seconds++)
+            {
+                Thread.Sleep(1000);
+
+                int now = IdleGCsSince(start);
+                quiet = (now == idleGCs) ? (quiet + 1) : 0;
+                idleGCs = now;
+
+                if ((idleGCs > 0) && (quiet >= QuietSeconds))
+                {
+                    break;
+                }
+            }
+
+            Console.WriteLine("{0} idle GCs in {1}s", idleGCs, seconds);
+
+            if (idleGCs == 0)
+            {
+                Console.WriteLine("Test Failed: no idle GC in {0}s", IdleWaitSeconds);
+                return 1;
+            }
+
+            if (quiet < QuietSeconds)
+            {
+                Console.WriteLine("Test Failed: idle GCs didn't stop");
+                return 1;
+            }
+
+            Console.WriteLine("Test Passed");
+            return 100;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System;
+using System.Reflection;
+using System.Threading;
+
+namespace DynamicHeapCountTest
+{
+    // Runs with server GC and COMPlus_GCDynamicHeapCount=1 (see dynamicheapcount.csproj).
+    // A few threads allocate for a while, then the process goes idle. With more than one
+    // active heap left the GC should do an idle gen1 GC (GCReason.Idle) on the finalizer 
+    // thread once no GC happened for a few seconds, and the objects we kept must survive it.
+    class DynamicHeapCount
+    {
+        const int IdleReason = 12;
+        const int IdleWaitSeconds = 20;
+
+        static byte[][] survivors = new byte[64][];
+
+        // GC.GetGCInfo and GCInfo aren't in the reference assemblies the tests build against.
+        static Array GetGCInfo(int count)
+        {
+            MethodInfo method = typeof(GC).GetTypeInfo().GetDeclaredMethod("GetGCInfo");
+            return (Array)method.Invoke(null, new object[] { count });
+        }
+
+        static object GetProperty(object obj, string name)
+        {
+            return obj.GetType().GetTypeInfo().GetDeclaredProperty(name).GetValue(obj);
+        }
+
+        static void Allocate(object param)
+        {
+            int id = (int)param;
+            byte[] last = null;
+            for (int i = 0; i < 20000; i++)
+            {
+                last = new byte[(i % 1000) + 1];
+                last[0] = (byte)id;
+            }
+            survivors[id] = last;
+        }
+
+        static int Main()
+        {
+            if (Environment.ProcessorCount == 1)
+            {
+                Console.WriteLine("Only one heap, nothing to test");
+                return 100;
+            }
+
+            Thread[] threads = new Thread[Environment.ProcessorCount];
+            for (int i = 0; i < threads.Length; i++)
+            {
+                threads[i] = new Thread(Allocate);
+                threads[i].Start(i % survivors.Length);
+            }
+            for (int i = 0; i < threads.Length; i++)
+            {
+                threads[i].Join();
+            }
+
+            bool idleGC = false;
+            for (int i = 0; (i < IdleWaitSeconds) && !idleGC; i++)
+            {
+                Thread.Sleep(1000);
+
+                // The idle GC is the most recent one unless a GC happened after it.
+                Array infos = GetGCInfo(1);
+                if (infos.Length == 1)
+                {
+                    object info = infos.GetValue(0);
+                    if (Convert.ToInt32(GetProperty(info, "Reason")) == IdleReason)
+                    {
+                        Console.WriteLine("GC#{0} was an idle gen{1} GC after {2}s", 
+                            GetProperty(info, "Index"), GetProperty(info, "Generation"), i + 1);
+                        idleGC = ((int)GetProperty(info, "Generation") == 1);
+                    }
+                }
+            }
+
+            for (int i = 0; i < Math.Min(threads.Length, survivors.Length); i++)
+            {
+                if ((survivors[i] == null) || (survivors[i][0] != (byte)i))
+                {
+                    Console.WriteLine("Object allocated by thread {0} is corrupt", i);
+                    return 1;
+                }
+            }
+
+            if (!idleGC)
+            {
+                Console.WriteLine("Test Failed: no idle GC in {0}s", IdleWaitSeconds);
+                return 1;
+            }
+
+            Console.WriteLine("Test Passed");
+            return 100;
+        }
+    }
+}
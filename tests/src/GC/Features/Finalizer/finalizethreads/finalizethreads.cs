@@ -0,0 +1,124 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+// Tests that with more than one finalizer thread every finalizer runs and
+// critical finalizers still run after the non critical ones.
+
+using System;
+using System.Collections.Generic;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+public class Normal
+{
+    public static int Finalized = 0;
+    public static Dictionary<int, int> Threads = new Dictionary<int, int>();
+
+    ~Normal()
+    {
+        // Give the other finalizer threads a chance to pick up some of the work.
+        for (int i = 0; i < 1000; i++)
+        {
+            Volatile.Read(ref Finalized);
+        }
+
+        lock (Threads)
+        {
+            Threads[Environment.CurrentManagedThreadId] = 1;
+        }
+        Interlocked.Increment(ref Finalized);
+    }
+}
+
+public class Critical : SafeHandle
+{
+    public static int Released = 0;
+    public static int Early = 0;
+    public static int Expected = 0;
+
+    public Critical() : base(IntPtr.Zero, true)
+    {
+        SetHandle(new IntPtr(1));
+    }
+
+    public override bool IsInvalid
+    {
+        get { return handle == IntPtr.Zero; }
+    }
+
+    protected override bool ReleaseHandle()
+    {
+        if (Volatile.Read(ref Normal.Finalized) != Expected)
+        {
+            Interlocked.Increment(ref Early);
+        }
+        Interlocked.Increment(ref Released);
+        return true;
+    }
+}
+
+public class Test
+{
+    const int NormalCount = 20000;
+    const int CriticalCount = 100;
+
+    [MethodImpl(MethodImplOptions.NoInlining)]
+    static void Allocate()
+    {
+        // Keep everything alive until the end so the same GC finds them all dead.
+        object[] normal = new object[NormalCount];
+        for (int i = 0; i < NormalCount; i++)
+        {
+            normal[i] = new Normal();
+        }
+
+        object[] critical = new object[CriticalCount];
+        for (int i = 0; i < CriticalCount; i++)
+        {
+            critical[i] = new Critical();
+        }
+
+        GC.KeepAlive(normal);
+        GC.KeepAlive(critical);
+    }
+
+    public static int Main()
+    {
+        for (int round = 1; round <= 3; round++)
+        {
+            Critical.Expected = NormalCount * round;
+            Allocate();
+
+            GC.Collect();
+            GC.WaitForPendingFinalizers();
+            GC.Collect();
+            GC.WaitForPendingFinalizers();
+
+            Console.WriteLine("Round {0}: {1} finalized, {2} released, {3} released early, {4} threads",
+                round, Normal.Finalized, Critical.Released, Critical.Early, Normal.Threads.Count);
+
+            if (Normal.Finalized != NormalCount * round)
+            {
+                Console.WriteLine("Test Failed: expected {0} non critical finalizers to run", NormalCount * round);
+                return 1;
+            }
+
+            if (Critical.Released != CriticalCount * round)
+            {
+                Console.WriteLine("Test Failed: expected {0} critical finalizers to run", CriticalCount * round);
+                return 1;
+            }
+
+            if (Critical.Early != 0)
+            {
+                Console.WriteLine("Test Failed: critical finalizers ran before non critical ones");
+                return 1;
+            }
+        }
+
+        Console.WriteLine("Test Passed");
+        return 100;
+    }
+}
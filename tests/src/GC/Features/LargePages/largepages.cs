@@ -0,0 +1,69 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System;
+using System.Collections.Generic;
+
+namespace LargePagesTest
+{
+    // Runs with COMPlus_GCLargePages=1 (see largepages.csproj), so segments are reserved
+    // aligned to large pages and committed and decommitted in whole large pages. We grow
+    // and shrink both the small and the large object heap a few times, which commits and
+    // decommits segment space, and check that everything we keep is intact after every
+    // compacting GC. Where large pages aren't available the GC runs as usual.
+    class LargePages
+    {
+        const int Rounds = 5;
+        const int ObjectsPerRound = 200000;
+
+        static byte[] Allocate(int i)
+        {
+            // Every 100th object goes on the LOH.
+            byte[] obj = new byte[((i % 100) == 0) ? (100 * 1024) : ((i % 500) + 2)];
+            obj[0] = (byte)i;
+            obj[obj.Length - 1] = (byte)(i >> 8);
+            return obj;
+        }
+
+        static int Main()
+        {
+            for (int round = 0; round < Rounds; round++)
+            {
+                List<byte[]> objects = new List<byte[]>();
+                for (int i = 0; i < ObjectsPerRound; i++)
+                {
+                    objects.Add(Allocate(i));
+                }
+
+                // Drop every other object so compacting leaves free space to decommit.
+                List<byte[]> kept = new List<byte[]>();
+                for (int i = 0; i < objects.Count; i += 2)
+                {
+                    kept.Add(objects[i]);
+                }
+                objects = null;
+
+                GC.Collect(2, GCCollectionMode.Forced, true);
+
+                for (int i = 0; i < kept.Count; i++)
+                {
+                    byte[] obj = kept[i];
+                    int index = i * 2;
+                    if ((obj[0] != (byte)index) || (obj[obj.Length - 1] != (byte)(index >> 8)))
+                    {
+                        Console.WriteLine("Round {0}: object {1} is corrupt", round, index);
+                        return 1;
+                    }
+                }
+
+                Console.WriteLine("Round {0}: {1} bytes in use", round, GC.GetTotalMemory(false));
+                kept = null;
+            }
+
+            GC.Collect();
+            Console.WriteLine("Test Passed");
+            return 100;
+        }
+    }
+}
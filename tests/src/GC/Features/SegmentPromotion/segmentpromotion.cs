@@ -0,0 +1,109 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+using System;
+using System.Collections.Generic;
+
+namespace SegmentPromotionTest
+{
+    // Runs with COMPlus_GCSegmentPromotion=1 and 16MB segments (see segmentpromotion.csproj).
+    // We keep a sliding window of linked lists alive, a lot more than fits on one segment,
+    // so ephemeral GCs keep filling the ephemeral segment. A full ephemeral segment is then
+    // promoted to gen2 in place and replaced by a new one, and gen2 GCs free the segments 
+    // whose lists we dropped. Every list is checked when it's dropped, and the ones we 
+    // still have at the end must be in gen2 after two gen1 GCs.
+    class SegmentPromotion
+    {
+        class Node
+        {
+            public Node Next;
+            public int List;
+            public int Index;
+            public byte[] Payload;
+        }
+
+        const int Lists = 400;
+        const int ListsKept = 100;
+        const int NodesPerList = 2000;
+
+        static Node Build(int list)
+        {
+            Node head = null;
+            for (int i = 0; i < NodesPerList; i++)
+            {
+                Node node = new Node();
+                node.List = list;
+                node.Index = i;
+                node.Payload = new byte[(i % 64) + 1];
+                node.Payload[node.Payload.Length - 1] = (byte)list;
+                node.Next = head;
+                head = node;
+
+                // Garbage between the nodes.
+                new byte[(i % 200) + 1].GetHashCode();
+            }
+            return head;
+        }
+
+        static bool Check(Node head, int list)
+        {
+            int expected = NodesPerList - 1;
+            for (Node node = head; node != null; node = node.Next, expected--)
+            {
+                if ((node.List != list) || (node.Index != expected) ||
+                    (node.Payload.Length != (expected % 64) + 1) ||
+                    (node.Payload[node.Payload.Length - 1] != (byte)list))
+                {
+                    Console.WriteLine("List {0} is corrupt at node {1}", list, expected);
+                    return false;
+                }
+            }
+            return (expected == -1);
+        }
+
+        static int Main()
+        {
+            Queue<Node> kept = new Queue<Node>();
+            int gen2Count = GC.CollectionCount(2);
+
+            for (int list = 0; list < Lists; list++)
+            {
+                kept.Enqueue(Build(list));
+                if (kept.Count > ListsKept)
+                {
+                    Node oldest = kept.Dequeue();
+                    int oldestList = list - ListsKept;
+                    if (!Check(oldest, oldestList))
+                    {
+                        return 1;
+                    }
+                }
+            }
+
+            // Two gen1 GCs get whatever is left in the ephemeral generations to gen2.
+            GC.Collect(1);
+            GC.Collect(1);
+
+            int keptList = Lists - ListsKept;
+            foreach (Node head in kept)
+            {
+                if (!Check(head, keptList))
+                {
+                    return 1;
+                }
+
+                if (GC.GetGeneration(head) != GC.MaxGeneration)
+                {
+                    Console.WriteLine("List {0} is still in gen{1}", keptList, GC.GetGeneration(head));
+                    return 1;
+                }
+                keptList++;
+            }
+
+            Console.WriteLine("{0} gen2 GCs", GC.CollectionCount(2) - gen2Count);
+            Console.WriteLine("Test Passed");
+            return 100;
+        }
+    }
+}